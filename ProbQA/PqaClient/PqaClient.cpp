@@ -52,6 +52,38 @@ std::string gKbsDir;
 
 } // anonymous namespace
 
+// The answer of a user who thinks of target |guess| to question |iQuestion| in the dichotomy workload. The targets and
+//   the questions are both the integers in a range, and the answers are: much less, less, equal, greater, much greater.
+TPqaId DichotomyAnswer(const TPqaId guess, const TPqaId iQuestion) {
+  if (guess < iQuestion - 32) {
+    return 0;
+  }
+  if (iQuestion - 32 <= guess && guess < iQuestion) {
+    return 1;
+  }
+  if (iQuestion == guess) {
+    return 2;
+  }
+  if (iQuestion < guess && guess <= iQuestion + 32) {
+    return 3;
+  }
+  if (guess > iQuestion + 32) {
+    return 4;
+  }
+  return cInvalidPqaId;
+}
+
+const char* PrecisionName(const TPqaPrecisionType precType) {
+  switch (precType) {
+  case TPqaPrecisionType::Float:
+    return "float";
+  case TPqaPrecisionType::Double:
+    return "double";
+  default:
+    return "other";
+  }
+}
+
 int LearnBinarySearch(const char* const initKbFp) {
   FILE *fpProgress = fopen("progress.txt", "wt");
 
@@ -137,23 +169,8 @@ int LearnBinarySearch(const char* const initKbFp) {
         fprintf(stderr, "Failed to query a next question.\n");
         return int(SRExitCode::UnspecifiedError);
       }
-      TPqaId iAnswer;
-      if (guess < iQuestion - 32) {
-        iAnswer = 0;
-      }
-      else if (iQuestion - 32 <= guess && guess < iQuestion) {
-        iAnswer = 1;
-      }
-      else if (iQuestion == guess) {
-        iAnswer = 2;
-      }
-      else if (iQuestion < guess && guess <= iQuestion + 32) {
-        iAnswer = 3;
-      }
-      else if (guess > iQuestion + 32) {
-        iAnswer = 4;
-      }
-      else {
+      const TPqaId iAnswer = DichotomyAnswer(guess, iQuestion);
+      if (iAnswer == cInvalidPqaId) {
         fprintf(stderr, "Answering logic error.\n");
         return int(SRExitCode::UnspecifiedError);
       }
@@ -212,7 +229,205 @@ int LearnBinarySearch(const char* const initKbFp) {
   return 0;
 }
 
-int __cdecl main() {
+// Microbenchmark of the hot paths touching the whole KB: NextQuestion() and RecordAnswer() . Trains the engine on a
+//   random workload first, so that the KB is not uniform, then measures the throughput of quizzes of fixed length.
+int BenchmarkKBAccess(const TPqaId nAnswers, const TPqaId nQuestions, const TPqaId nTargets, const bool tiledA,
+  const TPqaPrecisionType precType = TPqaPrecisionType::Double)
+{
+  PqaError err;
+  EngineDefinition ed;
+  ed._dims._nAnswers = nAnswers;
+  ed._dims._nQuestions = nQuestions;
+  ed._dims._nTargets = nTargets;
+  ed._initAmount = 0.1;
+  ed._prec._type = precType;
+  ed._tiledA = tiledA;
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  if (!err.IsOk() || pEngine == nullptr) {
+    fprintf(stderr, "Failed to instantiate a ProbQA engine: %s\n", err.ToString(true).ToStd().c_str());
+    return int(SRExitCode::UnspecifiedError);
+  }
+
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  constexpr int64_t cnWarmupQuizzes = 256;
+  constexpr int64_t cnMeasuredQuizzes = 1024;
+  constexpr int64_t cQuizLen = 16;
+
+  uint64_t pcStart = 0;
+  for (int64_t i = 0; i < cnWarmupQuizzes + cnMeasuredQuizzes; i++) {
+    if (i == cnWarmupQuizzes) {
+      pcStart = GetPerfCnt();
+    }
+    const TPqaId iQuiz = pEngine->StartQuiz(err);
+    if (!err.IsOk() || iQuiz == cInvalidPqaId) {
+      fprintf(stderr, "Failed to create a quiz.\n");
+      return int(SRExitCode::UnspecifiedError);
+    }
+    for (int64_t j = 0; j < cQuizLen; j++) {
+      const TPqaId iQuestion = pEngine->NextQuestion(err, iQuiz);
+      if (!err.IsOk() || iQuestion == cInvalidPqaId) {
+        fprintf(stderr, "Failed to query a next question.\n");
+        return int(SRExitCode::UnspecifiedError);
+      }
+      err = pEngine->RecordAnswer(iQuiz, ea.Generate<TPqaId>(nAnswers));
+      if (!err.IsOk()) {
+        fprintf(stderr, "Failed to record answer: %s\n", err.ToString(true).ToStd().c_str());
+        return int(SRExitCode::UnspecifiedError);
+      }
+    }
+    if (i < cnWarmupQuizzes) {
+      err = pEngine->RecordQuizTarget(iQuiz, ea.Generate<TPqaId>(nTargets));
+      if (!err.IsOk()) {
+        fprintf(stderr, "Failed to record quiz target: %s\n", err.ToString(true).ToStd().c_str());
+        return int(SRExitCode::UnspecifiedError);
+      }
+    }
+    err = pEngine->ReleaseQuiz(iQuiz);
+    if (!err.IsOk()) {
+      fprintf(stderr, "Failed to release a quiz: %s\n", err.ToString(true).ToStd().c_str());
+      return int(SRExitCode::UnspecifiedError);
+    }
+  }
+  const double elapsedSec = double(GetPerfCnt() - pcStart) / gPerfCntFreq;
+  EngineStats stats;
+  err = pEngine->GetStats(stats);
+  if (!err.IsOk()) {
+    fprintf(stderr, "Failed to get engine stats: %s\n", err.ToString(true).ToStd().c_str());
+    return int(SRExitCode::UnspecifiedError);
+  }
+  printf("K=%" PRId64 ", N=%" PRId64 ", M=%" PRId64 ", %s A, %s, KB %" PRIu64 " bytes: %.3lf sec, %.1lf questions/sec"
+    "\n", int64_t(nAnswers), int64_t(nQuestions), int64_t(nTargets), (tiledA ? "tiled" : "row-major"),
+    PrecisionName(precType), stats._kbBytes, elapsedSec, cnMeasuredQuizzes * cQuizLen / elapsedSec);
+  return 0;
+}
+
+namespace {
+
+// The outcome of the dichotomy workload on one engine.
+struct DichotomyOutcome {
+  int64_t _nCorrect = 0;
+  int64_t _sumQuizLens = 0;
+  double _totCertainty = 0;
+  uint64_t _perfCnt = 0; // performance counter ticks spent in the engine calls
+  std::vector<TPqaId> _asked; // the questions asked in the current quiz
+};
+
+// Runs a quiz for |guess| and records the outcome, if measured. Returns false on an engine error.
+bool RunDichotomyQuiz(IPqaEngine &engine, const TPqaId guess, const bool measure, DichotomyOutcome &outcome) {
+  constexpr int64_t cMaxQuizLen = 100;
+  PqaError err;
+  const uint64_t pcStart = GetPerfCnt();
+  outcome._asked.clear();
+  const TPqaId iQuiz = engine.StartQuiz(err);
+  if (!err.IsOk() || iQuiz == cInvalidPqaId) {
+    fprintf(stderr, "Failed to create a quiz.\n");
+    return false;
+  }
+  for (int64_t j = 0; j < cMaxQuizLen; j++) {
+    const TPqaId iQuestion = engine.NextQuestion(err, iQuiz);
+    if (!err.IsOk() || iQuestion == cInvalidPqaId) {
+      fprintf(stderr, "Failed to query a next question.\n");
+      return false;
+    }
+    outcome._asked.push_back(iQuestion);
+    err = engine.RecordAnswer(iQuiz, DichotomyAnswer(guess, iQuestion));
+    if (!err.IsOk()) {
+      fprintf(stderr, "Failed to record answer: %s\n", err.ToString(true).ToStd().c_str());
+      return false;
+    }
+    RatedTarget rt;
+    const TPqaId nListed = engine.ListTopTargets(err, iQuiz, 1, &rt);
+    if (!err.IsOk() || nListed != 1) {
+      fprintf(stderr, "Failed to list top targets.\n");
+      return false;
+    }
+    if (rt._iTarget == guess) {
+      if (measure) {
+        outcome._nCorrect++;
+        outcome._sumQuizLens += j + 1;
+        outcome._totCertainty += rt._prob * 100;
+      }
+      break;
+    }
+  }
+  err = engine.RecordQuizTarget(iQuiz, guess);
+  if (!err.IsOk()) {
+    fprintf(stderr, "Failed to record quiz target: %s\n", err.ToString(true).ToStd().c_str());
+    return false;
+  }
+  err = engine.ReleaseQuiz(iQuiz);
+  if (!err.IsOk()) {
+    fprintf(stderr, "Failed to release a quiz: %s\n", err.ToString(true).ToStd().c_str());
+    return false;
+  }
+  if (measure) {
+    outcome._perfCnt += GetPerfCnt() - pcStart;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+// Accuracy and speed comparison of the float engine against the double engine on the dichotomy workload. Both engines
+//   are trained and then measured on the same sequence of targets. Besides the precision of guessing the target, it
+//   reports in how many measured quizzes the two engines asked exactly the same questions.
+int CompareDichotomyPrecision(const int64_t nTrainings, const int64_t nMeasured) {
+  constexpr TPqaPrecisionType cPrecTypes[] = { TPqaPrecisionType::Double, TPqaPrecisionType::Float };
+  constexpr size_t cnEngines = sizeof(cPrecTypes) / sizeof(cPrecTypes[0]);
+  std::unique_ptr<IPqaEngine> engines[cnEngines];
+  for (size_t i = 0; i < cnEngines; i++) {
+    PqaError err;
+    EngineDefinition ed;
+    ed._dims._nAnswers = 5;
+    ed._dims._nQuestions = 1000;
+    ed._dims._nTargets = 1000;
+    ed._initAmount = 0.1;
+    ed._prec._type = cPrecTypes[i];
+    engines[i].reset(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+    if (!err.IsOk() || engines[i] == nullptr) {
+      fprintf(stderr, "Failed to instantiate a ProbQA engine: %s\n", err.ToString(true).ToStd().c_str());
+      return int(SRExitCode::UnspecifiedError);
+    }
+  }
+
+  // A fixed seed, so that the comparison is reproducible.
+  SRFastRandom fr(_mm256_set_epi64x(0x3c6ef372fe94f82bLL, 0x6a09e667f3bcc908LL, 0x510e527fade682d1LL,
+    0x1f83d9abfb41bd6bLL), _mm256_set_epi64x(0x5be0cd19137e2179LL, 0x9b05688c2b3e6c1fLL, 0xbb67ae8584caa73bLL,
+    0xa54ff53a5f1d36f1LL));
+  SREntropyAdapter ea(fr);
+  DichotomyOutcome outcomes[cnEngines];
+  int64_t nSameQuestions = 0;
+  for (int64_t i = 0; i < nTrainings + nMeasured; i++) {
+    const bool measure = (i >= nTrainings);
+    const TPqaId guess = ea.Generate<TPqaId>(1000);
+    for (size_t k = 0; k < cnEngines; k++) {
+      if (!RunDichotomyQuiz(*engines[k], guess, measure, outcomes[k])) {
+        return int(SRExitCode::UnspecifiedError);
+      }
+    }
+    if (measure && outcomes[0]._asked == outcomes[1]._asked) {
+      nSameQuestions++;
+    }
+  }
+
+  for (size_t k = 0; k < cnEngines; k++) {
+    EngineStats stats;
+    const PqaError err = engines[k]->GetStats(stats);
+    if (!err.IsOk()) {
+      fprintf(stderr, "Failed to get engine stats: %s\n", err.ToString(true).ToStd().c_str());
+      return int(SRExitCode::UnspecifiedError);
+    }
+    const DichotomyOutcome &oc = outcomes[k];
+    printf("%s: KB %" PRIu64 " bytes, precision %.2lf%%, avg. quiz length %.3lf, avg. certainty %.2lf%%, %.3lf sec\n",
+      PrecisionName(cPrecTypes[k]), stats._kbBytes, oc._nCorrect * 100.0 / nMeasured,
+      double(oc._sumQuizLens) / oc._nCorrect, oc._totCertainty / oc._nCorrect, double(oc._perfCnt) / gPerfCntFreq);
+  }
+  printf("Same questions asked in %.2lf%% of the measured quizzes.\n", nSameQuestions * 100.0 / nMeasured);
+  return 0;
+}
+
+int __cdecl main(int argc, char* argv[]) {
   const char* baseName = "Logs\\PqaClient";
   if (!CreateDirectoryA("Logs", nullptr)) {
     uint32_t le = GetLastError();
@@ -235,6 +450,36 @@ int __cdecl main() {
     }
   }
 
+  if (argc >= 2 && std::strcmp(argv[1], "--bench-kb") == 0) {
+    // To measure the throughput of KB access: --bench-kb [--tiled] [--float]
+    bool tiledA = false;
+    TPqaPrecisionType precType = TPqaPrecisionType::Double;
+    for (int i = 2; i < argc; i++) {
+      if (std::strcmp(argv[i], "--tiled") == 0) {
+        tiledA = true;
+      } else if (std::strcmp(argv[i], "--float") == 0) {
+        precType = TPqaPrecisionType::Float;
+      } else {
+        fprintf(stderr, "Unknown option of --bench-kb: %s\n", argv[i]);
+        return int(SRExitCode::UnspecifiedError);
+      }
+    }
+    return BenchmarkKBAccess(5, 1000, 1000, tiledA, precType);
+  }
+  if (argc >= 2 && std::strcmp(argv[1], "--compare-precision") == 0) {
+    // To compare the float engine against the double one: --compare-precision [nTrainings nMeasured]
+    int64_t nTrainings = 100 * 1000;
+    int64_t nMeasured = 10 * 1000;
+    if (argc == 4) {
+      nTrainings = std::strtoll(argv[2], nullptr, 10);
+      nMeasured = std::strtoll(argv[3], nullptr, 10);
+    }
+    if (argc == 3 || argc > 4 || nTrainings < 0 || nMeasured <= 0) {
+      fprintf(stderr, "Usage: --compare-precision [nTrainings nMeasured]\n");
+      return int(SRExitCode::UnspecifiedError);
+    }
+    return CompareDichotomyPrecision(nTrainings, nMeasured);
+  }
   //return LearnBinarySearch("KBs\\initial.kb"); // To load a saved KB
   return LearnBinarySearch(nullptr); // To create a KB from scratch by training
 }
@@ -18,8 +18,12 @@ SRThreadCount BaseCpuEngine::CalcMemOpThreads() {
 
 BaseCpuEngine::BaseCpuEngine(const EngineDefinition& engDef, const size_t workerStackSize)
   : _dims(engDef._dims), _precDef(engDef._prec), _maintSwitch(MaintenanceSwitch::Mode::Regular),
-  _pLogger(SRDefaultLogger::Get()), _memPool(1 + (engDef._memPoolMaxBytes >> SRSimd::_cLogNBytes)),
-  _tpWorkers(std::thread::hardware_concurrency(), workerStackSize), _nMemOpThreads(CalcMemOpThreads()),
+  _pLogger(SRDefaultLogger::Get()),
+  _memPool(1 + (engDef._memPoolMaxBytes >> SRSimd::_cLogNBytes), engDef._largePages),
+  _tpWorkers(std::thread::hardware_concurrency(), workerStackSize, engDef._numaAware),
+  _nMemOpThreads(CalcMemOpThreads()), _isa(std::min(SRCpuInfo::GetInstructionSet(), engDef._maxInstructionSet)),
+  _pruneEps(std::min(engDef._pruneTargetsEps, 1.0)),
+  _pruneFullPassPeriod(std::max<TPqaId>(1, engDef._pruneFullPassPeriod)),
   _nLooseWorkers(std::max<SRThreadCount>(1, std::thread::hardware_concurrency()-1))
 {
 }
@@ -88,4 +92,59 @@ TPqaId BaseCpuEngine::FindNearestQuestion(const TPqaId iMiddle, const CEBaseQuiz
   return cInvalidPqaId;
 }
 
+size_t BaseCpuEngine::FillOldIds(const TPqaId nOldIds, const GapTracker<TPqaId> &gaps, TPqaId *pOldIds) {
+  size_t iFirstGap = SRCast::ToSizeT(nOldIds);
+  TPqaId iNew = 0;
+  for (TPqaId iOld = 0; iOld < nOldIds; iOld++) {
+    if (gaps.IsGap(iOld)) {
+      iFirstGap = std::min(iFirstGap, SRCast::ToSizeT(iOld));
+      continue;
+    }
+    pOldIds[iNew] = iOld;
+    iNew++;
+  }
+  return iFirstGap;
+}
+
+void BaseCpuEngine::PackGaps(const TPqaId nItems, const GapTracker<TPqaId> &gt, std::vector<uint64_t> &words) {
+  const size_t nWords = SRCast::ToSizeT((nItems + 63) >> 6);
+  words.resize(nWords);
+  for (size_t iWord = 0; iWord < nWords; iWord++) {
+    uint64_t word = gt.GetPacked<uint64_t>(TPqaId(iWord));
+    // The tracker marks the items beyond the size as gaps.
+    const TPqaId nInWord = nItems - (TPqaId(iWord) << 6);
+    if (nInWord < 64) {
+      word &= (uint64_t(1) << nInWord) - 1;
+    }
+    words[iWord] = word;
+  }
+}
+
+bool BaseCpuEngine::ReadGaps(const KBFileInfo &kbFi, const KBFileSectionKind kind, const TPqaId nItems,
+  GapTracker<TPqaId> &gt)
+{
+  const KBFileSection *pSect = kbFi._pDir->Find(kind);
+  if (pSect == nullptr) {
+    return true; // no gaps
+  }
+  const size_t nWords = SRCast::ToSizeT((nItems + 63) >> 6);
+  if (pSect->_nBytes != nWords * sizeof(uint64_t)) {
+    return false;
+  }
+  SRSmartMPP<uint64_t> smppWords(_memPool, nWords);
+  if (!kbFi._file.ReadAt(smppWords.Get(), nWords * sizeof(uint64_t), pSect->_offset)) {
+    return false;
+  }
+  for (size_t iWord = 0; iWord < nWords; iWord++) {
+    unsigned long iSetBit;
+    for (uint64_t word = smppWords.Get()[iWord]; _BitScanForward64(&iSetBit, word); word &= word - 1) {
+      const TPqaId at = (TPqaId(iWord) << 6) + iSetBit;
+      if (at < nItems) {
+        gt.Release(at);
+      }
+    }
+  }
+  return true;
+}
+
 } // namespace ProbQA
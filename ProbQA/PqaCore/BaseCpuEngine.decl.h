@@ -12,6 +12,7 @@
 #include "../PqaCore/GapTracker.h"
 #include "../PqaCore/MaintenanceSwitch.h"
 #include "../PqaCore/Interface/PqaCommon.h"
+#include "../PqaCore/KBFileInfo.h"
 
 namespace ProbQA {
 
@@ -33,7 +34,15 @@ protected: // variables
   const PrecisionDefinition _precDef;
   EngineDimensions _dims; // Guarded by _rws in maintenance mode. Read-only in regular mode.
   const SRPlat::SRThreadCount _nMemOpThreads;
+  // The instruction set of the hot kernels, selected at engine creation.
+  const SRPlat::SRInstructionSet _isa;
+  //// The pruning of the targets in quizzes, see EngineDefinition .
+  const double _pruneEps;
+  const TPqaId _pruneFullPassPeriod;
   std::atomic<uint64_t> _nQuestionsAsked = 0;
+  //// The durations of the last successful SaveKB() in microseconds: in total, and of holding the KB lock.
+  std::atomic<uint64_t> _lastSaveMicros = 0;
+  std::atomic<uint64_t> _lastSaveLockMicros = 0;
 
   //// Don't violate the order of obtaining these locks, so to avoid a deadlock.
   //// Actually the locks form directed acyclic graph indicating which locks must be obtained one after another.
@@ -57,6 +66,17 @@ protected: // methods
 
   TPqaId FindNearestQuestion(const TPqaId iMiddle, const CEBaseQuiz &quiz);
 
+  // Fill |pOldIds| with the ids that aren't gaps, in the ascending order. Returns the first gap, or |nOldIds| if none.
+  static size_t FillOldIds(const TPqaId nOldIds, const GapTracker<TPqaId> &gaps, TPqaId *pOldIds);
+  // The memory pool can't allocate 0 items, so the maps of CompactionResult have at least 1 item.
+  static size_t CompactionMapItems(const TPqaId nIds) { return std::max<size_t>(1, SRPlat::SRCast::ToSizeT(nIds)); }
+
+  // Pack the gaps among the first |nItems| items into the words of a bitmap section of a KB file.
+  static void PackGaps(const TPqaId nItems, const GapTracker<TPqaId> &gt, std::vector<uint64_t> &words);
+  // Release in |gt| the gaps of the bitmap section |kind| of a sectioned KB file, if the file has it. Returns |false| if
+  //   the section can't be read or has a wrong size.
+  bool ReadGaps(const KBFileInfo &kbFi, const KBFileSectionKind kind, const TPqaId nItems, GapTracker<TPqaId> &gt);
+
 public: // Internal interface methods
   SRPlat::ISRLogger *GetLogger() const { return _pLogger.load(std::memory_order_relaxed); }
   TMemPool& GetMemPool() { return _memPool; }
@@ -68,6 +88,9 @@ public: // Internal interface methods
   const GapTracker<TPqaId>& GetTargetGaps() const { return _targetGaps; }
 
   const SRPlat::SRThreadCount GetNLooseWorkers() const { return _nLooseWorkers; }
+  SRPlat::SRInstructionSet GetInstructionSet() const { return _isa; }
+  double GetPruneEps() const { return _pruneEps; }
+  TPqaId GetPruneFullPassPeriod() const { return _pruneFullPassPeriod; }
 };
 
 } // namespace ProbQA
@@ -0,0 +1,48 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CECompactKBSubtaskQuestions.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+// The blocks of different questions don't overlap, and each subtask moves its stripe of vectors in all the rows in the
+//   ascending order of the new ids, so the source of a move is never overwritten before it's read.
+template<typename taNumber> void CECompactKBSubtaskQuestions<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  CEKBArena<taNumber> &PTR_RESTRICT kb = task.ModKB();
+  const TPqaId *PTR_RESTRICT pOldQuestions = task.GetOldQuestions();
+  const size_t nQuestions = task.GetNQuestions();
+  const size_t nAnswers = kb.GetNAnswers();
+  const size_t iFirst = SRCast::ToSizeT(_iFirst);
+  const size_t iLimit = SRCast::ToSizeT(_iLimit);
+  const size_t iFirstNum = iFirst << CEKBArena<taNumber>::_cLogNumsPerVect;
+
+  for (size_t i = task.GetFirstMovedQuestion(); i < nQuestions; i++) {
+    const size_t iOld = SRCast::ToSizeT(pOldQuestions[i]);
+    assert(i < iOld);
+    for (size_t k = 0; k < nAnswers; k++) {
+      for (size_t iVect = iFirst; iVect < iLimit;) {
+        size_t iSrcLim, iDestLim;
+        const taNumber *pSrc = kb.GetAVects(iOld, k, iVect, iSrcLim);
+        taNumber *pDest = kb.ModAVects(i, k, iVect, iDestLim);
+        const size_t iVectLim = std::min(iSrcLim, iLimit);
+        SRUtils::Copy256<true, true>(pDest, pSrc, iVectLim - iVect);
+        iVect = iVectLim;
+      }
+    }
+    SRUtils::Copy256<true, true>(kb.ModD(i) + iFirstNum, kb.GetD(iOld) + iFirstNum, iLimit - iFirst);
+    if (kb.HasInvD()) {
+      SRUtils::Copy256<true, true>(kb.ModInvD(i) + iFirstNum, kb.GetInvD(iOld) + iFirstNum, iLimit - iFirst);
+    }
+  }
+}
+
+template class CECompactKBSubtaskQuestions<SRDoubleNumber>;
+template class CECompactKBSubtaskQuestions<SRFloatNumber>;
+
+} // namespace ProbQA
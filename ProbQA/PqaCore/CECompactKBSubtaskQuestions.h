@@ -0,0 +1,22 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CECompactKBTask.h"
+
+namespace ProbQA {
+
+// Moves the SIMD vectors [_iFirst;_iLimit) of targets of the remaining questions to their new ids, in cube A, matrix D
+//   and the table of 1/D .
+template<typename taNumber> class CECompactKBSubtaskQuestions : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CECompactKBTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,67 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CECompactKBSubtaskTargets.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+// The questions are not moved yet, so the rows are at the old ids of the questions. The items after the new number of
+//   targets keep finite weights, which are initialized again when the targets are added.
+template<typename taNumber> void CECompactKBSubtaskTargets<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  CEKBArena<taNumber> &PTR_RESTRICT kb = task.ModKB();
+  const TPqaId *PTR_RESTRICT pOldQuestions = task.GetOldQuestions();
+  const TPqaId *PTR_RESTRICT pOldTargets = task.GetOldTargets();
+  const size_t nQuestions = task.GetNQuestions();
+  const size_t nTargets = task.GetNTargets();
+  const size_t jFirst = task.GetFirstMovedTarget();
+  const size_t nAnswers = kb.GetNAnswers();
+  const size_t nARows = nQuestions * nAnswers;
+  const size_t nDRowsLim = nARows + nQuestions;
+  const size_t iFirst = SRCast::ToSizeT(_iFirst);
+  const size_t iLimit = SRCast::ToSizeT(_iLimit);
+
+  auto fnGatherRow = [&](taNumber *PTR_RESTRICT pRow) {
+    for (size_t j = jFirst; j < nTargets; j++) {
+      pRow[j] = pRow[SRCast::ToSizeT(pOldTargets[j])];
+    }
+  };
+
+  // Cube A
+  const size_t iALim = std::min(iLimit, nARows);
+  for (size_t r = iFirst; r < iALim; r++) {
+    const size_t i = SRCast::ToSizeT(pOldQuestions[r / nAnswers]);
+    const size_t k = r % nAnswers;
+    if (!kb.IsTiledA()) {
+      fnGatherRow(&kb.ModA(i, k, 0));
+    } else {
+      for (size_t j = jFirst; j < nTargets; j++) {
+        kb.ModA(i, k, j) = kb.GetA(i, k, SRCast::ToSizeT(pOldTargets[j]));
+      }
+    }
+  }
+  // Matrix D and the table of 1/D
+  const size_t iDFirst = std::max(iFirst, nARows);
+  const size_t iDLim = std::min(iLimit, nDRowsLim);
+  for (size_t r = iDFirst; r < iDLim; r++) {
+    const size_t i = SRCast::ToSizeT(pOldQuestions[r - nARows]);
+    fnGatherRow(kb.ModD(i));
+    if (kb.HasInvD()) {
+      fnGatherRow(kb.ModInvD(i));
+    }
+  }
+  // Vector B
+  if (iFirst <= nDRowsLim && nDRowsLim < iLimit) {
+    fnGatherRow(kb.ModB());
+  }
+}
+
+template class CECompactKBSubtaskTargets<SRDoubleNumber>;
+template class CECompactKBSubtaskTargets<SRFloatNumber>;
+
+} // namespace ProbQA
@@ -0,0 +1,22 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CECompactKBTask.h"
+
+namespace ProbQA {
+
+// Gathers the remaining targets in the rows [_iFirst;_iLimit) of the remaining questions: the rows of cube A, then the
+//   rows of matrix D together with the rows of 1/D, then the row of vector B.
+template<typename taNumber> class CECompactKBSubtaskTargets : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CECompactKBTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,45 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CEBaseTask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Remove the gaps from the KB in place, by gathering the weights of the remaining items to the new ids. The new id of
+//   an item is not greater than its old id, so the gathers in the ascending order of the new ids never overwrite a
+//   weight not yet moved. Therefore the targets are gathered in parallel by the rows, then the questions are moved in
+//   parallel by the stripes of SIMD vectors across all the rows. The arena keeps its capacity and stride.
+template<typename taNumber> class CECompactKBTask : public CEBaseTask {
+  CEKBArena<taNumber> *const _pKb;
+  // The i-th item contains the old id for the new id=i .
+  const TPqaId *const _pOldQuestions;
+  const TPqaId *const _pOldTargets;
+  const size_t _nQuestions;
+  const size_t _nTargets;
+  // The first new id differing from the old one.
+  const size_t _iFirstMovedQuestion;
+  const size_t _iFirstMovedTarget;
+
+public:
+  explicit CECompactKBTask(CpuEngine<taNumber> &engine, CEKBArena<taNumber> &kb, const size_t nQuestions,
+    const TPqaId *const pOldQuestions, const size_t iFirstMovedQuestion, const size_t nTargets,
+    const TPqaId *const pOldTargets, const size_t iFirstMovedTarget) : CEBaseTask(engine), _pKb(&kb),
+    _pOldQuestions(pOldQuestions), _pOldTargets(pOldTargets), _nQuestions(nQuestions), _nTargets(nTargets),
+    _iFirstMovedQuestion(iFirstMovedQuestion), _iFirstMovedTarget(iFirstMovedTarget)
+  { }
+
+  CEKBArena<taNumber>& ModKB() const { return *_pKb; }
+  const TPqaId* GetOldQuestions() const { return _pOldQuestions; }
+  const TPqaId* GetOldTargets() const { return _pOldTargets; }
+  size_t GetNQuestions() const { return _nQuestions; }
+  size_t GetNTargets() const { return _nTargets; }
+  size_t GetFirstMovedQuestion() const { return _iFirstMovedQuestion; }
+  size_t GetFirstMovedTarget() const { return _iFirstMovedTarget; }
+};
+
+} // namespace ProbQA
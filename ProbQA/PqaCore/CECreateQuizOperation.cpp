@@ -17,7 +17,9 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CECreateQuizStart<SRDoubleNumber>;
+template class CECreateQuizStart<SRFloatNumber>;
 template class CECreateQuizResume<SRDoubleNumber>;
+template class CECreateQuizResume<SRFloatNumber>;
 
 template<typename taNumber> void CECreateQuizStart<taNumber>::UpdateLikelihoods(BaseCpuEngine &baseCe,
   CEBaseQuiz &baseQuiz)
@@ -41,11 +43,11 @@ template<typename taNumber> void CECreateQuizStart<taNumber>::UpdateLikelihoods(
 
   CESetPriorsTask<taNumber> spTask(engine, quiz);
   {
-    SRRWLock<false> rwl(engine.GetRws());
+    CEKBReadGuard kbrg(engine.GetRws(), engine.GetKBEpochs());
     // Zero out exponents, copy mantissas, prepare for summing
     typedef CESetPriorsSubtaskSum<taNumber> TSubtask;
     SRPoolRunner::Keeper<TSubtask> kp = pr.RunPreSplit<TSubtask>(spTask, targSplit);
-    rwl.EarlyRelease();
+    kbrg.EarlyRelease();
     Summator<taNumber>::ForPriors(kp, spTask);
   }
   // Divide the likelihoods by their sum so to get probabilities
@@ -74,7 +76,7 @@ template<typename taNumber> void CECreateQuizResume<taNumber>::UpdateLikelihoods
   const SRPoolRunner::Split targSplit = SRPoolRunner::CalcSplit(miSplit.BytePtr(commonBuf), nTargetVects, nWorkers);
   {
     CEUpdatePriorsTask<taNumber> task(engine, quiz, _nAnswered, _pAQs, CalcVectsInCache());
-    SRRWLock<false> rwl(engine.GetRws());
+    CEKBReadGuard kbrg(engine.GetRws(), engine.GetKBEpochs());
     // Copy from B and update the likelihoods with the questions answered.
     pr.RunPreSplit<CEUpdatePriorsSubtaskMul<taNumber>>(task, targSplit);
   }
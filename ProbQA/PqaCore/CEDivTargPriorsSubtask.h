@@ -21,9 +21,21 @@ template<> inline void __vectorcall CEBaseDivTargPriorsSubtask<SRPlat::SRDoubleN
   _mm_sfence();
 }
 
+template<> inline void __vectorcall CEBaseDivTargPriorsSubtask<SRPlat::SRFloatNumber>::RunInternal(
+  const CEQuiz<SRPlat::SRFloatNumber> &PTR_RESTRICT quiz, const SRPlat::SRNumPack<SRPlat::SRFloatNumber> sumPriors)
+{
+  auto *PTR_RESTRICT pMants = SRPlat::SRCast::Ptr<__m256>(quiz.GetPriorMants());
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    const __m256 original = SRPlat::SRSimd::Load<false>(pMants + i);
+    const __m256 normalized = _mm256_div_ps(original, sumPriors._comps);
+    SRPlat::SRSimd::Store<false>(pMants + i, normalized);
+  }
+  _mm_sfence();
+}
+
 template<typename taTask> inline void CEDivTargPriorsSubtask<taTask>::Run() {
   auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
-  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const CEQuiz<typename taTask::TNumber> &PTR_RESTRICT quiz = task.GetQuiz();
   RunInternal(quiz, task._sumPriors);
 }
 
@@ -0,0 +1,49 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEDroppedLackSubtask.h"
+#include "../PqaCore/CEQuiz.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template class CEDroppedLackSubtask<SRDoubleNumber>;
+template class CEDroppedLackSubtask<SRFloatNumber>;
+
+template<> void CEDroppedLackSubtask<SRDoubleNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  const TPqaId *const PTR_RESTRICT pDropped = task.GetDropped();
+  const TPqaId nDropped = task.GetNDropped();
+  double *const PTR_RESTRICT pDroppedLack = task.GetQuiz().GetDroppedLack();
+
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i)) {
+      continue;
+    }
+    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
+    SRAccumVectDbl256 accInvD2;
+    for (TPqaId t = 0; t < nDropped; t++) {
+      const TPqaId j = pDropped[t];
+      const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(targGaps.GetQuad(j)));
+      const __m256d vDij = SRSimd::Load<true>(pmDi + j);
+      const __m256d invDij = _mm256_andnot_pd(gapMask, bInvD ? vDij : _mm256_div_pd(SRVectMath::_cdOne256, vDij));
+      accInvD2.Add(_mm256_mul_pd(invDij, invDij));
+    }
+    pDroppedLack[i] += accInvD2.PreciseSum();
+  }
+}
+
+template<> void CEDroppedLackSubtask<SRFloatNumber>::Run() {
+  // The pruning of the targets is for double precision only.
+  assert(false);
+}
+
+} // namespace ProbQA
@@ -0,0 +1,21 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEDroppedLackTask.h"
+
+namespace ProbQA {
+
+// The subtask range is over the questions.
+template<typename taNumber> class CEDroppedLackSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEDroppedLackTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,30 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEQuiz.fwd.h"
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CEBaseTask.h"
+
+namespace ProbQA {
+
+// Add the sums of 1/D^2 over the vectors of targets just dropped from the quiz to the dropped lack of the quiz, in
+//   parallel over the questions.
+template<typename taNumber> class CEDroppedLackTask : public CEBaseTask {
+  CEQuiz<taNumber> *_pQuiz;
+  const TPqaId *const _pDropped;
+  const TPqaId _nDropped;
+
+public:
+  explicit CEDroppedLackTask(CpuEngine<taNumber> &engine, CEQuiz<taNumber> &quiz, const TPqaId *const pDropped,
+    const TPqaId nDropped) : CEBaseTask(engine), _pQuiz(&quiz), _pDropped(pDropped), _nDropped(nDropped)
+  { }
+
+  CEQuiz<taNumber>& GetQuiz() const { return *_pQuiz; }
+  const TPqaId* GetDropped() const { return _pDropped; }
+  TPqaId GetNDropped() const { return _nDropped; }
+};
+
+} // namespace ProbQA
@@ -12,16 +12,35 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template<typename taNumber> size_t CEEvalQsSubtaskConsider<taNumber>::CalcStackReq(const EngineDefinition& engDef) {
-  return SRSimd::GetPaddedBytes(sizeof(taNumber) * engDef._dims._nTargets) * 2
-    + sizeof(AnswerMetrics<taNumber>) * engDef._dims._nAnswers;
+  const size_t targBytes = SRSimd::GetPaddedBytes(sizeof(taNumber) * engDef._dims._nTargets);
+  const size_t nAnswers = SRCast::ToSizeT(engDef._dims._nAnswers);
+  // With the pruning, the kernel over the active vectors gathers the priors, the gap masks, inverse D, the likelihoods
+  //   and their logarithms for up to all the targets.
+  const size_t activeReq = ((engDef._pruneTargetsEps > 0) ? (targBytes * 5 + sizeof(AnswerMetrics<SRDoubleNumber>)
+    * nAnswers + 6 * SR_ALIGNED_ALLOCA_PADDING) : 0);
+  if (engDef._tiledA || std::is_same<taNumber, SRFloatNumber>::value) {
+    // Inverse D for all the targets, plus priors, gap masks and multipliers for a tile, which is no longer than all the
+    //   targets.
+    return std::max(activeReq, targBytes * 4 + (sizeof(AnswerMetrics<SRDoubleNumber>) + 2 * sizeof(SRAccumVectDbl256)
+      + SRSimd::_cNBytes) * nAnswers + 6 * SR_ALIGNED_ALLOCA_PADDING);
+  }
+  // The kernel for few answers buffers inverse D, and the likelihoods and their logarithms for all the answers.
+  const size_t answersReq = ((nAnswers <= _cMaxUnrolledAnswers) ? (targBytes * (1 + 2 * nAnswers)
+    + 3 * SR_ALIGNED_ALLOCA_PADDING) : 0);
+  // The AVX-512 kernel rounds the targets up to pairs of AVX2 vectors for inverse D, the likelihoods and their
+  //   logarithms, and keeps a mask byte per pair. _alloca() may round up the unaligned allocations too.
+  return std::max(std::max(activeReq, answersReq), (targBytes + SRSimd::_cNBytes) * 3
+    + (targBytes >> SRSimd::_cLogNBytes) + sizeof(AnswerMetrics<SRDoubleNumber>) * nAnswers
+    + 5 * SR_ALIGNED_ALLOCA_PADDING);
 }
 
 template class CEEvalQsSubtaskConsider<SRDoubleNumber>;
+template class CEEvalQsSubtaskConsider<SRFloatNumber>;
 
 #define LOCLOG(severityVar) SRLogStream(ISRLogger::Severity::severityVar, engine.GetLogger())
 
 FLOAT_PRECISE_BEGIN
-template<> double CEEvalQsSubtaskConsider<SRDoubleNumber>::CalcVelocityComponent(const double V,
+template<typename taNumber> double CEEvalQsSubtaskConsider<taNumber>::CalcVelocityComponent(const double V,
   const TPqaId nTargets) {
   // Min exponent : -1023
   // Exponent due to subnormals : -52
@@ -38,16 +57,110 @@ namespace {
   const __m256d gcProbEps = _mm256_set1_pd(std::ldexp(1.0, -960));
 }
 
-template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::Run() {
+template<typename taNumber> double CEEvalQsSubtaskConsider<taNumber>::CalcPriority(const BaseCpuEngine &engine,
+  const AnswerMetrics<SRDoubleNumber> *pAnsMets, const double totW, const double lack, const TPqaId nValidTargets)
+{
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+
+  if (std::fabs(totW - 1.0) > 1e-3) {
+    LOCLOG(Warning) << SR_FILE_LINE "The sum of answer weights is " << totW;
+  }
+
+  SRAccumVectDbl256 accAvgH; // average entropy over all answer options
+  SRAccumVectDbl256 accAvgV;// average velocity over all answer options
+  const TPqaId nAnswerVects = (nAnswers >> SRSimd::_cLogNComps64);
+  const TPqaId nVectorized = (nAnswerVects << SRSimd::_cLogNComps64);
+
+#define EASY_SET(metricVar, baseVar) _mm256_set_pd(pAnsMets[baseVar+3].metricVar.GetValue(), \
+  pAnsMets[baseVar+2].metricVar.GetValue(), pAnsMets[baseVar + 1].metricVar.GetValue(), \
+  pAnsMets[baseVar].metricVar.GetValue())
+
+  for (TPqaId k = 0; k < nVectorized; k += SRSimd::_cNComps64) {
+    const __m256d curW = EASY_SET(_weight, k);
+    
+    const __m256d curH = EASY_SET(_entropy, k);
+    const __m256d weightedEntropy = _mm256_mul_pd(curW, curH);
+    accAvgH.Add(weightedEntropy);
+
+    const __m256d curV2 = EASY_SET(_velocity, k);
+    const __m256d curV = _mm256_sqrt_pd(curV2);
+    const __m256d weightedVelocity = _mm256_mul_pd(curW, curV);
+    accAvgV.Add(weightedVelocity);
+  }
+
+#undef EASY_SET
+
+  for (TPqaId k = nVectorized; k < nAnswers; k++) {
+    const __m128d weight = _mm_set1_pd(pAnsMets[k]._weight.GetValue());
+    const double velocity = std::sqrt(pAnsMets[k]._velocity.GetValue());
+    const __m128d metrics = _mm_set_pd(velocity, pAnsMets[k]._entropy.GetValue());
+    const __m128d product = _mm_mul_pd(weight, metrics);
+    const SRVectCompCount iComp = static_cast<SRVectCompCount>(k - nVectorized);
+    //TODO: vectorize
+    accAvgH.Add(iComp, product.m128d_f64[0]);
+    accAvgV.Add(iComp, product.m128d_f64[1]);
+  }
+
+  __m128d averages;
+  averages.m128d_f64[0] = accAvgH.PairSum(accAvgV, averages.m128d_f64[1]);
+  const __m128d normalizer = _mm_set1_pd(totW);
+  averages = _mm_div_pd(averages, normalizer);
+
+  // The average entropy over all answers for this question
+  const double avgH = averages.m128d_f64[0];
+  const double nExpectedTargets = std::exp2(avgH);
+  if (nExpectedTargets + 1e-6 < 1) {
+    LOCLOG(Warning) << SR_FILE_LINE "Got nExpectedTargets=" << nExpectedTargets << ", entropy=" << avgH;
+  }
+
+  const double avgV = averages.m128d_f64[1];
+  if (avgV < 0 || avgV > _cMaxV) {
+    LOCLOG(Warning) << SR_FILE_LINE "Got avgV=" << avgV;
+  }
+
+  const double vComp = CalcVelocityComponent(avgV, nValidTargets+1);
+  if (vComp <= 0) {
+    LOCLOG(Warning) << SR_FILE_LINE "Got vComp=" << vComp;
+  }
+
+  //constexpr double epsV = 1e-30;
+  //const double scaledV = avgV / epsV;
+  //const double stableV = ((scaledV <= epsV) ? epsV : scaledV);
+  //const double vComp = stableV;
+
+  if (lack <= 0) {
+    LOCLOG(Warning) << SR_FILE_LINE "Got lack=" << lack;
+  }
+
+  //TODO: change to integer powers algorithm after best powers are found experimentally.
+  const double priority = std::pow(lack, 2) * std::pow(vComp, 9) * std::pow(nExpectedTargets, -2);
+
+  if (priority <= 0 || !std::isfinite(priority)) {
+    LOCLOG(Warning) << SR_FILE_LINE "Got priority=" << priority;
+  }
+  return priority;
+}
+
+// A single pass over the targets per answer computes the weight W = sum(L[j]) of the unnormalized likelihoods L[j] and
+//   the entropy from the posteriors L[j]/W :
+//   entropy = log2(W) - sum(L[j]*log2(L[j])) / W
+// The pass stores L[j] and log2(L[j]) for a short sweep computing the lack and the velocity, sum((L[j]/W-prior[j])^2) .
+//   The velocity can't be expanded into the sums over L[j] like the entropy, because the terms of the expansion cancel
+//   out when the posteriors are close to the priors.
+template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::RunRowMajor() {
   auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
   auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
   const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
   const TPqaId nAnswers = engine.GetDims()._nAnswers;
   const TPqaId nTargVects = SRMath::RShiftRoundUp(engine.GetDims()._nTargets, SRSimd::_cLogNComps64);
   auto *const PTR_RESTRICT pPriors = SRCast::CPtr<__m256d>(quiz.GetPriorMants());
   auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
   __m256d *const PTR_RESTRICT pInvDi = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
-  __m256d *const PTR_RESTRICT pPosteriors = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
+  __m256d *const PTR_RESTRICT pLh = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
+  __m256d *const PTR_RESTRICT pLog2Lh = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
 
   SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
   for (TPqaId i = _iFirst; i < _iLimit; i++) {
@@ -56,22 +169,26 @@ template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::Run() {
       task._pRunLength[i] = accRunLength.Get();
       continue;
     }
-    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(&(engine.GetD(i, 0)));
+    // With the table of 1/D maintained, load it instead of dividing by D .
+    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
     SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
     SRAccumVectDbl256 accL;
     for (TPqaId k = 0; k < nAnswers; k++) {
-      SRAccumVectDbl256 accLhEnt; // For likelihood and entropy
-      const __m256d *const PTR_RESTRICT psAik = SRCast::CPtr<__m256d>(&(engine.GetA(i, k, 0)));
+      SRAccumVectDbl256 accLh; // likelihood
+      SRAccumVectDbl256 accLhLog; // likelihood multiplied by its logarithm
+      const __m256d *const PTR_RESTRICT psAik = SRCast::CPtr<__m256d>(
+        &(kb.GetA(SRCast::ToSizeT(i), SRCast::ToSizeT(k), 0)));
       const bool isAns0 = (k == 0);
       for (TPqaId j = 0; j < nTargVects; j++) {
-        const uint8_t gaps = engine.GetTargetGaps().GetQuad(j);
+        const uint8_t gaps = targGaps.GetQuad(j);
         const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps));
         const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + j));
 
         __m256d invCountTotal; // mD[i][j]
         if (isAns0) {
           const __m256d vDij = SRSimd::Load<false>(pmDi + j);
-          invCountTotal = _mm256_andnot_pd(gapMask, _mm256_div_pd(SRVectMath::_cdOne256, vDij));
+          invCountTotal = _mm256_andnot_pd(gapMask, bInvD ? vDij : _mm256_div_pd(SRVectMath::_cdOne256, vDij));
           SRSimd::Store<true>(pInvDi + j, invCountTotal);
         }
         else {
@@ -80,140 +197,649 @@ template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::Run() {
 
         const __m256d Pr_Qi_eq_k_given_Tj = _mm256_mul_pd(SRSimd::Load<false>(psAik+j), invCountTotal);
         const __m256d likelihood = _mm256_mul_pd(Pr_Qi_eq_k_given_Tj, priors);
-        
-        SRSimd::Store<true>(pPosteriors + j, likelihood);
-        //TODO: profiler shows this as the bottleneck (23%)
-        accLhEnt.Add(likelihood);
+        const __m256d l2lh = _mm256_andnot_pd(gapMask, SRVectMath::Log2Hot(likelihood));
+        SRSimd::Store<true>(pLh + j, likelihood);
+        SRSimd::Store<true>(pLog2Lh + j, l2lh);
+
+        accLh.Add(likelihood);
+        accLhLog.Add(_mm256_mul_pd(likelihood, l2lh));
       }
-      const double Wk = accLhEnt.PreciseSum();
+      const double Wk = accLh.PreciseSum();
       accTotW.Add(SRDoubleNumber::FromDouble(Wk));
       pAnsMets[k]._weight.SetValue(Wk);
-      const __m256d invWk = _mm256_div_pd(SRVectMath::_cdOne256, _mm256_set1_pd(Wk));
-
-      accLhEnt.Reset(); // reuse for entropy summation
-      SRAccumVectDbl256 accV; // velocity
+      const double invWk = 1 / Wk;
+      const double l2Wk = std::log2(Wk);
+      pAnsMets[k]._entropy.SetValue(l2Wk - accLhLog.PreciseSum() * invWk);
+
+      // The logarithm of the posterior is the logarithm of the likelihood minus that of the weight.
+      const __m256d vl2Wk = _mm256_set1_pd(l2Wk);
+      const __m256d vInvWk = _mm256_set1_pd(invWk);
+      SRAccumVectDbl256 accV;
       for (TPqaId j = 0; j < nTargVects; j++) {
-        // So far there are likelihoods stored, rather than probabilities. Normalize to probabilities.
-        const __m256d posteriors = _mm256_mul_pd(SRSimd::Load<true>(pPosteriors+j), invWk);
-
-        const uint8_t gaps = engine.GetTargetGaps().GetQuad(j);
-        const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps));
+        const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(targGaps.GetQuad(j)));
+        const __m256d l2post = _mm256_sub_pd(SRSimd::Load<true>(pLog2Lh + j), vl2Wk);
+        const __m256d invDij = SRSimd::Load<true>(pInvDi + j);
+        accL.Add(_mm256_andnot_pd(gapMask, _mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post)));
 
-        // Operations should be faster if components are zero, so zero them out early.
         const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + j));
+        const __m256d diff = _mm256_sub_pd(_mm256_mul_pd(SRSimd::Load<true>(pLh + j), vInvWk), priors);
+        accV.Add(_mm256_mul_pd(diff, diff));
+      }
+      pAnsMets[k]._velocity.SetValue(accV.PreciseSum());
+    }
+    const double priority = CalcPriority(engine, pAnsMets, accTotW.Get().GetValue(), -accL.PreciseSum(),
+      task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
 
-        // Calculate negated entropy component: negated self-information multiplied by probability of its event.
-        const __m256d l2post = _mm256_andnot_pd(gapMask, SRVectMath::Log2Hot(posteriors));
-        //DEBUG
-        //for (int8_t c = 0; c <= 3; c++) {
-        //  if (l2post.m256d_f64[c] > 0) {
-        //    __debugbreak();
-        //  }
-        //}
-        const __m256d Hikj = _mm256_mul_pd(posteriors, l2post);
-        accLhEnt.Add(Hikj);
+    task._pRunLength[i] = accRunLength.Get(); 
+  }
+  //TODO: perhaps check task._pRunLength[_iLimit-1] for overflow/underflow instead of CpuEngine::NextQuestion()
+}
 
-        const __m256d invDij = SRSimd::Load<true>(pInvDi + j);
-        accL.Add(_mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post));
+template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::RunTiled() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+  // The rows of the KB may have spare capacity after the targets of the engine.
+  const size_t nTargVects = SRCast::ToSizeT(SRSimd::VectsFromComps<SRDoubleNumber>(engine.GetDims()._nTargets));
+  const size_t nTileVects = std::min(kb.GetTileVects(), nTargVects);
+  auto *const PTR_RESTRICT pPriors = SRCast::CPtr<__m256d>(quiz.GetPriorMants());
+  auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
+  __m256d *const PTR_RESTRICT pInvDi = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
+  // Gap-masked priors, gap masks, and the priors divided by D, for the current tile of targets.
+  __m256d *const PTR_RESTRICT pTilePriors = SR_STACK_ALLOC_ALIGN(__m256d, nTileVects);
+  __m256d *const PTR_RESTRICT pTileMasks = SR_STACK_ALLOC_ALIGN(__m256d, nTileVects);
+  __m256d *const PTR_RESTRICT pTileMuls = SR_STACK_ALLOC_ALIGN(__m256d, nTileVects);
+  // Per answer: the accumulators of likelihood (then reused for entropy) and of velocity, and the inverse weight.
+  SRAccumVectDbl256 *const PTR_RESTRICT pAccLhEnt = SR_STACK_ALLOC_ALIGN(SRAccumVectDbl256, nAnswers);
+  SRAccumVectDbl256 *const PTR_RESTRICT pAccV = SR_STACK_ALLOC_ALIGN(SRAccumVectDbl256, nAnswers);
+  __m256d *const PTR_RESTRICT pInvW = SR_STACK_ALLOC_ALIGN(__m256d, nAnswers);
+  for (TPqaId k = 0; k < nAnswers; k++) {
+    new(pAccLhEnt + k) SRAccumVectDbl256();
+    new(pAccV + k) SRAccumVectDbl256();
+  }
 
-        const __m256d diff = _mm256_sub_pd(posteriors, priors);
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
+    }
+    // With the table of 1/D maintained, load it instead of dividing by D .
+    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
 
-        //const __m256d priorsGood = _mm256_cmp_pd(priors, gcProbEps, _CMP_GT_OQ);
-        //const __m256d ratio = _mm256_div_pd(posteriors, priors);
-        //const __m256d diff = _mm256_and_pd(priorsGood, SRVectMath::Log2Hot(ratio));
-        //const __m256d absDiff = SRSimd::AbsF64(diff);
+    //// Pass 1: the weight of each answer, i.e. the sum of the likelihoods over all the targets. The priors and inverse
+    ////   D are loaded once per tile, and stay in L1 cache while all the answers of the tile are processed.
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      pAccLhEnt[k].Reset();
+    }
+    for (size_t iTileV = 0; iTileV < nTargVects;) {
+      size_t iTileLim;
+      const __m256d *PTR_RESTRICT psAi = SRCast::CPtr<__m256d>(kb.GetAVects(SRCast::ToSizeT(i), 0, iTileV, iTileLim));
+      // The rows of the answers are apart by the length of the tile, which may exceed the targets of the engine.
+      const size_t nTileVectsCur = iTileLim - iTileV;
+      iTileLim = std::min(iTileLim, nTargVects);
+      const size_t nCurVects = iTileLim - iTileV;
+      for (size_t j = 0; j < nCurVects; j++) {
+        const uint8_t gaps = targGaps.GetQuad(iTileV + j);
+        const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps));
+        const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + iTileV + j));
+        const __m256d vDij = SRSimd::Load<false>(pmDi + iTileV + j);
+        const __m256d invCountTotal = _mm256_andnot_pd(gapMask,
+          bInvD ? vDij : _mm256_div_pd(SRVectMath::_cdOne256, vDij));
+        SRSimd::Store<true>(pInvDi + iTileV + j, invCountTotal);
+        SRSimd::Store<true>(pTileMuls + j, _mm256_mul_pd(invCountTotal, priors));
+      }
+      // Within a tile, the rows of the answers follow each other.
+      for (TPqaId k = 0; k < nAnswers; k++, psAi += nTileVectsCur) {
+        SRAccumVectDbl256 &PTR_RESTRICT accLh = pAccLhEnt[k];
+        for (size_t j = 0; j < nCurVects; j++) {
+          const __m256d likelihood = _mm256_mul_pd(SRSimd::Load<false>(psAi + j), SRSimd::Load<true>(pTileMuls + j));
+          accLh.Add(likelihood);
+        }
+      }
+      iTileV = iTileLim;
+    }
 
-        const __m256d square = _mm256_mul_pd(diff, diff);
-        accV.Add(square);
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      const double Wk = pAccLhEnt[k].PreciseSum();
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      pAnsMets[k]._weight.SetValue(Wk);
+      pInvW[k] = _mm256_div_pd(SRVectMath::_cdOne256, _mm256_set1_pd(Wk));
+      pAccLhEnt[k].Reset(); // reuse for entropy summation
+      pAccV[k].Reset();
+    }
+
+    //// Pass 2: entropy, velocity and lack. The likelihoods are recomputed from the tiles of A, which is cheaper than
+    ////   storing and reloading them.
+    SRAccumVectDbl256 accL;
+    for (size_t iTileV = 0; iTileV < nTargVects;) {
+      size_t iTileLim;
+      const __m256d *PTR_RESTRICT psAi = SRCast::CPtr<__m256d>(kb.GetAVects(SRCast::ToSizeT(i), 0, iTileV, iTileLim));
+      const size_t nTileVectsCur = iTileLim - iTileV;
+      iTileLim = std::min(iTileLim, nTargVects);
+      const size_t nCurVects = iTileLim - iTileV;
+      for (size_t j = 0; j < nCurVects; j++) {
+        const uint8_t gaps = targGaps.GetQuad(iTileV + j);
+        const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps));
+        // Operations should be faster if components are zero, so zero them out early.
+        const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + iTileV + j));
+        SRSimd::Store<true>(pTileMasks + j, gapMask);
+        SRSimd::Store<true>(pTilePriors + j, priors);
+        SRSimd::Store<true>(pTileMuls + j, _mm256_mul_pd(SRSimd::Load<true>(pInvDi + iTileV + j), priors));
       }
+      for (TPqaId k = 0; k < nAnswers; k++, psAi += nTileVectsCur) {
+        const __m256d invWk = pInvW[k];
+        SRAccumVectDbl256 &PTR_RESTRICT accEnt = pAccLhEnt[k];
+        SRAccumVectDbl256 &PTR_RESTRICT accV = pAccV[k];
+        for (size_t j = 0; j < nCurVects; j++) {
+          const __m256d likelihood = _mm256_mul_pd(SRSimd::Load<false>(psAi + j), SRSimd::Load<true>(pTileMuls + j));
+          const __m256d posteriors = _mm256_mul_pd(likelihood, invWk);
+          const __m256d gapMask = SRSimd::Load<true>(pTileMasks + j);
+
+          // Calculate negated entropy component: negated self-information multiplied by probability of its event.
+          const __m256d l2post = _mm256_andnot_pd(gapMask, SRVectMath::Log2Hot(posteriors));
+          const __m256d Hikj = _mm256_mul_pd(posteriors, l2post);
+          accEnt.Add(Hikj);
+
+          const __m256d invDij = SRSimd::Load<true>(pInvDi + iTileV + j);
+          accL.Add(_mm256_andnot_pd(gapMask, _mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post)));
+
+          const __m256d diff = _mm256_sub_pd(posteriors, SRSimd::Load<true>(pTilePriors + j));
+          const __m256d square = _mm256_mul_pd(diff, diff);
+          accV.Add(square);
+        }
+      }
+      iTileV = iTileLim;
+    }
+
+    for (TPqaId k = 0; k < nAnswers; k++) {
       double velocity;
-      const double entropyHik = -accLhEnt.PairSum(accV, velocity);
+      const double entropyHik = -pAccLhEnt[k].PairSum(pAccV[k], velocity);
       pAnsMets[k]._entropy.SetValue(entropyHik);
       pAnsMets[k]._velocity.SetValue(velocity);
     }
-    const double totW = accTotW.Get().GetValue();
-    if (std::fabs(totW - 1.0) > 1e-3) {
-      LOCLOG(Warning) << SR_FILE_LINE "The sum of answer weights is " << totW;
-    }
 
-    SRAccumVectDbl256 accAvgH; // average entropy over all answer options
-    SRAccumVectDbl256 accAvgV;// average velocity over all answer options
-    const TPqaId nAnswerVects = (nAnswers >> SRSimd::_cLogNComps64);
-    const TPqaId nVectorized = (nAnswerVects << SRSimd::_cLogNComps64);
+    const double priority = CalcPriority(engine, pAnsMets, accTotW.Get().GetValue(), -accL.PreciseSum(),
+      task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
 
-#define EASY_SET(metricVar, baseVar) _mm256_set_pd(pAnsMets[baseVar+3].metricVar.GetValue(), \
-  pAnsMets[baseVar+2].metricVar.GetValue(), pAnsMets[baseVar + 1].metricVar.GetValue(), \
-  pAnsMets[baseVar].metricVar.GetValue())
+    task._pRunLength[i] = accRunLength.Get();
+  }
+}
 
-    for (TPqaId k = 0; k < nVectorized; k += SRSimd::_cNComps64) {
-      const __m256d curW = EASY_SET(_weight, k);
-      
-      const __m256d curH = EASY_SET(_entropy, k);
-      const __m256d weightedEntropy = _mm256_mul_pd(curW, curH);
-      accAvgH.Add(weightedEntropy);
+// Cube A of the question is streamed once: for each vector of targets, the likelihoods of all the answers are computed
+//   with the priors, the gap masks and 1/D loaded once, and buffered with their logarithms on the stack. Only the
+//   weights are accumulated in this pass, so that their accumulators stay in registers. The second pass sweeps the
+//   buffers of each answer for the entropy, the velocity and the lack.
+template<> template<TPqaId taNAnswers> void CEEvalQsSubtaskConsider<SRDoubleNumber>::RunRowMajorAnswers() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  assert(engine.GetDims()._nAnswers == taNAnswers);
+  const TPqaId nTargVects = SRMath::RShiftRoundUp(engine.GetDims()._nTargets, SRSimd::_cLogNComps64);
+  auto *const PTR_RESTRICT pPriors = SRCast::CPtr<__m256d>(quiz.GetPriorMants());
+  AnswerMetrics<SRDoubleNumber> ansMets[taNAnswers];
+  __m256d *const PTR_RESTRICT pInvDi = SR_STACK_ALLOC_ALIGN(__m256d, nTargVects);
+  // The likelihoods and their logarithms, [iAnswer][iTargVect] .
+  __m256d *const PTR_RESTRICT pLh = SR_STACK_ALLOC_ALIGN(__m256d, taNAnswers * nTargVects);
+  __m256d *const PTR_RESTRICT pLog2Lh = SR_STACK_ALLOC_ALIGN(__m256d, taNAnswers * nTargVects);
 
-      const __m256d curV2 = EASY_SET(_velocity, k);
-      const __m256d curV = _mm256_sqrt_pd(curV2);
-      const __m256d weightedVelocity = _mm256_mul_pd(curW, curV);
-      accAvgV.Add(weightedVelocity);
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
+    }
+    // With the table of 1/D maintained, load it instead of dividing by D .
+    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
+    const __m256d *PTR_RESTRICT psAik[taNAnswers];
+    for (TPqaId k = 0; k < taNAnswers; k++) {
+      psAik[k] = SRCast::CPtr<__m256d>(&(kb.GetA(SRCast::ToSizeT(i), SRCast::ToSizeT(k), 0)));
     }
 
-#undef EASY_SET
+    //// Pass 1: the likelihoods, their logarithms and the weight of each answer.
+    SRAccumVectDbl256 accLh[taNAnswers];
+    for (TPqaId j = 0; j < nTargVects; j++) {
+      const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(targGaps.GetQuad(j)));
+      const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + j));
+      const __m256d vDij = SRSimd::Load<false>(pmDi + j);
+      const __m256d invCountTotal = _mm256_andnot_pd(gapMask,
+        bInvD ? vDij : _mm256_div_pd(SRVectMath::_cdOne256, vDij));
+      SRSimd::Store<true>(pInvDi + j, invCountTotal);
+      const __m256d mul = _mm256_mul_pd(invCountTotal, priors);
+      for (TPqaId k = 0; k < taNAnswers; k++) {
+        const __m256d likelihood = _mm256_mul_pd(SRSimd::Load<false>(psAik[k] + j), mul);
+        SRSimd::Store<true>(pLh + k * nTargVects + j, likelihood);
+        SRSimd::Store<true>(pLog2Lh + k * nTargVects + j, _mm256_andnot_pd(gapMask, SRVectMath::Log2Hot(likelihood)));
+        accLh[k].Add(likelihood);
+      }
+    }
+
+    //// Pass 2: the entropy and the velocity of each answer, and the lack, from the buffers.
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    SRAccumVectDbl256 accL;
+    for (TPqaId k = 0; k < taNAnswers; k++) {
+      const double Wk = accLh[k].PreciseSum();
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      ansMets[k]._weight.SetValue(Wk);
+      const double invWk = 1 / Wk;
+      const double l2Wk = std::log2(Wk);
+      const __m256d vl2Wk = _mm256_set1_pd(l2Wk);
+      const __m256d vInvWk = _mm256_set1_pd(invWk);
+      const __m256d *const PTR_RESTRICT pLhk = pLh + k * nTargVects;
+      const __m256d *const PTR_RESTRICT pLog2Lhk = pLog2Lh + k * nTargVects;
+      SRAccumVectDbl256 accLhLog; // likelihood multiplied by its logarithm
+      SRAccumVectDbl256 accV;
+      for (TPqaId j = 0; j < nTargVects; j++) {
+        const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(targGaps.GetQuad(j)));
+        const __m256d likelihood = SRSimd::Load<true>(pLhk + j);
+        const __m256d l2lh = SRSimd::Load<true>(pLog2Lhk + j);
+        accLhLog.Add(_mm256_mul_pd(likelihood, l2lh));
 
-    for (TPqaId k = nVectorized; k < nAnswers; k++) {
-      const __m128d weight = _mm_set1_pd(pAnsMets[k]._weight.GetValue());
-      const double velocity = std::sqrt(pAnsMets[k]._velocity.GetValue());
-      const __m128d metrics = _mm_set_pd(velocity, pAnsMets[k]._entropy.GetValue());
-      const __m128d product = _mm_mul_pd(weight, metrics);
-      const SRVectCompCount iComp = static_cast<SRVectCompCount>(k - nVectorized);
-      //TODO: vectorize
-      accAvgH.Add(iComp, product.m128d_f64[0]);
-      accAvgV.Add(iComp, product.m128d_f64[1]);
+        const __m256d priors = _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + j));
+        const __m256d diff = _mm256_sub_pd(_mm256_mul_pd(likelihood, vInvWk), priors);
+        accV.Add(_mm256_mul_pd(diff, diff));
+
+        // The logarithm of the posterior is the logarithm of the likelihood minus that of the weight.
+        const __m256d l2post = _mm256_sub_pd(l2lh, vl2Wk);
+        const __m256d invDij = SRSimd::Load<true>(pInvDi + j);
+        accL.Add(_mm256_andnot_pd(gapMask, _mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post)));
+      }
+      ansMets[k]._entropy.SetValue(l2Wk - accLhLog.PreciseSum() * invWk);
+      ansMets[k]._velocity.SetValue(accV.PreciseSum());
     }
 
-    __m128d averages;
-    averages.m128d_f64[0] = accAvgH.PairSum(accAvgV, averages.m128d_f64[1]);
-    const __m128d normalizer = _mm_set1_pd(totW);
-    averages = _mm_div_pd(averages, normalizer);
+    const double priority = CalcPriority(engine, ansMets, accTotW.Get().GetValue(), -accL.PreciseSum(),
+      task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
+
+    task._pRunLength[i] = accRunLength.Get();
+  }
+}
 
-    // The average entropy over all answers for this question
-    const double avgH = averages.m128d_f64[0];
-    const double nExpectedTargets = std::exp2(avgH);
-    if (nExpectedTargets + 1e-6 < 1) {
-      LOCLOG(Warning) << SR_FILE_LINE "Got nExpectedTargets=" << nExpectedTargets << ", entropy=" << avgH;
+// Pairs of AVX2 vectors of targets are processed as one AVX-512 vector, and the odd AVX2 vector at the end under a
+//   mask. The gaps are applied with the mask registers, so that the lanes of the gaps are zeroed by the operations.
+template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::RunRowMajor512() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+  const TPqaId nTargVects = SRMath::RShiftRoundUp(engine.GetDims()._nTargets, SRSimd::_cLogNComps64);
+  // The number of AVX-512 vectors of targets, each made of a pair of AVX2 vectors.
+  const TPqaId nPairs = SRMath::RShiftRoundUp(nTargVects, 1);
+  constexpr uint8_t cLogPairComps = SRSimd::_cLogNComps64 + 1;
+  auto *const PTR_RESTRICT pPriors = SRCast::CPtr<double>(quiz.GetPriorMants());
+  auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
+  // The masks of the lanes within the targets and not in the gaps.
+  __mmask8 *const PTR_RESTRICT pKept = SR_STACK_ALLOC(__mmask8, nPairs);
+  // The stack is aligned only for AVX2, so these are accessed with unaligned loads and stores.
+  double *const PTR_RESTRICT pInvDi = SRCast::Ptr<double>(SR_STACK_ALLOC_ALIGN(__m256d, 2 * nPairs));
+  double *const PTR_RESTRICT pLh = SRCast::Ptr<double>(SR_STACK_ALLOC_ALIGN(__m256d, 2 * nPairs));
+  double *const PTR_RESTRICT pLog2Lh = SRCast::Ptr<double>(SR_STACK_ALLOC_ALIGN(__m256d, 2 * nPairs));
+
+  // The gaps are the same for all the questions.
+  for (TPqaId j = 0; j < nPairs; j++) {
+    const bool bPair = (2 * j + 1 < nTargVects);
+    pKept[j] = static_cast<__mmask8>((bPair ? 0xff : 0x0f) & ~targGaps.GetQuadPair(2 * j, bPair));
+  }
+
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
+    }
+    const double *const PTR_RESTRICT pmDi = SRCast::CPtr<double>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
+    for (TPqaId j = 0; j < nPairs; j++) {
+      const size_t jComp = SRCast::ToSizeT(j) << cLogPairComps;
+      const __m512d vDij = _mm512_maskz_loadu_pd(pKept[j], pmDi + jComp);
+      _mm512_storeu_pd(pInvDi + jComp, bInvD ? vDij : _mm512_maskz_div_pd(pKept[j], _mm512_set1_pd(1.0), vDij));
+    }
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    SRAccumVectDbl512 accL;
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      SRAccumVectDbl512 accLh; // likelihood
+      SRAccumVectDbl512 accLhLog; // likelihood multiplied by its logarithm
+      const double *const PTR_RESTRICT psAik = SRCast::CPtr<double>(
+        &(kb.GetA(SRCast::ToSizeT(i), SRCast::ToSizeT(k), 0)));
+      for (TPqaId j = 0; j < nPairs; j++) {
+        const __mmask8 kept = pKept[j];
+        const size_t jComp = SRCast::ToSizeT(j) << cLogPairComps;
+        const __m512d priors = _mm512_maskz_loadu_pd(kept, pPriors + jComp);
+        const __m512d Pr_Qi_eq_k_given_Tj = _mm512_mul_pd(_mm512_maskz_loadu_pd(kept, psAik + jComp),
+          _mm512_loadu_pd(pInvDi + jComp));
+        const __m512d likelihood = _mm512_mul_pd(Pr_Qi_eq_k_given_Tj, priors);
+        const __m512d l2lh = _mm512_maskz_mov_pd(kept, SRVectMath::Log2Hot512(likelihood));
+        _mm512_storeu_pd(pLh + jComp, likelihood);
+        _mm512_storeu_pd(pLog2Lh + jComp, l2lh);
+
+        accLh.Add(likelihood);
+        accLhLog.Add(_mm512_mul_pd(likelihood, l2lh));
+      }
+      const double Wk = accLh.PreciseSum();
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      pAnsMets[k]._weight.SetValue(Wk);
+      const double invWk = 1 / Wk;
+      const double l2Wk = std::log2(Wk);
+      pAnsMets[k]._entropy.SetValue(l2Wk - accLhLog.PreciseSum() * invWk);
+
+      // The logarithm of the posterior is the logarithm of the likelihood minus that of the weight.
+      const __m512d vl2Wk = _mm512_set1_pd(l2Wk);
+      const __m512d vInvWk = _mm512_set1_pd(invWk);
+      SRAccumVectDbl512 accV;
+      for (TPqaId j = 0; j < nPairs; j++) {
+        const __mmask8 kept = pKept[j];
+        const size_t jComp = SRCast::ToSizeT(j) << cLogPairComps;
+        const __m512d l2post = _mm512_sub_pd(_mm512_loadu_pd(pLog2Lh + jComp), vl2Wk);
+        const __m512d invDij = _mm512_loadu_pd(pInvDi + jComp);
+        accL.Add(_mm512_maskz_div_pd(kept, _mm512_mul_pd(invDij, invDij), l2post));
+
+        const __m512d diff = _mm512_sub_pd(_mm512_mul_pd(_mm512_loadu_pd(pLh + jComp), vInvWk),
+          _mm512_maskz_loadu_pd(kept, pPriors + jComp));
+        accV.Add(_mm512_mul_pd(diff, diff));
+      }
+      pAnsMets[k]._velocity.SetValue(accV.PreciseSum());
     }
+    const double priority = CalcPriority(engine, pAnsMets, accTotW.Get().GetValue(), -accL.PreciseSum(),
+      task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
+
+    task._pRunLength[i] = accRunLength.Get();
+  }
+}
 
-    const double avgV = averages.m128d_f64[1];
-    if (avgV < 0 || avgV > _cMaxV) {
-      LOCLOG(Warning) << SR_FILE_LINE "Got avgV=" << avgV;
+// The targets dropped from the quiz have zero priors, so they contribute only to the lack: in each answer, 1/D^2 divided
+//   by the logarithm of the posterior, which for a zero likelihood is the same for all of them. So the quiz keeps the
+//   sum of 1/D^2 over the dropped targets for each question, and this kernel divides it by the logarithm per answer.
+template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::RunActive() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+  const TPqaId *const PTR_RESTRICT pActiveVects = quiz.GetActiveVects();
+  const TPqaId nActive = quiz.GetNActiveVects();
+  const double *const PTR_RESTRICT pDroppedLack = quiz.GetDroppedLack();
+  // The logarithm of a zero likelihood, as the other kernels get it for the targets with zero priors.
+  const double l2Zero = SRVectMath::Log2Hot(_mm256_setzero_pd()).m256d_f64[0];
+  auto *const PTR_RESTRICT pPriors = SRCast::CPtr<__m256d>(quiz.GetPriorMants());
+  auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
+  //// These are indexed by the position in the array of the active vectors.
+  __m256d *const PTR_RESTRICT pActPriors = SR_STACK_ALLOC_ALIGN(__m256d, nActive);
+  __m256d *const PTR_RESTRICT pActMasks = SR_STACK_ALLOC_ALIGN(__m256d, nActive);
+  __m256d *const PTR_RESTRICT pInvDi = SR_STACK_ALLOC_ALIGN(__m256d, nActive);
+  __m256d *const PTR_RESTRICT pLh = SR_STACK_ALLOC_ALIGN(__m256d, nActive);
+  __m256d *const PTR_RESTRICT pLog2Lh = SR_STACK_ALLOC_ALIGN(__m256d, nActive);
+
+  // Gather the priors and the gap masks once for all the questions.
+  for (TPqaId t = 0; t < nActive; t++) {
+    const TPqaId j = pActiveVects[t];
+    const __m256d gapMask = _mm256_castsi256_pd(SRSimd::SetToBitQuadHot(targGaps.GetQuad(j)));
+    SRSimd::Store<true>(pActMasks + t, gapMask);
+    SRSimd::Store<true>(pActPriors + t, _mm256_andnot_pd(gapMask, SRSimd::Load<true>(pPriors + j)));
+  }
+
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
+    }
+    const __m256d *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
+    for (TPqaId t = 0; t < nActive; t++) {
+      const __m256d vDij = SRSimd::Load<true>(pmDi + pActiveVects[t]);
+      SRSimd::Store<true>(pInvDi + t, _mm256_andnot_pd(SRSimd::Load<true>(pActMasks + t),
+        bInvD ? vDij : _mm256_div_pd(SRVectMath::_cdOne256, vDij)));
+    }
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    SRAccumVectDbl256 accL;
+    // The sum over the answers of the inverse logarithms of the posteriors of the dropped targets.
+    SRAccumulator<SRDoubleNumber> accInvL2Dropped(SRDoubleNumber(0.0));
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      SRAccumVectDbl256 accLh; // likelihood
+      SRAccumVectDbl256 accLhLog; // likelihood multiplied by its logarithm
+      for (TPqaId t = 0; t < nActive; t++) {
+        size_t jTileLim;
+        const __m256d vAikj = SRSimd::Load<true>(SRCast::CPtr<__m256d>(kb.GetAVects(SRCast::ToSizeT(i),
+          SRCast::ToSizeT(k), SRCast::ToSizeT(pActiveVects[t]), jTileLim)));
+        const __m256d priors = SRSimd::Load<true>(pActPriors + t);
+        const __m256d likelihood = _mm256_mul_pd(_mm256_mul_pd(vAikj, SRSimd::Load<true>(pInvDi + t)), priors);
+        const __m256d l2lh = _mm256_andnot_pd(SRSimd::Load<true>(pActMasks + t), SRVectMath::Log2Hot(likelihood));
+        SRSimd::Store<true>(pLh + t, likelihood);
+        SRSimd::Store<true>(pLog2Lh + t, l2lh);
+
+        accLh.Add(likelihood);
+        accLhLog.Add(_mm256_mul_pd(likelihood, l2lh));
+      }
+      const double Wk = accLh.PreciseSum();
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      pAnsMets[k]._weight.SetValue(Wk);
+      const double invWk = 1 / Wk;
+      const double l2Wk = std::log2(Wk);
+      pAnsMets[k]._entropy.SetValue(l2Wk - accLhLog.PreciseSum() * invWk);
+      accInvL2Dropped.Add(SRDoubleNumber::FromDouble(1 / (l2Zero - l2Wk)));
+
+      const __m256d vl2Wk = _mm256_set1_pd(l2Wk);
+      const __m256d vInvWk = _mm256_set1_pd(invWk);
+      SRAccumVectDbl256 accV;
+      for (TPqaId t = 0; t < nActive; t++) {
+        const __m256d l2post = _mm256_sub_pd(SRSimd::Load<true>(pLog2Lh + t), vl2Wk);
+        const __m256d invDij = SRSimd::Load<true>(pInvDi + t);
+        accL.Add(_mm256_andnot_pd(SRSimd::Load<true>(pActMasks + t),
+          _mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post)));
+
+        const __m256d diff = _mm256_sub_pd(_mm256_mul_pd(SRSimd::Load<true>(pLh + t), vInvWk),
+          SRSimd::Load<true>(pActPriors + t));
+        accV.Add(_mm256_mul_pd(diff, diff));
+      }
+      pAnsMets[k]._velocity.SetValue(accV.PreciseSum());
     }
+    const double lack = -(accL.PreciseSum() + pDroppedLack[i] * accInvL2Dropped.Get().GetValue());
+    const double priority = CalcPriority(engine, pAnsMets, accTotW.Get().GetValue(), lack, task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
+
+    task._pRunLength[i] = accRunLength.Get();
+  }
+}
+
+template<> void CEEvalQsSubtaskConsider<SRDoubleNumber>::Run() {
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(GetTask()->GetBaseEngine());
+  if (static_cast<const TTask&>(*GetTask()).GetQuiz().GetActiveVects() != nullptr) {
+    RunActive();
+    return;
+  }
+  if (engine.GetKB().IsTiledA()) {
+    RunTiled();
+    return;
+  }
+  if (engine.GetInstructionSet() >= SRInstructionSet::Avx512) {
+    RunRowMajor512();
+    return;
+  }
+  static_assert(_cMaxUnrolledAnswers == 8, "Update the specializations below.");
+  // These should be tail calls
+  switch (engine.GetDims()._nAnswers) {
+  case 2: RunRowMajorAnswers<2>(); break;
+  case 3: RunRowMajorAnswers<3>(); break;
+  case 4: RunRowMajorAnswers<4>(); break;
+  case 5: RunRowMajorAnswers<5>(); break;
+  case 6: RunRowMajorAnswers<6>(); break;
+  case 7: RunRowMajorAnswers<7>(); break;
+  case 8: RunRowMajorAnswers<8>(); break;
+  default: RunRowMajor(); break;
+  }
+}
 
-    const double vComp = CalcVelocityComponent(avgV, task._nValidTargets+1);
-    if (vComp <= 0) {
-      LOCLOG(Warning) << SR_FILE_LINE "Got vComp=" << vComp;
+namespace {
+
+// Entropy, velocity and lack components of 4 targets, in double precision.
+inline void __vectorcall ConsiderQuad(const __m256d likelihood, const __m256d invWk, const __m256d gapMask,
+  const __m256d priors, const __m256d invDij, SRAccumVectDbl256 &PTR_RESTRICT accEnt,
+  SRAccumVectDbl256 &PTR_RESTRICT accV, SRAccumVectDbl256 &PTR_RESTRICT accL)
+{
+  const __m256d posteriors = _mm256_mul_pd(likelihood, invWk);
+  // Calculate negated entropy component: negated self-information multiplied by probability of its event.
+  const __m256d l2post = _mm256_andnot_pd(gapMask, SRVectMath::Log2Hot(posteriors));
+  accEnt.Add(_mm256_mul_pd(posteriors, l2post));
+  accL.Add(_mm256_andnot_pd(gapMask, _mm256_div_pd(_mm256_mul_pd(invDij, invDij), l2post)));
+  const __m256d diff = _mm256_sub_pd(posteriors, priors);
+  accV.Add(_mm256_mul_pd(diff, diff));
+}
+
+} // anonymous namespace
+
+// Likelihoods are computed 8 targets at once in single precision, and summed in double precision. The logarithms and
+//   divisions of pass 2 are done in double precision, 4 targets at once, because the posteriors may be tiny.
+template<> void CEEvalQsSubtaskConsider<SRFloatNumber>::RunTiled() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  const CEQuiz<SRFloatNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const CEKBArena<SRFloatNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const bool bInvD = kb.HasInvD();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+  // The rows of the KB may have spare capacity after the targets of the engine.
+  const size_t nTargVects = SRCast::ToSizeT(SRSimd::VectsFromComps<SRFloatNumber>(engine.GetDims()._nTargets));
+  const size_t nTileVects = std::min(kb.GetTileVects(), nTargVects);
+  auto *const PTR_RESTRICT pPriors = SRCast::CPtr<__m256>(quiz.GetPriorMants());
+  auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
+  __m256 *const PTR_RESTRICT pInvDi = SR_STACK_ALLOC_ALIGN(__m256, nTargVects);
+  __m256 *const PTR_RESTRICT pTilePriors = SR_STACK_ALLOC_ALIGN(__m256, nTileVects);
+  __m256i *const PTR_RESTRICT pTileMasks = SR_STACK_ALLOC_ALIGN(__m256i, nTileVects);
+  __m256 *const PTR_RESTRICT pTileMuls = SR_STACK_ALLOC_ALIGN(__m256, nTileVects);
+  SRAccumVectDbl256 *const PTR_RESTRICT pAccLhEnt = SR_STACK_ALLOC_ALIGN(SRAccumVectDbl256, nAnswers);
+  SRAccumVectDbl256 *const PTR_RESTRICT pAccV = SR_STACK_ALLOC_ALIGN(SRAccumVectDbl256, nAnswers);
+  __m256d *const PTR_RESTRICT pInvW = SR_STACK_ALLOC_ALIGN(__m256d, nAnswers);
+  for (TPqaId k = 0; k < nAnswers; k++) {
+    new(pAccLhEnt + k) SRAccumVectDbl256();
+    new(pAccV + k) SRAccumVectDbl256();
+  }
+
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
     }
+    const __m256 *const PTR_RESTRICT pmDi = SRCast::CPtr<__m256>(bInvD ? kb.GetInvD(SRCast::ToSizeT(i))
+      : kb.GetD(SRCast::ToSizeT(i)));
 
-    //constexpr double epsV = 1e-30;
-    //const double scaledV = avgV / epsV;
-    //const double stableV = ((scaledV <= epsV) ? epsV : scaledV);
-    //const double vComp = stableV;
+    //// Pass 1: the weight of each answer.
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      pAccLhEnt[k].Reset();
+    }
+    for (size_t iTileV = 0; iTileV < nTargVects;) {
+      size_t iTileLim;
+      const __m256 *PTR_RESTRICT psAi = SRCast::CPtr<__m256>(kb.GetAVects(SRCast::ToSizeT(i), 0, iTileV, iTileLim));
+      // The rows of the answers are apart by the length of the tile, which may exceed the targets of the engine.
+      const size_t nTileVectsCur = iTileLim - iTileV;
+      iTileLim = std::min(iTileLim, nTargVects);
+      const size_t nCurVects = iTileLim - iTileV;
+      for (size_t j = 0; j < nCurVects; j++) {
+        const uint8_t gaps = targGaps.GetOctet(iTileV + j);
+        const __m256 gapMask = _mm256_castsi256_ps(SRSimd::SetToBitOctet(gaps));
+        const __m256 priors = _mm256_andnot_ps(gapMask, SRSimd::Load<true>(pPriors + iTileV + j));
+        const __m256 vDij = SRSimd::Load<false>(pmDi + iTileV + j);
+        const __m256 invCountTotal = _mm256_andnot_ps(gapMask,
+          bInvD ? vDij : _mm256_div_ps(SRVectMath::_cfOne256, vDij));
+        SRSimd::Store<true>(pInvDi + iTileV + j, invCountTotal);
+        SRSimd::Store<true>(pTileMuls + j, _mm256_mul_ps(invCountTotal, priors));
+      }
+      for (TPqaId k = 0; k < nAnswers; k++, psAi += nTileVectsCur) {
+        SRAccumVectDbl256 &PTR_RESTRICT accLh = pAccLhEnt[k];
+        for (size_t j = 0; j < nCurVects; j++) {
+          accLh.Add(_mm256_mul_ps(SRSimd::Load<false>(psAi + j), SRSimd::Load<true>(pTileMuls + j)));
+        }
+      }
+      iTileV = iTileLim;
+    }
 
-    const double lack = -accL.PreciseSum();
-    if (lack <= 0) {
-      LOCLOG(Warning) << SR_FILE_LINE "Got lack=" << lack;
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      const double Wk = pAccLhEnt[k].PreciseSum();
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      pAnsMets[k]._weight.SetValue(Wk);
+      pInvW[k] = _mm256_div_pd(SRVectMath::_cdOne256, _mm256_set1_pd(Wk));
+      pAccLhEnt[k].Reset(); // reuse for entropy summation
+      pAccV[k].Reset();
     }
 
-    //TODO: change to integer powers algorithm after best powers are found experimentally.
-    const double priority = std::pow(lack, 2) * std::pow(vComp, 9) * std::pow(nExpectedTargets, -2);
+    //// Pass 2: entropy, velocity and lack.
+    SRAccumVectDbl256 accL;
+    for (size_t iTileV = 0; iTileV < nTargVects;) {
+      size_t iTileLim;
+      const __m256 *PTR_RESTRICT psAi = SRCast::CPtr<__m256>(kb.GetAVects(SRCast::ToSizeT(i), 0, iTileV, iTileLim));
+      const size_t nTileVectsCur = iTileLim - iTileV;
+      iTileLim = std::min(iTileLim, nTargVects);
+      const size_t nCurVects = iTileLim - iTileV;
+      for (size_t j = 0; j < nCurVects; j++) {
+        const uint8_t gaps = targGaps.GetOctet(iTileV + j);
+        const __m256i gapMask = SRSimd::SetToBitOctet(gaps);
+        const __m256 priors = _mm256_andnot_ps(_mm256_castsi256_ps(gapMask),
+          SRSimd::Load<true>(pPriors + iTileV + j));
+        SRSimd::Store<true>(pTileMasks + j, gapMask);
+        SRSimd::Store<true>(pTilePriors + j, priors);
+        SRSimd::Store<true>(pTileMuls + j, _mm256_mul_ps(SRSimd::Load<true>(pInvDi + iTileV + j), priors));
+      }
+      for (TPqaId k = 0; k < nAnswers; k++, psAi += nTileVectsCur) {
+        const __m256d invWk = pInvW[k];
+        SRAccumVectDbl256 &PTR_RESTRICT accEnt = pAccLhEnt[k];
+        SRAccumVectDbl256 &PTR_RESTRICT accV = pAccV[k];
+        for (size_t j = 0; j < nCurVects; j++) {
+          const __m256 likelihood = _mm256_mul_ps(SRSimd::Load<false>(psAi + j), SRSimd::Load<true>(pTileMuls + j));
+          const __m256i gapMask = SRSimd::Load<true>(pTileMasks + j);
+          const __m256 priors = SRSimd::Load<true>(pTilePriors + j);
+          const __m256 invDij = SRSimd::Load<true>(pInvDi + iTileV + j);
+          ConsiderQuad(SRSimd::WidenLowF32(likelihood), invWk, _mm256_castsi256_pd(SRSimd::WidenLowI32(gapMask)),
+            SRSimd::WidenLowF32(priors), SRSimd::WidenLowF32(invDij), accEnt, accV, accL);
+          ConsiderQuad(SRSimd::WidenHighF32(likelihood), invWk, _mm256_castsi256_pd(SRSimd::WidenHighI32(gapMask)),
+            SRSimd::WidenHighF32(priors), SRSimd::WidenHighF32(invDij), accEnt, accV, accL);
+        }
+      }
+      iTileV = iTileLim;
+    }
 
-    if (priority <= 0 || !std::isfinite(priority)) {
-      LOCLOG(Warning) << SR_FILE_LINE "Got priority=" << priority;
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      double velocity;
+      const double entropyHik = -pAccLhEnt[k].PairSum(pAccV[k], velocity);
+      pAnsMets[k]._entropy.SetValue(entropyHik);
+      pAnsMets[k]._velocity.SetValue(velocity);
     }
+
+    const double priority = CalcPriority(engine, pAnsMets, accTotW.Get().GetValue(), -accL.PreciseSum(),
+      task._nValidTargets);
     accRunLength.Add(SRDoubleNumber::FromDouble(priority));
 
-    task._pRunLength[i] = accRunLength.Get(); 
+    task._pRunLength[i] = accRunLength.Get();
   }
-  //TODO: perhaps check task._pRunLength[_iLimit-1] for overflow/underflow instead of CpuEngine::NextQuestion()
+}
+
+template<> void CEEvalQsSubtaskConsider<SRFloatNumber>::Run() {
+  // Both layouts of cube A are processed by the tiled kernel: row-major layout is a single tile.
+  RunTiled();
 }
 
 } // namespace ProbQA
@@ -5,7 +5,9 @@
 #pragma once
 
 #include "../PqaCore/CEEvalQsTask.fwd.h"
+#include "../PqaCore/BaseCpuEngine.fwd.h"
 #include "../PqaCore/Interface/PqaCommon.h"
+#include "../PqaCore/AnswerMetrics.h"
 
 namespace ProbQA {
 
@@ -17,12 +19,31 @@ public: // constants
   static constexpr double _cMaxV = SRMath::_cSqrt2;
   static constexpr double _cLnMaxV = SRMath::_cLnSqrt2;
   static constexpr double _cLn0Stab = -746; // stabilizer for std::log(0)
+  // The largest number of answers for which the row-major kernel is specialized.
+  static constexpr TPqaId _cMaxUnrolledAnswers = 8;
 
 private: // methods
   static double CalcVelocityComponent(const double V, const TPqaId nTargets);
+  // The kernel for row-major layout of cube A: [iQuestion][iAnswer][iTarget]
+  void RunRowMajor();
+  // The same for |taNAnswers| answers known at compile time, looping over the answers inside the loop over the targets,
+  //   so that the priors, the gap masks and 1/D of a vector of targets are loaded once for all the answers, and cube A
+  //   is read once per question.
+  template<TPqaId taNAnswers> void RunRowMajorAnswers();
+  // The same as RunRowMajor() with AVX-512, if the engine has selected it.
+  void RunRowMajor512();
+  // The same as RunRowMajor() over the active vectors of targets, if the quiz prunes them. Any layout of A .
+  void RunActive();
+  // The kernel for tiled layout of cube A: [iQuestion][targetTile][iAnswer][targetInTile] . For taNumber=SRFloatNumber,
+  //   row-major layout is processed as a single tile.
+  void RunTiled();
 
 public: // methods
   static size_t CalcStackReq(const EngineDefinition& engDef);
+  // Combine the metrics of the answers of a question into the priority of the question. The metrics are in double
+  //   precision regardless of taNumber.
+  static double CalcPriority(const BaseCpuEngine &engine, const AnswerMetrics<SRPlat::SRDoubleNumber> *pAnsMets,
+    const double totW, const double lack, const TPqaId nValidTargets);
 
   using SRPlat::SRStandardSubtask::SRStandardSubtask;
   virtual void Run() override final;
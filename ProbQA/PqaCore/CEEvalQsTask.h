@@ -18,17 +18,19 @@ template<typename taNumber> class CEEvalQsTask : public CEBaseTask {
   friend class CEEvalQsSubtaskConsider<taNumber>;
 
   const CEQuiz<taNumber> *const _pQuiz;
-  taNumber *const _pRunLength;
+  // The priorities of the questions span a range beyond float, so their run lengths are in double precision regardless
+  //   of taNumber.
+  SRPlat::SRDoubleNumber *const _pRunLength;
   const TPqaId _nValidTargets;
 
 public: // methods
   explicit inline CEEvalQsTask(CpuEngine<taNumber> &engine, const CEQuiz<taNumber> &quiz, const TPqaId nValidTargets,
-    taNumber *pRunLength)
+    SRPlat::SRDoubleNumber *pRunLength)
     : CEBaseTask(engine), _pQuiz(&quiz), _nValidTargets(nValidTargets), _pRunLength(pRunLength)
   { }
 
   const CEQuiz<taNumber>& GetQuiz() const { return *_pQuiz; }
-  const taNumber* GetRunLength() const { return _pRunLength; }
+  const SRPlat::SRDoubleNumber* GetRunLength() const { return _pRunLength; }
 };
 
 } // namespace ProbQA
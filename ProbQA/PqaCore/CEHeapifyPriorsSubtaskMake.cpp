@@ -14,6 +14,7 @@ namespace ProbQA {
 //TODO: because this class is not likely to have specialized methods, to avoid excessive listing of all the supported
 //  template arguments here, move the implementation to fwd/decl/h header-only idiom.
 template class CEHeapifyPriorsSubtaskMake<SRDoubleNumber>;
+template class CEHeapifyPriorsSubtaskMake<SRFloatNumber>;
 
 template<typename taNumber> struct CEHeapifyPriorsSubtaskMake<taNumber>::Context {
   const TTask *PTR_RESTRICT _pTask;
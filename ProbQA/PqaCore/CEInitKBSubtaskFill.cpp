@@ -0,0 +1,45 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEInitKBSubtaskFill.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template<typename taNumber> void CEInitKBSubtaskFill<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  CEKBArena<taNumber> &PTR_RESTRICT kb = task.ModKB();
+  const EngineDimensions &PTR_RESTRICT dims = task.GetBaseEngine().GetDims();
+  const size_t nQuestions = SRCast::ToSizeT(dims._nQuestions);
+  const size_t nAnswers = SRCast::ToSizeT(dims._nAnswers);
+  const size_t iFirst = SRCast::ToSizeT(_iFirst);
+  const size_t iLimit = SRCast::ToSizeT(_iLimit);
+  constexpr uint8_t logNumsPerVect = CEKBArena<taNumber>::_cLogNumsPerVect;
+
+  for (size_t i = 0; i < nQuestions; i++) {
+    for (size_t k = 0; k < nAnswers; k++) {
+      for (size_t j = iFirst; j < iLimit;) {
+        size_t jTileLim;
+        taNumber *pA = kb.ModAVects(i, k, j, jTileLim);
+        jTileLim = std::min(jTileLim, iLimit);
+        CEKBArena<taNumber>::template Fill<false>(pA, pA + ((jTileLim - j) << logNumsPerVect), task._initA);
+        j = jTileLim;
+      }
+    }
+  }
+  for (size_t i = 0; i < nQuestions; i++) {
+    CEKBArena<taNumber>::template Fill<false>(kb.ModD(i) + (iFirst << logNumsPerVect),
+      kb.ModD(i) + (iLimit << logNumsPerVect), task._initD);
+  }
+  CEKBArena<taNumber>::template Fill<false>(kb.ModB() + (iFirst << logNumsPerVect),
+    kb.ModB() + (iLimit << logNumsPerVect), task._initB);
+}
+
+template class CEInitKBSubtaskFill<SRDoubleNumber>;
+template class CEInitKBSubtaskFill<SRFloatNumber>;
+
+} // namespace ProbQA
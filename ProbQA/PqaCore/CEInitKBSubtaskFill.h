@@ -0,0 +1,21 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEInitKBTask.h"
+
+namespace ProbQA {
+
+// Fills the target vectors in range [_iFirst;_iLimit) of each row of cube A, matrix D and vector B.
+template<typename taNumber> class CEInitKBSubtaskFill : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEInitKBTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,46 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEInitKBSubtaskInvD.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template class CEInitKBSubtaskInvD<SRDoubleNumber>;
+template class CEInitKBSubtaskInvD<SRFloatNumber>;
+
+template<> void CEInitKBSubtaskInvD<SRDoubleNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = task.ModKB();
+  const size_t nQuestions = SRCast::ToSizeT(task.GetBaseEngine().GetDims()._nQuestions);
+
+  for (size_t i = 0; i < nQuestions; i++) {
+    const __m256d *PTR_RESTRICT pmDi = SRCast::CPtr<__m256d>(kb.GetD(i));
+    __m256d *PTR_RESTRICT pInvDi = SRCast::Ptr<__m256d>(kb.ModInvD(i));
+    for (int64_t j = _iFirst; j < _iLimit; j++) {
+      SRSimd::Store<false>(pInvDi + j, _mm256_div_pd(SRVectMath::_cdOne256, SRSimd::Load<false>(pmDi + j)));
+    }
+  }
+  _mm_sfence();
+}
+
+template<> void CEInitKBSubtaskInvD<SRFloatNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  CEKBArena<SRFloatNumber> &PTR_RESTRICT kb = task.ModKB();
+  const size_t nQuestions = SRCast::ToSizeT(task.GetBaseEngine().GetDims()._nQuestions);
+
+  for (size_t i = 0; i < nQuestions; i++) {
+    const __m256 *PTR_RESTRICT pmDi = SRCast::CPtr<__m256>(kb.GetD(i));
+    __m256 *PTR_RESTRICT pInvDi = SRCast::Ptr<__m256>(kb.ModInvD(i));
+    for (int64_t j = _iFirst; j < _iLimit; j++) {
+      SRSimd::Store<false>(pInvDi + j, _mm256_div_ps(SRVectMath::_cfOne256, SRSimd::Load<false>(pmDi + j)));
+    }
+  }
+  _mm_sfence();
+}
+
+} // namespace ProbQA
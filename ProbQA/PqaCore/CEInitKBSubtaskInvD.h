@@ -0,0 +1,21 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEInitKBTask.h"
+
+namespace ProbQA {
+
+// Computes 1/D for the target vectors in range [_iFirst;_iLimit) of each question, from matrix D already in the KB.
+template<typename taNumber> class CEInitKBSubtaskInvD : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEInitKBTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,36 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CEBaseTask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Initialize the KB in parallel, split by target vectors. With NUMA-aware workers this is also the first touch of the
+//   KB memory, so that the pages holding the targets of a node get allocated on that node.
+template<typename taNumber> class CEInitKBTask : public CEBaseTask {
+  CEKBArena<taNumber> *const _pKb;
+
+public: // variables
+  const taNumber _initA;
+  const taNumber _initD;
+  const taNumber _initB;
+
+public:
+  explicit CEInitKBTask(CpuEngine<taNumber> &engine, CEKBArena<taNumber> &kb, const taNumber initA,
+    const taNumber initD, const taNumber initB) : CEBaseTask(engine), _pKb(&kb), _initA(initA), _initD(initD),
+    _initB(initB)
+  { }
+  // For the subtasks deriving data from the KB rather than filling it with the initial values.
+  explicit CEInitKBTask(CpuEngine<taNumber> &engine, CEKBArena<taNumber> &kb) : CEBaseTask(engine), _pKb(&kb),
+    _initA(), _initD(), _initB()
+  { }
+
+  CEKBArena<taNumber>& ModKB() const { return *_pKb; }
+};
+
+} // namespace ProbQA
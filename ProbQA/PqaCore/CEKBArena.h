@@ -0,0 +1,441 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaCommon.h"
+
+namespace ProbQA {
+
+// Single SIMD-aligned allocation holding the whole knowledge base of CPU engine: cube A, matrix D and vector B. Each
+//   target dimension is padded to a whole number of SIMD vectors (the target stride). Cube A comes first, as a block
+//   per question, then the rows of D, then the row of B.
+// The allocation may have spare capacity for the questions and the targets added in maintenance mode: the room for more
+//   blocks of A and rows of D than there are questions, and more items in a row than needed for the targets of the
+//   engine. The items after the targets of the engine are gaps for the kernels, so the capacity of targets is simply
+//   a longer padding of the rows, which KB file keeps too.
+// Within a question, cube A is stored as [targetTile][iAnswer][targetInTile] . In the row-major layout there is a
+//   single tile covering all the targets, so that it degenerates to [iAnswer][iTarget] and the weights are in the
+//   same order as in KB file. In the tiled layout the tile is a power-of-2 number of SIMD vectors, selected so that the
+//   tile of priors and the tiles of all the answers fit L1 cache, and the last tile of a question may be shorter.
+// Optionally, the arena also holds the table of 1/D[iQuestion][iTarget] after vector B, so that the kernels multiply
+//   by it rather than divide by D. It's derived data, thus not a part of KB file.
+// Instead of the allocation, the KB can be a view of a memory-mapped KB file, if the layout of the rows in the file is
+//   the same as in the arena. Then cube A, matrix D and vector B may be apart, as in the sections of KB file, and the
+//   table of 1/D is allocated separately.
+// This class is not thread-safe: the engine guards it with its reader-writer lock, or keeps two instances of it for the
+//   readers pinning the epochs (see CEKBEpochs).
+template<typename taNumber> class CEKBArena {
+  static_assert(SRPlat::SRSimd::_cNBytes % sizeof(taNumber) == 0, "Number must be a divisor of SIMD size.");
+
+public: // constants
+  static constexpr size_t _cNumsPerVect = SRPlat::SRSimd::_cNBytes / sizeof(taNumber);
+  static constexpr uint8_t _cLogNumsPerVect = SRPlat::SRMath::StaticCeilLog2(_cNumsPerVect);
+
+private: // variables
+  taNumber *_pNums;
+  taNumber *_pD; // the rows of D
+  taNumber *_pB; // the row of B
+  taNumber *_pInvD; // the rows of 1/D, if maintained
+  SRPlat::SRFileMapping _mapping;
+  size_t _nTargStride; // number of items in a row, including the padding
+  size_t _nTargVects; // number of SIMD vectors in a row
+  size_t _nAnswers;
+  size_t _nQuestions;
+  size_t _nQuestCap; // number of questions there is room for
+  uint8_t _logTileVects;
+  bool _tiledA;
+  bool _bInvD; // whether the table of 1/D is maintained
+  bool _bPaged; // allocated in whole pages directly from the OS
+  bool _bLargePages; // backed by large pages
+  bool _bReadOnly; // a read-only view of the KB file
+  bool _bView; // a view of the memory owned by the client
+
+private: // methods
+  // The number of tile vectors such that a tile of priors, a tile of inverse D, and a tile of A plus a tile of
+  //   likelihoods for each answer, fit in the share of L1 cache of a logical core.
+  static uint8_t CalcLogTileVects(const size_t nAnswers) {
+    const size_t l1Bytes = SRPlat::SRCpuInfo::_l1DataCachePerPhysCoreBytes
+      / SRPlat::SRCpuInfo::_nLogicalCoresPerPhysCore;
+    const size_t maxVects = l1Bytes / ((2 * nAnswers + 2) * SRPlat::SRSimd::_cNBytes);
+    return (maxVects <= 1) ? 0 : (SRPlat::SRMath::CeilLog2(maxVects + 1) - 1);
+  }
+
+public: // methods
+  explicit CEKBArena() : _pNums(nullptr), _pD(nullptr), _pB(nullptr), _pInvD(nullptr), _nTargStride(0),
+    _nTargVects(0), _nAnswers(0), _nQuestions(0), _nQuestCap(0), _logTileVects(0), _tiledA(false), _bInvD(false),
+    _bPaged(false), _bLargePages(false), _bReadOnly(false), _bView(false)
+  { }
+  CEKBArena(const CEKBArena&) = delete;
+  CEKBArena& operator=(const CEKBArena&) = delete;
+  ~CEKBArena() { Clear(); }
+
+  static size_t CalcTargStride(const size_t nTargets) {
+    return SRPlat::SRSimd::VectsFromComps<taNumber>(nTargets) * _cNumsPerVect;
+  }
+
+private: // methods
+  void SetDims(const size_t nQuestions, const size_t nAnswers, const size_t nTargStride, const bool tiledA) {
+    _nTargStride = nTargStride;
+    _nTargVects = nTargStride >> _cLogNumsPerVect;
+    _nAnswers = nAnswers;
+    _nQuestions = nQuestions;
+    _nQuestCap = nQuestions;
+    _tiledA = tiledA;
+    // A single tile covers all the targets in the row-major layout.
+    const uint8_t logAllVects = SRPlat::SRMath::CeilLog2(std::max<size_t>(_nTargVects, 1));
+    _logTileVects = (tiledA ? std::min(CalcLogTileVects(nAnswers), logAllVects) : logAllVects);
+  }
+
+public: // methods
+
+  // Throws on allocation failure, leaving the arena empty. The items are left uninitialized. If |largePages| is
+  //   requested but large pages can't be obtained, falls back to regular pages.
+  void Allocate(const size_t nQuestions, const size_t nAnswers, const size_t nTargets, const bool tiledA,
+    const bool largePages, const bool invD)
+  {
+    AllocateCapacity(nQuestions, nQuestions, nAnswers, CalcTargStride(nTargets), tiledA, largePages, invD);
+  }
+
+  // Same as above, but with the room for |nQuestCap| questions, and |nTargStride| items in a row of targets, which must
+  //   be a whole number of SIMD vectors.
+  void AllocateCapacity(const size_t nQuestions, const size_t nQuestCap, const size_t nAnswers,
+    const size_t nTargStride, const bool tiledA, const bool largePages, const bool invD)
+  {
+    assert(nQuestions <= nQuestCap && (nTargStride & (_cNumsPerVect - 1)) == 0);
+    Clear();
+    const size_t nBytes = (nQuestCap * (nAnswers + (invD ? 2 : 1)) + 1) * nTargStride * sizeof(taNumber);
+    if (largePages) {
+      _pNums = SRPlat::SRCast::Ptr<taNumber>(SRPlat::SRLargePages::Alloc(nBytes, _bLargePages));
+      if (_pNums == nullptr) {
+        throw SRPlat::SRException(SRPlat::SRMessageBuilder(SR_FILE_LINE " failed to allocate ")(nBytes)(" bytes.")
+          .GetOwnedSRString());
+      }
+      _bPaged = true;
+    } else {
+      _pNums = SRPlat::SRCast::Ptr<taNumber>(SRPlat::SRUtils::ThrowingSimdAlloc(nBytes));
+    }
+    SetDims(nQuestions, nAnswers, nTargStride, tiledA);
+    _nQuestCap = nQuestCap;
+    _pD = _pNums + nQuestCap * nAnswers * nTargStride;
+    _pB = _pD + nQuestCap * nTargStride;
+    _bInvD = invD;
+    if (invD) {
+      _pInvD = _pB + nTargStride;
+    }
+  }
+
+  // Whether the rows of |nRowItems| items can hold |nTargets| targets, padded to whole SIMD vectors.
+  static bool IsTargStride(const size_t nTargets, const size_t nRowItems) {
+    return nRowItems >= CalcTargStride(nTargets) && (nRowItems & (_cNumsPerVect - 1)) == 0;
+  }
+
+  // Whether a KB file having |nFileRowItems| items in a row of targets, and cube A, matrix D and vector B at offsets
+  //   |offsA|, |offsD| and |offsB|, can be mapped as the arena: the file must have the same layout, i.e. the row-major
+  //   cube A and the rows padded as in the arena, and the weights must be SIMD-aligned.
+  static bool CanMap(const size_t nTargets, const size_t nFileRowItems, const bool tiledA, const uint64_t offsA,
+    const uint64_t offsD, const uint64_t offsB)
+  {
+    return !tiledA && IsTargStride(nTargets, nFileRowItems)
+      && ((offsA | offsD | offsB) & (SRPlat::SRSimd::_cNBytes - 1)) == 0;
+  }
+
+  // Point the arena into the mapping of the KB file, having |nTargStride| items in a row, instead of allocating it.
+  //   Returns false if the file can't be mapped or is too short, leaving the arena empty. Throws if the table of 1/D
+  //   can't be allocated.
+  bool Map(const char* const filePath, const uint64_t offsA, const uint64_t offsD, const uint64_t offsB,
+    const size_t nQuestions, const size_t nAnswers, const size_t nTargStride, const bool bReadOnly, const bool invD)
+  {
+    Clear();
+    assert(CanMap(0, nTargStride, false, offsA, offsD, offsB));
+    if (!_mapping.Map(filePath, bReadOnly ? SRPlat::SRFileMapping::Mode::ReadOnly
+      : SRPlat::SRFileMapping::Mode::CopyOnWrite))
+    {
+      return false;
+    }
+    SetDims(nQuestions, nAnswers, nTargStride, false);
+    const uint64_t rowBytes = nTargStride * sizeof(taNumber);
+    if (_mapping.GetNBytes() < offsA + nQuestions * nAnswers * rowBytes
+      || _mapping.GetNBytes() < offsD + nQuestions * rowBytes || _mapping.GetNBytes() < offsB + rowBytes)
+    {
+      Clear();
+      return false;
+    }
+    _pNums = SRPlat::SRCast::Ptr<taNumber>(_mapping.Get() + offsA);
+    _pD = SRPlat::SRCast::Ptr<taNumber>(_mapping.Get() + offsD);
+    _pB = SRPlat::SRCast::Ptr<taNumber>(_mapping.Get() + offsB);
+    _bReadOnly = bReadOnly;
+    _bInvD = invD;
+    if (invD) {
+      _pInvD = SRPlat::SRCast::Ptr<taNumber>(SRPlat::SRUtils::ThrowingSimdAlloc(
+        nQuestions * _nTargStride * sizeof(taNumber)));
+    }
+    return true;
+  }
+
+  // Point the arena into the client's memory of GetNBytes() for a row-major KB of the given dimensions, e.g. to make a
+  //   snapshot of the KB. The arena doesn't own the memory, and it has no table of 1/D.
+  void View(void *pMem, const size_t nQuestions, const size_t nAnswers, const size_t nTargStride) {
+    Clear();
+    SetDims(nQuestions, nAnswers, nTargStride, false);
+    _pNums = static_cast<taNumber*>(pMem);
+    _pD = _pNums + nQuestions * nAnswers * nTargStride;
+    _pB = _pD + nQuestions * nTargStride;
+    _bView = true;
+  }
+
+  void Clear() {
+    if (_bView) {
+      // The memory is the client's
+    } else if (_mapping.IsMapped()) {
+      _mapping.Unmap();
+      _mm_free(_pInvD);
+    } else if (_bPaged) {
+      SRPlat::SRLargePages::Free(_pNums);
+    } else {
+      _mm_free(_pNums);
+    }
+    _pNums = _pD = _pB = _pInvD = nullptr;
+    _nTargStride = _nTargVects = _nAnswers = _nQuestions = _nQuestCap = 0;
+    _logTileVects = 0;
+    _tiledA = _bInvD = _bPaged = _bLargePages = _bReadOnly = _bView = false;
+  }
+
+  // Fill the items in range [pFirst;pLimit), which must be at SIMD vector boundaries.
+  template<bool taCache> static void Fill(taNumber *pFirst, const taNumber *pLimit, const taNumber item) {
+    assert(pFirst <= pLimit && ((pLimit - pFirst) & (_cNumsPerVect - 1)) == 0);
+    const __m256i vect = SRPlat::SRUtils::Set1(item);
+    __m256i *PTR_RESTRICT p = SRPlat::SRCast::Ptr<__m256i>(pFirst);
+    for (size_t j = 0, jEn = (pLimit - pFirst) >> _cLogNumsPerVect; j < jEn; j++) {
+      taCache ? _mm256_store_si256(p + j, vect) : _mm256_stream_si256(p + j, vect);
+    }
+    if (!taCache) {
+      _mm_sfence();
+    }
+  }
+
+  // Fill the padding items after |nTargets| in each target dimension, so that the kernels operating on whole vectors
+  //   don't get garbage like NaNs or denormals there.
+  void FillPadding(const size_t nTargets, const taNumber item) {
+    assert(nTargets <= _nTargStride);
+    for (size_t i = 0; i < _nQuestions; i++) {
+      for (size_t k = 0; k < _nAnswers; k++) {
+        for (size_t j = nTargets; j < _nTargStride; j++) {
+          ModA(i, k, j) = item;
+        }
+      }
+      for (size_t j = nTargets; j < _nTargStride; j++) {
+        ModD(i)[j] = item;
+      }
+    }
+    for (size_t j = nTargets; j < _nTargStride; j++) {
+      ModB()[j] = item;
+    }
+  }
+
+  // Copy the weights and the table of 1/D from |src|, which must have been allocated or mapped with the same
+  //   dimensions, layout and table of 1/D.
+  void CopyFrom(const CEKBArena &src) {
+    assert(_nQuestions == src._nQuestions && _nAnswers == src._nAnswers && _nTargStride == src._nTargStride
+      && _logTileVects == src._logTileVects && _bInvD == src._bInvD);
+    const size_t rowBytes = _nTargStride * sizeof(taNumber);
+    std::memcpy(_pNums, src._pNums, _nQuestions * _nAnswers * rowBytes);
+    std::memcpy(_pD, src._pD, _nQuestions * rowBytes);
+    std::memcpy(_pB, src._pB, rowBytes);
+    if (_bInvD) {
+      std::memcpy(_pInvD, src._pInvD, _nQuestions * rowBytes);
+    }
+  }
+
+  // Copy the weights and the table of 1/D from |src|, which must have been allocated or mapped with the same number of
+  //   answers and the table of 1/D, and with at most as many questions and items in a row as this arena. The layouts
+  //   of cube A may differ.
+  void CopyGrown(const CEKBArena &src) {
+    assert(src._nQuestions <= _nQuestions && src._nAnswers == _nAnswers && src._nTargStride <= _nTargStride
+      && src._bInvD == _bInvD);
+    const size_t rowBytes = src._nTargStride * sizeof(taNumber);
+    for (size_t i = 0; i < src._nQuestions; i++) {
+      for (size_t k = 0; k < _nAnswers; k++) {
+        for (size_t iVect = 0; iVect < src._nTargVects;) {
+          size_t iSrcLim, iDestLim;
+          const taNumber *pSrc = src.GetAVects(i, k, iVect, iSrcLim);
+          taNumber *pDest = ModAVects(i, k, iVect, iDestLim);
+          const size_t iVectLim = std::min(iSrcLim, iDestLim);
+          std::memcpy(pDest, pSrc, (iVectLim - iVect) * SRPlat::SRSimd::_cNBytes);
+          iVect = iVectLim;
+        }
+      }
+      std::memcpy(ModD(i), src.GetD(i), rowBytes);
+      if (_bInvD) {
+        std::memcpy(ModInvD(i), src.GetInvD(i), rowBytes);
+      }
+    }
+    std::memcpy(ModB(), src.GetB(), rowBytes);
+  }
+
+  // Take over the allocation of |src|, which mustn't be a mapping or a view, leaving |src| empty.
+  void TakeFrom(CEKBArena &src) {
+    assert(!src._mapping.IsMapped() && !src._bView);
+    Clear();
+    _pNums = src._pNums;
+    _pD = src._pD;
+    _pB = src._pB;
+    _pInvD = src._pInvD;
+    _nTargStride = src._nTargStride;
+    _nTargVects = src._nTargVects;
+    _nAnswers = src._nAnswers;
+    _nQuestions = src._nQuestions;
+    _nQuestCap = src._nQuestCap;
+    _logTileVects = src._logTileVects;
+    _tiledA = src._tiledA;
+    _bInvD = src._bInvD;
+    _bPaged = src._bPaged;
+    _bLargePages = src._bLargePages;
+    // Make |src| release nothing.
+    src._pNums = nullptr;
+    src._bPaged = false;
+    src.Clear();
+  }
+
+  // Grow to |nQuestions| questions within the capacity. The weights of the new questions are left uninitialized.
+  void GrowQuestions(const size_t nQuestions) {
+    assert(_nQuestions <= nQuestions && nQuestions <= _nQuestCap);
+    _nQuestions = nQuestions;
+  }
+
+  // Drop the questions after the first |nQuestions| ones, keeping the capacity.
+  void ShrinkQuestions(const size_t nQuestions) {
+    assert(nQuestions <= _nQuestions);
+    _nQuestions = nQuestions;
+  }
+
+  // Set the weights of question |iQuestion| for all the items in a row, and the row of 1/D .
+  void InitQuestion(const size_t iQuestion, const taNumber initA, const taNumber initD) {
+    for (size_t k = 0; k < _nAnswers; k++) {
+      for (size_t iVect = 0; iVect < _nTargVects;) {
+        size_t iVectLim;
+        taNumber *pA = ModAVects(iQuestion, k, iVect, iVectLim);
+        Fill<true>(pA, pA + ((iVectLim - iVect) << _cLogNumsPerVect), initA);
+        iVect = iVectLim;
+      }
+    }
+    Fill<true>(ModD(iQuestion), ModD(iQuestion) + _nTargStride, initD);
+    if (_bInvD) {
+      Fill<true>(ModInvD(iQuestion), ModInvD(iQuestion) + _nTargStride, taNumber(1 / initD.ToAmount()));
+    }
+  }
+
+  // Set the weights of the items [iFirst;iLimit) of the rows in all the questions, and the items of 1/D .
+  void InitTargets(const size_t iFirst, const size_t iLimit, const taNumber initA, const taNumber initD,
+    const taNumber initB)
+  {
+    assert(iFirst <= iLimit && iLimit <= _nTargStride);
+    const taNumber initInvD(1 / initD.ToAmount());
+    for (size_t i = 0; i < _nQuestions; i++) {
+      for (size_t k = 0; k < _nAnswers; k++) {
+        for (size_t j = iFirst; j < iLimit; j++) {
+          ModA(i, k, j) = initA;
+        }
+      }
+      for (size_t j = iFirst; j < iLimit; j++) {
+        ModD(i)[j] = initD;
+      }
+      if (_bInvD) {
+        for (size_t j = iFirst; j < iLimit; j++) {
+          ModInvD(i)[j] = initInvD;
+        }
+      }
+    }
+    for (size_t j = iFirst; j < iLimit; j++) {
+      ModB()[j] = initB;
+    }
+  }
+
+  // Copy from |src| the cells that a training of the given answered questions for |iTarget| changes.
+  void CopyTrained(const CEKBArena &src, const TPqaId nQuestions, const AnsweredQuestion* const pAQs,
+    const TPqaId iTarget)
+  {
+    const size_t iTarg = SRPlat::SRCast::ToSizeT(iTarget);
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      const size_t iQuestion = SRPlat::SRCast::ToSizeT(pAQs[i]._iQuestion);
+      const size_t iAnswer = SRPlat::SRCast::ToSizeT(pAQs[i]._iAnswer);
+      ModA(iQuestion, iAnswer, iTarg) = src.GetA(iQuestion, iAnswer, iTarg);
+      ModD(iQuestion)[iTarg] = src.GetD(iQuestion)[iTarg];
+      if (_bInvD) {
+        ModInvD(iQuestion)[iTarg] = src.GetInvD(iQuestion)[iTarg];
+      }
+    }
+    ModB()[iTarg] = src.GetB()[iTarg];
+  }
+
+  // Copy from |src| the rows of D and 1/D of the questions [iFirst;iLimit).
+  void CopyDRows(const CEKBArena &src, const size_t iFirst, const size_t iLimit) {
+    assert(iFirst <= iLimit && iLimit <= _nQuestions && _nTargStride == src._nTargStride && _bInvD == src._bInvD);
+    const size_t nBytes = (iLimit - iFirst) * _nTargStride * sizeof(taNumber);
+    std::memcpy(ModD(iFirst), src.GetD(iFirst), nBytes);
+    if (_bInvD) {
+      std::memcpy(ModInvD(iFirst), src.GetInvD(iFirst), nBytes);
+    }
+  }
+
+  // Offset of A[iQuestion][iAnswer][iTarget] from the beginning of the arena.
+  size_t AOffs(const size_t iQuestion, const size_t iAnswer, const size_t iTarget) const {
+    const size_t tileStart = (iTarget >> (_logTileVects + _cLogNumsPerVect)) << (_logTileVects + _cLogNumsPerVect);
+    const size_t tileLen = std::min(GetTileNums(), _nTargStride - tileStart);
+    return iQuestion * _nAnswers * _nTargStride + tileStart * _nAnswers + iAnswer * tileLen + (iTarget - tileStart);
+  }
+
+  const taNumber& GetA(const size_t iQuestion, const size_t iAnswer, const size_t iTarget) const {
+    return _pNums[AOffs(iQuestion, iAnswer, iTarget)];
+  }
+  taNumber& ModA(const size_t iQuestion, const size_t iAnswer, const size_t iTarget) {
+    return _pNums[AOffs(iQuestion, iAnswer, iTarget)];
+  }
+
+  // Get the pointer to SIMD vector |iVect| of targets in A[iQuestion][iAnswer], and the limit of vector indices
+  //   stored contiguously after it.
+  const taNumber* GetAVects(const size_t iQuestion, const size_t iAnswer, const size_t iVect, size_t &iVectLim) const
+  {
+    iVectLim = std::min(((iVect >> _logTileVects) + 1) << _logTileVects, _nTargVects);
+    return &GetA(iQuestion, iAnswer, iVect << _cLogNumsPerVect);
+  }
+  taNumber* ModAVects(const size_t iQuestion, const size_t iAnswer, const size_t iVect, size_t &iVectLim) {
+    iVectLim = std::min(((iVect >> _logTileVects) + 1) << _logTileVects, _nTargVects);
+    return &ModA(iQuestion, iAnswer, iVect << _cLogNumsPerVect);
+  }
+
+  // The beginning of the block of A for |iQuestion|, i.e. the tiles of all the answers.
+  const taNumber* GetAQuestion(const size_t iQuestion) const { return _pNums + iQuestion * _nAnswers * _nTargStride; }
+  taNumber* ModAQuestion(const size_t iQuestion) { return _pNums + iQuestion * _nAnswers * _nTargStride; }
+
+  // The rows of D are contiguous, as well as the blocks of A.
+  const taNumber* GetD(const size_t iQuestion) const { return _pD + iQuestion * _nTargStride; }
+  taNumber* ModD(const size_t iQuestion) { return _pD + iQuestion * _nTargStride; }
+
+  const taNumber* GetB() const { return _pB; }
+  taNumber* ModB() { return _pB; }
+
+  // The rows of 1/D , only if HasInvD() .
+  const taNumber* GetInvD(const size_t iQuestion) const { return _pInvD + iQuestion * _nTargStride; }
+  taNumber* ModInvD(const size_t iQuestion) { return _pInvD + iQuestion * _nTargStride; }
+
+  size_t GetNQuestions() const { return _nQuestions; }
+  size_t GetQuestCap() const { return _nQuestCap; }
+  size_t GetNAnswers() const { return _nAnswers; }
+  size_t GetTargStride() const { return _nTargStride; }
+  size_t GetTargVects() const { return _nTargVects; }
+  uint8_t GetLogTileVects() const { return _logTileVects; }
+  size_t GetTileVects() const { return size_t(1) << _logTileVects; }
+  size_t GetTileNums() const { return size_t(1) << (_logTileVects + _cLogNumsPerVect); }
+  bool IsTiledA() const { return _tiledA; }
+  bool HasInvD() const { return _bInvD; }
+  bool IsLargePages() const { return _bLargePages; }
+  bool IsMapped() const { return _mapping.IsMapped(); }
+  // Whether the KB is a read-only view of the KB file, so it can't be trained.
+  bool IsReadOnly() const { return _bReadOnly; }
+  // The number of bytes of the KB weights, excluding the derived data.
+  size_t GetNBytes() const { return (_nQuestions * (_nAnswers + 1) + 1) * _nTargStride * sizeof(taNumber); }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,269 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Compression of the KB weights for KB file, by blocks of rows so that the blocks are encoded and decoded in parallel.
+//   The rows are in the order of the file: the rows of cube A, then the rows of matrix D, then the row of vector B,
+//   each padded as in the arena. Each number is XORed with the previous one in the block (zero for the first), as
+//   Gorilla time-series database does for floating-point values:
+//   '0' - the XOR is zero, i.e. the number repeats;
+//   '10' - the meaningful bits of the XOR fit the window of the previous non-zero XOR, and they follow;
+//   '11' - the number of leading zeros, the number of meaningful bits minus 1, then the meaningful bits.
+//   The initial and the rarely trained weights repeat, while the neighbouring trained ones share the sign, the exponent
+//   and the high bits of the mantissa. The bits are written most significant first.
+template<typename taNumber> class CEKBCodec {
+public: // types
+  typedef std::conditional_t<sizeof(taNumber) == sizeof(uint64_t), uint64_t, uint32_t> TBits;
+  static_assert(sizeof(TBits) == sizeof(taNumber), "The number must be of 4 or 8 bytes.");
+
+public: // constants
+  static constexpr uint8_t _cNBits = sizeof(TBits) * 8;
+  static constexpr uint8_t _cLogNBits = SRPlat::SRMath::StaticCeilLog2(_cNBits);
+  // The approximate size of the weights in a block before encoding.
+  static constexpr size_t _cBlockBytes = size_t(1024) * 1024;
+
+private: // types
+  class BitWriter {
+    uint8_t *_pOut;
+    uint64_t _acc; // the bits not stored yet, from the highest
+    uint8_t _nAccBits;
+
+  private: // methods
+    void Store() {
+      const uint64_t word = _byteswap_uint64(_acc);
+      std::memcpy(_pOut, &word, sizeof(word));
+      _pOut += sizeof(word);
+      _acc = 0;
+      _nAccBits = 0;
+    }
+
+  public: // methods
+    explicit BitWriter(uint8_t *pOut) : _pOut(pOut), _acc(0), _nAccBits(0) { }
+
+    // Append the lowest |nBits| of |bits|, which must be zeros above them. |nBits| must be in [1;64].
+    void Put(const uint64_t bits, const uint8_t nBits) {
+      assert(1 <= nBits && nBits <= 64 && (nBits == 64 || (bits >> nBits) == 0));
+      const uint8_t nFree = 64 - _nAccBits;
+      if (nBits < nFree) {
+        _acc |= bits << (nFree - nBits);
+        _nAccBits += nBits;
+        return;
+      }
+      const uint8_t nRest = nBits - nFree;
+      _acc |= bits >> nRest;
+      Store();
+      if (nRest != 0) {
+        _acc = bits << (64 - nRest);
+        _nAccBits = nRest;
+      }
+    }
+
+    // Store the remaining bits, padded with zeros to a whole byte. Returns the limit of the bytes written.
+    uint8_t* Finish() {
+      const uint64_t word = _byteswap_uint64(_acc);
+      const size_t nBytes = (_nAccBits + 7) >> 3;
+      std::memcpy(_pOut, &word, nBytes);
+      return _pOut + nBytes;
+    }
+  };
+
+  class BitReader {
+    const uint8_t *_pIn;
+    const uint8_t *const _pLim;
+    uint64_t _acc; // the bits not consumed yet, from the highest
+    uint8_t _nAccBits;
+    uint8_t _nPadBits; // the lowest bits of |_acc| that are the zeros past the end of the input
+    bool _bOverrun;
+
+  private: // methods
+    // The next 8 bytes of the input, padded with zeros past its end.
+    uint64_t Load() {
+      uint64_t word = 0;
+      const size_t nBytes = std::min<size_t>(sizeof(word), _pLim - _pIn);
+      if (nBytes == 0) {
+        _bOverrun = true;
+      }
+      std::memcpy(&word, _pIn, nBytes);
+      _pIn += nBytes;
+      _nPadBits = uint8_t((sizeof(word) - nBytes) * 8);
+      return _byteswap_uint64(word);
+    }
+
+  public: // methods
+    explicit BitReader(const uint8_t *pIn, const size_t nBytes) : _pIn(pIn), _pLim(pIn + nBytes), _acc(0),
+      _nAccBits(0), _nPadBits(0), _bOverrun(false)
+    { }
+
+    // |nBits| must be in [1;64].
+    uint64_t Get(const uint8_t nBits) {
+      assert(1 <= nBits && nBits <= 64);
+      if (nBits <= _nAccBits) {
+        const uint64_t bits = _acc >> (64 - nBits);
+        _acc = (nBits == 64) ? 0 : (_acc << nBits);
+        _nAccBits -= nBits;
+        return bits;
+      }
+      const uint8_t nRest = nBits - _nAccBits;
+      const uint64_t high = (_nAccBits == 0) ? 0 : (_acc >> (64 - _nAccBits));
+      const uint64_t word = Load();
+      const uint64_t bits = ((nRest == 64) ? 0 : (high << nRest)) | (word >> (64 - nRest));
+      _acc = (nRest == 64) ? 0 : (word << nRest);
+      _nAccBits = 64 - nRest;
+      return bits;
+    }
+
+    // Whether the input ended before the bits requested, i.e. it's damaged.
+    bool IsOverrun() const { return _bOverrun || _nAccBits < _nPadBits; }
+    // Whether all the input has been consumed, except the padding of the last byte.
+    bool IsAtEnd() const { return _pIn == _pLim && _nAccBits < _nPadBits + 8; }
+  };
+
+  // The state carried from a number to the next one within a block.
+  struct State {
+    TBits _prev = 0;
+    uint8_t _nLeading = 0;
+    uint8_t _nTrailing = 0;
+    bool _bWindow = false;
+  };
+
+private: // methods
+  static uint8_t CountLeading(const TBits x) {
+    unsigned long iBit;
+    _BitScanReverse64(&iBit, uint64_t(x));
+    return uint8_t(_cNBits - 1 - iBit);
+  }
+  static uint8_t CountTrailing(const TBits x) {
+    unsigned long iBit;
+    _BitScanForward64(&iBit, uint64_t(x));
+    return uint8_t(iBit);
+  }
+
+  static void Encode(BitWriter &bw, State &st, const TBits cur) {
+    const TBits x = cur ^ st._prev;
+    st._prev = cur;
+    if (x == 0) {
+      bw.Put(0, 1);
+      return;
+    }
+    const uint8_t nLeading = CountLeading(x);
+    const uint8_t nTrailing = CountTrailing(x);
+    if (st._bWindow && nLeading >= st._nLeading && nTrailing >= st._nTrailing) {
+      bw.Put(2, 2);
+      bw.Put(x >> st._nTrailing, _cNBits - st._nLeading - st._nTrailing);
+      return;
+    }
+    const uint8_t nMeaningful = _cNBits - nLeading - nTrailing;
+    bw.Put((uint64_t(3) << (2 * _cLogNBits)) | (uint64_t(nLeading) << _cLogNBits) | (nMeaningful - 1),
+      2 + 2 * _cLogNBits);
+    bw.Put(x >> nTrailing, nMeaningful);
+    st._nLeading = nLeading;
+    st._nTrailing = nTrailing;
+    st._bWindow = true;
+  }
+
+  // Returns false if the input is damaged.
+  static bool Decode(BitReader &br, State &st, TBits &cur) {
+    if (br.Get(1) == 0) {
+      cur = st._prev;
+      return true;
+    }
+    if (br.Get(1) == 0) {
+      if (!st._bWindow) {
+        return false;
+      }
+    } else {
+      const uint64_t lens = br.Get(2 * _cLogNBits);
+      const uint8_t nLeading = uint8_t(lens >> _cLogNBits);
+      const uint8_t nMeaningful = uint8_t(lens & ((uint64_t(1) << _cLogNBits) - 1)) + 1;
+      if (nLeading + nMeaningful > _cNBits) {
+        return false;
+      }
+      st._nLeading = nLeading;
+      st._nTrailing = _cNBits - nLeading - nMeaningful;
+      st._bWindow = true;
+    }
+    const TBits x = TBits(br.Get(_cNBits - st._nLeading - st._nTrailing)) << st._nTrailing;
+    cur = st._prev ^ x;
+    st._prev = cur;
+    return true;
+  }
+
+  // Call |fn(pItems, nItems)| for the contiguous runs of the numbers in rows [iFirst;iLimit), in the order of the rows
+  //   and of the targets within a row. A row of tiled cube A is split into the runs by the tiles.
+  template<typename taFunc> static void ForEachRun(const CEKBArena<taNumber> &kb, const size_t iFirst,
+    const size_t iLimit, const taFunc &fn)
+  {
+    const size_t nAnswers = kb.GetNAnswers();
+    const size_t nARows = kb.GetNQuestions() * nAnswers;
+    const size_t nTargStride = kb.GetTargStride();
+    const size_t nTargVects = kb.GetTargVects();
+    for (size_t r = iFirst; r < iLimit; r++) {
+      if (r < nARows) {
+        for (size_t iVect = 0; iVect < nTargVects;) {
+          size_t iVectLim;
+          const taNumber *pTile = kb.GetAVects(r / nAnswers, r % nAnswers, iVect, iVectLim);
+          fn(pTile, (iVectLim - iVect) << CEKBArena<taNumber>::_cLogNumsPerVect);
+          iVect = iVectLim;
+        }
+      } else if (r < nARows + kb.GetNQuestions()) {
+        fn(kb.GetD(r - nARows), nTargStride);
+      } else {
+        fn(kb.GetB(), nTargStride);
+      }
+    }
+  }
+
+public: // methods
+  static size_t CalcNRows(const CEKBArena<taNumber> &kb) { return kb.GetNQuestions() * (kb.GetNAnswers() + 1) + 1; }
+  static size_t CalcRowsPerBlock(const size_t nTargStride) {
+    return std::max<size_t>(1, _cBlockBytes / (nTargStride * sizeof(taNumber)));
+  }
+  // The most bytes that |nRows| rows can take once encoded.
+  static size_t CalcMaxBytes(const size_t nRows, const size_t nTargStride) {
+    return (nRows * nTargStride * (2 + 2 * _cLogNBits + _cNBits) + 7) >> 3;
+  }
+
+  // Encode rows [iFirst;iLimit) of |kb| as a block to |pOut|, having CalcMaxBytes() bytes. Returns the number of bytes
+  //   written.
+  static size_t EncodeRows(const CEKBArena<taNumber> &kb, const size_t iFirst, const size_t iLimit, uint8_t *pOut) {
+    BitWriter bw(pOut);
+    State st;
+    ForEachRun(kb, iFirst, iLimit, [&](const taNumber *pItems, const size_t nItems) {
+      const uint8_t *pBytes = reinterpret_cast<const uint8_t*>(pItems);
+      for (size_t j = 0; j < nItems; j++) {
+        TBits cur;
+        std::memcpy(&cur, pBytes + j * sizeof(TBits), sizeof(cur));
+        Encode(bw, st, cur);
+      }
+    });
+    return bw.Finish() - pOut;
+  }
+
+  // Decode into rows [iFirst;iLimit) of |kb| the block of |nBytes| at |pIn|. Returns false if the block is damaged,
+  //   including when it's truncated or has extra bytes, without reading past |nBytes|.
+  static bool DecodeRows(CEKBArena<taNumber> &kb, const size_t iFirst, const size_t iLimit, const uint8_t *pIn,
+    const size_t nBytes)
+  {
+    BitReader br(pIn, nBytes);
+    State st;
+    bool bOk = true;
+    ForEachRun(kb, iFirst, iLimit, [&](const taNumber *pItems, const size_t nItems) {
+      // The runs are located in the const arena, while they belong to |kb| which is being decoded into.
+      uint8_t *pBytes = reinterpret_cast<uint8_t*>(const_cast<taNumber*>(pItems));
+      for (size_t j = 0; bOk && j < nItems; j++) {
+        TBits cur = 0;
+        bOk = Decode(br, st, cur);
+        std::memcpy(pBytes + j * sizeof(TBits), &cur, sizeof(cur));
+      }
+    });
+    return bOk && !br.IsOverrun() && br.IsAtEnd();
+  }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,67 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEKBCodecSubtask.h"
+#include "../PqaCore/CEKBCodec.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template<typename taNumber> void CEKBCodecSubtask<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<TTask&>(*GetTask());
+  if (task.IsEncoding()) {
+    RunEncode(task);
+  } else {
+    RunDecode(task);
+  }
+}
+
+template<typename taNumber> void CEKBCodecSubtask<taNumber>::RunEncode(TTask &task) {
+  typedef CEKBCodec<taNumber> TCodec;
+  const CEKBArena<taNumber> &kb = task.GetKB();
+  const size_t nRows = TCodec::CalcNRows(kb);
+  // Each block is encoded into the buffer for the worst case, then appended to the bytes of the subtask, which grow to
+  //   about the size of the encoded blocks.
+  SRSmartMPP<uint8_t> smppBlock(task.GetBaseEngine().GetMemPool(),
+    TCodec::CalcMaxBytes(task._nRowsPerBlock, kb.GetTargStride()));
+  std::vector<uint8_t> &bytes = task._pSubtaskBytes[_iWorker];
+  bytes.clear();
+  for (int64_t iBlock = _iFirst; iBlock < _iLimit; iBlock++) {
+    const size_t iFirstRow = SRCast::ToSizeT(iBlock) * task._nRowsPerBlock;
+    const size_t iLimRow = std::min(iFirstRow + task._nRowsPerBlock, nRows);
+    const size_t nBytes = TCodec::EncodeRows(kb, iFirstRow, iLimRow, smppBlock.Get());
+    bytes.insert(bytes.end(), smppBlock.Get(), smppBlock.Get() + nBytes);
+    task._pBlockBytes[iBlock] = nBytes;
+  }
+}
+
+template<typename taNumber> void CEKBCodecSubtask<taNumber>::RunDecode(TTask &task) {
+  typedef CEKBCodec<taNumber> TCodec;
+  CEKBArena<taNumber> &kb = task.ModKB();
+  const size_t nRows = TCodec::CalcNRows(kb);
+  // The engine has checked that no block is larger than this.
+  SRSmartMPP<uint8_t> smppBlock(task.GetBaseEngine().GetMemPool(),
+    TCodec::CalcMaxBytes(task._nRowsPerBlock, kb.GetTargStride()));
+  for (int64_t iBlock = _iFirst; iBlock < _iLimit; iBlock++) {
+    const uint64_t blockStart = (iBlock == 0) ? 0 : task._pBlockEnds[iBlock - 1];
+    const size_t nBytes = SRCast::ToSizeT(task._pBlockEnds[iBlock] - blockStart);
+    const size_t iFirstRow = SRCast::ToSizeT(iBlock) * task._nRowsPerBlock;
+    const size_t iLimRow = std::min(iFirstRow + task._nRowsPerBlock, nRows);
+    if (!task.GetFile().ReadAt(smppBlock.Get(), nBytes, task._offsCoded + blockStart)
+      || !TCodec::DecodeRows(kb, iFirstRow, iLimRow, smppBlock.Get(), nBytes))
+    {
+      task.AddError(PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(task._filePath), SRMessageBuilder(
+        SR_FILE_LINE "Can't read or decode the block of the compressed KB weights #")(iBlock).GetOwnedSRString()));
+      return;
+    }
+  }
+}
+
+template class CEKBCodecSubtask<SRDoubleNumber>;
+template class CEKBCodecSubtask<SRFloatNumber>;
+
+} // namespace ProbQA
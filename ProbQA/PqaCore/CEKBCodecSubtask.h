@@ -0,0 +1,25 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEKBCodecTask.h"
+
+namespace ProbQA {
+
+// Encodes or decodes the blocks in range [_iFirst;_iLimit).
+template<typename taNumber> class CEKBCodecSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEKBCodecTask<taNumber> TTask;
+
+private: // methods
+  void RunEncode(TTask &task);
+  void RunDecode(TTask &task);
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
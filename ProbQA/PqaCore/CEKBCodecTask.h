@@ -0,0 +1,53 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CETask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Encode the weights of the KB into blocks of rows in memory, or decode the blocks read from a compressed KB file, in
+//   parallel, split by the blocks.
+template<typename taNumber> class CEKBCodecTask : public CETask {
+  const CEKBArena<taNumber> *const _pSource;
+  CEKBArena<taNumber> *const _pDest;
+  const SRPlat::SRPositionalFile *const _pFile;
+
+public: // variables
+  const char* const _filePath;
+  const size_t _nRowsPerBlock;
+  //// Encoding: the blocks of each subtask, and the size of each block.
+  std::vector<uint8_t> *const _pSubtaskBytes;
+  uint64_t *const _pBlockBytes;
+  //// Decoding: the offset of the encoded weights in the file, and the end of each block relative to it.
+  const uint64_t _offsCoded;
+  const uint64_t *const _pBlockEnds;
+
+public:
+  // For encoding |kb| into |pSubtaskBytes|, having an item per subtask.
+  explicit CEKBCodecTask(CpuEngine<taNumber> &engine, const SRPlat::SRSubtaskCount nWorkers,
+    const CEKBArena<taNumber> &kb, const size_t nRowsPerBlock, std::vector<uint8_t> *pSubtaskBytes,
+    uint64_t *pBlockBytes) : CETask(engine, nWorkers), _pSource(&kb), _pDest(nullptr), _pFile(nullptr),
+    _filePath(nullptr), _nRowsPerBlock(nRowsPerBlock), _pSubtaskBytes(pSubtaskBytes), _pBlockBytes(pBlockBytes),
+    _offsCoded(0), _pBlockEnds(nullptr)
+  { }
+
+  // For decoding the blocks from |file| into |kb|.
+  explicit CEKBCodecTask(CpuEngine<taNumber> &engine, const SRPlat::SRSubtaskCount nWorkers, CEKBArena<taNumber> &kb,
+    const size_t nRowsPerBlock, const SRPlat::SRPositionalFile &file, const char* const filePath,
+    const uint64_t offsCoded, const uint64_t *pBlockEnds) : CETask(engine, nWorkers), _pSource(&kb), _pDest(&kb),
+    _pFile(&file), _filePath(filePath), _nRowsPerBlock(nRowsPerBlock), _pSubtaskBytes(nullptr), _pBlockBytes(nullptr),
+    _offsCoded(offsCoded), _pBlockEnds(pBlockEnds)
+  { }
+
+  bool IsEncoding() const { return _pFile == nullptr; }
+  const CEKBArena<taNumber>& GetKB() const { return *_pSource; }
+  CEKBArena<taNumber>& ModKB() const { return *_pDest; }
+  const SRPlat::SRPositionalFile& GetFile() const { return *_pFile; }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,93 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/KBFileFormat.h"
+
+namespace ProbQA {
+
+// Tracks which pages of the weights in a sectioned KB file differ from the KB since the file was written, so that a
+//   checkpoint can rewrite just these pages. The pages are counted from the start of cube A section, and each section
+//   starts at a page boundary, so a page never spans two sections. Not thread-safe: the engine marks the pages under
+//   the exclusive KB lock.
+class CEKBDirtyPages {
+public: // constants
+  static constexpr uint8_t _cLogPageBytes = 12;
+  static_assert((uint64_t(1) << _cLogPageBytes) == KBFileDirectory::_cPageBytes, "Must track the pages of the file.");
+
+private: // variables
+  SRPlat::SRBitArray _isDirty;
+  // The file offsets of the sections of the weights.
+  uint64_t _offsA;
+  uint64_t _offsD;
+  uint64_t _offsB;
+  uint64_t _rowBytes;
+  uint64_t _nNumBytes;
+  uint64_t _nAnswers;
+  // Whether there is a file to compare with.
+  bool _bTracking;
+
+private: // methods
+  void Mark(const uint64_t offset) {
+    assert(_bTracking);
+    _isDirty.SetOne((offset - _offsA) >> _cLogPageBytes);
+  }
+
+public: // methods
+  explicit CEKBDirtyPages() : _isDirty(0), _offsA(0), _offsD(0), _offsB(0), _rowBytes(0), _nNumBytes(0), _nAnswers(0),
+    _bTracking(false)
+  { }
+
+  // Start tracking the changes since writing the weights with the layout of |dir|: all the pages are clean.
+  void Reset(const KBFileDirectory &dir, const size_t nNumBytes) {
+    const KBFileSection &sectA = *dir.Find(KBFileSectionKind::CubeA);
+    const KBFileSection &sectB = *dir.Find(KBFileSectionKind::VectorB);
+    _offsA = sectA._offset;
+    _offsD = dir.Find(KBFileSectionKind::MatrixD)->_offset;
+    _offsB = sectB._offset;
+    _rowBytes = sectA._rowBytes;
+    _nNumBytes = nNumBytes;
+    _nAnswers = SRPlat::SRCast::ToUint64(dir._header._dims._nAnswers);
+    const uint64_t nPages = (KBFileDirectory::AlignToPage(_offsB + sectB._nBytes) - _offsA) >> _cLogPageBytes;
+    _isDirty.ReduceTo(0);
+    _isDirty.GrowTo(nPages);
+    _bTracking = true;
+  }
+  // Stop tracking, e.g. when the file doesn't reflect the KB anymore.
+  void Stop() { _bTracking = false; }
+  bool IsTracking() const { return _bTracking; }
+
+  void MarkA(const TPqaId iQuestion, const TPqaId iAnswer, const TPqaId iTarget) {
+    Mark(_offsA + (SRPlat::SRCast::ToUint64(iQuestion) * _nAnswers + SRPlat::SRCast::ToUint64(iAnswer)) * _rowBytes
+      + SRPlat::SRCast::ToUint64(iTarget) * _nNumBytes);
+  }
+  void MarkD(const TPqaId iQuestion, const TPqaId iTarget) {
+    Mark(_offsD + SRPlat::SRCast::ToUint64(iQuestion) * _rowBytes + SRPlat::SRCast::ToUint64(iTarget) * _nNumBytes);
+  }
+  // Mark the whole rows of D of the questions [iFirst;iLimit).
+  void MarkDRows(const TPqaId iFirst, const TPqaId iLimit) {
+    if (iFirst >= iLimit) {
+      return;
+    }
+    const uint64_t iPageLim = ((_offsD + SRPlat::SRCast::ToUint64(iLimit) * _rowBytes - 1 - _offsA) >> _cLogPageBytes)
+      + 1;
+    for (uint64_t iPage = (_offsD + SRPlat::SRCast::ToUint64(iFirst) * _rowBytes - _offsA) >> _cLogPageBytes;
+      iPage < iPageLim; iPage++)
+    {
+      _isDirty.SetOne(iPage);
+    }
+  }
+  void MarkB(const TPqaId iTarget) {
+    Mark(_offsB + SRPlat::SRCast::ToUint64(iTarget) * _nNumBytes);
+  }
+
+  uint64_t GetNPages() const { return _isDirty.Size(); }
+  bool IsDirty(const uint64_t iPage) const { return _isDirty.GetOne(iPage); }
+  // Returns 64 adjacent flags of the pages starting at |iPage64| * 64, so to skip the clean pages quickly.
+  uint64_t GetDirty64(const uint64_t iPage64) const { return _isDirty.GetPacked<uint64_t>(iPage64); }
+  uint64_t GetPageOffset(const uint64_t iPage) const { return _offsA + (iPage << _cLogPageBytes); }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,123 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+namespace ProbQA {
+
+// The epochs of the readers of the KB in the epoch mode of the engine, where the KB is kept in two instances by the
+//   left-right scheme. The readers use the published instance without any lock, while a training updates the other
+//   instance. Then the trained instance is published, and once the grace period of the readers of the previous one is
+//   over, the previous instance catches up with the training and becomes the one to train next.
+// A reader pins the current epoch by incrementing its counter in a slot selected by the thread. The slots occupy
+//   separate cache lines, so that the readers on different cores don't contend. Each of the 2 alternating epochs has
+//   its own counters, so that the readers arriving meanwhile don't prolong the grace period.
+class CEKBEpochs {
+public: // constants
+  static constexpr uint32_t _cnSlots = 64;
+  static constexpr uint32_t _cYieldPeriod = 64;
+
+private: // types
+  struct alignas(SRPlat::SRCpuInfo::_cacheLineBytes) Slot {
+    std::atomic<uint64_t> _nPinned[2];
+  };
+
+private: // variables
+  Slot _slots[_cnSlots];
+  // The parity of the current epoch.
+  std::atomic<uint32_t> _iEpoch;
+  bool _bEnabled;
+
+private: // methods
+  static uint32_t GetSlot() {
+    // Windows thread identifiers are multiples of 4.
+    return (GetCurrentThreadId() >> 2) % _cnSlots;
+  }
+
+  void WaitUnpinned(const uint32_t iEpoch) {
+    for (uint32_t i = 0; i < _cnSlots; i++) {
+      uint32_t nSpins = 0;
+      while (_slots[i]._nPinned[iEpoch].load(std::memory_order_seq_cst) != 0) {
+        nSpins++;
+        if (nSpins >= _cYieldPeriod) {
+          nSpins = 0;
+          std::this_thread::yield();
+        } else {
+          _mm_pause();
+        }
+      }
+    }
+  }
+
+public: // methods
+  explicit CEKBEpochs() : _iEpoch(0), _bEnabled(false) {
+    for (uint32_t i = 0; i < _cnSlots; i++) {
+      _slots[i]._nPinned[0].store(0, std::memory_order_relaxed);
+      _slots[i]._nPinned[1].store(0, std::memory_order_relaxed);
+    }
+  }
+  CEKBEpochs(const CEKBEpochs&) = delete;
+  CEKBEpochs& operator=(const CEKBEpochs&) = delete;
+
+  // Must be called before the readers appear.
+  void Enable() { _bEnabled = true; }
+  bool IsEnabled() const { return _bEnabled; }
+
+  // Returns the token for Unpin().
+  uint32_t Pin() {
+    const uint32_t iSlot = GetSlot();
+    const uint32_t iEpoch = _iEpoch.load(std::memory_order_seq_cst);
+    _slots[iSlot]._nPinned[iEpoch].fetch_add(1, std::memory_order_seq_cst);
+    return (iSlot << 1) | iEpoch;
+  }
+  void Unpin(const uint32_t token) {
+    _slots[token >> 1]._nPinned[token & 1].fetch_sub(1, std::memory_order_release);
+  }
+
+  // Wait until no reader can be using the instance of the KB that was published before the caller published another
+  //   one. The callers must be serialized.
+  void Synchronize() {
+    const uint32_t iPrev = _iEpoch.load(std::memory_order_relaxed);
+    // A reader may have read the parity before the previous switch, and then pinned it after the previous grace period.
+    WaitUnpinned(iPrev ^ 1);
+    _iEpoch.store(iPrev ^ 1, std::memory_order_seq_cst);
+    WaitUnpinned(iPrev);
+  }
+};
+
+// The shared access of a reader to the KB: a pin of the epoch in the epoch mode, otherwise the shared KB lock.
+class CEKBReadGuard {
+  SRPlat::SRReaderWriterSync *_pRws;
+  CEKBEpochs *_pEpochs;
+  uint32_t _token;
+
+public: // methods
+  explicit CEKBReadGuard(SRPlat::SRReaderWriterSync &rws, CEKBEpochs &epochs) : _pRws(nullptr), _pEpochs(nullptr),
+    _token(0)
+  {
+    if (epochs.IsEnabled()) {
+      _token = epochs.Pin();
+      _pEpochs = &epochs;
+    } else {
+      rws.Acquire<false>();
+      _pRws = &rws;
+    }
+  }
+  CEKBReadGuard(const CEKBReadGuard&) = delete;
+  CEKBReadGuard& operator=(const CEKBReadGuard&) = delete;
+
+  void EarlyRelease() {
+    if (_pEpochs != nullptr) {
+      _pEpochs->Unpin(_token);
+      _pEpochs = nullptr;
+    }
+    if (_pRws != nullptr) {
+      _pRws->Release<false>();
+      _pRws = nullptr;
+    }
+  }
+  ~CEKBReadGuard() { EarlyRelease(); }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,95 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEKBFileSubtask.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template<typename taNumber> void CEKBFileSubtask<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<TTask&>(*GetTask());
+  CEKBArena<taNumber> &PTR_RESTRICT kb = task.ModKB();
+  const SRPositionalFile &file = task.GetFile();
+  // The dimensions are the arena's, because a snapshot is written without locking the engine.
+  const size_t nQuestions = kb.GetNQuestions();
+  const size_t nAnswers = kb.GetNAnswers();
+  const size_t nTargStride = kb.GetTargStride();
+  const size_t nRowItems = task._nFileRowItems;
+  const size_t rowBytes = nRowItems * sizeof(taNumber);
+  const size_t nARows = nQuestions * nAnswers;
+  const size_t nDRowsLim = nARows + nQuestions;
+  const size_t iFirst = SRCast::ToSizeT(_iFirst);
+  const size_t iLimit = SRCast::ToSizeT(_iLimit);
+  // The consecutive rows are contiguous both in the arena and in the file.
+  const bool bSameRows = (nRowItems == nTargStride);
+
+  auto fnTransfer = [&](taNumber *pItems, const size_t nBytes, const uint64_t offset) {
+    return task._bWrite ? file.WriteAt(pItems, nBytes, offset) : file.ReadAt(pItems, nBytes, offset);
+  };
+
+  bool bOk = true;
+  // Cube A
+  const size_t iALim = std::min(iLimit, nARows);
+  if (iFirst < iALim) {
+    if (!kb.IsTiledA() && bSameRows) {
+      bOk = fnTransfer(kb.ModAQuestion(0) + iFirst * nTargStride, (iALim - iFirst) * rowBytes,
+        task._offsA + iFirst * rowBytes);
+    } else if (!kb.IsTiledA()) {
+      for (size_t r = iFirst; bOk && r < iALim; r++) {
+        bOk = fnTransfer(&kb.ModA(r / nAnswers, r % nAnswers, 0), rowBytes, task._offsA + r * rowBytes);
+      }
+    } else {
+      // The tiles of a row are apart in the arena, so the row is gathered or scattered via a buffer.
+      SRSmartMPP<taNumber> smppRow(task.GetBaseEngine().GetMemPool(), nRowItems);
+      taNumber *const PTR_RESTRICT pRow = smppRow.Get();
+      const size_t nTileNums = kb.GetTileNums();
+      auto fnForEachTile = [&](const size_t r, const bool bToRow) {
+        for (size_t tileStart = 0; tileStart < nRowItems; tileStart += nTileNums) {
+          taNumber *pTile = &kb.ModA(r / nAnswers, r % nAnswers, tileStart);
+          const size_t nBytes = std::min(nTileNums, nRowItems - tileStart) * sizeof(taNumber);
+          bToRow ? std::memcpy(pRow + tileStart, pTile, nBytes) : std::memcpy(pTile, pRow + tileStart, nBytes);
+        }
+      };
+      for (size_t r = iFirst; bOk && r < iALim; r++) {
+        if (task._bWrite) {
+          fnForEachTile(r, true);
+          bOk = fnTransfer(pRow, rowBytes, task._offsA + r * rowBytes);
+        } else {
+          bOk = fnTransfer(pRow, rowBytes, task._offsA + r * rowBytes);
+          fnForEachTile(r, false);
+        }
+      }
+    }
+  }
+  // Matrix D
+  const size_t iDFirst = std::max(iFirst, nARows) - nARows;
+  const size_t iDLim = std::max(std::min(iLimit, nDRowsLim), nARows) - nARows;
+  if (bOk && iDFirst < iDLim) {
+    if (bSameRows) {
+      bOk = fnTransfer(kb.ModD(iDFirst), (iDLim - iDFirst) * rowBytes, task._offsD + iDFirst * rowBytes);
+    } else {
+      for (size_t i = iDFirst; bOk && i < iDLim; i++) {
+        bOk = fnTransfer(kb.ModD(i), rowBytes, task._offsD + i * rowBytes);
+      }
+    }
+  }
+  // Vector B
+  if (bOk && iFirst <= nDRowsLim && nDRowsLim < iLimit) {
+    bOk = fnTransfer(kb.ModB(), rowBytes, task._offsB);
+  }
+
+  if (!bOk) {
+    task.AddError(PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(task._filePath), SRMessageBuilder(
+      SR_FILE_LINE "Can't ")(task._bWrite ? "write" : "read")(" the KB weights in rows ")(iFirst)("..")(iLimit)
+      .GetOwnedSRString()));
+  }
+}
+
+template class CEKBFileSubtask<SRDoubleNumber>;
+template class CEKBFileSubtask<SRFloatNumber>;
+
+} // namespace ProbQA
@@ -0,0 +1,21 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEKBFileTask.h"
+
+namespace ProbQA {
+
+// Transfers the rows in range [_iFirst;_iLimit) of the KB weights between the arena and the file.
+template<typename taNumber> class CEKBFileSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEKBFileTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,43 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CETask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Read or write the weights of the KB from/to a file, in parallel, split by the rows of targets: the rows of cube A in
+//   row-major order, then the rows of matrix D, then the row of vector B. Each subtask transfers its range of rows with
+//   positional I/O, so the subtasks don't contend for a file pointer.
+template<typename taNumber> class CEKBFileTask : public CETask {
+  CEKBArena<taNumber> *const _pKb;
+  const SRPlat::SRPositionalFile *const _pFile;
+
+public: // variables
+  const char* const _filePath;
+  // The offsets of cube A, matrix D and vector B in the file.
+  const uint64_t _offsA;
+  const uint64_t _offsD;
+  const uint64_t _offsB;
+  // The number of items in a row of targets in the file: the number of targets in a legacy file, or the target
+  //   stride of the arena in a sectioned file.
+  const size_t _nFileRowItems;
+  const bool _bWrite;
+
+public:
+  explicit CEKBFileTask(CpuEngine<taNumber> &engine, const SRPlat::SRSubtaskCount nWorkers, CEKBArena<taNumber> &kb,
+    const SRPlat::SRPositionalFile &file, const char* const filePath, const uint64_t offsA, const uint64_t offsD,
+    const uint64_t offsB, const size_t nFileRowItems, const bool bWrite) : CETask(engine, nWorkers), _pKb(&kb),
+    _pFile(&file), _filePath(filePath), _offsA(offsA), _offsD(offsD), _offsB(offsB), _nFileRowItems(nFileRowItems),
+    _bWrite(bWrite)
+  { }
+
+  CEKBArena<taNumber>& ModKB() const { return *_pKb; }
+  const SRPlat::SRPositionalFile& GetFile() const { return *_pFile; }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,65 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CEKBSnapshotSubtask.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+// The stores bypass the cache, because the snapshot is only read back by the file writes, while the loads are cached
+//   because the source is the live KB.
+template<typename taNumber> void CEKBSnapshotSubtask<taNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  const CEKBArena<taNumber> &PTR_RESTRICT src = task.GetSource();
+  CEKBArena<taNumber> &PTR_RESTRICT dest = task.ModSnapshot();
+  const size_t nQuestions = src.GetNQuestions();
+  const size_t nAnswers = src.GetNAnswers();
+  const size_t nTargStride = src.GetTargStride();
+  const size_t nTargVects = src.GetTargVects();
+  const size_t nARows = nQuestions * nAnswers;
+  const size_t nDRowsLim = nARows + nQuestions;
+  const size_t iFirst = SRCast::ToSizeT(_iFirst);
+  const size_t iLimit = SRCast::ToSizeT(_iLimit);
+  assert(dest.GetNQuestions() == nQuestions && dest.GetNAnswers() == nAnswers && dest.GetTargStride() == nTargStride
+    && !dest.IsTiledA());
+
+  // Cube A
+  const size_t iALim = std::min(iLimit, nARows);
+  if (iFirst < iALim) {
+    if (!src.IsTiledA()) {
+      SRUtils::Copy256<false, true>(dest.ModAQuestion(0) + iFirst * nTargStride,
+        src.GetAQuestion(0) + iFirst * nTargStride, (iALim - iFirst) * nTargVects);
+    } else {
+      for (size_t r = iFirst; r < iALim; r++) {
+        const size_t i = r / nAnswers;
+        const size_t k = r % nAnswers;
+        for (size_t iVect = 0; iVect < nTargVects;) {
+          size_t iVectLim;
+          const taNumber *pTile = src.GetAVects(i, k, iVect, iVectLim);
+          SRUtils::Copy256<false, true>(&dest.ModA(i, k, iVect << CEKBArena<taNumber>::_cLogNumsPerVect), pTile,
+            iVectLim - iVect);
+          iVect = iVectLim;
+        }
+      }
+    }
+  }
+  // Matrix D
+  const size_t iDFirst = std::max(iFirst, nARows) - nARows;
+  const size_t iDLim = std::max(std::min(iLimit, nDRowsLim), nARows) - nARows;
+  if (iDFirst < iDLim) {
+    SRUtils::Copy256<false, true>(dest.ModD(iDFirst), src.GetD(iDFirst), (iDLim - iDFirst) * nTargVects);
+  }
+  // Vector B
+  if (iFirst <= nDRowsLim && nDRowsLim < iLimit) {
+    SRUtils::Copy256<false, true>(dest.ModB(), src.GetB(), nTargVects);
+  }
+}
+
+template class CEKBSnapshotSubtask<SRDoubleNumber>;
+template class CEKBSnapshotSubtask<SRFloatNumber>;
+
+} // namespace ProbQA
@@ -0,0 +1,21 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEKBSnapshotTask.h"
+
+namespace ProbQA {
+
+// Copies the rows in range [_iFirst;_iLimit) of the KB weights into the snapshot, including the padding.
+template<typename taNumber> class CEKBSnapshotSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CEKBSnapshotTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
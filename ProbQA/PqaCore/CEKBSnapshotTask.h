@@ -0,0 +1,28 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CEBaseTask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Copy the weights of the KB into a row-major snapshot in parallel, split by the rows of targets in the same order as
+//   CEKBFileTask: the rows of cube A, then the rows of matrix D, then the row of vector B.
+template<typename taNumber> class CEKBSnapshotTask : public CEBaseTask {
+  const CEKBArena<taNumber> *const _pSource;
+  CEKBArena<taNumber> *const _pSnapshot;
+
+public:
+  explicit CEKBSnapshotTask(CpuEngine<taNumber> &engine, const CEKBArena<taNumber> &source,
+    CEKBArena<taNumber> &snapshot) : CEBaseTask(engine), _pSource(&source), _pSnapshot(&snapshot)
+  { }
+
+  const CEKBArena<taNumber>& GetSource() const { return *_pSource; }
+  CEKBArena<taNumber>& ModSnapshot() const { return *_pSnapshot; }
+};
+
+} // namespace ProbQA
@@ -0,0 +1,46 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+namespace ProbQA {
+
+// The version of the weights of the KB, for the results computed from them to be cached. It's a sequence lock: the
+//   writers increment it before and after changing the KB, so that it's odd meanwhile, while a reader obtains it before
+//   a computation and checks after it that the version hasn't changed.
+class CEKBVersion {
+public: // constants
+  // Odd, so never equal to the version of an unchanging KB.
+  static constexpr uint64_t _cNone = std::numeric_limits<uint64_t>::max();
+
+private: // variables
+  std::atomic<uint64_t> _version;
+
+public: // types
+  // The scope of a change of the KB. The caller must hold the KB lock exclusively.
+  class Change {
+    CEKBVersion *_pKbv;
+  public:
+    explicit Change(CEKBVersion &kbv) : _pKbv(&kbv) { _pKbv->_version.fetch_add(1, std::memory_order_seq_cst); }
+    Change(const Change&) = delete;
+    Change& operator=(const Change&) = delete;
+    ~Change() { _pKbv->_version.fetch_add(1, std::memory_order_seq_cst); }
+  };
+
+public: // methods
+  explicit CEKBVersion() : _version(0) { }
+  CEKBVersion(const CEKBVersion&) = delete;
+  CEKBVersion& operator=(const CEKBVersion&) = delete;
+
+  // Returns an odd number while the KB is being changed.
+  uint64_t Get() const { return _version.load(std::memory_order_seq_cst); }
+  // Whether the KB was not being changed at |version| and hasn't changed since then, so that what has been computed
+  //   from the KB meanwhile is for |version|.
+  bool IsUnchanged(const uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (version & 1) == 0 && Get() == version;
+  }
+};
+
+} // namespace ProbQA
@@ -19,6 +19,7 @@ namespace ProbQA {
 //TODO: because this class is not likely to have specialized methods, to avoid excessive listing of all the supported
 //  template arguments here, move the implementation to fwd/decl/h header-only idiom.
 template class CEListTopTargetsAlgorithm<SRDoubleNumber>;
+template class CEListTopTargetsAlgorithm<SRFloatNumber>;
 
 template<typename taNumber> CEListTopTargetsAlgorithm<taNumber>::CEListTopTargetsAlgorithm(PqaError &PTR_RESTRICT err, 
   CpuEngine<taNumber> &PTR_RESTRICT engine, const CEQuiz<taNumber> &PTR_RESTRICT quiz, const TPqaId maxCount,
@@ -172,4 +173,40 @@ template<typename taNumber> TPqaId CEListTopTargetsAlgorithm<taNumber>::RunRadix
   return _maxCount;
 }
 
+template<typename taNumber> TPqaId CEListTopTargetsAlgorithm<taNumber>::RunActive() {
+  // The active targets are few enough after pruning, so a single thread partially sorts them.
+  const TPqaId *const PTR_RESTRICT pActiveVects = _pQuiz->GetActiveVects();
+  assert(pActiveVects != nullptr);
+  const TPqaId nActiveVects = _pQuiz->GetNActiveVects();
+  constexpr TPqaId nVectComps = SRSimd::_cNComps64;
+
+  SRSmartMPP<RatedTarget> ratings(_pEngine->GetMemPool(), SRCast::ToSizeT(nActiveVects * nVectComps));
+  RatedTarget *const PTR_RESTRICT pRatings = ratings.Get();
+  const taNumber *const PTR_RESTRICT pPriors = _pQuiz->GetPriorMants();
+  const GapTracker<TPqaId> &PTR_RESTRICT gt = _pEngine->GetTargetGaps();
+  TPqaId nRated = 0;
+  for (TPqaId k = 0; k < nActiveVects; k++) {
+    const TPqaId iFirst = pActiveVects[k] * nVectComps;
+    const TPqaId iLimit = std::min(iFirst + nVectComps, _nTargets);
+    for (TPqaId i = iFirst; i < iLimit; i++) {
+      if (gt.IsGap(i)) {
+        continue;
+      }
+      const TPqaAmount prob = pPriors[i].ToAmount();
+      if (prob <= 0) {
+        continue;
+      }
+      pRatings[nRated]._prob = prob;
+      pRatings[nRated]._iTarget = i;
+      nRated++;
+    }
+  }
+
+  const TPqaId nListed = std::min(_maxCount, nRated);
+  std::partial_sort(pRatings, pRatings + nListed, pRatings + nRated,
+    [](const RatedTarget& a, const RatedTarget& b) { return b < a; });
+  std::copy(pRatings, pRatings + nListed, _pDest);
+  return nListed;
+}
+
 } // namespace ProbQA
@@ -32,6 +32,8 @@ public:
 
   TPqaId RunHeapifyBased();
   TPqaId RunRadixSortBased();
+  // Lists the top targets among the active ones of a quiz that prunes its targets.
+  TPqaId RunActive();
 };
 
 } // namespace ProbQA
@@ -0,0 +1,57 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CENextQsCache.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+CENextQsCache::CENextQsCache(const TPqaId maxDepth, const uint64_t maxBytes)
+  : _maxDepth(SRCast::ToSizeT(std::max<TPqaId>(0, maxDepth))), _maxBytes(maxBytes), _kbVersion(0), _nBytes(0)
+{ }
+
+bool CENextQsCache::LockedUseVersion(const uint64_t kbVersion) {
+  if (kbVersion < _kbVersion) {
+    return false;
+  }
+  if (kbVersion > _kbVersion) {
+    _entries.clear();
+    _nBytes = 0;
+    _kbVersion = kbVersion;
+  }
+  return true;
+}
+
+TPqaId CENextQsCache::Select(const std::vector<AnsweredQuestion> &answers, const uint64_t kbVersion) {
+  SRLock<SRCriticalSection> csl(_cs);
+  if (!LockedUseVersion(kbVersion)) {
+    return cInvalidPqaId;
+  }
+  TEntries::const_iterator it = _entries.find(answers);
+  if (it == _entries.end()) {
+    return cInvalidPqaId;
+  }
+  const TCumPriorities &cp = it->second;
+  const SRDoubleNumber selRunLen = SRDoubleNumber::MakeRandom(SRDoubleNumber::FromDouble(cp.back()),
+    SRFastRandom::ThreadLocal());
+  const size_t iSel = std::upper_bound(cp.begin(), cp.end(), selRunLen.GetValue()) - cp.begin();
+  return TPqaId(std::min(iSel, cp.size() - 1));
+}
+
+void CENextQsCache::Insert(const std::vector<AnsweredQuestion> &answers, const uint64_t kbVersion,
+  TCumPriorities &&cumPriorities)
+{
+  const uint64_t entryBytes = answers.size() * sizeof(AnsweredQuestion) + cumPriorities.size() * sizeof(double);
+  SRLock<SRCriticalSection> csl(_cs);
+  if (!LockedUseVersion(kbVersion) || _nBytes + entryBytes > _maxBytes) {
+    return;
+  }
+  if (_entries.emplace(answers, std::move(cumPriorities)).second) {
+    _nBytes += entryBytes;
+  }
+}
+
+} // namespace ProbQA
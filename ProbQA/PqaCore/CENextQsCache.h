@@ -0,0 +1,58 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaCommon.h"
+
+namespace ProbQA {
+
+// The distributions of the priorities of the questions, which NextQuestion() selects from, computed for the quizzes
+//   started from the same priors and given the same sequence of answers. So the first few questions of most quizzes are
+//   selected without evaluating all the questions. All the entries are for a single version of the KB, and they are
+//   dropped once a computation for a newer version arrives. When the memory budget is exhausted, the new entries are
+//   not stored, so that the entries for the shorter sequences of answers, which are requested more often, stay.
+class CENextQsCache {
+  struct AnswersLess {
+    bool operator()(const std::vector<AnsweredQuestion> &a, const std::vector<AnsweredQuestion> &b) const {
+      return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+        [](const AnsweredQuestion &x, const AnsweredQuestion &y) {
+          return (x._iQuestion < y._iQuestion) || (x._iQuestion == y._iQuestion && x._iAnswer < y._iAnswer);
+        }
+      );
+    }
+  };
+  // For each question, the sum of the priorities of the questions up to and including it.
+  typedef std::vector<double> TCumPriorities;
+  typedef std::map<std::vector<AnsweredQuestion>, TCumPriorities, AnswersLess> TEntries;
+
+private: // variables
+  const size_t _maxDepth;
+  const uint64_t _maxBytes;
+  SRPlat::SRCriticalSection _cs;
+  TEntries _entries; // Guarded by _cs
+  // The version of the KB of all the entries. Guarded by _cs
+  uint64_t _kbVersion;
+  // The memory taken by the entries. Guarded by _cs
+  uint64_t _nBytes;
+
+private: // methods
+  // Drop the entries if they are for an older version of the KB. Returns false if |kbVersion| is older than theirs.
+  bool LockedUseVersion(const uint64_t kbVersion);
+
+public: // methods
+  explicit CENextQsCache(const TPqaId maxDepth, const uint64_t maxBytes);
+  CENextQsCache(const CENextQsCache&) = delete;
+  CENextQsCache& operator=(const CENextQsCache&) = delete;
+
+  // Whether the selection of the next question after |nAnswered| answers is cached.
+  bool Covers(const size_t nAnswered) const { return nAnswered < _maxDepth; }
+  // Select a question at random by the cached distribution for the answers and the version of the KB. Returns
+  //   cInvalidPqaId if there is no such entry.
+  TPqaId Select(const std::vector<AnsweredQuestion> &answers, const uint64_t kbVersion);
+  // Store the distribution, unless it doesn't fit the memory budget.
+  void Insert(const std::vector<AnsweredQuestion> &answers, const uint64_t kbVersion, TCumPriorities &&cumPriorities);
+};
+
+} // namespace ProbQA
@@ -14,6 +14,7 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CENormPriorsSubtaskCorrSum<SRDoubleNumber>;
+template class CENormPriorsSubtaskCorrSum<SRFloatNumber>;
 
 namespace {
 
@@ -42,7 +43,46 @@ struct ContextDouble {
   }
 };
 
-}
+struct ContextFloat {
+  const GapTracker<TPqaId> *PTR_RESTRICT _pGt;
+  const CENormPriorsTask<SRFloatNumber> *PTR_RESTRICT _pTask;
+  __m256 *PTR_RESTRICT _pMants;
+  __m256i *PTR_RESTRICT _pExps;
+
+  // Returns the normalized exponents of 4 targets, and sets to all-one bits the components of |assume0| for the
+  //   targets to zero out.
+  ATTR_NOALIAS inline __m256i __vectorcall NormExps(const TPqaId iExpVect, const __m256i mantExps,
+    const uint8_t gapQuad, __m256i &PTR_RESTRICT assume0)
+  {
+    const __m256i origExps = _mm256_add_epi64(SRSimd::Load<false, __m256i>(_pExps + iExpVect), mantExps);
+    const __m256i normExps = _mm256_add_epi64(origExps, _pTask->_corrExp);
+    // Avoid subnormal numbers (pretend they are zeros)
+    const __m256i isExpBelow1 = _mm256_cmpgt_epi64(_mm256_set1_epi64x(1), normExps);
+    assume0 = _mm256_or_si256(isExpBelow1, SRSimd::SetToBitQuadHot(gapQuad));
+    SRSimd::Store<false>(_pExps + iExpVect, _mm256_setzero_si256());
+    return normExps;
+  }
+
+  // Returns the addend for bucket summator
+  ATTR_NOALIAS inline __m256 __vectorcall Process(const TPqaId iVect) {
+    const __m256 oldMants = SRSimd::Load<false, __m256>(_pMants + iVect);
+    const __m256i mantExps = SRSimd::ExtractExponents32<false>(oldMants);
+    const uint8_t gaps = _pGt->GetOctet(iVect);
+    __m256i assume0Lo, assume0Hi;
+    const __m256i normExpsLo = NormExps(2 * iVect, SRSimd::WidenLowI32(mantExps), gaps & 0x0f, assume0Lo);
+    const __m256i normExpsHi = NormExps(2 * iVect + 1, SRSimd::WidenHighI32(mantExps), gaps >> 4, assume0Hi);
+    // The exponents that don't fit 32 bits are below 1, thus masked away.
+    const __m256i normExps = SRSimd::NarrowI64(normExpsLo, normExpsHi);
+    const __m256i assume0 = SRSimd::NarrowI64(assume0Lo, assume0Hi);
+
+    const __m256 newMants = _mm256_andnot_ps(_mm256_castsi256_ps(assume0),
+      SRSimd::ReplaceExponents(oldMants, normExps));
+    SRSimd::Store<false>(_pMants + iVect, newMants);
+    return newMants;
+  }
+};
+
+} // anonymous namespace
 
 template<> void CENormPriorsSubtaskCorrSum<SRDoubleNumber>::Run() {
   ContextDouble ctx;
@@ -62,4 +102,22 @@ template<> void CENormPriorsSubtaskCorrSum<SRDoubleNumber>::Run() {
   _mm_sfence();
 }
 
+template<> void CENormPriorsSubtaskCorrSum<SRFloatNumber>::Run() {
+  ContextFloat ctx;
+  ctx._pTask = static_cast<const TTask*>(GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(ctx._pTask->GetBaseEngine());
+  const CEQuiz<SRFloatNumber> &PTR_RESTRICT quiz = ctx._pTask->GetQuiz();
+  ctx._pGt = &engine.GetTargetGaps();
+  ctx._pExps = SRCast::Ptr<__m256i>(quiz.GetTlhExps());
+  ctx._pMants = SRCast::Ptr<__m256>(quiz.GetPriorMants());
+
+  SRAccumVectDbl256 acc;
+  for (TPqaId i = _iFirst, iEn = _iLimit; i < iEn; i++) {
+    const __m256 addend = ctx.Process(i);
+    acc.Add(addend);
+  }
+  _sumPriors.SetValue(static_cast<float>(acc.PreciseSum()));
+  _mm_sfence();
+}
+
 } // namespace ProbQA
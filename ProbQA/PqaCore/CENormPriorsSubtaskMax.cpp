@@ -12,6 +12,7 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CENormPriorsSubtaskMax<SRDoubleNumber>;
+template class CENormPriorsSubtaskMax<SRFloatNumber>;
 
 namespace {
 
@@ -32,6 +33,29 @@ struct ContextDouble {
   }
 };
 
+struct ContextFloat {
+  const __m256 *PTR_RESTRICT _pMants;
+  const __m256i *PTR_RESTRICT _pExps;
+  const GapTracker<TPqaId> *PTR_RESTRICT _pGt;
+
+  // Returns the total exponents of the lower 4 targets of the vector, and those of the higher 4 in |totExpHi|.
+  // |retentionLo| and |retentionHi| are output parameters for the masks for retaining the old maximum.
+  ATTR_NOALIAS inline __m256i __vectorcall Process(const TPqaId iVect, __m256i &PTR_RESTRICT totExpHi,
+    __m256i &PTR_RESTRICT retentionLo, __m256i &PTR_RESTRICT retentionHi)
+  {
+    const __m256i mantExps = SRSimd::ExtractExponents32<false>(SRSimd::Load<false, __m256>(_pMants + iVect));
+    totExpHi = _mm256_add_epi64(SRSimd::Load<false, __m256i>(_pExps + 2 * iVect + 1),
+      SRSimd::WidenHighI32(mantExps));
+    const __m256i totExpLo = _mm256_add_epi64(SRSimd::Load<false, __m256i>(_pExps + 2 * iVect),
+      SRSimd::WidenLowI32(mantExps));
+    // Mask away the targets at gaps
+    const uint8_t gaps = _pGt->GetOctet(iVect);
+    retentionLo = SRSimd::SetToBitQuadHot(gaps & 0x0f);
+    retentionHi = SRSimd::SetToBitQuadHot(gaps >> 4);
+    return totExpLo;
+  }
+};
+
 } // anonymous namespace
 
 template<> void CENormPriorsSubtaskMax<SRDoubleNumber>::Run() {
@@ -53,4 +77,24 @@ template<> void CENormPriorsSubtaskMax<SRDoubleNumber>::Run() {
   _maxExp = SRSimd::FullHorizMaxI64(curMax);
 }
 
+template<> void CENormPriorsSubtaskMax<SRFloatNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  const CEQuiz<SRFloatNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+
+  ContextFloat ctx;
+  ctx._pGt = &engine.GetTargetGaps();
+  ctx._pExps = SRCast::CPtr<__m256i>(quiz.GetTlhExps());
+  ctx._pMants = SRCast::CPtr<__m256>(quiz.GetPriorMants());
+
+  __m256i curMax = _mm256_set1_epi64x(std::numeric_limits<int64_t>::min());
+  for (TPqaId i = _iFirst, iEn = _iLimit; i < iEn; i++) {
+    __m256i totExpHi, retentionLo, retentionHi;
+    const __m256i totExpLo = ctx.Process(i, totExpHi, retentionLo, retentionHi);
+    curMax = SRSimd::MaxI64(curMax, totExpLo, retentionLo);
+    curMax = SRSimd::MaxI64(curMax, totExpHi, retentionHi);
+  }
+  _maxExp = SRSimd::FullHorizMaxI64(curMax);
+}
+
 } // namespace ProbQA
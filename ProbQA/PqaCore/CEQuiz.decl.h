@@ -7,6 +7,7 @@
 #include "../PqaCore/CEQuiz.fwd.h"
 #include "../PqaCore/CpuEngine.fwd.h"
 #include "../PqaCore/BaseCpuEngine.h"
+#include "../PqaCore/CEKBVersion.h"
 #include "../PqaCore/Interface/PqaCommon.h"
 
 namespace ProbQA {
@@ -31,8 +32,34 @@ private:
 
 protected: // variables
   TPqaId _activeQuestion = cInvalidPqaId;
+  // If the engine prunes the targets, the ascending indices of the SIMD vectors of targets that are not dropped from
+  //   the quiz, otherwise nullptr. Only the first |_nActiveVects| are valid, and until the first answer is recorded,
+  //   _nActiveVects is cInvalidPqaId meaning that all the vectors are active.
+  TPqaId *_pActiveVects;
+  TPqaId _nActiveVects = cInvalidPqaId;
+  // If the engine prunes the targets, for each question the sum of 1/D^2 over the targets dropped from the quiz, with
+  //   the values of D at the time they were dropped, otherwise nullptr. The dropped targets have zero likelihoods, so
+  //   each answer adds to the lack of the question this sum divided by the same logarithm of the posterior.
+  double *_pDroppedLack;
+  // The number of answers recorded since the last pass over all the targets.
+  TPqaId _nSinceFullPass = 0;
+  // The version of the KB with which all the priors have been computed, if the quiz was started rather than resumed,
+  //   otherwise CEKBVersion::_cNone . Only such quizzes share the cached selection of the next question.
+  uint64_t _kbVersion = CEKBVersion::_cNone;
 
 protected: // methods
+  // The exponents are 64-bit per target, while a SIMD vector of priors may hold up to 8 targets (for float), thus the
+  //   exponents are allocated for whole vectors of the narrowest number.
+  static size_t CalcExpItems(const size_t nTargets) {
+    return SRPlat::SRSimd::VectsFromComps<float>(nTargets) * (SRPlat::SRSimd::_cNBytes / sizeof(float));
+  }
+  // The pruning is at the granularity of SIMD vectors, so to keep the kernels vectorized.
+  static size_t CalcActiveItems(const BaseCpuEngine &engine, const size_t nTargets) {
+    return (engine.GetPruneEps() > 0) ? SRPlat::SRSimd::VectsFromComps<double>(nTargets) : 0;
+  }
+  static size_t CalcDroppedLackItems(const BaseCpuEngine &engine, const size_t nQuestions) {
+    return (engine.GetPruneEps() > 0) ? nQuestions : 0;
+  }
   inline explicit CEBaseQuiz(BaseCpuEngine *pEngine);
   inline ~CEBaseQuiz();
   BaseCpuEngine* GetBaseEngine() const { return _pEngine; }
@@ -43,6 +70,12 @@ public: // methods
   std::vector<AnsweredQuestion>& ModAnswers() { return _answers; }
   const std::vector<AnsweredQuestion>& GetAnswers() const { return _answers; }
   void SetActiveQuestion(TPqaId iQuestion) { _activeQuestion = iQuestion; }
+  // Returns nullptr if all the vectors of targets are active.
+  const TPqaId* GetActiveVects() const { return (_nActiveVects == cInvalidPqaId) ? nullptr : _pActiveVects; }
+  TPqaId GetNActiveVects() const { return _nActiveVects; }
+  double* GetDroppedLack() const { return _pDroppedLack; }
+  uint64_t GetKBVersion() const { return _kbVersion; }
+  void SetKBVersion(const uint64_t version) { _kbVersion = version; }
 };
 
 template<typename taNumber> class CEQuiz : public CEBaseQuiz {
@@ -50,6 +83,13 @@ template<typename taNumber> class CEQuiz : public CEBaseQuiz {
   // Priors must be usually normalized, except for short periods of updating them.
   taNumber *_pPriorMants;
 
+private: // methods
+  // Drop the vectors of targets whose priors are all below the threshold relative to the maximum prior, from all the
+  //   vectors if |bAllVects|, otherwise from the active vectors, then renormalize the priors of the rest.
+  inline void PruneTargets(const bool bAllVects);
+  // Add the vectors of targets just dropped to the dropped lack of each question.
+  inline void AddDroppedLack(const TPqaId *const pDropped, const TPqaId nDropped);
+
 public: // methods
   explicit CEQuiz(CpuEngine<taNumber> *pEngine);
   ~CEQuiz();
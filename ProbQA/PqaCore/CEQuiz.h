@@ -5,6 +5,8 @@
 #pragma once
 
 #include "../PqaCore/CEQuiz.decl.h"
+#include "../PqaCore/CECreateQuizOperation.h"
+#include "../PqaCore/CEDroppedLackSubtask.h"
 #include "../PqaCore/CEDivTargPriorsSubtask.h"
 #include "../PqaCore/CERecordAnswerTask.h"
 #include "../PqaCore/CERecordAnswerSubtaskMul.h"
@@ -23,12 +25,18 @@ inline CEBaseQuiz::CEBaseQuiz(BaseCpuEngine *pEngine) : _pEngine(pEngine) {
 
   SRMemTotal mtCommon;
   SRMemItem<__m256i> miIsQAsked(SRPlat::SRSimd::VectsFromBits(nQuestions), SRPlat::SRMemPadding::Both, mtCommon);
-  SRMemItem<TExponent> miExponents(nTargets, SRPlat::SRMemPadding::Both, mtCommon);
+  SRMemItem<TExponent> miExponents(CalcExpItems(nTargets), SRPlat::SRMemPadding::Both, mtCommon);
+  const size_t nActiveItems = CalcActiveItems(*_pEngine, nTargets);
+  SRMemItem<TPqaId> miActiveVects(nActiveItems, SRPlat::SRMemPadding::Both, mtCommon);
+  const size_t nDroppedLackItems = CalcDroppedLackItems(*_pEngine, nQuestions);
+  SRMemItem<double> miDroppedLack(nDroppedLackItems, SRPlat::SRMemPadding::Both, mtCommon);
   // First allocate all the memory so to revert if anything fails.
   SRSmartMPP<uint8_t> commonBuf(_pEngine->GetMemPool(), mtCommon._nBytes);
   // Must be the first memory block, because it's used for releasing the memory
   _isQAsked = miIsQAsked.Ptr(commonBuf);
   _pTlhExps = miExponents.Ptr(commonBuf);
+  _pActiveVects = ((nActiveItems == 0) ? nullptr : miActiveVects.Ptr(commonBuf));
+  _pDroppedLack = ((nDroppedLackItems == 0) ? nullptr : miDroppedLack.Ptr(commonBuf));
   // As all the memory is allocated, safely proceed with finishing construction of CEBaseQuiz object.
   commonBuf.Detach();
 }
@@ -43,7 +51,10 @@ inline CEBaseQuiz::~CEBaseQuiz() {
 
   SRMemTotal mtCommon;
   SRMemItem<__m256i> miIsQAsked(SRPlat::SRSimd::VectsFromBits(nQuestions), SRPlat::SRMemPadding::Both, mtCommon);
-  SRMemItem<TExponent> miExponents(nTargets, SRPlat::SRMemPadding::Both, mtCommon);
+  SRMemItem<TExponent> miExponents(CalcExpItems(nTargets), SRPlat::SRMemPadding::Both, mtCommon);
+  SRMemItem<TPqaId> miActiveVects(CalcActiveItems(*_pEngine, nTargets), SRPlat::SRMemPadding::Both, mtCommon);
+  SRMemItem<double> miDroppedLack(CalcDroppedLackItems(*_pEngine, nQuestions), SRPlat::SRMemPadding::Both,
+    mtCommon);
   _pEngine->GetMemPool().ReleaseMem(_isQAsked, mtCommon._nBytes);
 }
 
@@ -91,6 +102,40 @@ template<typename taNumber> inline PqaError CEQuiz<taNumber>::RecordAnswer(const
   const SRThreadCount nWorkers = engine.GetNLooseWorkers();
   //const SRThreadCount nWorkers = engine.GetWorkers().GetWorkerCount();
 
+  if (_pActiveVects != nullptr && _nActiveVects != cInvalidPqaId) {
+    _nSinceFullPass++;
+    if (_nSinceFullPass >= engine.GetPruneFullPassPeriod()) {
+      // Recompute the priors of all the targets from scratch, as ResumeQuiz() does, so to readmit the dropped ones.
+      PqaError err;
+      CECreateQuizResume<taNumber> resumeOp(err, TPqaId(_answers.size()), _answers.data());
+      resumeOp.UpdateLikelihoods(engine, *this);
+      if (!err.IsOk()) {
+        return std::move(err);
+      }
+      _nSinceFullPass = 0;
+      PruneTargets(true);
+      return PqaError();
+    }
+    // Update only the active vectors of targets. The division by the sum is left to the pruning.
+    SRMemTotal mtCommon;
+    const SRByteMem miSubtasks(nWorkers * sizeof(CERecordAnswerSubtaskMul<taNumber>), SRMemPadding::None,
+      mtCommon);
+    const SRByteMem miSplit(SRPoolRunner::CalcSplitMemReq(nWorkers), SRMemPadding::Both, mtCommon);
+
+    SRSmartMPP<uint8_t> commonBuf(engine.GetMemPool(), mtCommon._nBytes);
+    SRPoolRunner pr(engine.GetWorkers(), miSubtasks.BytePtr(commonBuf));
+    const SRPoolRunner::Split activeSplit = SRPoolRunner::CalcSplit(miSplit.BytePtr(commonBuf), _nActiveVects,
+      nWorkers);
+
+    CERecordAnswerTask<taNumber> raTask(engine, *this, _answers.back(), _pActiveVects);
+    {
+      CEKBReadGuard kbrg(engine.GetRws(), engine.GetKBEpochs());
+      pr.RunPreSplit<CERecordAnswerSubtaskMul<taNumber>>(raTask, activeSplit);
+    }
+    PruneTargets(false);
+    return PqaError();
+  }
+
   SRMemTotal mtCommon;
   const SRByteMem miSubtasks(nWorkers * SRMaxSizeof<CERecordAnswerSubtaskMul<taNumber>, 
     CEDivTargPriorsSubtask<CERecordAnswerTask<taNumber>>>::value, SRMemPadding::None, mtCommon);
@@ -104,14 +149,104 @@ template<typename taNumber> inline PqaError CEQuiz<taNumber>::RecordAnswer(const
 
   CERecordAnswerTask<taNumber> raTask(engine, *this, _answers.back());
   {
-    SRRWLock<false> rwl(engine.GetRws());
+    CEKBReadGuard kbrg(engine.GetRws(), engine.GetKBEpochs());
     typedef CERecordAnswerSubtaskMul<taNumber> TSubtask;
     SRPoolRunner::Keeper<TSubtask> kp = pr.RunPreSplit<TSubtask>(raTask, targSplit);
     Summator<taNumber>::ForPriors(kp, raTask);
   }
   // Divide the likelihoods by their sum calculated above
   pr.RunPreSplit<CEDivTargPriorsSubtask<CERecordAnswerTask<taNumber>>>(raTask, targSplit);
+  if (_pActiveVects != nullptr) {
+    PruneTargets(true);
+  }
   return PqaError();
 }
 
+// This takes time proportional to the number of vectors considered, so it's sequential: it's called after a parallel
+//   pass over the same vectors, which is heavier. Only the dropped lack, which takes a pass over the dropped vectors
+//   of D , runs on the workers.
+template<typename taNumber> inline void CEQuiz<taNumber>::PruneTargets(const bool bAllVects) {
+  using namespace SRPlat;
+  constexpr TPqaId cNComps = TPqaId(SRSimd::_cNBytes / sizeof(taNumber));
+  const TPqaId nTargets = GetBaseEngine()->GetDims()._nTargets;
+  const TPqaId nVects = (bAllVects ? SRSimd::VectsFromComps<taNumber>(nTargets) : _nActiveVects);
+  taNumber *PTR_RESTRICT pMants = _pPriorMants;
+  auto fnCompLim = [nTargets](const TPqaId iVect) {
+    return std::min<TPqaId>(nTargets, (iVect + 1) * cNComps);
+  };
+
+  TPqaAmount maxProb = 0;
+  for (TPqaId i = 0; i < nVects; i++) {
+    const TPqaId iVect = (bAllVects ? i : _pActiveVects[i]);
+    for (TPqaId j = iVect * cNComps, jLim = fnCompLim(iVect); j < jLim; j++) {
+      maxProb = std::max(maxProb, pMants[j].ToAmount());
+    }
+  }
+  const TPqaAmount threshold = maxProb * GetBaseEngine()->GetPruneEps();
+
+  // The active vectors stay in the ascending order, and the list is compacted in place.
+  SRSmartMPP<TPqaId> dropped(GetBaseEngine()->GetMemPool(), SRCast::ToSizeT(std::max<TPqaId>(nVects, 1)));
+  TPqaId nDropped = 0;
+  SRAccumulator<SRDoubleNumber> accKept(SRDoubleNumber(0.0));
+  TPqaId nKept = 0;
+  for (TPqaId i = 0; i < nVects; i++) {
+    const TPqaId iVect = (bAllVects ? i : _pActiveVects[i]);
+    const TPqaId jFirst = iVect * cNComps;
+    const TPqaId jLim = fnCompLim(iVect);
+    bool bKeep = false;
+    for (TPqaId j = jFirst; j < jLim; j++) {
+      bKeep |= (pMants[j].ToAmount() >= threshold);
+    }
+    if (!bKeep) {
+      for (TPqaId j = jFirst; j < jLim; j++) {
+        pMants[j] = taNumber(0.0);
+      }
+      dropped.Get()[nDropped] = iVect;
+      nDropped++;
+      continue;
+    }
+    for (TPqaId j = jFirst; j < jLim; j++) {
+      accKept.Add(SRDoubleNumber::FromDouble(pMants[j].ToAmount()));
+    }
+    _pActiveVects[nKept] = iVect;
+    nKept++;
+  }
+  _nActiveVects = nKept;
+  // After a pass over all the vectors, the dropped lack is summed anew, with the current D .
+  if (bAllVects) {
+    std::fill(_pDroppedLack, _pDroppedLack + GetBaseEngine()->GetDims()._nQuestions, 0.0);
+  }
+  AddDroppedLack(dropped.Get(), nDropped);
+
+  const TPqaAmount sumKept = accKept.Get().ToAmount();
+  if (sumKept <= 0) {
+    return; // all the priors have underflowed
+  }
+  for (TPqaId i = 0; i < nKept; i++) {
+    const TPqaId iVect = _pActiveVects[i];
+    for (TPqaId j = iVect * cNComps, jLim = fnCompLim(iVect); j < jLim; j++) {
+      pMants[j] = taNumber(pMants[j].ToAmount() / sumKept);
+    }
+  }
+}
+
+template<typename taNumber> inline void CEQuiz<taNumber>::AddDroppedLack(const TPqaId *const pDropped,
+  const TPqaId nDropped)
+{
+  using namespace SRPlat;
+  if (nDropped == 0) {
+    return;
+  }
+  CpuEngine<taNumber> &PTR_RESTRICT engine = *GetEngine();
+  const SRThreadCount nWorkers = engine.GetWorkers().GetWorkerCount();
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CEDroppedLackSubtask<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(engine.GetMemPool(), mtCommon._nBytes);
+  SRPoolRunner pr(engine.GetWorkers(), miSubtasks.BytePtr(commonBuf));
+
+  CEDroppedLackTask<taNumber> dlTask(engine, *this, pDropped, nDropped);
+  CEKBReadGuard kbrg(engine.GetRws(), engine.GetKBEpochs());
+  pr.SplitAndRunSubtasks<CEDroppedLackSubtask<taNumber>>(dlTask, engine.GetDims()._nQuestions, nWorkers);
+}
+
 } // namespace ProbQA
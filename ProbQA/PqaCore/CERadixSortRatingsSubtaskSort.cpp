@@ -15,6 +15,7 @@ namespace ProbQA {
 //TODO: because this class is not likely to have specialized methods, to avoid excessive listing of all the supported
 //  template arguments here, move the implementation to fwd/decl/h header-only idiom.
 template class CERadixSortRatingsSubtaskSort<SRDoubleNumber>;
+template class CERadixSortRatingsSubtaskSort<SRFloatNumber>;
 
 namespace {
   static_assert(sizeof(RatedTarget) == sizeof(__m128i), "For SSE streaming below.");
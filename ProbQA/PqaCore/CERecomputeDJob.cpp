@@ -0,0 +1,110 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CERecomputeDJob.h"
+#include "../PqaCore/CpuEngine.h"
+#include "../PqaCore/ErrorHelper.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template<typename taNumber> CERecomputeDJob<taNumber>::CERecomputeDJob(CpuEngine<taNumber> &engine,
+  const RecomputeDOptions &options) : _engine(engine), _options(options), _tStart(std::chrono::steady_clock::now()),
+  _nQuestionsTotal(0), _nQuestionsDone(0), _nItemsCorrected(0), _maxRelDrift(0), _maxLockMicros(0), _bCancel(false),
+  _doneMicros(0), _bDone(false), _bResultTaken(false), _thread(&CERecomputeDJob::RunThread, this)
+{ }
+
+template<typename taNumber> CERecomputeDJob<taNumber>::~CERecomputeDJob() {
+  Wait();
+  _thread.join();
+}
+
+template<typename taNumber> uint64_t CERecomputeDJob<taNumber>::GetElapsedMicros() const {
+  return SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - _tStart).count());
+}
+
+template<typename taNumber> void CERecomputeDJob<taNumber>::RunThread() {
+  if (_options._bLowPriority) {
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+  }
+  PqaError err;
+  try {
+    err = _engine.RunRecomputeDJob(*this);
+  }
+  CATCH_TO_ERR_SET(err);
+  // The engine may be gone from now on, because the job has left its maintenance switch.
+  SRLock<SRCriticalSection> csl(_cs);
+  _result = std::move(err);
+  _doneMicros = GetElapsedMicros();
+  _bDone = true;
+  _finished.WakeAll();
+}
+
+template<typename taNumber> void CERecomputeDJob<taNumber>::OnChunkDone(const TPqaId nQuestionsDone,
+  const uint64_t nItemsCorrected, const double maxRelDrift, const uint64_t lockMicros)
+{
+  _nQuestionsDone.store(nQuestionsDone, std::memory_order_relaxed);
+  _nItemsCorrected.store(nItemsCorrected, std::memory_order_relaxed);
+  _maxRelDrift.store(maxRelDrift, std::memory_order_relaxed);
+  if (lockMicros > _maxLockMicros.load(std::memory_order_relaxed)) {
+    _maxLockMicros.store(lockMicros, std::memory_order_relaxed);
+  }
+}
+
+template<typename taNumber> void CERecomputeDJob<taNumber>::GetProgress(RecomputeDProgress &progress) {
+  {
+    SRLock<SRCriticalSection> csl(_cs);
+    progress._bDone = _bDone;
+    progress._elapsedMicros = _bDone ? _doneMicros : GetElapsedMicros();
+  }
+  progress._nQuestionsTotal = _nQuestionsTotal.load(std::memory_order_relaxed);
+  progress._nQuestionsDone = _nQuestionsDone.load(std::memory_order_relaxed);
+  progress._nItemsCorrected = _nItemsCorrected.load(std::memory_order_relaxed);
+  progress._maxRelDrift = _maxRelDrift.load(std::memory_order_relaxed);
+  progress._maxLockMicros = _maxLockMicros.load(std::memory_order_relaxed);
+}
+
+template<typename taNumber> bool CERecomputeDJob<taNumber>::Wait(const uint32_t timeoutMiS) {
+  const auto tDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMiS);
+  SRLock<SRCriticalSection> csl(_cs);
+  while (!_bDone) {
+    uint32_t waitMiS = INFINITE;
+    if (timeoutMiS != INFINITE) {
+      const int64_t leftMiS = std::chrono::duration_cast<std::chrono::milliseconds>(
+        tDeadline - std::chrono::steady_clock::now()).count();
+      if (leftMiS <= 0) {
+        return false;
+      }
+      waitMiS = static_cast<uint32_t>(leftMiS);
+    }
+    _finished.Wait(_cs, waitMiS);
+  }
+  return true;
+}
+
+template<typename taNumber> void CERecomputeDJob<taNumber>::Cancel() {
+  _bCancel.store(true, std::memory_order_relaxed);
+}
+
+template<typename taNumber> PqaError CERecomputeDJob<taNumber>::TakeResult() {
+  SRLock<SRCriticalSection> csl(_cs);
+  if (!_bDone) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+      "The recomputation of matrix D is still in progress."));
+  }
+  if (_bResultTaken) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+      "The result of the recomputation of matrix D has already been taken."));
+  }
+  _bResultTaken = true;
+  return std::move(_result);
+}
+
+template class CERecomputeDJob<SRDoubleNumber>;
+template class CERecomputeDJob<SRFloatNumber>;
+
+} // namespace ProbQA
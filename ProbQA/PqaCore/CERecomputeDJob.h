@@ -0,0 +1,57 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/Interface/IPqaRecomputeDJob.h"
+
+namespace ProbQA {
+
+// Runs CpuEngine::RunRecomputeDJob() on its own thread, and publishes the progress and the outcome. The engine holds
+//   the maintenance switch for the job, so that it isn't shut down until the job stops using it.
+template<typename taNumber> class CERecomputeDJob : public IPqaRecomputeDJob {
+  CpuEngine<taNumber> &_engine;
+  const RecomputeDOptions _options;
+  const std::chrono::steady_clock::time_point _tStart;
+  std::atomic<TPqaId> _nQuestionsTotal;
+  std::atomic<TPqaId> _nQuestionsDone;
+  std::atomic<uint64_t> _nItemsCorrected;
+  std::atomic<double> _maxRelDrift;
+  std::atomic<uint64_t> _maxLockMicros;
+  std::atomic<bool> _bCancel;
+  SRPlat::SRCriticalSection _cs;
+  SRPlat::SRConditionVariable _finished;
+  PqaError _result; // Guarded by _cs
+  uint64_t _doneMicros; // Guarded by _cs
+  bool _bDone; // Guarded by _cs
+  bool _bResultTaken; // Guarded by _cs
+  // Must be the last, so that the thread starts with the rest initialized.
+  std::thread _thread;
+
+private: // methods
+  void RunThread();
+  uint64_t GetElapsedMicros() const;
+
+public: // Internal interface methods
+  // The caller must have entered the maintenance switch of |engine| in agnostic mode, which the job leaves.
+  explicit CERecomputeDJob(CpuEngine<taNumber> &engine, const RecomputeDOptions &options);
+
+  const RecomputeDOptions& GetOptions() const { return _options; }
+  bool IsCancelled() const { return _bCancel.load(std::memory_order_relaxed); }
+  void SetNQuestionsTotal(const TPqaId nQuestions) { _nQuestionsTotal.store(nQuestions, std::memory_order_relaxed); }
+  // Called by the job thread only, after each chunk.
+  void OnChunkDone(const TPqaId nQuestionsDone, const uint64_t nItemsCorrected, const double maxRelDrift,
+    const uint64_t lockMicros);
+
+public: // Client interface methods
+  virtual ~CERecomputeDJob() override final;
+
+  virtual void GetProgress(RecomputeDProgress &progress) override final;
+  virtual bool Wait(const uint32_t timeoutMiS = INFINITE) override final;
+  virtual void Cancel() override final;
+  virtual PqaError TakeResult() override final;
+};
+
+} // namespace ProbQA
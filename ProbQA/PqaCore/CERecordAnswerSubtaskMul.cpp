@@ -11,10 +11,12 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CERecordAnswerSubtaskMul<SRDoubleNumber>;
+template class CERecordAnswerSubtaskMul<SRFloatNumber>;
 
-template<> void CERecordAnswerSubtaskMul<SRDoubleNumber>::Run() {
+template<> template<bool taInvD> void CERecordAnswerSubtaskMul<SRDoubleNumber>::RunInternal() {
   auto &PTR_RESTRICT  task = static_cast<const TTask&>(*GetTask());
   auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
   const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
   const GapTracker<TPqaId>& targGaps = engine.GetTargetGaps();
 
@@ -22,23 +24,169 @@ template<> void CERecordAnswerSubtaskMul<SRDoubleNumber>::Run() {
 
   SRAccumVectDbl256 accMants;
   const AnsweredQuestion &PTR_RESTRICT aq = task.GetAQ();
-  const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(&engine.GetA(aq._iQuestion, aq._iAnswer, 0));
-  const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(&engine.GetD(aq._iQuestion, 0));
-  for (TPqaId i = _iFirst; i < _iLimit; i++) {
-    const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls + i);
+  const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(taInvD
+    ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+  for (size_t i = SRCast::ToSizeT(_iFirst); i < SRCast::ToSizeT(_iLimit);) {
+    // In the tiled layout of cube A, the row of A is contiguous only within a tile.
+    size_t iTileLim;
+    const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(kb.GetAVects(
+      SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), i, iTileLim));
+    iTileLim = std::min(iTileLim, SRCast::ToSizeT(_iLimit));
+    for (; i < iTileLim; i++, pAdjMuls++) {
+      const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls);
+      const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + i);
+      // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
+      const __m256d P_qa_given_t = (taInvD ? _mm256_mul_pd(adjMuls, adjDivs) : _mm256_div_pd(adjMuls, adjDivs));
+
+      const __m256d oldMants = SRSimd::Load<false>(pMants + i);
+      const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
+      const uint8_t gaps = targGaps.GetQuad(i);
+      const __m256d newMants = _mm256_andnot_pd(_mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps)), product);
+      SRSimd::Store<false>(pMants + i, newMants);
+
+      accMants.Add(newMants);
+    }
+  }
+  _sumPriors.SetValue(accMants.PreciseSum());
+}
+
+// Pairs of AVX2 vectors are processed as one AVX-512 vector, and the odd AVX2 vector at the end of a tile or of the
+//   subtask range under a mask. The gaps are applied with the mask registers instead of the blend masks.
+template<> template<bool taInvD> void CERecordAnswerSubtaskMul<SRDoubleNumber>::RunInternal512() {
+  auto &PTR_RESTRICT  task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId>& targGaps = engine.GetTargetGaps();
+
+  double *PTR_RESTRICT pMants = SRCast::Ptr<double>(quiz.GetPriorMants());
+
+  SRAccumVectDbl512 accMants;
+  const AnsweredQuestion &PTR_RESTRICT aq = task.GetAQ();
+  const double *PTR_RESTRICT pAdjDivs = SRCast::CPtr<double>(taInvD
+    ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+  for (size_t i = SRCast::ToSizeT(_iFirst); i < SRCast::ToSizeT(_iLimit);) {
+    size_t iTileLim;
+    const double *PTR_RESTRICT pAdjMuls = SRCast::CPtr<double>(kb.GetAVects(
+      SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), i, iTileLim));
+    iTileLim = std::min(iTileLim, SRCast::ToSizeT(_iLimit));
+    for (; i < iTileLim; i += 2, pAdjMuls += 2 * SRSimd::_cNComps64) {
+      const bool bPair = (i + 1 < iTileLim);
+      const __mmask8 lanes = (bPair ? 0xff : 0x0f);
+      const __mmask8 kept = static_cast<__mmask8>(lanes & ~targGaps.GetQuadPair(i, bPair));
+      const size_t iComp = i << SRSimd::_cLogNComps64;
+
+      const __m512d adjMuls = _mm512_maskz_loadu_pd(lanes, pAdjMuls);
+      const __m512d adjDivs = _mm512_maskz_loadu_pd(lanes, pAdjDivs + iComp);
+      // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,...,j7))
+      const __m512d P_qa_given_t = (taInvD ? _mm512_mul_pd(adjMuls, adjDivs)
+        : _mm512_maskz_div_pd(lanes, adjMuls, adjDivs));
+
+      const __m512d oldMants = _mm512_maskz_loadu_pd(lanes, pMants + iComp);
+      const __m512d newMants = _mm512_maskz_mul_pd(kept, oldMants, P_qa_given_t);
+      _mm512_mask_storeu_pd(pMants + iComp, lanes, newMants);
+
+      accMants.Add(newMants);
+    }
+    // The next tile starts right after the odd vector, if any.
+    i = std::min(i, iTileLim);
+  }
+  _sumPriors.SetValue(accMants.PreciseSum());
+}
+
+// The subtask range is over the indices into the array of the active vectors of targets.
+template<> template<bool taInvD> void CERecordAnswerSubtaskMul<SRDoubleNumber>::RunActive() {
+  auto &PTR_RESTRICT  task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const CEQuiz<SRDoubleNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId>& targGaps = engine.GetTargetGaps();
+  const TPqaId *PTR_RESTRICT pActiveVects = task.GetActiveVects();
+
+  __m256d *PTR_RESTRICT pMants = SRCast::Ptr<__m256d>(quiz.GetPriorMants());
+
+  SRAccumVectDbl256 accMants;
+  const AnsweredQuestion &PTR_RESTRICT aq = task.GetAQ();
+  const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(taInvD
+    ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+  for (TPqaId k = _iFirst; k < _iLimit; k++) {
+    const size_t i = SRCast::ToSizeT(pActiveVects[k]);
+    size_t iTileLim;
+    const __m256d adjMuls = SRSimd::Load<false>(SRCast::CPtr<__m256d>(kb.GetAVects(
+      SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), i, iTileLim)));
     const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + i);
     // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
-    const __m256d P_qa_given_t = _mm256_div_pd(adjMuls, adjDivs);
+    const __m256d P_qa_given_t = (taInvD ? _mm256_mul_pd(adjMuls, adjDivs) : _mm256_div_pd(adjMuls, adjDivs));
 
-    const __m256d oldMants = SRSimd::Load<false>(pMants + i);
+    const __m256d oldMants = SRSimd::Load<true>(pMants + i);
     const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
     const uint8_t gaps = targGaps.GetQuad(i);
     const __m256d newMants = _mm256_andnot_pd(_mm256_castsi256_pd(SRSimd::SetToBitQuadHot(gaps)), product);
-    SRSimd::Store<false>(pMants + i, newMants);
+    SRSimd::Store<true>(pMants + i, newMants);
 
     accMants.Add(newMants);
   }
   _sumPriors.SetValue(accMants.PreciseSum());
 }
 
+template<> void CERecordAnswerSubtaskMul<SRDoubleNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  // These should be tail calls
+  if (task.GetActiveVects() != nullptr) {
+    engine.GetKB().HasInvD() ? RunActive<true>() : RunActive<false>();
+    return;
+  }
+  if (engine.GetInstructionSet() >= SRInstructionSet::Avx512) {
+    engine.GetKB().HasInvD() ? RunInternal512<true>() : RunInternal512<false>();
+    return;
+  }
+  engine.GetKB().HasInvD() ? RunInternal<true>() : RunInternal<false>();
+}
+
+template<> template<bool taInvD> void CERecordAnswerSubtaskMul<SRFloatNumber>::RunInternal() {
+  auto &PTR_RESTRICT  task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRFloatNumber> &PTR_RESTRICT kb = engine.GetKB();
+  const CEQuiz<SRFloatNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId>& targGaps = engine.GetTargetGaps();
+
+  __m256 *PTR_RESTRICT pMants = SRCast::Ptr<__m256>(quiz.GetPriorMants());
+
+  SRAccumVectDbl256 accMants;
+  const AnsweredQuestion &PTR_RESTRICT aq = task.GetAQ();
+  const __m256 *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256>(taInvD
+    ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+  for (size_t i = SRCast::ToSizeT(_iFirst); i < SRCast::ToSizeT(_iLimit);) {
+    size_t iTileLim;
+    const __m256 *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256>(kb.GetAVects(
+      SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), i, iTileLim));
+    iTileLim = std::min(iTileLim, SRCast::ToSizeT(_iLimit));
+    for (; i < iTileLim; i++, pAdjMuls++) {
+      const __m256 adjMuls = SRSimd::Load<false>(pAdjMuls);
+      const __m256 adjDivs = SRSimd::Load<false>(pAdjDivs + i);
+      // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,...,j7))
+      const __m256 P_qa_given_t = (taInvD ? _mm256_mul_ps(adjMuls, adjDivs) : _mm256_div_ps(adjMuls, adjDivs));
+
+      const __m256 oldMants = SRSimd::Load<false>(pMants + i);
+      const __m256 product = _mm256_mul_ps(oldMants, P_qa_given_t);
+      const uint8_t gaps = targGaps.GetOctet(i);
+      const __m256 newMants = _mm256_andnot_ps(_mm256_castsi256_ps(SRSimd::SetToBitOctet(gaps)), product);
+      SRSimd::Store<false>(pMants + i, newMants);
+
+      accMants.Add(newMants);
+    }
+  }
+  _sumPriors.SetValue(static_cast<float>(accMants.PreciseSum()));
+}
+
+template<> void CERecordAnswerSubtaskMul<SRFloatNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  // The pruning of the targets is for double precision only.
+  assert(task.GetActiveVects() == nullptr);
+  // This should be a tail call
+  engine.GetKB().HasInvD() ? RunInternal<true>() : RunInternal<false>();
+}
+
 } // namespace ProbQA
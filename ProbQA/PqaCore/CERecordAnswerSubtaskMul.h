@@ -16,6 +16,14 @@ public: // types
 public: // variables
   taNumber _sumPriors;
 
+private: // methods
+  // taInvD: whether to multiply by the table of 1/D instead of dividing by D .
+  template<bool taInvD> void RunInternal();
+  // The same with AVX-512, if the engine has selected it.
+  template<bool taInvD> void RunInternal512();
+  // The same over the active vectors of targets, if the quiz prunes them.
+  template<bool taInvD> void RunActive();
+
 public: // methods
   using SRPlat::SRStandardSubtask::SRStandardSubtask;
   virtual void Run() override final;
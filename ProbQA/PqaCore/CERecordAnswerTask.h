@@ -18,14 +18,18 @@ public: // types
 private: // variables
   const AnsweredQuestion _aq;
   CEQuiz<taNumber> *_pQuiz;
+  // If not nullptr, the subtasks are split over the indices into this array of active vectors of targets.
+  const TPqaId *const _pActiveVects;
 public: // variables
   SRPlat::SRNumPack<taNumber> _sumPriors;
 
 public:
-  explicit CERecordAnswerTask(CpuEngine<taNumber> &engine, CEQuiz<taNumber> &quiz, const AnsweredQuestion& aq)
-    : CEBaseTask(engine), _pQuiz(&quiz), _aq(aq) { }
+  explicit CERecordAnswerTask(CpuEngine<taNumber> &engine, CEQuiz<taNumber> &quiz, const AnsweredQuestion& aq,
+    const TPqaId *const pActiveVects = nullptr)
+    : CEBaseTask(engine), _pQuiz(&quiz), _aq(aq), _pActiveVects(pActiveVects) { }
 
   const AnsweredQuestion& GetAQ() const { return _aq; }
+  const TPqaId* GetActiveVects() const { return _pActiveVects; }
   CEQuiz<taNumber>& GetQuiz() const { return *_pQuiz; }
 };
 
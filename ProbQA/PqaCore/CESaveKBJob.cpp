@@ -0,0 +1,110 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CESaveKBJob.h"
+#include "../PqaCore/CpuEngine.h"
+#include "../PqaCore/ErrorHelper.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template<typename taNumber> CESaveKBJob<taNumber>::CESaveKBJob(CpuEngine<taNumber> &engine,
+  const char* const filePath, const SaveKBOptions &options) : _engine(engine), _filePath(filePath), _options(options),
+  _tStart(std::chrono::steady_clock::now()), _nBytesTotal(0), _nBytesWritten(0), _lockMicros(0),
+  _writeStartMicros(0), _bCancel(false), _doneMicros(0), _bDone(false), _bResultTaken(false),
+  _thread(&CESaveKBJob::RunThread, this)
+{ }
+
+template<typename taNumber> CESaveKBJob<taNumber>::~CESaveKBJob() {
+  Wait();
+  _thread.join();
+}
+
+template<typename taNumber> uint64_t CESaveKBJob<taNumber>::GetElapsedMicros() const {
+  return SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - _tStart).count());
+}
+
+template<typename taNumber> void CESaveKBJob<taNumber>::RunThread() {
+  if (_options._bLowPriority) {
+    // The background mode lowers the I/O priority too, so that the disk serves the foreground first.
+    SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+  }
+  PqaError err;
+  try {
+    err = _engine.RunSaveKBJob(*this);
+  }
+  CATCH_TO_ERR_SET(err);
+  // The engine may be gone from now on, because the job has left its maintenance switch.
+  SRLock<SRCriticalSection> csl(_cs);
+  _result = std::move(err);
+  _doneMicros = GetElapsedMicros();
+  _bDone = true;
+  _finished.WakeAll();
+}
+
+template<typename taNumber> void CESaveKBJob<taNumber>::OnSnapshotTaken(const uint64_t nBytesTotal,
+  const uint64_t lockMicros)
+{
+  _nBytesTotal.store(nBytesTotal, std::memory_order_relaxed);
+  _lockMicros.store(lockMicros, std::memory_order_relaxed);
+  _writeStartMicros.store(GetElapsedMicros(), std::memory_order_relaxed);
+}
+
+template<typename taNumber> void CESaveKBJob<taNumber>::GetProgress(SaveKBProgress &progress) {
+  {
+    SRLock<SRCriticalSection> csl(_cs);
+    progress._bDone = _bDone;
+    progress._elapsedMicros = _bDone ? _doneMicros : GetElapsedMicros();
+  }
+  progress._nBytesTotal = _nBytesTotal.load(std::memory_order_relaxed);
+  progress._nBytesWritten = _nBytesWritten.load(std::memory_order_relaxed);
+  progress._lockMicros = _lockMicros.load(std::memory_order_relaxed);
+  const uint64_t writeStartMicros = _writeStartMicros.load(std::memory_order_relaxed);
+  progress._bytesPerSec = (writeStartMicros == 0 || progress._elapsedMicros <= writeStartMicros) ? 0
+    : progress._nBytesWritten * 1e6 / (progress._elapsedMicros - writeStartMicros);
+}
+
+template<typename taNumber> bool CESaveKBJob<taNumber>::Wait(const uint32_t timeoutMiS) {
+  const auto tDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMiS);
+  SRLock<SRCriticalSection> csl(_cs);
+  while (!_bDone) {
+    uint32_t waitMiS = INFINITE;
+    if (timeoutMiS != INFINITE) {
+      const int64_t leftMiS = std::chrono::duration_cast<std::chrono::milliseconds>(
+        tDeadline - std::chrono::steady_clock::now()).count();
+      if (leftMiS <= 0) {
+        return false;
+      }
+      waitMiS = static_cast<uint32_t>(leftMiS);
+    }
+    _finished.Wait(_cs, waitMiS);
+  }
+  return true;
+}
+
+template<typename taNumber> void CESaveKBJob<taNumber>::Cancel() {
+  _bCancel.store(true, std::memory_order_relaxed);
+}
+
+template<typename taNumber> PqaError CESaveKBJob<taNumber>::TakeResult() {
+  SRLock<SRCriticalSection> csl(_cs);
+  if (!_bDone) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+      "The save of the KB is still in progress."));
+  }
+  if (_bResultTaken) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+      "The result of the save of the KB has already been taken."));
+  }
+  _bResultTaken = true;
+  return std::move(_result);
+}
+
+template class CESaveKBJob<SRDoubleNumber>;
+template class CESaveKBJob<SRFloatNumber>;
+
+} // namespace ProbQA
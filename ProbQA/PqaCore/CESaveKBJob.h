@@ -0,0 +1,58 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/Interface/IPqaSaveKBJob.h"
+
+namespace ProbQA {
+
+// Runs CpuEngine::RunSaveKBJob() on its own thread, and publishes the progress and the outcome. The engine holds the
+//   maintenance switch for the job, so that it isn't shut down until the job stops using it.
+template<typename taNumber> class CESaveKBJob : public IPqaSaveKBJob {
+  CpuEngine<taNumber> &_engine;
+  const std::string _filePath;
+  const SaveKBOptions _options;
+  const std::chrono::steady_clock::time_point _tStart;
+  std::atomic<uint64_t> _nBytesTotal;
+  std::atomic<uint64_t> _nBytesWritten;
+  std::atomic<uint64_t> _lockMicros;
+  // The time since _tStart when writing the file began.
+  std::atomic<uint64_t> _writeStartMicros;
+  std::atomic<bool> _bCancel;
+  SRPlat::SRCriticalSection _cs;
+  SRPlat::SRConditionVariable _finished;
+  PqaError _result; // Guarded by _cs
+  uint64_t _doneMicros; // Guarded by _cs
+  bool _bDone; // Guarded by _cs
+  bool _bResultTaken; // Guarded by _cs
+  // Must be the last, so that the thread starts with the rest initialized.
+  std::thread _thread;
+
+private: // methods
+  void RunThread();
+  uint64_t GetElapsedMicros() const;
+
+public: // Internal interface methods
+  // The caller must have entered the maintenance switch of |engine| in agnostic mode, which the job leaves.
+  explicit CESaveKBJob(CpuEngine<taNumber> &engine, const char* const filePath, const SaveKBOptions &options);
+
+  const char* GetFilePath() const { return _filePath.c_str(); }
+  const SaveKBOptions& GetOptions() const { return _options; }
+  bool IsCancelled() const { return _bCancel.load(std::memory_order_relaxed); }
+  // Called once the snapshot is taken and the KB lock is released.
+  void OnSnapshotTaken(const uint64_t nBytesTotal, const uint64_t lockMicros);
+  void AddBytesWritten(const uint64_t nBytes) { _nBytesWritten.fetch_add(nBytes, std::memory_order_relaxed); }
+
+public: // Client interface methods
+  virtual ~CESaveKBJob() override final;
+
+  virtual void GetProgress(SaveKBProgress &progress) override final;
+  virtual bool Wait(const uint32_t timeoutMiS = INFINITE) override final;
+  virtual void Cancel() override final;
+  virtual PqaError TakeResult() override final;
+};
+
+} // namespace ProbQA
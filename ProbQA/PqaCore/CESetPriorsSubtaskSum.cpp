@@ -13,6 +13,7 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CESetPriorsSubtaskSum<SRDoubleNumber>;
+template class CESetPriorsSubtaskSum<SRFloatNumber>;
 
 template<> void CESetPriorsSubtaskSum<SRDoubleNumber>::Run() {
   auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
@@ -24,7 +25,7 @@ template<> void CESetPriorsSubtaskSum<SRDoubleNumber>::Run() {
     " 64-bit integer.");
   auto *PTR_RESTRICT pExps = SRCast::Ptr<__m256i>(quiz.GetTlhExps());
   auto *PTR_RESTRICT pMants = SRCast::Ptr<__m256d>(quiz.GetPriorMants());
-  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256d>(&(engine.GetB(0)));
+  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256d>(engine.GetKB().GetB());
 
   SRAccumVectDbl256 acc;
   for (TPqaId i = _iFirst; i < _iLimit; i++) {
@@ -39,4 +40,31 @@ template<> void CESetPriorsSubtaskSum<SRDoubleNumber>::Run() {
   _mm_sfence();
 }
 
+template<> void CESetPriorsSubtaskSum<SRFloatNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  const CEQuiz<SRFloatNumber> &PTR_RESTRICT quiz = task.GetQuiz();
+  const GapTracker<TPqaId> &PTR_RESTRICT targGaps = engine.GetTargetGaps();
+
+  static_assert(std::is_same<int64_t, CEQuiz<SRFloatNumber>::TExponent>::value, "The code below assumes TExponent is"
+    " 64-bit integer.");
+  // There are 2 vectors of exponents per vector of 8 mantissas.
+  auto *PTR_RESTRICT pExps = SRCast::Ptr<__m256i>(quiz.GetTlhExps());
+  auto *PTR_RESTRICT pMants = SRCast::Ptr<__m256>(quiz.GetPriorMants());
+  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256>(engine.GetKB().GetB());
+
+  SRAccumVectDbl256 acc;
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    const __m256 allMants = SRSimd::Load<false>(pvB + i);
+    const uint8_t gaps = targGaps.GetOctet(i);
+    const __m256 activeMants = _mm256_andnot_ps(_mm256_castsi256_ps(SRSimd::SetToBitOctet(gaps)), allMants);
+    SRSimd::Store<false>(pMants + i, activeMants);
+    SRSimd::Store<false>(pExps + 2 * i, _mm256_setzero_si256());
+    SRSimd::Store<false>(pExps + 2 * i + 1, _mm256_setzero_si256());
+    acc.Add(activeMants);
+  }
+  _sumPriors.SetValue(static_cast<float>(acc.PreciseSum()));
+  _mm_sfence();
+}
+
 } // namespace ProbQA
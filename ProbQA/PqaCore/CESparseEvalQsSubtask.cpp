@@ -0,0 +1,110 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CESparseEvalQsSubtask.h"
+#include "../PqaCore/CESparseEvalQsTask.h"
+#include "../PqaCore/CESparseQuiz.h"
+#include "../PqaCore/CEEvalQsSubtaskConsider.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+size_t CESparseEvalQsSubtask::CalcStackReq(const EngineDefinition& engDef) {
+  return sizeof(AnswerMetrics<SRDoubleNumber>) * SRCast::ToSizeT(engDef._dims._nAnswers);
+}
+
+// For a question i and an answer k, the posterior of target j is p[j]*A[i][k][j]/D[i][j]/W[k], where W[k] is the sum of
+//   the numerators. For the targets with default cells, A/D is the same ratio r0, so their sums over the targets are
+//   expressed via the sums of the priors: these are precomputed over all the targets, and the sums over the explicit
+//   targets are subtracted.
+void CESparseEvalQsSubtask::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  auto &PTR_RESTRICT engine = static_cast<const SparseCpuEngine&>(task.GetBaseEngine());
+  const CESparseKB &PTR_RESTRICT kb = engine.GetKB();
+  const CESparseQuiz &PTR_RESTRICT quiz = task.GetQuiz();
+  const TPqaId nAnswers = engine.GetDims()._nAnswers;
+  const double *const PTR_RESTRICT pProbs = task._pProbs;
+  const double *const PTR_RESTRICT pLog2Probs = task._pLog2Probs;
+  auto *const PTR_RESTRICT pAnsMets = SR_STACK_ALLOC(AnswerMetrics<SRDoubleNumber>, nAnswers);
+
+  SRAccumulator<SRDoubleNumber> accRunLength(SRDoubleNumber(0.0));
+  for (TPqaId i = _iFirst; i < _iLimit; i++) {
+    if (engine.GetQuestionGaps().IsGap(i) || SRBitHelper::Test(quiz.GetQAsked(), i)) {
+      // Set 0 probability to this question
+      task._pRunLength[i] = accRunLength.Get();
+      continue;
+    }
+    const size_t iQuestion = SRCast::ToSizeT(i);
+    // The default cells differ between the questions, while their ratio A/D is 1/nAnswers for all of them.
+    const double defaultA = kb.GetDefaultA(iQuestion);
+    const double ratio0 = defaultA / kb.GetDefaultD(iQuestion);
+    const double invD0 = 1 / kb.GetDefaultD(iQuestion);
+    const CESparseRow &PTR_RESTRICT rowD = kb.GetDRow(iQuestion);
+    const TPqaId *const PTR_RESTRICT pExplicit = rowD.GetTargets();
+    const double *const PTR_RESTRICT pD = rowD.GetValues();
+    const size_t nExplicit = rowD.GetSize();
+
+    // Sums of the priors over the explicit targets
+    double explP = 0, explPLog2P = 0, explPSquare = 0;
+    for (size_t j = 0; j < nExplicit; j++) {
+      const double p = pProbs[pExplicit[j]];
+      if (p > 0) {
+        explP += p;
+        explPLog2P += p * pLog2Probs[pExplicit[j]];
+        explPSquare += p * p;
+      }
+    }
+    const double defP = std::max(1 - explP, 0.0);
+
+    SRAccumulator<SRDoubleNumber> accTotW(SRDoubleNumber(0.0));
+    SRAccumulator<SRDoubleNumber> accL(SRDoubleNumber(0.0));
+    for (TPqaId k = 0; k < nAnswers; k++) {
+      const CESparseRow &PTR_RESTRICT rowA = kb.GetARow(iQuestion, SRCast::ToSizeT(k));
+      double explW = 0;
+      CESparseKB::ForEachMerged(pExplicit, nExplicit, rowA, defaultA, [&](const size_t j, const double a) {
+        explW += pProbs[pExplicit[j]] * a / pD[j];
+      });
+      const double Wk = ratio0 * defP + explW;
+      accTotW.Add(SRDoubleNumber::FromDouble(Wk));
+      pAnsMets[k]._weight.SetValue(Wk);
+      const double invWk = 1 / Wk;
+
+      // The posteriors of the targets with default cells are p*defRatio .
+      const double defRatio = ratio0 * invWk;
+      const double defLog2Ratio = std::log2(defRatio);
+      double negEnt = 0, velocity = 0, lack = 0, explLack = 0;
+      CESparseKB::ForEachMerged(pExplicit, nExplicit, rowA, defaultA, [&](const size_t j, const double a) {
+        const double p = pProbs[pExplicit[j]];
+        if (p <= 0) {
+          return;
+        }
+        const double invD = 1 / pD[j];
+        const double posterior = p * a * invD * invWk;
+        const double l2post = std::log2(posterior);
+        negEnt += posterior * l2post;
+        const double diff = posterior - p;
+        velocity += diff * diff;
+        lack += invD * invD / l2post;
+        explLack += task.TargetLack(pExplicit[j], defLog2Ratio);
+      });
+      negEnt += defRatio * ((task._sumPLog2P - explPLog2P) + defLog2Ratio * defP);
+      const double defDiff = defRatio - 1;
+      velocity += defDiff * defDiff * std::max(task._sumPSquare - explPSquare, 0.0);
+      lack += invD0 * invD0 * (task.SumLack(defLog2Ratio) - explLack);
+      accL.Add(SRDoubleNumber::FromDouble(lack));
+
+      pAnsMets[k]._entropy.SetValue(-negEnt);
+      pAnsMets[k]._velocity.SetValue(velocity);
+    }
+    const double priority = CEEvalQsSubtaskConsider<SRDoubleNumber>::CalcPriority(engine, pAnsMets,
+      accTotW.Get().GetValue(), -accL.Get().GetValue(), task._nValidTargets);
+    accRunLength.Add(SRDoubleNumber::FromDouble(priority));
+
+    task._pRunLength[i] = accRunLength.Get();
+  }
+}
+
+} // namespace ProbQA
@@ -0,0 +1,24 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaCommon.h"
+
+namespace ProbQA {
+
+class CESparseEvalQsTask;
+
+class CESparseEvalQsSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CESparseEvalQsTask TTask;
+
+public: // methods
+  static size_t CalcStackReq(const EngineDefinition& engDef);
+
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,87 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEBaseTask.h"
+#include "../PqaCore/SparseCpuEngine.h"
+
+namespace ProbQA {
+
+// Question evaluation over a sparse KB. Only the explicit cells of the KB are visited per question: the contribution of
+//   the targets with default cells is computed from the statistics of the priors, which are gathered once per
+//   NextQuestion() by the engine.
+class CESparseEvalQsTask : public CEBaseTask {
+public: // constants
+  // The targets with prior probability at least 2**_cHeavyLog2 are processed exactly in the lack term. There are at
+  //   most 2**(-_cHeavyLog2) of them.
+  static constexpr double _cHeavyLog2 = -8;
+  static constexpr TPqaId _cMaxHeavy = TPqaId(1) << 8;
+  // The lighter targets are approximated by the mean log2 prior of their bin in a histogram over log2(-log2(p)) of the
+  //   prior probability p. A bin spans the ratio 2**h of log2(p), where h = log2(log2(pMin)/_cHeavyLog2)/_cNBins for the
+  //   least positive prior pMin, so h < log2(1075/8)/256 < 0.028 for any double, and 2**h-1 < 1.93% . The lack term
+  //   1/log2(q) of a light target with posterior q is then off by the relative error up to (2**h-1)*log2(p)/log2(q) to
+  //   the first order, i.e. by less than 4% while q <= sqrt(p) . The exact term would take time proportional to the
+  //   number of targets for each question and answer, while this takes time proportional to the explicit cells.
+  static constexpr TPqaId _cNBins = 256;
+
+public: // variables
+  const CESparseQuiz *const _pQuiz;
+  // The priorities of the questions span a range beyond float, so their run lengths are in double precision.
+  SRPlat::SRDoubleNumber *const _pRunLength;
+  const TPqaId _nValidTargets;
+
+  //// Normalized priors and their statistics, filled by the engine before running the subtasks.
+  double *_pProbs; // zero for the targets in gaps
+  double *_pLog2Probs; // -inf for the targets in gaps
+  // The log2 prior that stands for each target with a nonzero prior in the lack term: exact for the heavy targets, and
+  //   the mean of the bin for the light ones.
+  double *_pLackLog2;
+  double _sumPLog2P;
+  double _sumPSquare;
+  double *_pHeavyLog2; // log2 of the heavy priors
+  TPqaId _nHeavy;
+  double *_pBinCounts;
+  double *_pBinMeans; // the mean log2 of the priors in each bin
+  double _binLow; // log2(-_cHeavyLog2)
+  double _binScale;
+
+public: // methods
+  explicit CESparseEvalQsTask(SparseCpuEngine &engine, const CESparseQuiz &quiz, const TPqaId nValidTargets,
+    SRPlat::SRDoubleNumber *pRunLength)
+    : CEBaseTask(engine), _pQuiz(&quiz), _pRunLength(pRunLength), _nValidTargets(nValidTargets)
+  { }
+
+  const CESparseQuiz& GetQuiz() const { return *_pQuiz; }
+  const SRPlat::SRDoubleNumber* GetRunLength() const { return _pRunLength; }
+
+  // Sum of 1/(x+logRatio) over the log2 priors x of all the targets with nonzero priors, with the light targets
+  //   approximated by the bins.
+  double SumLack(const double logRatio) const {
+    double sum = 0;
+    for (TPqaId i = 0; i < _nHeavy; i++) {
+      sum += 1 / (_pHeavyLog2[i] + logRatio);
+    }
+    for (TPqaId i = 0; i < _cNBins; i++) {
+      if (_pBinCounts[i] != 0) {
+        sum += _pBinCounts[i] / (_pBinMeans[i] + logRatio);
+      }
+    }
+    return sum;
+  }
+
+  // The term of SumLack() for target |iTarget| with a nonzero prior, approximated the same way.
+  double TargetLack(const TPqaId iTarget, const double logRatio) const {
+    return 1 / (_pLackLog2[iTarget] + logRatio);
+  }
+
+  // The priors above 2**_cHeavyLog2, which are light only beyond _cMaxHeavy due to rounding, go to the first bin.
+  TPqaId GetBin(const double log2P) const {
+    const double y = std::log2(std::max(-log2P, -_cHeavyLog2));
+    const TPqaId iBin = static_cast<TPqaId>((y - _binLow) * _binScale);
+    return std::min(std::max(iBin, TPqaId(0)), _cNBins - 1);
+  }
+};
+
+} // namespace ProbQA
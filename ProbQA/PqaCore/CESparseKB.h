@@ -0,0 +1,242 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaCommon.h"
+
+namespace ProbQA {
+
+// The explicit cells of a row of the KB over the targets: the target indices in increasing order and their values. The
+//   other cells of the row have the default value, which is kept by the owner.
+class CESparseRow {
+  std::vector<TPqaId> _iTargets;
+  std::vector<double> _values;
+
+public: // methods
+  size_t GetSize() const { return _iTargets.size(); }
+  const TPqaId* GetTargets() const { return _iTargets.data(); }
+  const double* GetValues() const { return _values.data(); }
+  size_t GetNBytes() const { return _iTargets.size() * (sizeof(TPqaId) + sizeof(double)); }
+
+  // Returns the value of the cell for |iTarget|, or |defaultValue| if the cell is not explicit.
+  double Get(const TPqaId iTarget, const double defaultValue) const {
+    auto it = std::lower_bound(_iTargets.begin(), _iTargets.end(), iTarget);
+    if (it == _iTargets.end() || *it != iTarget) {
+      return defaultValue;
+    }
+    return _values[it - _iTargets.begin()];
+  }
+
+  // Returns the cell for |iTarget|, making it explicit with |defaultValue| if it wasn't.
+  double& Mod(const TPqaId iTarget, const double defaultValue) {
+    auto it = std::lower_bound(_iTargets.begin(), _iTargets.end(), iTarget);
+    const size_t pos = it - _iTargets.begin();
+    if (it == _iTargets.end() || *it != iTarget) {
+      _iTargets.insert(it, iTarget);
+      _values.insert(_values.begin() + pos, defaultValue);
+    }
+    return _values[pos];
+  }
+
+  // Make the cell for |iTarget| default again, if it was explicit.
+  void Erase(const TPqaId iTarget) {
+    auto it = std::lower_bound(_iTargets.begin(), _iTargets.end(), iTarget);
+    if (it != _iTargets.end() && *it == iTarget) {
+      _values.erase(_values.begin() + (it - _iTargets.begin()));
+      _iTargets.erase(it);
+    }
+  }
+
+  // Renumber the targets to |pNewIds[iTarget]|, dropping the cells where it's negative. The new numbering must keep
+  //   the order of the remaining targets, as compaction does.
+  void Renumber(const TPqaId *pNewIds) {
+    size_t nKept = 0;
+    for (size_t j = 0; j < _iTargets.size(); j++) {
+      const TPqaId iNew = pNewIds[_iTargets[j]];
+      if (iNew < 0) {
+        continue;
+      }
+      assert(nKept == 0 || _iTargets[nKept - 1] < iNew);
+      _iTargets[nKept] = iNew;
+      _values[nKept] = _values[j];
+      nKept++;
+    }
+    _iTargets.resize(nKept);
+    _values.resize(nKept);
+  }
+
+  // Replace the cells with |nCells| ones from |pTargets| and |pValues|, where the targets are in increasing order.
+  void Assign(const TPqaId *pTargets, const double *pValues, const size_t nCells) {
+    _iTargets.assign(pTargets, pTargets + nCells);
+    _values.assign(pValues, pValues + nCells);
+  }
+
+  void Clear() {
+    std::vector<TPqaId>().swap(_iTargets);
+    std::vector<double>().swap(_values);
+  }
+};
+
+// Sparse knowledge base of the CPU engine: for each question, a row of explicit cells of cube A per answer, and a row
+//   of explicit cells of matrix D . The cells that have never been trained keep the initial values of the question, so
+//   they are not stored: the default cell of A of a question is the square of its initial amount, and the default cell
+//   of D is the sum of the default cells of A over the answers. A cell of D is explicit whenever any cell of A for the
+//   same question and target is explicit, because training and adding targets change them together. Vector B is dense,
+//   as it takes only as much memory as the priors of a quiz.
+// This class is not thread-safe: the engine guards it with its reader-writer lock.
+class CESparseKB {
+  std::vector<CESparseRow> _rows; // [iQuestion][iAnswer], and the row of D at iAnswer=_nAnswers
+  std::vector<double> _defaultA; // [iQuestion]
+  std::vector<double> _b;
+  size_t _nAnswers = 0;
+
+public: // methods
+  void Init(const size_t nQuestions, const size_t nAnswers, const size_t nTargets, const double defaultA,
+    const double initB)
+  {
+    _rows.clear();
+    _rows.resize(nQuestions * (nAnswers + 1));
+    _defaultA.assign(nQuestions, defaultA);
+    _b.assign(nTargets, initB);
+    _nAnswers = nAnswers;
+  }
+
+  void Clear() {
+    std::vector<CESparseRow>().swap(_rows);
+    std::vector<double>().swap(_defaultA);
+    std::vector<double>().swap(_b);
+    _nAnswers = 0;
+  }
+
+  size_t GetNQuestions() const { return _defaultA.size(); }
+  size_t GetNAnswers() const { return _nAnswers; }
+  size_t GetNTargets() const { return _b.size(); }
+
+  double GetDefaultA(const size_t iQuestion) const { return _defaultA[iQuestion]; }
+  double GetDefaultD(const size_t iQuestion) const { return _defaultA[iQuestion] * _nAnswers; }
+
+  const CESparseRow& GetARow(const size_t iQuestion, const size_t iAnswer) const {
+    return _rows[iQuestion * (_nAnswers + 1) + iAnswer];
+  }
+  CESparseRow& ModARow(const size_t iQuestion, const size_t iAnswer) {
+    return _rows[iQuestion * (_nAnswers + 1) + iAnswer];
+  }
+  const CESparseRow& GetDRow(const size_t iQuestion) const { return GetARow(iQuestion, _nAnswers); }
+  CESparseRow& ModDRow(const size_t iQuestion) { return ModARow(iQuestion, _nAnswers); }
+
+  // The rows in the order of the KB file: [iQuestion][iAnswer] rows of A, each followed by the row of D .
+  size_t GetNRows() const { return _rows.size(); }
+  const CESparseRow& GetRow(const size_t iRow) const { return _rows[iRow]; }
+  CESparseRow& ModRow(const size_t iRow) { return _rows[iRow]; }
+  const double* GetDefaultsA() const { return _defaultA.data(); }
+
+  const double* GetB() const { return _b.data(); }
+  double* ModB() { return _b.data(); }
+
+  // Grow to |nQuestions| and |nTargets|. The new questions have no cells and the default value 0, and the new items of
+  //   vector B are 0, so they must be initialized before use.
+  void Grow(const size_t nQuestions, const size_t nTargets) {
+    assert(nQuestions >= GetNQuestions() && nTargets >= GetNTargets());
+    _rows.resize(nQuestions * (_nAnswers + 1));
+    _defaultA.resize(nQuestions, 0);
+    _b.resize(nTargets, 0);
+  }
+
+  // Reset |iQuestion| to the initial state with the default cell of A |defaultA|.
+  void InitQuestion(const size_t iQuestion, const double defaultA) {
+    for (size_t k = 0; k <= _nAnswers; k++) {
+      ModARow(iQuestion, k).Clear();
+    }
+    _defaultA[iQuestion] = defaultA;
+  }
+
+  // Reset |iTarget| to the initial state with the cells of A |initA| for all the questions, and the item of vector B
+  //   |initB|. The cells are explicit in the questions whose default differs.
+  void InitTarget(const TPqaId iTarget, const double initA, const double initB) {
+    const double initD = initA * _nAnswers;
+    for (size_t i = 0; i < _defaultA.size(); i++) {
+      const bool bExplicit = (_defaultA[i] != initA);
+      for (size_t k = 0; k < _nAnswers; k++) {
+        CESparseRow &rowA = ModARow(i, k);
+        if (bExplicit) {
+          rowA.Mod(iTarget, initA) = initA;
+        } else {
+          rowA.Erase(iTarget);
+        }
+      }
+      if (bExplicit) {
+        ModDRow(i).Mod(iTarget, initD) = initD;
+      } else {
+        ModDRow(i).Erase(iTarget);
+      }
+    }
+    _b[SRPlat::SRCast::ToSizeT(iTarget)] = initB;
+  }
+
+  // Keep |nQuestions| questions, the i-th of which is |pOldQuestions[i]|, and |nTargets| targets, the j-th of which is
+  //   |pOldTargets[j]|. Both old ids must be increasing.
+  void Compact(const size_t nQuestions, const TPqaId *pOldQuestions, const size_t nTargets,
+    const TPqaId *pOldTargets)
+  {
+    const size_t nRowsPerQuestion = _nAnswers + 1;
+    for (size_t i = 0; i < nQuestions; i++) {
+      const size_t iOld = SRPlat::SRCast::ToSizeT(pOldQuestions[i]);
+      assert(i <= iOld);
+      if (iOld == i) {
+        continue;
+      }
+      for (size_t k = 0; k < nRowsPerQuestion; k++) {
+        _rows[i * nRowsPerQuestion + k] = std::move(_rows[iOld * nRowsPerQuestion + k]);
+      }
+      _defaultA[i] = _defaultA[iOld];
+    }
+    _rows.resize(nQuestions * nRowsPerQuestion);
+    _defaultA.resize(nQuestions);
+
+    std::vector<TPqaId> newIds(_b.size(), cInvalidPqaId);
+    for (size_t j = 0; j < nTargets; j++) {
+      const size_t jOld = SRPlat::SRCast::ToSizeT(pOldTargets[j]);
+      assert(j <= jOld);
+      newIds[jOld] = TPqaId(j);
+      _b[j] = _b[jOld];
+    }
+    _b.resize(nTargets);
+    for (CESparseRow& row : _rows) {
+      row.Renumber(newIds.data());
+    }
+  }
+
+  // The number of bytes taken by the explicit cells, the default cells of the questions and vector B .
+  size_t GetNBytes() const {
+    size_t nBytes = (_defaultA.size() + _b.size()) * sizeof(double);
+    for (const CESparseRow& row : _rows) {
+      nBytes += row.GetNBytes();
+    }
+    return nBytes;
+  }
+
+  // Call f(i, value) for each i-th target in |pTargets|, with the value from |row| or |defaultValue|. |pTargets|
+  //   must be sorted and contain all the targets of |row|.
+  template<typename taFunc> static void ForEachMerged(const TPqaId *pTargets, const size_t nTargets,
+    const CESparseRow& row, const double defaultValue, const taFunc &f)
+  {
+    const TPqaId *pRowTargets = row.GetTargets();
+    const double *pRowValues = row.GetValues();
+    size_t j = 0;
+    const size_t nRow = row.GetSize();
+    for (size_t i = 0; i < nTargets; i++) {
+      if (j < nRow && pRowTargets[j] == pTargets[i]) {
+        f(i, pRowValues[j]);
+        j++;
+      }
+      else {
+        f(i, defaultValue);
+      }
+    }
+    assert(j == nRow);
+  }
+};
+
+} // namespace ProbQA
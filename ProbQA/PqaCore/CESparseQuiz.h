@@ -0,0 +1,56 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CEQuiz.h"
+#include "../PqaCore/SparseCpuEngine.h"
+
+namespace ProbQA {
+
+class CESparseQuiz : public CEBaseQuiz {
+  // Log2 of the target likelihoods, except the factor which the answers contribute to all the targets via the default
+  //   cells of the KB. The likelihoods aren't normalized, as log2 doesn't underflow. -inf for the targets in gaps.
+  double *_pLogLhs;
+
+public: // methods
+  explicit CESparseQuiz(SparseCpuEngine *pEngine);
+  ~CESparseQuiz();
+  double* GetLogLhs() const { return _pLogLhs; }
+  SparseCpuEngine* GetEngine() const { return static_cast<SparseCpuEngine*>(GetBaseEngine()); }
+  inline PqaError RecordAnswer(const TPqaId iAnswer);
+};
+
+inline CESparseQuiz::CESparseQuiz(SparseCpuEngine *pEngine) : CEBaseQuiz(pEngine) {
+  const size_t nTargets = SRPlat::SRCast::ToSizeT(pEngine->GetDims()._nTargets);
+  // First allocate all the memory so to revert if anything fails.
+  SRPlat::SRSmartMPP<double> smppLogLhs(pEngine->GetMemPool(), nTargets);
+  _pLogLhs = smppLogLhs.Detach();
+}
+
+inline CESparseQuiz::~CESparseQuiz() {
+  //NOTE: engine dimensions must not change during lifetime of the quiz because below we must provide the same number
+  //  of targets.
+  const size_t nTargets = SRPlat::SRCast::ToSizeT(GetBaseEngine()->GetDims()._nTargets);
+  GetBaseEngine()->GetMemPool().ReleaseMem(_pLogLhs, sizeof(*_pLogLhs) * nTargets);
+}
+
+inline PqaError CESparseQuiz::RecordAnswer(const TPqaId iAnswer) {
+  if (_activeQuestion == cInvalidPqaId) {
+    return PqaError(PqaErrorCode::NoQuizActiveQuestion, new NoQuizActiveQuestionErrorParams(iAnswer),
+      SRPlat::SRString::MakeUnowned(SR_FILE_LINE "An attempt to record an answer in a quiz that doesn't have an active"
+        "question"));
+  }
+  _answers.emplace_back(_activeQuestion, iAnswer);
+  SRPlat::SRBitHelper::Set(GetQAsked(), _activeQuestion);
+  _activeQuestion = cInvalidPqaId;
+
+  // Only the targets with explicit cells for the question change their likelihoods relative to the others.
+  SparseCpuEngine &PTR_RESTRICT engine = *GetEngine();
+  SRPlat::SRRWLock<false> rwl(engine.GetRws());
+  engine.ApplyAnswer(*this, _answers.back());
+  return PqaError();
+}
+
+} // namespace ProbQA
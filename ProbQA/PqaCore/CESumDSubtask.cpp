@@ -0,0 +1,60 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CESumDSubtask.h"
+#include "../PqaCore/CpuEngine.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+template class CESumDSubtask<SRDoubleNumber>;
+template class CESumDSubtask<SRFloatNumber>;
+
+// The loads are cached, because the source is the live KB. The weights of cube A are positive, so the sums only grow
+//   and Kahan summation is as precise as Neumaier's variant here.
+template<> void CESumDSubtask<SRDoubleNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  const CEKBArena<SRDoubleNumber> &PTR_RESTRICT kb = task.GetKB();
+  const size_t nAnswers = kb.GetNAnswers();
+  const size_t nTargStride = kb.GetTargStride();
+
+  for (size_t i = task._iFirst; i < task._iLimit; i++) {
+    double *PTR_RESTRICT pRow = task._pSums + (i - task._iFirst) * nTargStride;
+    for (int64_t j = _iFirst; j < _iLimit; j++) {
+      const size_t iTarg = SRCast::ToSizeT(j) << CEKBArena<SRDoubleNumber>::_cLogNumsPerVect;
+      SRAccumVectDbl256 acc;
+      for (size_t k = 0; k < nAnswers; k++) {
+        acc.Add(SRSimd::Load<true>(SRCast::CPtr<__m256d>(&kb.GetA(i, k, iTarg))));
+      }
+      _mm256_storeu_pd(pRow + iTarg, acc.ComponentSums());
+    }
+  }
+}
+
+template<> void CESumDSubtask<SRFloatNumber>::Run() {
+  auto &PTR_RESTRICT task = static_cast<const TTask&>(*GetTask());
+  const CEKBArena<SRFloatNumber> &PTR_RESTRICT kb = task.GetKB();
+  const size_t nAnswers = kb.GetNAnswers();
+  const size_t nTargStride = kb.GetTargStride();
+
+  for (size_t i = task._iFirst; i < task._iLimit; i++) {
+    double *PTR_RESTRICT pRow = task._pSums + (i - task._iFirst) * nTargStride;
+    for (int64_t j = _iFirst; j < _iLimit; j++) {
+      const size_t iTarg = SRCast::ToSizeT(j) << CEKBArena<SRFloatNumber>::_cLogNumsPerVect;
+      // The lower and the upper halves of the vector of floats.
+      SRAccumVectDbl256 accLo, accHi;
+      for (size_t k = 0; k < nAnswers; k++) {
+        const __m256 a = SRSimd::Load<true>(SRCast::CPtr<__m256>(&kb.GetA(i, k, iTarg)));
+        accLo.Add(SRSimd::WidenLowF32(a));
+        accHi.Add(SRSimd::WidenHighF32(a));
+      }
+      _mm256_storeu_pd(pRow + iTarg, accLo.ComponentSums());
+      _mm256_storeu_pd(pRow + iTarg + SRSimd::_cNComps64, accHi.ComponentSums());
+    }
+  }
+}
+
+} // namespace ProbQA
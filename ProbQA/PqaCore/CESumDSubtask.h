@@ -0,0 +1,22 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CESumDTask.h"
+
+namespace ProbQA {
+
+// Sums with Kahan summation the target vectors in range [_iFirst;_iLimit) of cube A over the answers, for each question
+//   of the task.
+template<typename taNumber> class CESumDSubtask : public SRPlat::SRStandardSubtask {
+public: // types
+  typedef CESumDTask<taNumber> TTask;
+
+public: // methods
+  using SRPlat::SRStandardSubtask::SRStandardSubtask;
+  virtual void Run() override final;
+};
+
+} // namespace ProbQA
@@ -0,0 +1,32 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/CpuEngine.fwd.h"
+#include "../PqaCore/CEBaseTask.h"
+#include "../PqaCore/CEKBArena.h"
+
+namespace ProbQA {
+
+// Sum cube A over the answers for the questions in range [_iFirst;_iLimit) in parallel, split by target vectors, into
+//   the rows of |pSums| of the target stride each, in double precision.
+template<typename taNumber> class CESumDTask : public CEBaseTask {
+  const CEKBArena<taNumber> *const _pKb;
+
+public: // variables
+  double *const _pSums;
+  const size_t _iFirst;
+  const size_t _iLimit;
+
+public:
+  explicit CESumDTask(CpuEngine<taNumber> &engine, const CEKBArena<taNumber> &kb, const size_t iFirst,
+    const size_t iLimit, double *pSums) : CEBaseTask(engine), _pKb(&kb), _pSums(pSums), _iFirst(iFirst),
+    _iLimit(iLimit)
+  { }
+
+  const CEKBArena<taNumber>& GetKB() const { return *_pKb; }
+};
+
+} // namespace ProbQA
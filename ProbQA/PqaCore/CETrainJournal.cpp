@@ -0,0 +1,202 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/CETrainJournal.h"
+#include "../PqaCore/KBFileFormat.h"
+#include "../PqaCore/Interface/PqaErrorParams.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+namespace {
+
+constexpr uint8_t cTrainJournalMagic[8] = { 0x8F, 'P', 'q', 'a', 'T', 'J', '\r', '\n' };
+// The records are read in chunks of this size, unless a record is larger.
+constexpr size_t cReadChunk = size_t(1024) * 1024;
+
+} // anonymous namespace
+
+CETrainJournal::CETrainJournal() : _iLastPending(0), _iLastDurable(0), _fileEnd(0), _bFlushing(false),
+  _bFailed(false), _bOpen(false)
+{ }
+
+uint64_t CETrainJournal::CalcChecksum(const RecordHeader &rh, const AnsweredQuestion *pAQs) {
+  RecordHeader header = rh;
+  header._checksum = 0;
+  const uint64_t hash = KBFileDirectory::HashBytes(KBFileDirectory::_cHashBasis, &header, sizeof(header));
+  return KBFileDirectory::HashBytes(hash, pAQs, size_t(rh._nQuestions) * sizeof(AnsweredQuestion));
+}
+
+PqaError CETrainJournal::Open(const char* const filePath, const TRecordHandler &fnRecord) {
+  if (!_file.Open(filePath, SRPositionalFile::Mode::Extend)) {
+    return PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(filePath), SRString::MakeUnowned(
+      SR_FILE_LINE "Can't open the training journal."));
+  }
+  _filePath = filePath;
+  uint64_t fileBytes;
+  if (!_file.GetSize(fileBytes)) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't get the size of the training journal."));
+  }
+
+  FileHeader fh;
+  uint64_t validEnd = sizeof(fh);
+  if (fileBytes < sizeof(fh)) {
+    // A new journal, or the one torn before its header was complete.
+    std::memcpy(fh._magic, cTrainJournalMagic, sizeof(cTrainJournalMagic));
+    fh._version = _cVersion;
+    fh._endianTag = KBFileDirectory::_cEndianTag;
+    if (!_file.Preallocate(0) || !_file.WriteAt(&fh, sizeof(fh), 0) || !_file.Flush()) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Can't write the header of the training journal."));
+    }
+  } else {
+    if (!_file.ReadAt(&fh, sizeof(fh), 0)) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Can't read the header of the training journal."));
+    }
+    if (std::memcmp(fh._magic, cTrainJournalMagic, sizeof(cTrainJournalMagic)) != 0
+      || fh._endianTag != KBFileDirectory::_cEndianTag || fh._version == 0 || fh._version > _cVersion)
+    {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "The file is not a training journal of a supported version and byte order."));
+    }
+
+    std::vector<uint8_t> buf;
+    uint64_t bufStart = 0;
+    bool bReadFailed = false;
+    // Returns nullptr if the file ends before |nBytes| at |offset|.
+    auto fnLoad = [&](const uint64_t offset, const size_t nBytes) -> const uint8_t* {
+      if (offset + nBytes > fileBytes) {
+        return nullptr;
+      }
+      if (offset < bufStart || offset + nBytes > bufStart + buf.size()) {
+        const size_t nToRead = SRCast::ToSizeT(std::min(uint64_t(std::max(nBytes, cReadChunk)), fileBytes - offset));
+        buf.resize(nToRead);
+        if (!_file.ReadAt(buf.data(), nToRead, offset)) {
+          bReadFailed = true;
+          return nullptr;
+        }
+        bufStart = offset;
+      }
+      return buf.data() + (offset - bufStart);
+    };
+
+    std::vector<AnsweredQuestion> aqs;
+    for (;;) {
+      const uint8_t *pBytes = fnLoad(validEnd, sizeof(RecordHeader));
+      if (pBytes == nullptr) {
+        break;
+      }
+      RecordHeader rh;
+      std::memcpy(&rh, pBytes, sizeof(rh));
+      const size_t nAQBytes = size_t(rh._nQuestions) * sizeof(AnsweredQuestion);
+      pBytes = fnLoad(validEnd + sizeof(rh), nAQBytes);
+      if (pBytes == nullptr) {
+        break;
+      }
+      aqs.resize(rh._nQuestions, AnsweredQuestion(cInvalidPqaId, cInvalidPqaId));
+      std::memcpy(aqs.data(), pBytes, nAQBytes);
+      if (CalcChecksum(rh, aqs.data()) != rh._checksum) {
+        break;
+      }
+      PqaError err = fnRecord(rh, aqs.data());
+      if (!err.IsOk()) {
+        return std::move(err);
+      }
+      validEnd += sizeof(rh) + nAQBytes;
+    }
+    if (bReadFailed) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+        "Can't read the training journal at offset ")(validEnd).GetOwnedSRString());
+    }
+    // Cut off the torn tail, so that the new records follow the valid ones.
+    if (validEnd < fileBytes && (!_file.Preallocate(validEnd) || !_file.Flush())) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Can't cut off the torn tail of the training journal."));
+    }
+  }
+
+  SRLock<SRCriticalSection> csl(_cs);
+  _fileEnd = validEnd;
+  _bOpen = true;
+  return PqaError();
+}
+
+PqaError CETrainJournal::Close() {
+  if (!_bOpen) {
+    return PqaError();
+  }
+  _bOpen = false;
+  uint64_t iLastPending;
+  {
+    SRLock<SRCriticalSection> csl(_cs);
+    iLastPending = _iLastPending;
+  }
+  PqaError err = Commit(iLastPending);
+  if (!_file.Close() && err.IsOk()) {
+    err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(_filePath.c_str()), SRString::MakeUnowned(SR_FILE_LINE
+      "Failed in closing the training journal."));
+  }
+  return std::move(err);
+}
+
+void CETrainJournal::Append(const uint64_t iTraining, const RecordKind kind, const TPqaId nQuestions,
+  const AnsweredQuestion* const pAQs, const TPqaId iTarget, const TPqaAmount amount)
+{
+  RecordHeader rh = {};
+  rh._iTraining = iTraining;
+  rh._iTarget = iTarget;
+  rh._amount = amount;
+  assert(0 <= nQuestions && nQuestions <= TPqaId(UINT32_MAX));
+  rh._nQuestions = static_cast<uint32_t>(nQuestions);
+  rh._kind = kind;
+  rh._checksum = CalcChecksum(rh, pAQs);
+  const size_t nAQBytes = SRCast::ToSizeT(nQuestions) * sizeof(AnsweredQuestion);
+
+  SRLock<SRCriticalSection> csl(_cs);
+  assert(iTraining > _iLastPending);
+  const size_t at = _pending.size();
+  _pending.resize(at + sizeof(rh) + nAQBytes);
+  std::memcpy(_pending.data() + at, &rh, sizeof(rh));
+  std::memcpy(_pending.data() + at + sizeof(rh), pAQs, nAQBytes);
+  _iLastPending = iTraining;
+}
+
+PqaError CETrainJournal::Commit(const uint64_t iTraining) {
+  SRLock<SRCriticalSection> csl(_cs);
+  assert(iTraining <= _iLastPending);
+  while (_iLastDurable < iTraining) {
+    if (_bFailed) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(_filePath.c_str()), SRString::MakeUnowned(
+        SR_FILE_LINE "Writing to the training journal has failed."));
+    }
+    if (_bFlushing) {
+      _flushed.Wait(_cs);
+      continue;
+    }
+    // Write all the records buffered by now, including those of the other threads, with a single flush.
+    _bFlushing = true;
+    std::vector<uint8_t> batch;
+    batch.swap(_pending);
+    const uint64_t iBatchLast = _iLastPending;
+    const uint64_t offset = _fileEnd;
+    _cs.Release();
+    const bool bOk = _file.WriteAt(batch.data(), batch.size(), offset) && _file.Flush();
+    _cs.Acquire();
+    _bFlushing = false;
+    if (bOk) {
+      _fileEnd = offset + batch.size();
+      _iLastDurable = iBatchLast;
+    } else {
+      _bFailed = true;
+    }
+    _flushed.WakeAll();
+  }
+  return PqaError();
+}
+
+} // namespace ProbQA
@@ -0,0 +1,91 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaErrors.h"
+
+namespace ProbQA {
+
+// Append-only journal of the trainings, so that the trainings since the last save of the KB survive a crash. A file
+//   starts with the magic, the version and the endianness tag, then the records follow: each is a header, followed by
+//   the answered questions. A record torn by a crash fails the checksum, and it ends the journal.
+// The trainings are numbered in the order they are applied to the KB, and the KB file stores the number of the last
+//   one, so that only the newer records are replayed on load.
+// Appending is a group commit: the records are buffered in the order of the trainings, then the first thread waiting
+//   for its record to become durable writes and flushes all the buffered records, including those of the other threads.
+class CETrainJournal {
+public: // types
+  enum class RecordKind : uint8_t {
+    Train = 1, // IPqaEngine::Train(), which counts the questions asked
+    QuizTarget = 2 // IPqaEngine::RecordQuizTarget()
+  };
+
+  struct RecordHeader {
+    uint64_t _iTraining;
+    TPqaId _iTarget;
+    TPqaAmount _amount;
+    uint32_t _nQuestions;
+    RecordKind _kind;
+    uint8_t _reserved[3];
+    // FNV-1a hash of the header with this field set to 0, and of the answered questions.
+    uint64_t _checksum;
+  };
+
+  struct FileHeader {
+    uint8_t _magic[8];
+    uint32_t _version;
+    uint32_t _endianTag;
+  };
+
+  // The callback for each valid record read from the journal. Returns an error to stop reading.
+  typedef std::function<PqaError(const RecordHeader &rh, const AnsweredQuestion *pAQs)> TRecordHandler;
+
+public: // constants
+  static constexpr uint32_t _cVersion = 1;
+
+private: // variables
+  SRPlat::SRPositionalFile _file;
+  std::string _filePath;
+  SRPlat::SRCriticalSection _cs;
+  SRPlat::SRConditionVariable _flushed;
+  // The records not written yet. Guarded by _cs
+  std::vector<uint8_t> _pending;
+  // The number of the last training in _pending . Guarded by _cs
+  uint64_t _iLastPending;
+  // The number of the last training written and flushed. Guarded by _cs
+  uint64_t _iLastDurable;
+  // Where the next records go. Guarded by _cs
+  uint64_t _fileEnd;
+  // Whether a thread is writing the records. Guarded by _cs
+  bool _bFlushing;
+  // Whether writing has failed, so that the journal can't be appended anymore. Guarded by _cs
+  bool _bFailed;
+  // Whether the journal has been read and accepts the records.
+  bool _bOpen;
+
+private: // methods
+  static uint64_t CalcChecksum(const RecordHeader &rh, const AnsweredQuestion *pAQs);
+
+public: // methods
+  explicit CETrainJournal();
+  CETrainJournal(const CETrainJournal&) = delete;
+  CETrainJournal& operator=(const CETrainJournal&) = delete;
+
+  // Open or create the journal, call |fnRecord| for each valid record in it, then cut off the invalid tail if any and
+  //   prepare for appending.
+  PqaError Open(const char* const filePath, const TRecordHandler &fnRecord);
+  // Write the pending records and close the file.
+  PqaError Close();
+  bool IsOpen() const { return _bOpen; }
+
+  // Buffer the record of training number |iTraining|. The callers must append in the order of the trainings, e.g.
+  //   under the exclusive KB lock.
+  void Append(const uint64_t iTraining, const RecordKind kind, const TPqaId nQuestions,
+    const AnsweredQuestion* const pAQs, const TPqaId iTarget, const TPqaAmount amount);
+  // Wait until the records up to |iTraining| inclusive are durable, writing them if no other thread is doing this.
+  PqaError Commit(const uint64_t iTraining);
+};
+
+} // namespace ProbQA
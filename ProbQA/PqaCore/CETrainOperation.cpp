@@ -11,6 +11,7 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CETrainOperation<SRDoubleNumber>;
+template class CETrainOperation<SRFloatNumber>;
 
 void CETrainOperation<SRDoubleNumber>::ProcessOne(const AnsweredQuestion& aq, const double twoB, const double bSquare) {
   // Use SSE2 instead of AVX here to supposedly reduce the load on the CPU core (better hyperthreading).
@@ -23,6 +24,13 @@ void CETrainOperation<SRDoubleNumber>::ProcessOne(const AnsweredQuestion& aq, co
   sum = _mm_add_pd(sum, sseAddend);
   _engine.ModA(aq._iQuestion, aq._iAnswer, _iTarget).SetValue(sum.m128d_f64[0]);
   _engine.ModD(aq._iQuestion, _iTarget).SetValue(sum.m128d_f64[1]);
+  UpdateInvD(aq._iQuestion, sum.m128d_f64[1]);
+}
+
+void CETrainOperation<SRDoubleNumber>::UpdateInvD(const TPqaId iQuestion, const double newD) {
+  if (_engine.GetKB().HasInvD()) {
+    _engine.ModInvD(iQuestion, _iTarget).SetValue(1.0 / newD);
+  }
 }
 
 template<> void CETrainOperation<SRDoubleNumber>::Perform1(const AnsweredQuestion& aq) {
@@ -52,6 +60,7 @@ template<> void CETrainOperation<SRDoubleNumber>::Perform2(const AnsweredQuestio
       _engine.ModA(aqFirst._iQuestion, aqFirst._iAnswer, _iTarget).SetValue(sum.m256d_f64[0]);
       _engine.ModA(aqSecond._iQuestion, aqSecond._iAnswer, _iTarget).SetValue(sum.m256d_f64[1]);
       _engine.ModD(aqFirst._iQuestion, _iTarget).SetValue(sum.m256d_f64[2]);
+      UpdateInvD(aqFirst._iQuestion, sum.m256d_f64[2]);
     }
   } else { // We can vectorize all the 4 additions
     //TODO: consider memorizing these vectors in NumSpec, though they would then take 1 cache line in each core and
@@ -79,7 +88,47 @@ template<> void CETrainOperation<SRDoubleNumber>::Perform2(const AnsweredQuestio
     _engine.ModA(aqSecond._iQuestion, aqSecond._iAnswer, _iTarget).SetValue(sum.m256d_f64[1]);
     _engine.ModD(aqFirst._iQuestion, _iTarget).SetValue(sum.m256d_f64[2]);
     _engine.ModD(aqSecond._iQuestion, _iTarget).SetValue(sum.m256d_f64[3]);
+    if (_engine.GetKB().HasInvD()) {
+      const __m128d invD = _mm_div_pd(_mm_set1_pd(1.0), _mm256_extractf128_pd(sum, 1));
+      _engine.ModInvD(aqFirst._iQuestion, _iTarget).SetValue(invD.m128d_f64[0]);
+      _engine.ModInvD(aqSecond._iQuestion, _iTarget).SetValue(invD.m128d_f64[1]);
+    }
+  }
+}
+
+// The cells are converted to double on load and back to float on store, so that the increments are not rounded to
+//   float precision separately.
+template<> void CETrainOperation<SRFloatNumber>::ProcessOne(const AnsweredQuestion& aq, const double twoB,
+  const double bSquare)
+{
+  const double aSquare = _engine.GetA(aq._iQuestion, aq._iAnswer, _iTarget).GetValue();
+  const double addend = std::sqrt(aSquare) * twoB + bSquare;
+  const double newD = _engine.GetD(aq._iQuestion, _iTarget).GetValue() + addend;
+  _engine.ModA(aq._iQuestion, aq._iAnswer, _iTarget).SetValue(static_cast<float>(aSquare + addend));
+  _engine.ModD(aq._iQuestion, _iTarget).SetValue(static_cast<float>(newD));
+  UpdateInvD(aq._iQuestion, newD);
+}
+
+template<> void CETrainOperation<SRFloatNumber>::UpdateInvD(const TPqaId iQuestion, const double newD) {
+  if (_engine.GetKB().HasInvD()) {
+    _engine.ModInvD(iQuestion, _iTarget).SetValue(static_cast<float>(1.0 / newD));
+  }
+}
+
+template<> void CETrainOperation<SRFloatNumber>::Perform1(const AnsweredQuestion& aq) {
+  ProcessOne(aq, _numSpec._inc2B, _numSpec._incBSquare);
+}
+
+template<> void CETrainOperation<SRFloatNumber>::Perform2(const AnsweredQuestion& aqFirst,
+  const AnsweredQuestion& aqSecond)
+{
+  if (aqFirst._iQuestion == aqSecond._iQuestion && aqFirst._iAnswer == aqSecond._iAnswer) {
+    ProcessOne(aqFirst, _numSpec._inc4B, _numSpec._incSquare2B);
+    return;
   }
+  // Otherwise the cells of A differ, and the increments of D, if it's the same cell, just add up.
+  ProcessOne(aqFirst, _numSpec._inc2B, _numSpec._incBSquare);
+  ProcessOne(aqSecond, _numSpec._inc2B, _numSpec._incBSquare);
 }
 
 } // namespace ProbQA
@@ -15,8 +15,10 @@ template<typename taNumber> class CETrainOperation {
   const CETrainTaskNumSpec<taNumber>& _numSpec;
   const TPqaId _iTarget;
 
-  // A method for taNumber=SRDoubleNumber only. Overload for other taNumber values.
+  // A method for taNumber=SRDoubleNumber and SRFloatNumber only. Overload for other taNumber values.
   void ProcessOne(const AnsweredQuestion& aq, const double twoB, const double bSquare);
+  // Keep the table of 1/D , if any, in sync with the updated D[iQuestion][_iTarget] .
+  void UpdateInvD(const TPqaId iQuestion, const double newD);
 
 public:
   CETrainOperation(CpuEngine<taNumber> &engine, const TPqaId iTarget, const CETrainTaskNumSpec<taNumber>& numSpec)
@@ -12,18 +12,16 @@ using namespace SRPlat;
 
 namespace ProbQA {
 
-template class CETrainSubtaskAdd<SRDoubleNumber>;
-
-template<> void CETrainSubtaskAdd<SRDoubleNumber>::Run() {
+template<typename taNumber> void CETrainSubtaskAdd<taNumber>::Run() {
   auto& cTask = static_cast<const TTask&>(*GetTask()); // enable optimizations with const
-  auto& engine = static_cast<CpuEngine<SRDoubleNumber>&>(cTask.GetBaseEngine());
+  auto& engine = static_cast<CpuEngine<taNumber>&>(cTask.GetBaseEngine());
   TPqaId iLast = cTask._last[_iWorker];
   if (iLast == cInvalidPqaId) {
     return;
   }
   const TPqaId *const cPrev = cTask._prev;
 
-  CETrainOperation<SRDoubleNumber> trainOp(engine, cTask._iTarget, cTask._numSpec);
+  CETrainOperation<taNumber> trainOp(engine, cTask._iTarget, cTask._numSpec);
   do {
     const AnsweredQuestion& aqFirst = cTask._pAQs[iLast];
     iLast = cPrev[iLast];
@@ -37,4 +35,7 @@ template<> void CETrainSubtaskAdd<SRDoubleNumber>::Run() {
   } while (iLast != cInvalidPqaId);
 }
 
+template class CETrainSubtaskAdd<SRDoubleNumber>;
+template class CETrainSubtaskAdd<SRFloatNumber>;
+
 } // namespace ProbQA
@@ -32,4 +32,10 @@ public: // methods
   }
 };
 
+// The cells of a float KB are trained in double arithmetic, so the increments are the same.
+template<> class CETrainTaskNumSpec<SRPlat::SRFloatNumber> : public CETrainTaskNumSpec<SRPlat::SRDoubleNumber> {
+public: // methods
+  using CETrainTaskNumSpec<SRPlat::SRDoubleNumber>::CETrainTaskNumSpec;
+};
+
 } // namespace ProbQA
@@ -12,9 +12,13 @@ using namespace SRPlat;
 namespace ProbQA {
 
 template class CEUpdatePriorsSubtaskMul<SRDoubleNumber>;
+template class CEUpdatePriorsSubtaskMul<SRFloatNumber>;
 
-template<> template<bool taCache> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>::RunInternal(const TTask& task) const {
+template<> template<bool taCache, bool taInvD> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>::RunInternal(
+  const TTask& task) const
+{
   auto& engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &kb = engine.GetKB();
   const CEQuiz<SRDoubleNumber> &quiz = *task._pQuiz;
 
   static_assert(std::is_same<int64_t, CEQuiz<SRDoubleNumber>::TExponent>::value, "The code below assumes TExponent is"
@@ -22,7 +26,7 @@ template<> template<bool taCache> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>:
 
   auto *PTR_RESTRICT pExps = SRCast::Ptr<__m256i>(quiz.GetTlhExps());
   auto *PTR_RESTRICT pMants = SRCast::Ptr<__m256d>(quiz.GetPriorMants());
-  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256d>( &(engine.GetB(0)) );
+  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256d>(kb.GetB());
 
   //TODO: consider replacing this with an assert(), because CpuEngine checks for nAnswered==0 and resorts to StartQuiz()
   //  in that case.
@@ -42,45 +46,60 @@ template<> template<bool taCache> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>:
     const size_t iBlockLim = std::min(SRCast::ToSizeT(_iLimit), iBlockStart + nVectsInBlock);
     { // separate step for i==0
       const AnsweredQuestion& aq = task._pAQs[0];
-      const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(&(engine.GetA(aq._iQuestion, aq._iAnswer, 0)));
-      const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(&(engine.GetD(aq._iQuestion, 0)));
-      for (size_t j = iBlockStart; j < iBlockLim; j++) {
-        const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls + j);
-        const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + j);
-        // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
-        const __m256d P_qa_given_t = _mm256_div_pd(adjMuls, adjDivs);
-
-        const __m256d oldMants = SRSimd::Load<false>(pvB);
-        const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
-        
-        const __m256d newMants = SRSimd::MakeExponent0(product);
-        SRSimd::Store<taCache>(pMants + j, newMants);
-
-        const __m256i prodExps = SRSimd::ExtractExponents64<false>(product);
-        SRSimd::Store<taCache>(pExps + j, prodExps);
+      const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(taInvD
+        ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+      for (size_t j = iBlockStart; j < iBlockLim;) {
+        // In the tiled layout of cube A, the row of A is contiguous only within a tile.
+        size_t jTileLim;
+        const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(kb.GetAVects(
+          SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), j, jTileLim));
+        jTileLim = std::min(jTileLim, iBlockLim);
+        for (; j < jTileLim; j++, pAdjMuls++) {
+          const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls);
+          const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + j);
+          // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
+          const __m256d P_qa_given_t = (taInvD ? _mm256_mul_pd(adjMuls, adjDivs)
+            : _mm256_div_pd(adjMuls, adjDivs));
+
+          const __m256d oldMants = SRSimd::Load<false>(pvB + j);
+          const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
+
+          const __m256d newMants = SRSimd::MakeExponent0(product);
+          SRSimd::Store<taCache>(pMants + j, newMants);
+
+          const __m256i prodExps = SRSimd::ExtractExponents64<false>(product);
+          SRSimd::Store<taCache>(pExps + j, prodExps);
+        }
       }
     }
     for (size_t i = 1; i < SRCast::ToSizeT(task._nAnswered); i++) {
       const AnsweredQuestion& aq = task._pAQs[i];
-      const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(&engine.GetA(aq._iQuestion, aq._iAnswer, 0));
-      const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(&engine.GetD(aq._iQuestion, 0));
-      for (size_t j = iBlockStart; j < iBlockLim; j++) {
-        const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls + j);
-        const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + j);
-        // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
-        const __m256d P_qa_given_t = _mm256_div_pd(adjMuls, adjDivs);
-
-        //TODO: verify that taCache based branchings are compile-time
-        const __m256d oldMants = SRSimd::Load<taCache>(pMants + j);
-        const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
-        //TODO: move separate summation of exponent to a common function (available to other subtasks etc.)?
-        const __m256d newMants = SRSimd::MakeExponent0(product);
-        SRSimd::Store<taCache>(pMants + j, newMants);
-
-        const __m256i prodExps = SRSimd::ExtractExponents64<false>(product);
-        const __m256i oldExps = SRSimd::Load<taCache>(pExps+j);
-        const __m256i newExps = _mm256_add_epi64(prodExps, oldExps);
-        SRSimd::Store<taCache>(pExps + j, newExps);
+      const __m256d *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256d>(taInvD
+        ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+      for (size_t j = iBlockStart; j < iBlockLim;) {
+        size_t jTileLim;
+        const __m256d *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256d>(kb.GetAVects(
+          SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), j, jTileLim));
+        jTileLim = std::min(jTileLim, iBlockLim);
+        for (; j < jTileLim; j++, pAdjMuls++) {
+          const __m256d adjMuls = SRSimd::Load<false>(pAdjMuls);
+          const __m256d adjDivs = SRSimd::Load<false>(pAdjDivs + j);
+          // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,j1,j2,j3))
+          const __m256d P_qa_given_t = (taInvD ? _mm256_mul_pd(adjMuls, adjDivs)
+            : _mm256_div_pd(adjMuls, adjDivs));
+
+          //TODO: verify that taCache based branchings are compile-time
+          const __m256d oldMants = SRSimd::Load<taCache>(pMants + j);
+          const __m256d product = _mm256_mul_pd(oldMants, P_qa_given_t);
+          //TODO: move separate summation of exponent to a common function (available to other subtasks etc.)?
+          const __m256d newMants = SRSimd::MakeExponent0(product);
+          SRSimd::Store<taCache>(pMants + j, newMants);
+
+          const __m256i prodExps = SRSimd::ExtractExponents64<false>(product);
+          const __m256i oldExps = SRSimd::Load<taCache>(pExps+j);
+          const __m256i newExps = _mm256_add_epi64(prodExps, oldExps);
+          SRSimd::Store<taCache>(pExps + j, newExps);
+        }
       }
     }
     if (taCache) {
@@ -107,10 +126,227 @@ template<> template<bool taCache> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>:
   }
 }
 
+// Pairs of AVX2 vectors are processed as one AVX-512 vector, and the odd AVX2 vector at the end of a tile or of a block
+//   under a mask. The stores are regular rather than streaming, because the AVX-512 vectors are not necessarily
+//   aligned at 64 bytes.
+template<> template<bool taCache, bool taInvD> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>::RunInternal512(
+  const TTask& task) const
+{
+  auto& engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRDoubleNumber> &kb = engine.GetKB();
+  const CEQuiz<SRDoubleNumber> &quiz = *task._pQuiz;
+
+  static_assert(std::is_same<int64_t, CEQuiz<SRDoubleNumber>::TExponent>::value, "The code below assumes TExponent is"
+    " 64-bit integer.");
+
+  auto *PTR_RESTRICT pExps = quiz.GetTlhExps();
+  auto *PTR_RESTRICT pMants = SRCast::Ptr<double>(quiz.GetPriorMants());
+  auto *PTR_RESTRICT pB = SRCast::CPtr<double>(kb.GetB());
+
+  if (task._nAnswered == 0) {
+    // The AVX2 kernel does this with streaming stores, which is the best for copying.
+    RunInternal<false, taInvD>(task);
+    return;
+  }
+
+  assert(_iLimit > _iFirst);
+  const size_t nVectsInBlock = (taCache ? (task._nVectsInCache >> 1) : (_iLimit - _iFirst));
+  size_t iBlockStart = _iFirst;
+  for (;;) {
+    const size_t iBlockLim = std::min(SRCast::ToSizeT(_iLimit), iBlockStart + nVectsInBlock);
+    { // separate step for i==0
+      const AnsweredQuestion& aq = task._pAQs[0];
+      const double *PTR_RESTRICT pAdjDivs = SRCast::CPtr<double>(taInvD
+        ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+      for (size_t j = iBlockStart; j < iBlockLim;) {
+        size_t jTileLim;
+        const double *PTR_RESTRICT pAdjMuls = SRCast::CPtr<double>(kb.GetAVects(
+          SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), j, jTileLim));
+        jTileLim = std::min(jTileLim, iBlockLim);
+        for (; j < jTileLim; j += 2, pAdjMuls += 2 * SRSimd::_cNComps64) {
+          const __mmask8 lanes = ((j + 1 < jTileLim) ? 0xff : 0x0f);
+          const size_t jComp = j << SRSimd::_cLogNComps64;
+          const __m512d adjMuls = _mm512_maskz_loadu_pd(lanes, pAdjMuls);
+          const __m512d adjDivs = _mm512_maskz_loadu_pd(lanes, pAdjDivs + jComp);
+          // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,...,j7))
+          const __m512d P_qa_given_t = (taInvD ? _mm512_mul_pd(adjMuls, adjDivs)
+            : _mm512_maskz_div_pd(lanes, adjMuls, adjDivs));
+
+          const __m512d oldMants = _mm512_maskz_loadu_pd(lanes, pB + jComp);
+          const __m512d product = _mm512_mul_pd(oldMants, P_qa_given_t);
+
+          _mm512_mask_storeu_pd(pMants + jComp, lanes, SRSimd::MakeExponent0(product));
+          _mm512_mask_storeu_epi64(pExps + jComp, lanes, SRSimd::ExtractExponents64<false>(product));
+        }
+        j = std::min(j, jTileLim);
+      }
+    }
+    for (size_t i = 1; i < SRCast::ToSizeT(task._nAnswered); i++) {
+      const AnsweredQuestion& aq = task._pAQs[i];
+      const double *PTR_RESTRICT pAdjDivs = SRCast::CPtr<double>(taInvD
+        ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+      for (size_t j = iBlockStart; j < iBlockLim;) {
+        size_t jTileLim;
+        const double *PTR_RESTRICT pAdjMuls = SRCast::CPtr<double>(kb.GetAVects(
+          SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), j, jTileLim));
+        jTileLim = std::min(jTileLim, iBlockLim);
+        for (; j < jTileLim; j += 2, pAdjMuls += 2 * SRSimd::_cNComps64) {
+          const __mmask8 lanes = ((j + 1 < jTileLim) ? 0xff : 0x0f);
+          const size_t jComp = j << SRSimd::_cLogNComps64;
+          const __m512d adjMuls = _mm512_maskz_loadu_pd(lanes, pAdjMuls);
+          const __m512d adjDivs = _mm512_maskz_loadu_pd(lanes, pAdjDivs + jComp);
+          // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,...,j7))
+          const __m512d P_qa_given_t = (taInvD ? _mm512_mul_pd(adjMuls, adjDivs)
+            : _mm512_maskz_div_pd(lanes, adjMuls, adjDivs));
+
+          const __m512d oldMants = _mm512_maskz_loadu_pd(lanes, pMants + jComp);
+          const __m512d product = _mm512_mul_pd(oldMants, P_qa_given_t);
+          _mm512_mask_storeu_pd(pMants + jComp, lanes, SRSimd::MakeExponent0(product));
+
+          const __m512i prodExps = SRSimd::ExtractExponents64<false>(product);
+          const __m512i oldExps = _mm512_maskz_loadu_epi64(lanes, pExps + jComp);
+          _mm512_mask_storeu_epi64(pExps + jComp, lanes, _mm512_add_epi64(prodExps, oldExps));
+        }
+        j = std::min(j, jTileLim);
+      }
+    }
+    if (taCache) {
+      const size_t nBytes = (iBlockLim - iBlockStart) << SRSimd::_cLogNBytes;
+      const size_t iStartComp = iBlockStart << SRSimd::_cLogNComps64;
+      // The bounds may be used in the next block or by another thread.
+      if (iBlockStart > SRCast::ToSizeT(_iFirst)) {
+        // Can flush left because it's for the current thread only and has been processed.
+        SRUtils::FlushCache<true, false>(pMants + iStartComp, nBytes);
+        SRUtils::FlushCache<true, false>(pExps + iStartComp, nBytes);
+      } else {
+        // Can't flush left because another thread may be using it
+        SRUtils::FlushCache<false, false>(pMants + iStartComp, nBytes);
+        SRUtils::FlushCache<false, false>(pExps + iStartComp, nBytes);
+      }
+    }
+    if (iBlockLim >= SRCast::ToSizeT(_iLimit)) {
+      break;
+    }
+    iBlockStart = iBlockLim;
+  }
+}
+
 template<> void CEUpdatePriorsSubtaskMul<SRDoubleNumber>::Run() {
   auto& task = static_cast<const TTask&>(*GetTask());
-  // This should be a tail call
-  (task._nVectsInCache < 2) ? RunInternal<false>(task) : RunInternal<true>(task);
+  auto& engine = static_cast<const CpuEngine<SRDoubleNumber>&>(task.GetBaseEngine());
+  if (engine.GetInstructionSet() >= SRInstructionSet::Avx512) {
+    if (engine.GetKB().HasInvD()) {
+      (task._nVectsInCache < 2) ? RunInternal512<false, true>(task) : RunInternal512<true, true>(task);
+    } else {
+      (task._nVectsInCache < 2) ? RunInternal512<false, false>(task) : RunInternal512<true, false>(task);
+    }
+    return;
+  }
+  if (engine.GetKB().HasInvD()) {
+    (task._nVectsInCache < 2) ? RunInternal<false, true>(task) : RunInternal<true, true>(task);
+  } else {
+    (task._nVectsInCache < 2) ? RunInternal<false, false>(task) : RunInternal<true, false>(task);
+  }
+}
+
+template<> template<bool taCache, bool taInvD> void CEUpdatePriorsSubtaskMul<SRFloatNumber>::RunInternal(
+  const TTask& task) const
+{
+  auto& engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  const CEKBArena<SRFloatNumber> &kb = engine.GetKB();
+  const CEQuiz<SRFloatNumber> &quiz = *task._pQuiz;
+
+  static_assert(std::is_same<int64_t, CEQuiz<SRFloatNumber>::TExponent>::value, "The code below assumes TExponent is"
+    " 64-bit integer.");
+
+  // There are 2 vectors of exponents per vector of 8 mantissas.
+  auto *PTR_RESTRICT pExps = SRCast::Ptr<__m256i>(quiz.GetTlhExps());
+  auto *PTR_RESTRICT pMants = SRCast::Ptr<__m256>(quiz.GetPriorMants());
+  auto *PTR_RESTRICT pvB = SRCast::CPtr<__m256>(kb.GetB());
+
+  if (task._nAnswered == 0) {
+    for (TPqaId i = _iFirst; i < _iLimit; i++) {
+      SRSimd::Store<false>(pMants + i, SRSimd::Load<false>(pvB + i));
+      SRSimd::Store<false>(pExps + 2 * i, _mm256_setzero_si256());
+      SRSimd::Store<false>(pExps + 2 * i + 1, _mm256_setzero_si256());
+    }
+    _mm_sfence();
+    return;
+  }
+
+  assert(_iLimit > _iFirst);
+  const size_t nVectsInBlock = (taCache ? (task._nVectsInCache / 3) : (_iLimit - _iFirst));
+  size_t iBlockStart = _iFirst;
+  for (;;) {
+    const size_t iBlockLim = std::min(SRCast::ToSizeT(_iLimit), iBlockStart + nVectsInBlock);
+    for (size_t i = 0; i < SRCast::ToSizeT(task._nAnswered); i++) {
+      const AnsweredQuestion& aq = task._pAQs[i];
+      const __m256 *PTR_RESTRICT pAdjDivs = SRCast::CPtr<__m256>(taInvD
+        ? kb.GetInvD(SRCast::ToSizeT(aq._iQuestion)) : kb.GetD(SRCast::ToSizeT(aq._iQuestion)));
+      for (size_t j = iBlockStart; j < iBlockLim;) {
+        // In the tiled layout of cube A, the row of A is contiguous only within a tile.
+        size_t jTileLim;
+        const __m256 *PTR_RESTRICT pAdjMuls = SRCast::CPtr<__m256>(kb.GetAVects(
+          SRCast::ToSizeT(aq._iQuestion), SRCast::ToSizeT(aq._iAnswer), j, jTileLim));
+        jTileLim = std::min(jTileLim, iBlockLim);
+        for (; j < jTileLim; j++, pAdjMuls++) {
+          const __m256 adjMuls = SRSimd::Load<false>(pAdjMuls);
+          const __m256 adjDivs = SRSimd::Load<false>(pAdjDivs + j);
+          // P(answer(aq._iQuestion)==aq._iAnswer GIVEN target==(j0,...,j7))
+          const __m256 P_qa_given_t = (taInvD ? _mm256_mul_ps(adjMuls, adjDivs)
+            : _mm256_div_ps(adjMuls, adjDivs));
+
+          // The first answered question starts from vector B, the others continue from the stored mantissas.
+          const __m256 oldMants = ((i == 0) ? SRSimd::Load<false>(pvB + j) : SRSimd::Load<taCache>(pMants + j));
+          const __m256 product = _mm256_mul_ps(oldMants, P_qa_given_t);
+          const __m256 newMants = SRSimd::MakeExponent0(product);
+          SRSimd::Store<taCache>(pMants + j, newMants);
+
+          const __m256i prodExps = SRSimd::ExtractExponents32<false>(product);
+          __m256i newExpsLo = SRSimd::WidenLowI32(prodExps);
+          __m256i newExpsHi = SRSimd::WidenHighI32(prodExps);
+          if (i != 0) {
+            newExpsLo = _mm256_add_epi64(newExpsLo, SRSimd::Load<taCache>(pExps + 2 * j));
+            newExpsHi = _mm256_add_epi64(newExpsHi, SRSimd::Load<taCache>(pExps + 2 * j + 1));
+          }
+          SRSimd::Store<taCache>(pExps + 2 * j, newExpsLo);
+          SRSimd::Store<taCache>(pExps + 2 * j + 1, newExpsHi);
+        }
+      }
+    }
+    if (taCache) {
+      const size_t nBytes = (iBlockLim - iBlockStart) << SRSimd::_cLogNBytes;
+      // The bounds may be used in the next block or by another thread.
+      if (iBlockStart > SRCast::ToSizeT(_iFirst)) {
+        // Can flush left because it's for the current thread only and has been processed.
+        SRUtils::FlushCache<true, false>(pMants + iBlockStart, nBytes);
+        SRUtils::FlushCache<true, false>(pExps + 2 * iBlockStart, 2 * nBytes);
+      } else {
+        // Can't flush left because another thread may be using it
+        SRUtils::FlushCache<false, false>(pMants + iBlockStart, nBytes);
+        SRUtils::FlushCache<false, false>(pExps + 2 * iBlockStart, 2 * nBytes);
+      }
+      _mm_sfence();
+    }
+    if (iBlockLim >= SRCast::ToSizeT(_iLimit)) {
+      break;
+    }
+    iBlockStart = iBlockLim;
+  }
+  if (!taCache) {
+    _mm_sfence();
+  }
+}
+
+template<> void CEUpdatePriorsSubtaskMul<SRFloatNumber>::Run() {
+  auto& task = static_cast<const TTask&>(*GetTask());
+  auto& engine = static_cast<const CpuEngine<SRFloatNumber>&>(task.GetBaseEngine());
+  // Each vector of mantissas in cache comes with 2 vectors of exponents.
+  if (engine.GetKB().HasInvD()) {
+    (task._nVectsInCache < 3) ? RunInternal<false, true>(task) : RunInternal<true, true>(task);
+  } else {
+    (task._nVectsInCache < 3) ? RunInternal<false, false>(task) : RunInternal<true, false>(task);
+  }
 }
 
 } // namespace ProbQA
@@ -14,7 +14,10 @@ public: // types
   typedef CEUpdatePriorsTask<taNumber> TTask;
 
 private: // methods
-  template<bool taCache> void RunInternal(const TTask& task) const;
+  // taInvD: whether to multiply by the table of 1/D instead of dividing by D .
+  template<bool taCache, bool taInvD> void RunInternal(const TTask& task) const;
+  // The same with AVX-512, if the engine has selected it.
+  template<bool taCache, bool taInvD> void RunInternal512(const TTask& task) const;
 
 public: // methods
   using SRPlat::SRStandardSubtask::SRStandardSubtask;
@@ -17,6 +17,17 @@
 #include "../PqaCore/CEEvalQsSubtaskConsider.h"
 #include "../PqaCore/CEListTopTargetsAlgorithm.h"
 #include "../PqaCore/CETrainOperation.h"
+#include "../PqaCore/CEInitKBSubtaskFill.h"
+#include "../PqaCore/CEInitKBSubtaskInvD.h"
+#include "../PqaCore/CEKBFileSubtask.h"
+#include "../PqaCore/CEKBSnapshotSubtask.h"
+#include "../PqaCore/CECompactKBSubtaskTargets.h"
+#include "../PqaCore/CECompactKBSubtaskQuestions.h"
+#include "../PqaCore/CESaveKBJob.h"
+#include "../PqaCore/CERecomputeDJob.h"
+#include "../PqaCore/CESumDSubtask.h"
+#include "../PqaCore/CEKBCodec.h"
+#include "../PqaCore/CEKBCodecSubtask.h"
 
 using namespace SRPlat;
 
@@ -31,7 +42,8 @@ template<typename taNumber> size_t CpuEngine<taNumber>::CalcWorkerStackSize(cons
 }
 
 template<typename taNumber> CpuEngine<taNumber>::CpuEngine(const EngineDefinition& engDef, KBFileInfo *pKbFi)
-  : BaseCpuEngine(engDef, CalcWorkerStackSize(engDef))
+  : BaseCpuEngine(engDef, CalcWorkerStackSize(engDef)), _pReadKB(&_kb), _pWriteKB(&_kb),
+  _nextQsCache(engDef._nextQsCacheDepth, engDef._nextQsCacheMaxBytes)
 {
   const size_t nQuestions = SRCast::ToSizeT(_dims._nQuestions);
   const size_t nAnswers = SRCast::ToSizeT(_dims._nAnswers);
@@ -39,54 +51,236 @@ template<typename taNumber> CpuEngine<taNumber>::CpuEngine(const EngineDefinitio
 
   const taNumber init1(engDef._initAmount);
   const taNumber initSqr = taNumber(init1).Sqr();
-  //// Init cube A: A[q][ao][t] is weight for answer option |ao| for question |q| for target |t|
-  _sA.resize(nQuestions);
-  for (size_t i = 0, iEn= nQuestions; i < iEn; i++) {
-    _sA[i].resize(SRCast::ToSizeT(_dims._nAnswers));
-    for (size_t k = 0, kEn= nAnswers; k < kEn; k++) {
-      _sA[i][k].Resize<false>(nTargets);
-      if (pKbFi == nullptr) {
-        _sA[i][k].FillAll<false>(initSqr);
-        continue;
-      }
-      if (std::fread(&(_sA[i][k][0]), sizeof(taNumber), nTargets, pKbFi->_sf.Get()) != nTargets) {
-        PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(pKbFi->_filePath), SRMessageBuilder(SR_FILE_LINE
-          "Can't read the target dimension of _sA weights at [")(i)(", ")(k)("].").GetOwnedSRString()).ThrowMoving();
-      }
-    }
-  }
-
-  //// Init matrix D: D[q][t] is the sum of weigths over all answers for question |q| for target |t|. In the other
-  ////   words, D[q][t] is A[q][0][t] + A[q][1][t] + ... + A[q][K-1][t], where K is the number of answer options.
-  //// Note that D is subject to summation errors, thus its regular recomputation is desired.
   const taNumber initMD = initSqr * nAnswers;
-  _mD.resize(size_t(_dims._nQuestions));
-  for (size_t i = 0, iEn=nQuestions; i < iEn; i++) {
-    _mD[i].Resize<false>(nTargets);
-    if (pKbFi == nullptr) {
-      _mD[i].FillAll<false>(initMD);
-      continue;
+
+  uint64_t offsA = 0, offsD = 0, offsB = 0, nFileRowItems = 0;
+  const bool bCoded = (pKbFi != nullptr && pKbFi->_pDir != nullptr && pKbFi->_pDir->IsCoded());
+  if (pKbFi != nullptr) {
+    if (bCoded) {
+      nFileRowItems = pKbFi->_pDir->Find(KBFileSectionKind::CodedWeights)->_rowBytes / sizeof(taNumber);
+    } else {
+      pKbFi->LocateWeights(_dims, sizeof(taNumber), offsA, offsD, offsB, nFileRowItems);
     }
-    if (std::fread(&(_mD[i][0]), sizeof(taNumber), nTargets, pKbFi->_sf.Get()) != nTargets) {
+    // The sectioned file keeps the padding of the arena, which in turn depends on the width of SIMD, and the capacity
+    //   of the targets.
+    if (pKbFi->_pDir != nullptr && !CEKBArena<taNumber>::IsTargStride(nTargets, SRCast::ToSizeT(nFileRowItems))) {
       PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(pKbFi->_filePath), SRMessageBuilder(SR_FILE_LINE
-        "Can't read the target dimension of _mD weights at [")(i)("].").GetOwnedSRString()).ThrowMoving();
+        "The KB file has rows of ")(nFileRowItems)(" items, while at least ")
+        (CEKBArena<taNumber>::CalcTargStride(nTargets))(" in whole SIMD vectors are expected.").GetOwnedSRString())
+        .ThrowMoving();
     }
   }
-
-  //// Init vector B: the sums of weights over all trainings for each target
-  _vB.Resize<false>(nTargets);
-  if (pKbFi == nullptr) {
-    _vB.FillAll<false>(init1);
+  const size_t nTargStride = (pKbFi != nullptr && pKbFi->_pDir != nullptr) ? SRCast::ToSizeT(nFileRowItems)
+    : CEKBArena<taNumber>::CalcTargStride(nTargets);
+
+  bool bMapped = false;
+  if (pKbFi != nullptr && pKbFi->_mapping != TPqaKBMapping::None) {
+    if (bCoded) {
+      CELOG(Warning) << SR_FILE_LINE "The KB file " << pKbFi->_filePath << " is compressed, so it can't be mapped."
+        " Decoding it instead.";
+    } else if (CEKBArena<taNumber>::CanMap(nTargets, SRCast::ToSizeT(nFileRowItems), engDef._tiledA, offsA, offsD,
+      offsB))
+    {
+      bMapped = _kb.Map(pKbFi->_filePath, offsA, offsD, offsB, nQuestions, nAnswers, nTargStride,
+        pKbFi->_mapping == TPqaKBMapping::ReadOnly, engDef._invDTable);
+      if (!bMapped) {
+        CELOG(Warning) << SR_FILE_LINE "Failed to map the KB file " << pKbFi->_filePath << ", error "
+          << GetLastError() << ". Reading it instead.";
+      }
+    } else {
+      CELOG(Warning) << SR_FILE_LINE "The layout of the KB file " << pKbFi->_filePath << " doesn't allow mapping it:"
+        " the layout must be row-major, and the legacy file must have a multiple of "
+        << CEKBArena<taNumber>::_cNumsPerVect << " targets. Reading it instead.";
+    }
+  }
+  // Otherwise the pages of the file are loaded on the first access.
+  if (!bMapped) {
+    _kb.AllocateCapacity(nQuestions, nQuestions, nAnswers, nTargStride, engDef._tiledA, engDef._largePages,
+      engDef._invDTable);
+  }
+  // With NUMA-aware workers, the KB must be first-touched by the workers owning the targets even if it's then
+  //   overwritten from the file.
+  if (!bMapped && (pKbFi == nullptr || _tpWorkers.GetNodeCount() > 1)) {
+    //// Init cube A: A[q][ao][t] is weight for answer option |ao| for question |q| for target |t|
+    //// Init matrix D: D[q][t] is the sum of weigths over all answers for question |q| for target |t|. In the other
+    ////   words, D[q][t] is A[q][0][t] + A[q][1][t] + ... + A[q][K-1][t], where K is the number of answer options.
+    //// Note that D is subject to summation errors, thus its regular recomputation is desired.
+    //// Init vector B: the sums of weights over all trainings for each target
+    InitKB(initSqr, initMD, init1);
   }
-  else {
-    if (std::fread(&(_vB[0]), sizeof(taNumber), nTargets, pKbFi->_sf.Get()) != nTargets) {
-      PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(pKbFi->_filePath), SRString::MakeUnowned(SR_FILE_LINE
-        "Can't read the _vB weights.")).ThrowMoving();
+  if (bCoded) {
+    ReadCodedKB(*pKbFi);
+  } else if (!bMapped && pKbFi != nullptr) {
+    // The rows in a sectioned file are padded as in the arena, so the padding is read too. A legacy file has cube A,
+    //   then matrix D, then vector B, without the padding.
+    PqaError err = TransferKBFile(_kb, pKbFi->_file, pKbFi->_filePath, offsA, offsD, offsB,
+      SRCast::ToSizeT(nFileRowItems), false);
+    if (!err.IsOk()) {
+      const PqaErrorCode code = err.GetCode();
+      PqaException(code, err.DetachParams(), SRString(err.GetMessage())).ThrowMoving();
+    }
+    if (pKbFi->_pDir == nullptr) {
+      _kb.FillPadding(nTargets, initSqr);
     }
   }
+  if (_kb.HasInvD()) {
+    InitInvD();
+  }
+  if (engDef._epochKB) {
+    // The instance which isn't published is trained first.
+    _kbMirror.AllocateCapacity(nQuestions, nQuestions, nAnswers, nTargStride, _kb.IsTiledA(), engDef._largePages,
+      engDef._invDTable);
+    _kbMirror.CopyFrom(_kb);
+    _pWriteKB = &_kbMirror;
+    _kbEpochs.Enable();
+  }
 
   _questionGaps.GrowTo(nQuestions);
   _targetGaps.GrowTo(nTargets);
+  if (pKbFi != nullptr && pKbFi->_pDir != nullptr) {
+    ReadSectionedExtras(*pKbFi);
+  }
+  if (engDef._journalPath != nullptr) {
+    ReplayJournal(engDef._journalPath);
+  }
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::TransferKBFile(CEKBArena<taNumber> &kb,
+  const SRPositionalFile &file, const char* const filePath, const uint64_t offsA, const uint64_t offsD,
+  const uint64_t offsB, const size_t nFileRowItems, const bool bWrite)
+{
+  const size_t nRows = kb.GetNQuestions() * (kb.GetNAnswers() + 1) + 1;
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(_nMemOpThreads * sizeof(CEKBFileSubtask<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CEKBFileTask<taNumber> task(*this, _nMemOpThreads, kb, file, filePath, offsA, offsD, offsB, nFileRowItems,
+    bWrite);
+  {
+    SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+    pr.SplitAndRunSubtasks<CEKBFileSubtask<taNumber>>(task, nRows, _nMemOpThreads);
+  }
+  return task.TakeAggregateError(SRString::MakeUnowned(SR_FILE_LINE "Failed to transfer the KB weights."));
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::ReadCodedKB(const KBFileInfo &kbFi) {
+  typedef CEKBCodec<taNumber> TCodec;
+  const KBFileSection *pIndex = kbFi._pDir->Find(KBFileSectionKind::CodecIndex);
+  const KBFileSection *pCoded = kbFi._pDir->Find(KBFileSectionKind::CodedWeights);
+  const size_t nRows = TCodec::CalcNRows(_kb);
+  const size_t nTargStride = _kb.GetTargStride();
+  // The number of rows in a block, then the end of each block.
+  std::vector<uint64_t> index(SRCast::ToSizeT(pIndex->_nBytes / sizeof(uint64_t)));
+  bool bOk = kbFi._file.ReadAt(index.data(), index.size() * sizeof(uint64_t), pIndex->_offset);
+  const uint64_t nRowsPerBlock = bOk ? index[0] : 0;
+  bOk = bOk && 1 <= nRowsPerBlock && nRowsPerBlock <= nRows
+    && index.size() - 1 == (nRows + nRowsPerBlock - 1) / nRowsPerBlock;
+  if (bOk) {
+    const uint64_t maxBlockBytes = TCodec::CalcMaxBytes(SRCast::ToSizeT(nRowsPerBlock), nTargStride);
+    for (size_t i = 1; bOk && i < index.size(); i++) {
+      const uint64_t blockStart = (i == 1) ? 0 : index[i - 1];
+      bOk = blockStart <= index[i] && index[i] - blockStart <= maxBlockBytes;
+    }
+    bOk = bOk && index.back() == pCoded->_nBytes;
+  }
+  if (!bOk) {
+    PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(kbFi._filePath), SRString::MakeUnowned(
+      SR_FILE_LINE "The index of the compressed KB weights is damaged.")).ThrowMoving();
+  }
+
+  const SRThreadCount nWorkers = _tpWorkers.GetWorkerCount();
+  const size_t nBlocks = index.size() - 1;
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CEKBCodecSubtask<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CEKBCodecTask<taNumber> task(*this, nWorkers, _kb, SRCast::ToSizeT(nRowsPerBlock), kbFi._file, kbFi._filePath,
+    pCoded->_offset, index.data() + 1);
+  {
+    SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+    pr.SplitAndRunSubtasks<CEKBCodecSubtask<taNumber>>(task, nBlocks, nWorkers);
+  }
+  PqaError err = task.TakeAggregateError(SRString::MakeUnowned(SR_FILE_LINE
+    "Failed to decode the compressed KB weights."));
+  if (!err.IsOk()) {
+    const PqaErrorCode code = err.GetCode();
+    PqaException(code, err.DetachParams(), SRString(err.GetMessage())).ThrowMoving();
+  }
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::ReadSectionedExtras(const KBFileInfo &kbFi) {
+  bool bOk = ReadGaps(kbFi, KBFileSectionKind::QuestionGaps, _dims._nQuestions, _questionGaps)
+    && ReadGaps(kbFi, KBFileSectionKind::TargetGaps, _dims._nTargets, _targetGaps);
+  const KBFileSection *pAsked = kbFi._pDir->Find(KBFileSectionKind::QuestionsAsked);
+  if (bOk && pAsked != nullptr) {
+    uint64_t nAsked;
+    bOk = kbFi._file.ReadAt(&nAsked, sizeof(nAsked), pAsked->_offset);
+    _nQuestionsAsked.store(nAsked, std::memory_order_relaxed);
+  }
+  // The files saved before the training journal appeared don't have the counter of trainings.
+  const KBFileSection *pTrainings = kbFi._pDir->Find(KBFileSectionKind::TrainingsCount);
+  if (bOk && pTrainings != nullptr) {
+    bOk = kbFi._file.ReadAt(&_nTrainings, sizeof(_nTrainings), pTrainings->_offset);
+  }
+  if (!bOk) {
+    PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(kbFi._filePath), SRString::MakeUnowned(
+      SR_FILE_LINE "Can't read the gaps or the counters of questions asked and trainings.")).ThrowMoving();
+  }
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::ReplayJournal(const char* const journalPath) {
+  uint64_t nReplayed = 0;
+  PqaError err = _journal.Open(journalPath, [&](const CETrainJournal::RecordHeader &rh, const AnsweredQuestion *pAQs) {
+    if (rh._iTraining <= _nTrainings) {
+      return PqaError(); // already in the KB
+    }
+    if (rh._iTraining != _nTrainings + 1) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(journalPath), SRMessageBuilder(SR_FILE_LINE
+        "The training journal misses the trainings after #")(_nTrainings)(" of the KB: the next record is #")
+        (rh._iTraining).GetOwnedSRString());
+    }
+    // The journal isn't open for appending yet, so the replayed trainings are not journaled again.
+    nReplayed++;
+    return TrainInternal(TPqaId(rh._nQuestions), pAQs, rh._iTarget, rh._amount, rh._kind);
+  });
+  if (!err.IsOk()) {
+    const PqaErrorCode code = err.GetCode();
+    PqaException(code, err.DetachParams(), SRString(err.GetMessage())).ThrowMoving();
+  }
+  if (nReplayed != 0) {
+    CELOG(Info) << "Replayed " << nReplayed << " trainings from the journal " << journalPath << ", up to #"
+      << _nTrainings << '.';
+  }
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::InitKB(const taNumber initA, const taNumber initD,
+  const taNumber initB)
+{
+  const SRThreadCount nWorkers = _tpWorkers.GetWorkerCount();
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CEInitKBSubtaskFill<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CEInitKBTask<taNumber> task(*this, _kb, initA, initD, initB);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+  // The split must be the same as in the operations on target vectors, so that the subtasks land on the same nodes.
+  pr.SplitAndRunSubtasks<CEInitKBSubtaskFill<taNumber>>(task, _kb.GetTargVects(), nWorkers);
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::InitInvD() {
+  const SRThreadCount nWorkers = _tpWorkers.GetWorkerCount();
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CEInitKBSubtaskInvD<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CEInitKBTask<taNumber> task(*this, _kb);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+  pr.SplitAndRunSubtasks<CEInitKBSubtaskInvD<taNumber>>(task, _kb.GetTargVects(), nWorkers);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::MakeReadOnlyError() {
+  return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't modify the KB because"
+    " it's a read-only mapping of the KB file."));
 }
 
 template<typename taNumber> CpuEngine<taNumber>::~CpuEngine() {
@@ -118,14 +312,24 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::Shutdown(const char* c
 
   PqaError err;
   if (saveFilePath != nullptr) do {
-    SRSmartFile sf(std::fopen(saveFilePath, "wb"));
-    if (sf.Get() == nullptr) {
+    SRPositionalFile file;
+    if (!file.Open(saveFilePath, SRPositionalFile::Mode::Write)) {
       err = PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(saveFilePath), SRString::MakeUnowned(
         SR_FILE_LINE "Can't open the file to write KB to."));
       break;
     }
-    err = LockedSaveKB(sf, false, saveFilePath);
+    err = LockedSaveKB(file, saveFilePath, false);
+    if (err.IsOk() && !file.Close()) {
+      err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(saveFilePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Failed in closing the file."));
+    }
   } WHILE_FALSE;
+  {
+    PqaError jErr = _journal.Close();
+    if (err.IsOk()) {
+      err = std::move(jErr);
+    }
+  }
 
   //TODO: check the order - perhaps some releases should happen while the workers are still operational
 
@@ -142,10 +346,8 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::Shutdown(const char* c
   _quizzes.clear();
   _quizGaps.Compact(0);
 
-  //// Release KB
-  _sA.clear();
-  _mD.clear();
-  _vB.Clear();
+  //// Release KB, including its mirror in the epoch mode
+  LockedForEachKB([](CEKBArena<taNumber> &kb) { kb.Clear(); });
   _questionGaps.Compact(0);
   _targetGaps.Compact(0);
   _dims._nAnswers = _dims._nQuestions = _dims._nTargets = 0;
@@ -157,7 +359,8 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::Shutdown(const char* c
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::TrainInternal(const TPqaId nQuestions,
-  const AnsweredQuestion* const pAQs, const TPqaId iTarget, const TPqaAmount amount)
+  const AnsweredQuestion* const pAQs, const TPqaId iTarget, const TPqaAmount amount,
+  const CETrainJournal::RecordKind kind)
 {
   if (nQuestions < 0) {
     return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
@@ -196,11 +399,14 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::TrainInternal(const TP
     }
   }); (void)ttLastFinally; // prevent warning C4189
 
+  // The number of the training in the journal, if it's written.
+  uint64_t iTraining = 0;
   { // Scope for the locks
     MaintenanceSwitch::AgnosticLock msal(_maintSwitch);
     
     //// The further code must be reader-writer locked, because we are validating the input before modifying the KB,
-    ////   so noone must change or read the KB in between.
+    ////   so noone must change or read the KB in between. In the epoch mode, the readers use the other instance of the
+    ////   KB meanwhile.
     SRRWLock<true> rwl(_rws);
 
     // Can't move dimensions-related code out of SRW lock because this operation can be run in maintenance mode too.
@@ -217,6 +423,11 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::TrainInternal(const TP
         "Target index is not in KB (but rather at a gap)."));
     }
 
+    if (_kb.IsReadOnly()) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+
     SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
 
     //// Distribute the AQs into buckets with the number of buckets divisable by the number of workers.
@@ -231,20 +442,34 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::TrainInternal(const TP
       return resErr;
     }
 
-    //// Update the KB with the given training data.
+    //// Update the KB with the given training data. The input is valid, so the KB changes from here on.
+    CEKBVersion::Change kbvc(_kbVersion);
     pr.RunPerWorkerSubtasks<CETrainSubtaskAdd<taNumber>>(trainTask, trainTask.GetWorkerCount());
     resErr = trainTask.TakeAggregateError(SRString::MakeUnowned("Failed " SR_FILE_LINE));
     if (!resErr.IsOk()) {
       return resErr;
     }
 
-    _vB[iTarget] += amount;
+    ModB(iTarget) += amount;
+    LockedPublishTrained(nQuestions, pAQs, iTarget);
+    LockedMarkTrained(nQuestions, pAQs, iTarget);
+    _nTrainings++;
+    if (_journal.IsOpen()) {
+      _journal.Append(_nTrainings, kind, nQuestions, pAQs, iTarget, amount);
+      iTraining = _nTrainings;
+    }
 
     //TODO: why is this inside the locks?
     // This method should increase the counter of questions asked by the number of questions in this training.
-    _nQuestionsAsked.fetch_add(nQuestions, std::memory_order_relaxed);
+    if (kind == CETrainJournal::RecordKind::Train) {
+      _nQuestionsAsked.fetch_add(nQuestions, std::memory_order_relaxed);
+    }
   }
 
+  // The journal is written out of the locks, so that the concurrent trainings share a flush.
+  if (iTraining != 0) {
+    return _journal.Commit(iTraining);
+  }
   return PqaError();
 }
 
@@ -252,7 +477,7 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::Train(const TPqaId nQu
   const AnsweredQuestion* const pAQs, const TPqaId iTarget, const TPqaAmount amount)
 {
   try {
-    return TrainInternal(nQuestions, pAQs, iTarget, amount);
+    return TrainInternal(nQuestions, pAQs, iTarget, amount, CETrainJournal::RecordKind::Train);
   }
   CATCH_TO_ERR_RETURN;
 }
@@ -334,9 +559,13 @@ template<typename taNumber> TPqaId CpuEngine<taNumber>::CreateQuizInternal(CECre
     }
     op._err = tNoSrw.TakeAggregateError();
     if(op._err.IsOk()) {
+      const uint64_t kbVersion = _kbVersion.Get();
       // If it's "resume quiz" operation, update the prior likelihoods with the questions answered, and normalize the
       //   priors. If it's "start quiz" operation, just divide the priors by their sum.
       op.UpdateLikelihoods(*this, *spQuiz.Get());
+      if (!op.IsResume() && _kbVersion.IsUnchanged(kbVersion)) {
+        spQuiz.Get()->SetKBVersion(kbVersion);
+      }
     }
     if (!op._err.IsOk()) {
       spQuiz.EarlyRelease();
@@ -445,49 +674,37 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::NormalizePriors(CEQuiz
   return PqaError();
 }
 
-template<typename taNumber> TPqaId CpuEngine<taNumber>::NextQuestion(PqaError& err, const TPqaId iQuiz) {
-  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
-  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
-    err = PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
-      " mode operation (compute next question) because current mode is not regular (but maintenance/shutdown?)."));
-    return cInvalidPqaId;
-  }
-  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
-
-  CEQuiz<taNumber> *pQuiz = UseQuiz(err, iQuiz);
-  if (pQuiz == nullptr) {
-    assert(!err.IsOk());
-    return cInvalidPqaId;
-  }
-
+template<typename taNumber> TPqaId CpuEngine<taNumber>::EvalNextQuestion(const CEQuiz<taNumber> &quiz,
+  const uint64_t kbVersion)
+{
   const SRSubtaskCount nWorkers = _tpWorkers.GetWorkerCount() * 8;
   SRMemTotal mtCommon;
   const SRByteMem miSubtasks(nWorkers * SRMaxSizeof<CEEvalQsSubtaskConsider<taNumber> >::value, SRMemPadding::None,
     mtCommon);
   const SRByteMem miSplit(SRPoolRunner::CalcSplitMemReq(nWorkers), SRMemPadding::Both, mtCommon);
-  const SRMemItem<taNumber> miRunLength(_dims._nQuestions, SRMemPadding::Both, mtCommon);
-  const SRMemItem<taNumber> miGrandTotals(nWorkers, SRMemPadding::Both, mtCommon);
+  const SRMemItem<SRDoubleNumber> miRunLength(_dims._nQuestions, SRMemPadding::Both, mtCommon);
+  const SRMemItem<SRDoubleNumber> miGrandTotals(nWorkers, SRMemPadding::Both, mtCommon);
 
   SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
   SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
 
   TPqaId selQuestion;
   do {
-    CEEvalQsTask<taNumber> evalQsTask(*this, *pQuiz, _dims._nTargets - _targetGaps.GetNGaps(),
+    CEEvalQsTask<taNumber> evalQsTask(*this, quiz, _dims._nTargets - _targetGaps.GetNGaps(),
       miRunLength.Ptr(commonBuf));
     // Although there are no more subtasks which would use this split, it will be used for run-length analysis.
     const SRPoolRunner::Split questionSplit = SRPoolRunner::CalcSplit(miSplit.BytePtr(commonBuf), _dims._nQuestions,
       nWorkers);
     {
-      SRRWLock<false> rwl(_rws);
+      CEKBReadGuard kbrg(_rws, _kbEpochs);
       SRPoolRunner::Keeper<CEEvalQsSubtaskConsider<taNumber>> kp = pr.RunPreSplit<CEEvalQsSubtaskConsider<taNumber>>(
         evalQsTask, questionSplit);
     }
-    SRAccumulator<taNumber> accTotG(taNumber(0.0));
-    const taNumber *const PTR_RESTRICT pRunLength = evalQsTask.GetRunLength();
-    taNumber *const PTR_RESTRICT pGrandTotals = miGrandTotals.Ptr(commonBuf);
+    SRAccumulator<SRDoubleNumber> accTotG(SRDoubleNumber(0.0));
+    const SRDoubleNumber *const PTR_RESTRICT pRunLength = evalQsTask.GetRunLength();
+    SRDoubleNumber *const PTR_RESTRICT pGrandTotals = miGrandTotals.Ptr(commonBuf);
     for (SRSubtaskCount i = 0; i < questionSplit._nSubtasks; i++) {
-      const taNumber curGT = pRunLength[questionSplit._pBounds[i] - 1];
+      const SRDoubleNumber curGT = pRunLength[questionSplit._pBounds[i] - 1];
       accTotG.Add(curGT);
       pGrandTotals[i] = accTotG.Get();
       //TODO: for performance reasons this check should be moved to subtasks, but here it checks consistency better
@@ -496,11 +713,22 @@ template<typename taNumber> TPqaId CpuEngine<taNumber>::NextQuestion(PqaError& e
           << pGrandTotals[i].ToAmount();
       }
     }
-    const taNumber totG = pGrandTotals[questionSplit._nSubtasks - 1];
+    const SRDoubleNumber totG = pGrandTotals[questionSplit._nSubtasks - 1];
     if (totG <= TPqaAmount(0)) {
       CELOG(Warning) << SR_FILE_LINE << "Grand-grand total is " << totG.ToAmount();
     }
-    const taNumber selRunLen = taNumber::MakeRandom(totG, SRFastRandom::ThreadLocal());
+    if (kbVersion != CEKBVersion::_cNone && _kbVersion.IsUnchanged(kbVersion)) {
+      // Merge the run lengths of the pieces into a single distribution over all the questions.
+      std::vector<double> cumPriorities(SRCast::ToSizeT(_dims._nQuestions));
+      for (SRSubtaskCount i = 0; i < questionSplit._nSubtasks; i++) {
+        const double base = ((i == 0) ? 0.0 : pGrandTotals[i - 1].GetValue());
+        for (size_t j = ((i == 0) ? 0 : questionSplit._pBounds[i - 1]); j < questionSplit._pBounds[i]; j++) {
+          cumPriorities[j] = base + pRunLength[j].GetValue();
+        }
+      }
+      _nextQsCache.Insert(quiz.GetAnswers(), kbVersion, std::move(cumPriorities));
+    }
+    const SRDoubleNumber selRunLen = SRDoubleNumber::MakeRandom(totG, SRFastRandom::ThreadLocal());
     const SRSubtaskCount iWorker = static_cast<SRSubtaskCount>(
       std::upper_bound(pGrandTotals, pGrandTotals + questionSplit._nSubtasks, selRunLen) - pGrandTotals);
     if (iWorker >= questionSplit._nSubtasks) {
@@ -509,7 +737,8 @@ template<typename taNumber> TPqaId CpuEngine<taNumber>::NextQuestion(PqaError& e
       break;
     }
 
-    const taNumber inWorkerRunLen = selRunLen - ((iWorker == 0) ? SRDoubleNumber(0.0) : pGrandTotals[iWorker-1]);
+    const SRDoubleNumber inWorkerRunLen = selRunLen
+      - ((iWorker == 0) ? SRDoubleNumber(0.0) : pGrandTotals[iWorker-1]);
     const TPqaId iFirst = ((iWorker == 0) ? 0 : questionSplit._pBounds[iWorker - 1]);
     const TPqaId iLimit = questionSplit._pBounds[iWorker];
     selQuestion = std::upper_bound(pRunLength + iFirst, pRunLength + iLimit, inWorkerRunLen) - pRunLength;
@@ -523,6 +752,35 @@ template<typename taNumber> TPqaId CpuEngine<taNumber>::NextQuestion(PqaError& e
       selQuestion = iLimit - 1;
     }
   } WHILE_FALSE;
+  return selQuestion;
+}
+
+template<typename taNumber> TPqaId CpuEngine<taNumber>::NextQuestion(PqaError& err, const TPqaId iQuiz) {
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    err = PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (compute next question) because current mode is not regular (but maintenance/shutdown?)."));
+    return cInvalidPqaId;
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  CEQuiz<taNumber> *pQuiz = UseQuiz(err, iQuiz);
+  if (pQuiz == nullptr) {
+    assert(!err.IsOk());
+    return cInvalidPqaId;
+  }
+
+  const std::vector<AnsweredQuestion>& answers = pQuiz->GetAnswers();
+  // The quiz shares the cached distributions if its priors have been computed with the current KB.
+  const uint64_t kbVersion = (_nextQsCache.Covers(answers.size()) && pQuiz->GetKBVersion() == _kbVersion.Get())
+    ? pQuiz->GetKBVersion() : CEKBVersion::_cNone;
+  TPqaId selQuestion = cInvalidPqaId;
+  if (kbVersion != CEKBVersion::_cNone) {
+    selQuestion = _nextQsCache.Select(answers, kbVersion);
+  }
+  if (selQuestion == cInvalidPqaId) {
+    selQuestion = EvalNextQuestion(*pQuiz, kbVersion);
+  }
 
   // If the selected question is in a gap or already answered, try to select the neighboring questions
   if (_questionGaps.IsGap(selQuestion) || SRBitHelper::Test(pQuiz->GetQAsked(), selQuestion)) {
@@ -562,7 +820,13 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::RecordAnswer(const TPq
     }
   }
 
-  return pQuiz->RecordAnswer(iAnswer);
+  const uint64_t kbVersion = _kbVersion.Get();
+  PqaError err = pQuiz->RecordAnswer(iAnswer);
+  // The priors stay those of the single version of the KB only if the answer is recorded with the same one.
+  if (!err.IsOk() || pQuiz->GetKBVersion() != kbVersion || !_kbVersion.IsUnchanged(kbVersion)) {
+    pQuiz->SetKBVersion(CEKBVersion::_cNone);
+  }
+  return err;
 }
 
 template<typename taNumber> TPqaId CpuEngine<taNumber>::ListTopTargets(PqaError& err, const TPqaId iQuiz,
@@ -583,6 +847,9 @@ template<typename taNumber> TPqaId CpuEngine<taNumber>::ListTopTargets(PqaError&
   }
 
   CEListTopTargetsAlgorithm<taNumber> ltta(err, *this, *pQuiz, maxCount, pDest);
+  if (pQuiz->GetActiveVects() != nullptr) {
+    return ltta.RunActive();
+  }
   
   //TODO: experiment to determine operation weights (comparison vs memory operations).
   const uint64_t nTargPerThread = SRMath::PosDivideRoundUp<uint64_t>(ltta._nTargets, ltta._nWorkers);
@@ -644,8 +911,15 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::RecordQuizTarget(const
   const std::vector<AnsweredQuestion>& answers = pQuiz->GetAnswers();
   const CETrainTaskNumSpec<taNumber> numSpec(amount);
   CETrainOperation<taNumber> trainOp(*this, iTarget, numSpec);
+  uint64_t iTraining = 0;
   {
+    // In the epoch mode, this doesn't stop the readers of the KB, see LockedPublishTrained().
     SRRWLock<true> rwl(_rws);
+    if (_kb.IsReadOnly()) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+    CEKBVersion::Change kbvc(_kbVersion);
     TPqaId i = 0;
     const TPqaId iEn = TPqaId(answers.size()) - 1;
     for (; i < iEn; i += 2) {
@@ -657,9 +931,20 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::RecordQuizTarget(const
     if (i == iEn) {
       trainOp.Perform1(answers[i]);
     }
-    _vB[iTarget] += amount;
+    ModB(iTarget) += amount;
+    LockedPublishTrained(TPqaId(answers.size()), answers.data(), iTarget);
+    LockedMarkTrained(TPqaId(answers.size()), answers.data(), iTarget);
+    _nTrainings++;
+    if (_journal.IsOpen()) {
+      _journal.Append(_nTrainings, CETrainJournal::RecordKind::QuizTarget, TPqaId(answers.size()), answers.data(),
+        iTarget, amount);
+      iTraining = _nTrainings;
+    }
   }
 
+  if (iTraining != 0) {
+    return _journal.Commit(iTraining);
+  }
   return PqaError();
 }
 
@@ -699,84 +984,695 @@ template<typename taNumber> PqaError CpuEngine<taNumber>::ReleaseQuiz(const TPqa
   return PqaError();
 }
 
-template<typename taNumber> PqaError CpuEngine<taNumber>::LockedSaveKB(SRSmartFile &sf, const bool bDoubleBuffer,
-  const char* const filePath)
+template<typename taNumber> void CpuEngine<taNumber>::LockedTakeExtras(KBFileExtras &extras) {
+  extras._dir.Init(_precDef, _dims, sizeof(taNumber), _kb.GetTargStride());
+  PackGaps(_dims._nQuestions, _questionGaps, extras._questionGaps);
+  PackGaps(_dims._nTargets, _targetGaps, extras._targetGaps);
+  extras._nQuestionsAsked = _nQuestionsAsked.load(std::memory_order_relaxed);
+  extras._nTrainings = _nTrainings;
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedSnapshotKB(CEKBArena<taNumber> &snapshot) {
+  const size_t nRows = _kb.GetNQuestions() * (_kb.GetNAnswers() + 1) + 1;
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(_nMemOpThreads * sizeof(CEKBSnapshotSubtask<taNumber>), SRMemPadding::None,
+    mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CEKBSnapshotTask<taNumber> task(*this, _kb, snapshot);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+  pr.SplitAndRunSubtasks<CEKBSnapshotSubtask<taNumber>>(task, nRows, _nMemOpThreads);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::WriteKBFile(const SRPositionalFile &file,
+  const char* const filePath, CEKBArena<taNumber> &kb, const KBFileExtras &extras)
+{
+  const KBFileDirectory &dir = extras._dir;
+  // The gaps between the sections read as zeros after the preallocation.
+  if (!file.Preallocate(dir.GetFileBytes()) || !file.WriteAt(&dir, sizeof(dir), 0)) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't preallocate the KB file or write its header and directory."));
+  }
+
+  // The rows are written with the padding, so that the file can be mapped as the arena.
+  {
+    PqaError err = TransferKBFile(kb, file, filePath, dir.Find(KBFileSectionKind::CubeA)->_offset,
+      dir.Find(KBFileSectionKind::MatrixD)->_offset, dir.Find(KBFileSectionKind::VectorB)->_offset,
+      kb.GetTargStride(), true);
+    if (!err.IsOk()) {
+      return std::move(err);
+    }
+  }
+
+  return WriteKBExtras(file, filePath, extras);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::WriteKBExtras(const SRPositionalFile &file,
+  const char* const filePath, const KBFileExtras &extras)
+{
+  const KBFileDirectory &dir = extras._dir;
+  auto fnWriteGaps = [&](const KBFileSectionKind kind, const std::vector<uint64_t> &words) {
+    return file.WriteAt(words.data(), words.size() * sizeof(uint64_t), dir.Find(kind)->_offset);
+  };
+  const bool bOk = fnWriteGaps(KBFileSectionKind::QuestionGaps, extras._questionGaps)
+    && fnWriteGaps(KBFileSectionKind::TargetGaps, extras._targetGaps)
+    && file.WriteAt(&extras._nQuestionsAsked, sizeof(extras._nQuestionsAsked),
+      dir.Find(KBFileSectionKind::QuestionsAsked)->_offset)
+    && file.WriteAt(&extras._nTrainings, sizeof(extras._nTrainings),
+      dir.Find(KBFileSectionKind::TrainingsCount)->_offset);
+  if (!bOk) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't write the gaps or the counters of questions asked and trainings."));
+  }
+  return PqaError();
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::WriteCodedKBFile(const SRPositionalFile &file,
+  const char* const filePath, const CEKBArena<taNumber> &kb, KBFileExtras &extras)
 {
-  const size_t nTargets = SRCast::ToSizeT(_dims._nTargets);
+  typedef CEKBCodec<taNumber> TCodec;
+  const size_t nRows = TCodec::CalcNRows(kb);
+  const size_t nRowsPerBlock = TCodec::CalcRowsPerBlock(kb.GetTargStride());
+  const size_t nBlocks = (nRows + nRowsPerBlock - 1) / nRowsPerBlock;
+  const SRThreadCount nWorkers = _tpWorkers.GetWorkerCount();
+  // The encoded size isn't known in advance, so each subtask collects its blocks in memory.
+  std::vector<std::vector<uint8_t>> subtaskBytes(nWorkers);
+  std::vector<uint64_t> blockEnds(nBlocks);
+  {
+    SRMemTotal mtCommon;
+    const SRByteMem miSubtasks(nWorkers * sizeof(CEKBCodecSubtask<taNumber>), SRMemPadding::None, mtCommon);
+    SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+    CEKBCodecTask<taNumber> task(*this, nWorkers, kb, nRowsPerBlock, subtaskBytes.data(), blockEnds.data());
+    {
+      SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+      pr.SplitAndRunSubtasks<CEKBCodecSubtask<taNumber>>(task, nBlocks, nWorkers);
+    }
+    PqaError err = task.TakeAggregateError(SRString::MakeUnowned(SR_FILE_LINE "Failed to encode the KB weights."));
+    if (!err.IsOk()) {
+      return std::move(err);
+    }
+  }
 
-  size_t bufSize;
-  if (bDoubleBuffer) {
-    bufSize = /* reserve */ SRSimd::_cNBytes + sizeof(_precDef) + sizeof(_dims)
-      + sizeof(taNumber) * nTargets * (_dims._nQuestions * _dims._nAnswers + _dims._nQuestions + 1);
+  {
+    const PrecisionDefinition prec = extras._dir._header._prec;
+    const EngineDimensions dims = extras._dir._header._dims;
+    extras._dir.InitCoded(prec, dims, sizeof(taNumber), kb.GetTargStride(), nBlocks);
   }
-  else {
-    bufSize = _cFileBufSize;
+  // The subtasks have encoded contiguous ranges of the blocks in the order of the workers.
+  uint64_t offset = extras._dir.Find(KBFileSectionKind::CodedWeights)->_offset;
+  for (const std::vector<uint8_t> &bytes : subtaskBytes) {
+    if (bytes.empty()) {
+      continue;
+    }
+    if (!file.WriteAt(bytes.data(), bytes.size(), offset)) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+        "Can't write the compressed KB weights at offset ")(offset).GetOwnedSRString());
+    }
+    offset += bytes.size();
   }
-  if (std::setvbuf(sf.Get(), nullptr, _IOFBF, bufSize) != 0) {
-    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
-      "Can't set file buffer size to ")(bufSize).GetOwnedSRString());
+  // Turn the sizes of the blocks into their ends.
+  for (size_t i = 1; i < nBlocks; i++) {
+    blockEnds[i] += blockEnds[i - 1];
   }
+  CELOG(Info) << "Compressed " << kb.GetNBytes() << " bytes of KB weights to " << blockEnds.back() << " bytes.";
+  return FinishCodedKBFile(file, filePath, extras, nRowsPerBlock, blockEnds);
+}
 
-  // Can be out of locks so long that the member variable is const
-  if (std::fwrite(&_precDef, sizeof(_precDef), 1, sf.Get()) != 1) {
+template<typename taNumber> PqaError CpuEngine<taNumber>::FinishCodedKBFile(const SRPositionalFile &file,
+  const char* const filePath, KBFileExtras &extras, const uint64_t nRowsPerBlock,
+  const std::vector<uint64_t> &blockEnds)
+{
+  extras._dir.SetCodedBytes(blockEnds.back());
+  std::vector<uint64_t> index;
+  index.reserve(blockEnds.size() + 1);
+  index.push_back(nRowsPerBlock);
+  index.insert(index.end(), blockEnds.begin(), blockEnds.end());
+  if (!file.WriteAt(&extras._dir, sizeof(extras._dir), 0) || !file.WriteAt(index.data(),
+    index.size() * sizeof(uint64_t), extras._dir.Find(KBFileSectionKind::CodecIndex)->_offset))
+  {
     return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
-      "Can't write precision definition header."));
+      "Can't write the header, the directory or the index of the compressed KB file."));
   }
+  return WriteKBExtras(file, filePath, extras);
+}
 
-  if (std::fwrite(&_dims, sizeof(_dims), 1, sf.Get()) != 1) {
-    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
-      "Can't write engine dimensions header."));
+template<typename taNumber> PqaError CpuEngine<taNumber>::LockedSaveKB(const SRPositionalFile &file,
+  const char* const filePath, const bool bCompress)
+{
+  KBFileExtras extras;
+  LockedTakeExtras(extras);
+  PqaError err = bCompress ? WriteCodedKBFile(file, filePath, _kb, extras) : WriteKBFile(file, filePath, _kb, extras);
+  if (err.IsOk()) {
+    // A compressed file can't be patched, so the next incremental save writes the whole KB.
+    if (bCompress) {
+      _dirtyPages.Stop();
+    } else {
+      _dirtyPages.Reset(extras._dir, sizeof(taNumber));
+    }
   }
+  return std::move(err);
+}
 
-  for (TPqaId i = 0; i < _dims._nQuestions; i++) {
-    for (TPqaId k = 0; k < _dims._nAnswers; k++) {
-      if (std::fwrite(&(_sA[i][k][0]), sizeof(taNumber), nTargets, sf.Get()) != nTargets) {
-        return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
-          "Can't write the target dimension of _sA weights at [")(i)(", ")(k)("].").GetOwnedSRString());
-      }
+template<typename taNumber> void CpuEngine<taNumber>::LockedPublishTrained(const TPqaId nQuestions,
+  const AnsweredQuestion* const pAQs, const TPqaId iTarget)
+{
+  LockedPublish([&](CEKBArena<taNumber> &prev, const CEKBArena<taNumber> &updated) {
+    prev.CopyTrained(updated, nQuestions, pAQs, iTarget);
+  });
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedMarkTrained(const TPqaId nQuestions,
+  const AnsweredQuestion* const pAQs, const TPqaId iTarget)
+{
+  if (!_dirtyPages.IsTracking()) {
+    return;
+  }
+  for (TPqaId i = 0; i < nQuestions; i++) {
+    _dirtyPages.MarkA(pAQs[i]._iQuestion, pAQs[i]._iAnswer, iTarget);
+    _dirtyPages.MarkD(pAQs[i]._iQuestion, iTarget);
+  }
+  _dirtyPages.MarkB(iTarget);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::LockedPatchKB(const SRPositionalFile &file,
+  const char* const filePath, bool &bPatched, uint64_t &nPagesWritten)
+{
+  bPatched = false;
+  nPagesWritten = 0;
+  KBFileExtras extras;
+  LockedTakeExtras(extras);
+  const KBFileDirectory &dir = extras._dir;
+  {
+    // The file may have been overwritten by someone else since the last save.
+    KBFileDirectory fileDir;
+    if (!file.ReadAt(&fileDir, sizeof(fileDir), 0) || std::memcmp(&fileDir, &dir, sizeof(dir)) != 0) {
+      return PqaError();
     }
   }
 
-  for (TPqaId i = 0; i < _dims._nQuestions; i++) {
-    if (std::fwrite(&(_mD[i][0]), sizeof(taNumber), nTargets, sf.Get()) != nTargets) {
+  const KBFileSection &sectA = *dir.Find(KBFileSectionKind::CubeA);
+  const KBFileSection &sectD = *dir.Find(KBFileSectionKind::MatrixD);
+  const KBFileSection &sectB = *dir.Find(KBFileSectionKind::VectorB);
+  const uint64_t rowBytes = sectA._rowBytes;
+  const size_t nAnswers = _kb.GetNAnswers();
+  const size_t nTileNums = _kb.GetTileNums();
+  // Copy the bytes at file offsets [offset;offsLim) of the weights into |pDest| in the layout of the file. The sections
+  //   are page-aligned, so the tail of the last page of a section is zeros.
+  auto fnGather = [&](uint64_t offset, const uint64_t offsLim, uint8_t *pDest) {
+    while (offset < offsLim) {
+      const KBFileSection &sect = (offset >= sectB._offset) ? sectB : ((offset >= sectD._offset) ? sectD : sectA);
+      const uint64_t dataLim = std::min(offsLim, sect._offset + sect._nBytes);
+      if (offset >= dataLim) {
+        const uint64_t zeroLim = std::min(offsLim, KBFileDirectory::AlignToPage(sect._offset + sect._nBytes));
+        std::memset(pDest, 0, SRCast::ToSizeT(zeroLim - offset));
+        pDest += zeroLim - offset;
+        offset = zeroLim;
+        continue;
+      }
+      const uint64_t rel = offset - sect._offset;
+      const size_t nBytes = SRCast::ToSizeT(dataLim - offset);
+      if (&sect != &sectA || !_kb.IsTiledA()) {
+        const taNumber *pBase = (&sect == &sectA) ? _kb.GetAQuestion(0) : ((&sect == &sectD) ? _kb.GetD(0)
+          : _kb.GetB());
+        std::memcpy(pDest, reinterpret_cast<const uint8_t*>(pBase) + rel, nBytes);
+      } else {
+        // The tiles of a row are apart in the arena.
+        for (uint64_t pos = rel; pos < rel + nBytes;) {
+          const size_t r = SRCast::ToSizeT(pos / rowBytes);
+          const size_t j = SRCast::ToSizeT((pos % rowBytes) / sizeof(taNumber));
+          const uint64_t pieceLim = std::min(rel + nBytes, r * rowBytes
+            + std::min((j / nTileNums + 1) * nTileNums, _kb.GetTargStride()) * sizeof(taNumber));
+          std::memcpy(pDest + (pos - rel), &_kb.GetA(r / nAnswers, r % nAnswers, j), SRCast::ToSizeT(pieceLim - pos));
+          pos = pieceLim;
+        }
+      }
+      pDest += nBytes;
+      offset = dataLim;
+    }
+  };
+
+  // Write the runs of adjacent dirty pages, each at most the size of the buffer.
+  SRSmartMPP<uint8_t> smppBuf(_memPool, _cFileBufSize);
+  const uint64_t nBufPages = _cFileBufSize >> CEKBDirtyPages::_cLogPageBytes;
+  const uint64_t nPages = _dirtyPages.GetNPages();
+  for (uint64_t iPage = 0; iPage < nPages;) {
+    const uint64_t dirty64 = _dirtyPages.GetDirty64(iPage >> 6) >> (iPage & 63);
+    unsigned long iSetBit;
+    if (!_BitScanForward64(&iSetBit, dirty64)) {
+      iPage = (iPage | 63) + 1;
+      continue;
+    }
+    iPage += iSetBit;
+    if (iPage >= nPages) {
+      break;
+    }
+    uint64_t iRunLim = iPage + 1;
+    while (iRunLim < nPages && iRunLim - iPage < nBufPages && _dirtyPages.IsDirty(iRunLim)) {
+      iRunLim++;
+    }
+    const uint64_t offset = _dirtyPages.GetPageOffset(iPage);
+    const uint64_t offsLim = _dirtyPages.GetPageOffset(iRunLim);
+    fnGather(offset, offsLim, smppBuf.Get());
+    if (!file.WriteAt(smppBuf.Get(), SRCast::ToSizeT(offsLim - offset), offset)) {
       return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
-        "Can't write the target dimension of _mD weights at [")(i)("].").GetOwnedSRString());
+        "Can't write the changed pages of the KB at offset ")(offset).GetOwnedSRString());
     }
+    nPagesWritten += iRunLim - iPage;
+    iPage = iRunLim;
   }
 
-  if (std::fwrite(&(_vB[0]), sizeof(taNumber), nTargets, sf.Get()) != nTargets) {
-    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
-      "Can't write the _vB weights."));
+  PqaError err = WriteKBExtras(file, filePath, extras);
+  if (!err.IsOk()) {
+    return std::move(err);
   }
-
+  _dirtyPages.Reset(dir, sizeof(taNumber));
+  bPatched = true;
   return PqaError();
 }
 
-template<typename taNumber> PqaError CpuEngine<taNumber>::SaveKB(const char* const filePath, const bool bDoubleBuffer) {
-  SRSmartFile sf(std::fopen(filePath, "wb"));
-  if (sf.Get() == nullptr) {
+template<typename taNumber> PqaError CpuEngine<taNumber>::SaveKB(const char* const filePath, const bool bDoubleBuffer,
+  const bool bCompress)
+{
+  const auto tStart = std::chrono::steady_clock::now();
+  SRPositionalFile file;
+  if (!file.Open(filePath, SRPositionalFile::Mode::Write)) {
     return PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(filePath), SRString::MakeUnowned(
       SR_FILE_LINE "Can't open the file to write KB to."));
   }
 
+  std::chrono::steady_clock::duration lockTime;
+  uint64_t nKBBytes;
   {
     MaintenanceSwitch::AgnosticLock msal(_maintSwitch);
     // Can't write engine dimensions before reader-writer lock, because maintenance switch doesn't prevent their change
     //   in maintenance mode.
     SRRWLock<false> rwl(_rws);
+    const auto tLocked = std::chrono::steady_clock::now();
+    SRLock<SRCriticalSection> csl(_csCheckpoint);
+    nKBBytes = _kb.GetNBytes();
+    // Until the file is written, it can't be patched.
+    _checkpointPath.clear();
 
-    PqaError err = LockedSaveKB(sf, bDoubleBuffer, filePath);
+    PqaError err;
+    if (bDoubleBuffer) {
+      KBFileExtras extras;
+      LockedTakeExtras(extras);
+      SRSmartMPP<uint8_t> smppSnapshot(_memPool, _kb.GetNBytes());
+      CEKBArena<taNumber> snapshot;
+      snapshot.View(smppSnapshot.Get(), _kb.GetNQuestions(), _kb.GetNAnswers(), _kb.GetTargStride());
+      LockedSnapshotKB(snapshot);
+      // The training after the snapshot makes the pages dirty with respect to the file being written, while a
+      //   compressed file can't be patched.
+      if (bCompress) {
+        _dirtyPages.Stop();
+      } else {
+        _dirtyPages.Reset(extras._dir, sizeof(taNumber));
+      }
+      rwl.EarlyRelease();
+      lockTime = std::chrono::steady_clock::now() - tLocked;
+
+      // The snapshot has its own dimensions, so the training and the maintenance can proceed meanwhile.
+      err = bCompress ? WriteCodedKBFile(file, filePath, snapshot, extras)
+        : WriteKBFile(file, filePath, snapshot, extras);
+    } else {
+      err = LockedSaveKB(file, filePath, bCompress);
+      lockTime = std::chrono::steady_clock::now() - tLocked;
+    }
     if (!err.IsOk()) {
       return std::move(err);
     }
+
+    // Close it explicitly here, to be able to handle and report an error
+    if (!file.Close()) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Failed in closing the file."));
+    }
+    _checkpointPath = filePath;
   }
 
-  // Close it explicitly here, to be able to handle and report an error
-  if (!sf.EarlyClose()) {
+  const uint64_t lockMicros = SRCast::ToUint64(
+    std::chrono::duration_cast<std::chrono::microseconds>(lockTime).count());
+  const uint64_t totalMicros = SRCast::ToUint64(
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count());
+  _lastSaveLockMicros.store(lockMicros, std::memory_order_relaxed);
+  _lastSaveMicros.store(totalMicros, std::memory_order_relaxed);
+  CELOG(Info) << "Saved " << nKBBytes << " bytes of KB weights to " << filePath << " in " << totalMicros
+    << " microseconds, of which the KB was locked for " << lockMicros << " microseconds.";
+  return PqaError();
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::SaveKBIncremental(const char* const filePath) {
+  const auto tStart = std::chrono::steady_clock::now();
+  {
+    MaintenanceSwitch::AgnosticLock msal(_maintSwitch);
+    SRRWLock<false> rwl(_rws);
+    const auto tLocked = std::chrono::steady_clock::now();
+    SRLock<SRCriticalSection> csl(_csCheckpoint);
+    SRPositionalFile file;
+    if (_dirtyPages.IsTracking() && _checkpointPath == filePath
+      && file.Open(filePath, SRPositionalFile::Mode::Update))
+    {
+      bool bPatched;
+      uint64_t nPagesWritten;
+      PqaError err = LockedPatchKB(file, filePath, bPatched, nPagesWritten);
+      if (err.IsOk() && bPatched && !file.Close()) {
+        err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+          "Failed in closing the file."));
+      }
+      if (!err.IsOk()) {
+        // The file may be patched partially.
+        _checkpointPath.clear();
+        return std::move(err);
+      }
+      if (bPatched) {
+        const auto tEnd = std::chrono::steady_clock::now();
+        const uint64_t lockMicros = SRCast::ToUint64(
+          std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tLocked).count());
+        const uint64_t totalMicros = SRCast::ToUint64(
+          std::chrono::duration_cast<std::chrono::microseconds>(tEnd - tStart).count());
+        _lastSaveLockMicros.store(lockMicros, std::memory_order_relaxed);
+        _lastSaveMicros.store(totalMicros, std::memory_order_relaxed);
+        CELOG(Info) << "Patched " << nPagesWritten << " changed pages of KB weights in " << filePath << " in "
+          << totalMicros << " microseconds.";
+        return PqaError();
+      }
+    }
+  }
+  // The file isn't the one of the last save, or its layout has changed since then.
+  return SaveKB(filePath, false);
+}
+
+template<typename taNumber> IPqaSaveKBJob* CpuEngine<taNumber>::SaveKBAsync(PqaError& err,
+  const char* const filePath, const SaveKBOptions &options)
+{
+  try {
+    err.Release();
+    if (options._chunkBytes == 0) {
+      err = PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(0), SRString::MakeUnowned(
+        SR_FILE_LINE "The size of a chunk to write must be positive."));
+      return nullptr;
+    }
+    // The job leaves the switch once it doesn't use the engine anymore, so that Shutdown() waits for it.
+    _maintSwitch.EnterAgnostic();
+    try {
+      return new CESaveKBJob<taNumber>(*this, filePath, options);
+    }
+    catch (...) {
+      _maintSwitch.LeaveAgnostic();
+      throw;
+    }
+  }
+  CATCH_TO_ERR_SET(err);
+  return nullptr;
+}
+
+template<typename taNumber> IPqaRecomputeDJob* CpuEngine<taNumber>::RecomputeDAsync(PqaError& err,
+  const RecomputeDOptions &options)
+{
+  try {
+    err.Release();
+    if (options._nQuestionsPerChunk <= 0) {
+      err = PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(
+        TPqaAmount(options._nQuestionsPerChunk)), SRString::MakeUnowned(SR_FILE_LINE
+        "The number of questions in a chunk to recompute must be positive."));
+      return nullptr;
+    }
+    // The job leaves the switch once it doesn't use the engine anymore, so that Shutdown() waits for it.
+    _maintSwitch.EnterAgnostic();
+    try {
+      return new CERecomputeDJob<taNumber>(*this, options);
+    }
+    catch (...) {
+      _maintSwitch.LeaveAgnostic();
+      throw;
+    }
+  }
+  CATCH_TO_ERR_SET(err);
+  return nullptr;
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::StreamKBFile(CESaveKBJob<taNumber> &job,
+  const SRPositionalFile &file, const CEKBArena<taNumber> &snapshot, const KBFileExtras &extras)
+{
+  const char* const filePath = job.GetFilePath();
+  const KBFileDirectory &dir = extras._dir;
+  const KBFileSection *const sects[] = { dir.Find(KBFileSectionKind::CubeA), dir.Find(KBFileSectionKind::MatrixD),
+    dir.Find(KBFileSectionKind::VectorB) };
+  const uint8_t *const pSources[] = { reinterpret_cast<const uint8_t*>(snapshot.GetAQuestion(0)),
+    reinterpret_cast<const uint8_t*>(snapshot.GetD(0)), reinterpret_cast<const uint8_t*>(snapshot.GetB()) };
+
+  // The gaps between the sections read as zeros after the preallocation.
+  if (!file.Preallocate(dir.GetFileBytes()) || !file.WriteAt(&dir, sizeof(dir), 0)) {
     return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
-      "Failed in closing the file."));
+      "Can't preallocate the KB file or write its header and directory."));
+  }
+  // The snapshot is row-major like the file, so each section is written in chunks straight from it.
+  const uint64_t chunkBytes = job.GetOptions()._chunkBytes;
+  for (size_t i = 0; i < std::size(sects); i++) {
+    for (uint64_t pos = 0; pos < sects[i]->_nBytes; pos += chunkBytes) {
+      if (job.IsCancelled()) {
+        return PqaError(PqaErrorCode::Cancelled, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+          "The asynchronous save of the KB has been cancelled."));
+      }
+      const size_t nBytes = SRCast::ToSizeT(std::min(chunkBytes, sects[i]->_nBytes - pos));
+      if (!file.WriteAt(pSources[i] + pos, nBytes, sects[i]->_offset + pos)) {
+        return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+          "Can't write the KB weights at offset ")(sects[i]->_offset + pos).GetOwnedSRString());
+      }
+      job.AddBytesWritten(nBytes);
+    }
+  }
+  return WriteKBExtras(file, filePath, extras);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::StreamCodedKBFile(CESaveKBJob<taNumber> &job,
+  const SRPositionalFile &file, const CEKBArena<taNumber> &snapshot, KBFileExtras &extras)
+{
+  typedef CEKBCodec<taNumber> TCodec;
+  const char* const filePath = job.GetFilePath();
+  const size_t nTargStride = snapshot.GetTargStride();
+  const size_t nRows = TCodec::CalcNRows(snapshot);
+  const size_t nRowsPerBlock = TCodec::CalcRowsPerBlock(nTargStride);
+  {
+    const PrecisionDefinition prec = extras._dir._header._prec;
+    const EngineDimensions dims = extras._dir._header._dims;
+    extras._dir.InitCoded(prec, dims, sizeof(taNumber), nTargStride, (nRows + nRowsPerBlock - 1) / nRowsPerBlock);
+  }
+  const uint64_t offsCoded = extras._dir.Find(KBFileSectionKind::CodedWeights)->_offset;
+
+  // The blocks of the codec are the chunks here, encoded one by one on this thread.
+  SRSmartMPP<uint8_t> smppBlock(_memPool, TCodec::CalcMaxBytes(nRowsPerBlock, nTargStride));
+  std::vector<uint64_t> blockEnds;
+  uint64_t codedEnd = 0;
+  for (size_t iFirstRow = 0; iFirstRow < nRows; iFirstRow += nRowsPerBlock) {
+    if (job.IsCancelled()) {
+      return PqaError(PqaErrorCode::Cancelled, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+        "The asynchronous save of the KB has been cancelled."));
+    }
+    const size_t iLimRow = std::min(iFirstRow + nRowsPerBlock, nRows);
+    const size_t nBytes = TCodec::EncodeRows(snapshot, iFirstRow, iLimRow, smppBlock.Get());
+    if (!file.WriteAt(smppBlock.Get(), nBytes, offsCoded + codedEnd)) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+        "Can't write the compressed KB weights at offset ")(offsCoded + codedEnd).GetOwnedSRString());
+    }
+    codedEnd += nBytes;
+    blockEnds.push_back(codedEnd);
+    job.AddBytesWritten((iLimRow - iFirstRow) * nTargStride * sizeof(taNumber));
+  }
+  return FinishCodedKBFile(file, filePath, extras, nRowsPerBlock, blockEnds);
+}
+
+template<typename taNumber> PqaError CpuEngine<taNumber>::RunSaveKBJob(CESaveKBJob<taNumber> &job) {
+  // Declared first so that it runs last, after the snapshot has returned to the memory pool.
+  auto&& msFinally = SRMakeFinally([this] { _maintSwitch.LeaveAgnostic(); });
+  const auto tStart = std::chrono::steady_clock::now();
+  const char* const filePath = job.GetFilePath();
+  SRPositionalFile file;
+  if (!file.Open(filePath, SRPositionalFile::Mode::Write)) {
+    return PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(filePath), SRString::MakeUnowned(
+      SR_FILE_LINE "Can't open the file to write KB to."));
+  }
+
+  uint64_t lockMicros;
+  uint64_t nBytesTotal = 0;
+  {
+    SRRWLock<false> rwl(_rws);
+    const auto tLocked = std::chrono::steady_clock::now();
+    SRLock<SRCriticalSection> csl(_csCheckpoint);
+    // Until the file is written, it can't be patched.
+    _checkpointPath.clear();
+
+    KBFileExtras extras;
+    LockedTakeExtras(extras);
+    SRSmartMPP<uint8_t> smppSnapshot(_memPool, _kb.GetNBytes());
+    CEKBArena<taNumber> snapshot;
+    snapshot.View(smppSnapshot.Get(), _kb.GetNQuestions(), _kb.GetNAnswers(), _kb.GetTargStride());
+    {
+      // Copy on this thread rather than on the workers, which stay available to the quizzes.
+      CEKBSnapshotTask<taNumber> task(*this, _kb, snapshot);
+      CEKBSnapshotSubtask<taNumber> subtask(&task);
+      subtask.SetStandardParams(0, 0, int64_t(_kb.GetNQuestions() * (_kb.GetNAnswers() + 1) + 1));
+      subtask.Run();
+    }
+    // The training after the snapshot makes the pages dirty with respect to the file being written, while a compressed
+    //   file can't be patched.
+    if (job.GetOptions()._bCompress) {
+      _dirtyPages.Stop();
+    } else {
+      _dirtyPages.Reset(extras._dir, sizeof(taNumber));
+    }
+    rwl.EarlyRelease();
+    lockMicros = SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - tLocked).count());
+    nBytesTotal = snapshot.GetNBytes();
+    job.OnSnapshotTaken(nBytesTotal, lockMicros);
+
+    PqaError err = job.GetOptions()._bCompress ? StreamCodedKBFile(job, file, snapshot, extras)
+      : StreamKBFile(job, file, snapshot, extras);
+    if (!err.IsOk()) {
+      return std::move(err);
+    }
+    // Close it explicitly here, to be able to handle and report an error
+    if (!file.Close()) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Failed in closing the file."));
+    }
+    _checkpointPath = filePath;
+  }
+
+  const uint64_t totalMicros = SRCast::ToUint64(
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count());
+  _lastSaveLockMicros.store(lockMicros, std::memory_order_relaxed);
+  _lastSaveMicros.store(totalMicros, std::memory_order_relaxed);
+  CELOG(Info) << "Saved asynchronously " << nBytesTotal << " bytes of KB weights to " << filePath << " in "
+    << totalMicros << " microseconds, of which the KB was locked for " << lockMicros << " microseconds.";
+  return PqaError();
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::SumD(const CEKBArena<taNumber> &kb, const size_t iFirst,
+  const size_t iLimit, double *pSums)
+{
+  const SRThreadCount nWorkers = _tpWorkers.GetWorkerCount();
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CESumDSubtask<taNumber>), SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CESumDTask<taNumber> task(*this, kb, iFirst, iLimit, pSums);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+  // The split must be the same as in the operations on target vectors, so that the subtasks land on the same nodes.
+  pr.SplitAndRunSubtasks<CESumDSubtask<taNumber>>(task, kb.GetTargVects(), nWorkers);
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedApplyD(const size_t iFirst, const size_t iLimit,
+  const double *pSums, uint64_t &nCorrected, double &maxRelDrift)
+{
+  CEKBArena<taNumber> &kb = *_pWriteKB;
+  const size_t nTargStride = kb.GetTargStride();
+  const TPqaId nTargets = _dims._nTargets;
+  bool bChanged = false;
+  for (size_t i = iFirst; i < iLimit; i++) {
+    if (_questionGaps.IsGap(TPqaId(i))) {
+      continue;
+    }
+    taNumber *pD = kb.ModD(i);
+    const double *pRow = pSums + (i - iFirst) * nTargStride;
+    for (TPqaId j = 0; j < nTargets; j++) {
+      // The weights of the gaps may be arbitrary, e.g. the spare items of the rows.
+      if (_targetGaps.IsGap(j)) {
+        continue;
+      }
+      const taNumber newD(pRow[j]);
+      const double oldD = pD[j].ToAmount();
+      if (oldD == newD.ToAmount()) {
+        continue;
+      }
+      nCorrected++;
+      maxRelDrift = std::max(maxRelDrift, std::abs(oldD - newD.ToAmount()) / newD.ToAmount());
+      pD[j] = newD;
+      if (kb.HasInvD()) {
+        kb.ModInvD(i)[j] = taNumber(1 / newD.ToAmount());
+      }
+      bChanged = true;
+    }
   }
+  if (!bChanged) {
+    return;
+  }
+  if (_dirtyPages.IsTracking()) {
+    _dirtyPages.MarkDRows(TPqaId(iFirst), TPqaId(iLimit));
+  }
+  LockedPublish([&](CEKBArena<taNumber> &prev, const CEKBArena<taNumber> &updated) {
+    prev.CopyDRows(updated, iFirst, iLimit);
+  });
+}
 
+template<typename taNumber> PqaError CpuEngine<taNumber>::RunRecomputeDJob(CERecomputeDJob<taNumber> &job) {
+  // Declared first so that it runs last, after the buffers are freed.
+  auto&& msFinally = SRMakeFinally([this] { _maintSwitch.LeaveAgnostic(); });
+  const RecomputeDOptions &options = job.GetOptions();
+  const size_t nPerChunk = SRCast::ToSizeT(options._nQuestionsPerChunk);
+  {
+    SRRWLock<false> rwl(_rws);
+    if (_kb.IsReadOnly()) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+  }
+  std::vector<double> sums;
+  uint64_t nCorrected = 0;
+  double maxRelDrift = 0;
+  // The dimensions may change between the chunks in maintenance mode, so they are taken anew for each chunk.
+  for (size_t iFirst = 0;;) {
+    if (job.IsCancelled()) {
+      return PqaError(PqaErrorCode::Cancelled, nullptr, SRString::MakeUnowned(SR_FILE_LINE
+        "The recomputation of matrix D has been cancelled."));
+    }
+    size_t iLimit;
+    uint64_t iTraining, iReshape;
+    // Sum under the shared lock, so that only the trainings wait meanwhile.
+    {
+      SRRWLock<false> rwl(_rws);
+      const size_t nQuestions = _kb.GetNQuestions();
+      job.SetNQuestionsTotal(TPqaId(nQuestions));
+      if (iFirst >= nQuestions) {
+        break;
+      }
+      iLimit = std::min(iFirst + nPerChunk, nQuestions);
+      iTraining = _nTrainings;
+      iReshape = _nReshapes;
+      sums.resize((iLimit - iFirst) * _kb.GetTargStride());
+      SumD(*_pWriteKB, iFirst, iLimit, sums.data());
+    }
+    uint64_t lockMicros;
+    {
+      SRRWLock<true> rwl(_rws);
+      const auto tLocked = std::chrono::steady_clock::now();
+      if (_nTrainings != iTraining || _nReshapes != iReshape) {
+        // Cube A has changed since the summation, so sum again, this time for one chunk under the exclusive lock.
+        iLimit = std::min(iLimit, _kb.GetNQuestions());
+        if (iFirst >= iLimit) {
+          continue;
+        }
+        sums.resize((iLimit - iFirst) * _kb.GetTargStride());
+        SumD(*_pWriteKB, iFirst, iLimit, sums.data());
+      }
+      {
+        CEKBVersion::Change kbvc(_kbVersion);
+        LockedApplyD(iFirst, iLimit, sums.data(), nCorrected, maxRelDrift);
+      }
+      rwl.EarlyRelease();
+      lockMicros = SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - tLocked).count());
+    }
+    job.OnChunkDone(TPqaId(iLimit), nCorrected, maxRelDrift, lockMicros);
+    iFirst = iLimit;
+    if (options._pauseMiS != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options._pauseMiS));
+    }
+  }
+  CELOG(Info) << "Recomputed matrix D: corrected " << nCorrected << " items, with the maximum relative drift of "
+    << maxRelDrift << '.';
   return PqaError();
 }
 
@@ -785,56 +1681,368 @@ template<typename taNumber> uint64_t CpuEngine<taNumber>::GetTotalQuestionsAsked
   return _nQuestionsAsked.load(std::memory_order_relaxed);
 }
 
+template<typename taNumber> PqaError CpuEngine<taNumber>::GetStats(EngineStats &stats) {
+  stats._nQuestionsAsked = _nQuestionsAsked.load(std::memory_order_relaxed);
+  {
+    SRRWLock<false> rwl(_rws);
+    stats._kbBytes = _kb.GetNBytes();
+    stats._kbLargePages = _kb.IsLargePages();
+    stats._kbMapped = _kb.IsMapped();
+  }
+  stats._nPoolLargePageAllocs = _memPool.GetNLargePageAllocs();
+  stats._nPoolLargePageFallbacks = _memPool.GetNLargePageFallbacks();
+  stats._lastSaveMicros = _lastSaveMicros.load(std::memory_order_relaxed);
+  stats._lastSaveLockMicros = _lastSaveLockMicros.load(std::memory_order_relaxed);
+  return PqaError();
+}
+
 template<typename taNumber> PqaError CpuEngine<taNumber>::StartMaintenance(const bool forceQuizes) {
-  (void)forceQuizes; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::StartMaintenance")));
+  try {
+    // Wait for the regular-only operations to finish, and deny the new ones, so that the quizzes can't be used.
+    _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Maintenance>();
+    SRLock<SRCriticalSection> csl(_csQuizReg);
+    const TPqaId nQuizzes = TPqaId(_quizzes.size()) - _quizGaps.GetNGaps();
+    if (nQuizzes > 0 && !forceQuizes) {
+      csl.EarlyRelease();
+      _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Regular>();
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRMessageBuilder(SR_FILE_LINE "Can't start maintenance because"
+        " there are ")(nQuizzes)(" quizzes in progress.").GetOwnedSRString());
+    }
+    // The quizzes are computed for the current dimensions of the KB, which maintenance changes.
+    for (size_t i = 0; i < _quizzes.size(); i++) {
+      if (_quizGaps.IsGap(i)) {
+        continue;
+      }
+      SRCheckingRelease(_memPool, _quizzes[i]);
+    }
+    _quizzes.clear();
+    _quizGaps.Compact(0);
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::FinishMaintenance() {
-  //TODO: adjust workers's stack size if more is needed for the new dimensions: SRThreadPool::ChangeStackSize()
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::FinishMaintenance")));
+  try {
+    _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Regular>(&AdjustWorkerStacks, this);
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::AdjustWorkerStacks(void *pEngine) {
+  CpuEngine<taNumber> &engine = *static_cast<CpuEngine<taNumber>*>(pEngine);
+  EngineDefinition engDef;
+  // All the fields that CalcWorkerStackSize() reads.
+  engDef._dims = engine._dims;
+  engDef._tiledA = engine._kb.IsTiledA();
+  engDef._pruneTargetsEps = engine.GetPruneEps();
+  const size_t stackSize = CalcWorkerStackSize(engDef);
+  if (stackSize + SRThreadPool::_cReserveStackSize <= engine._tpWorkers.GetStackSize()) {
+    return;
+  }
+  // The workers are idle, because no operation is in progress.
+  engine._tpWorkers.ChangeStackSize(stackSize);
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedReserveKB(const TPqaId nQuestions, const TPqaId nTargets)
+{
+  const size_t nNewQuestions = SRCast::ToSizeT(nQuestions);
+  const size_t nTargStride = _kb.GetTargStride();
+  const size_t nQuestCap = _kb.GetQuestCap();
+  const bool bTargetsFit = CEKBArena<taNumber>::IsTargStride(SRCast::ToSizeT(nTargets), nTargStride);
+  if (bTargetsFit && nNewQuestions <= nQuestCap) {
+    LockedForEachKB([&](CEKBArena<taNumber> &kb) { kb.GrowQuestions(nNewQuestions); });
+    return;
+  }
+  // Grow by a half at least, so that the KB is copied O(log(n)) times while n items are added.
+  const size_t nNewStride = bTargetsFit ? nTargStride : std::max(
+    CEKBArena<taNumber>::CalcTargStride(SRCast::ToSizeT(nTargets)),
+    CEKBArena<taNumber>::CalcTargStride(nTargStride + nTargStride / 2));
+  const size_t nNewQuestCap = (nNewQuestions <= nQuestCap) ? nQuestCap
+    : std::max(nNewQuestions, nQuestCap + nQuestCap / 2);
+
+  CEKBArena<taNumber> *const pKBs[2] = { &_kb, &_kbMirror };
+  const size_t nKBs = (_kbEpochs.IsEnabled() ? 2 : 1);
+  // Allocate all the instances first, so that a failure leaves the KB intact.
+  CEKBArena<taNumber> grown[2];
+  for (size_t i = 0; i < nKBs; i++) {
+    grown[i].AllocateCapacity(nNewQuestions, nNewQuestCap, _kb.GetNAnswers(), nNewStride, _kb.IsTiledA(),
+      _kb.IsLargePages(), _kb.HasInvD());
+  }
+  const taNumber gapItem(1);
+  for (size_t i = 0; i < nKBs; i++) {
+    grown[i].CopyGrown(*pKBs[i]);
+    // The new items of the rows are gaps until the targets are added there.
+    grown[i].InitTargets(nTargStride, nNewStride, gapItem, gapItem, gapItem);
+    pKBs[i]->TakeFrom(grown[i]);
+  }
+  CELOG(Info) << "Grew the KB to the capacity of " << nNewQuestCap << " questions and " << nNewStride
+    << " items in a row of targets.";
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedOnDimsChanged() {
+  _nReshapes++;
+  SRLock<SRCriticalSection> csl(_csCheckpoint);
+  _dirtyPages.Stop();
+  _checkpointPath.clear();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::AddQuestions(TPqaId nQuestions, AddQuestionParam *pAqps) {
-  (void)nQuestions; (void)pAqps; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::AddQuestions")));
+  if (nQuestions < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
+      SR_FILE_LINE "|nQuestions| must be non-negative."));
+  }
+  for (TPqaId i = 0; i < nQuestions; i++) {
+    if (pAqps[i]._initialAmount <= 0) {
+      return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(pAqps[i]._initialAmount),
+        SRString::MakeUnowned(SR_FILE_LINE "The initial amount of a question must be positive."));
+    }
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (add questions) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    if (_kb.IsReadOnly()) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+    CEKBVersion::Change kbvc(_kbVersion);
+    // The gaps are reused first, then the questions are appended.
+    const TPqaId nAppended = std::max<TPqaId>(0, nQuestions - _questionGaps.GetNGaps());
+    LockedReserveKB(_dims._nQuestions + nAppended, _dims._nTargets);
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      const TPqaId iQuestion = _questionGaps.Acquire();
+      pAqps[i]._iQuestion = iQuestion;
+      // The same as the initial weights of the KB in the constructor.
+      const taNumber initSqr = taNumber(pAqps[i]._initialAmount).Sqr();
+      const taNumber initMD = initSqr * _dims._nAnswers;
+      LockedForEachKB([&](CEKBArena<taNumber> &kb) {
+        kb.InitQuestion(SRCast::ToSizeT(iQuestion), initSqr, initMD);
+      });
+    }
+    _dims._nQuestions += nAppended;
+    LockedOnDimsChanged();
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::AddTargets(TPqaId nTargets, AddTargetParam *pAtps) {
-  (void)nTargets; (void)pAtps; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::AddTargets")));
+  if (nTargets < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nTargets), SRString::MakeUnowned(
+      SR_FILE_LINE "|nTargets| must be non-negative."));
+  }
+  for (TPqaId i = 0; i < nTargets; i++) {
+    if (pAtps[i]._initialAmount <= 0) {
+      return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(pAtps[i]._initialAmount),
+        SRString::MakeUnowned(SR_FILE_LINE "The initial amount of a target must be positive."));
+    }
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (add targets) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    if (_kb.IsReadOnly()) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+    CEKBVersion::Change kbvc(_kbVersion);
+    // The gaps are reused first, then the targets are appended, usually into the spare items of the rows.
+    const TPqaId nAppended = std::max<TPqaId>(0, nTargets - _targetGaps.GetNGaps());
+    LockedReserveKB(_dims._nQuestions, _dims._nTargets + nAppended);
+    for (TPqaId i = 0; i < nTargets; i++) {
+      const TPqaId iTarget = _targetGaps.Acquire();
+      pAtps[i]._iTarget = iTarget;
+      // The same as the initial weights of the KB in the constructor.
+      const taNumber init1(pAtps[i]._initialAmount);
+      const taNumber initSqr = taNumber(init1).Sqr();
+      const taNumber initMD = initSqr * _dims._nAnswers;
+      const size_t iTarg = SRCast::ToSizeT(iTarget);
+      LockedForEachKB([&](CEKBArena<taNumber> &kb) { kb.InitTargets(iTarg, iTarg + 1, initSqr, initMD, init1); });
+    }
+    _dims._nTargets += nAppended;
+    LockedOnDimsChanged();
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::RemoveQuestions(const TPqaId nQuestions, const TPqaId *pQIds)
 {
-  (void)nQuestions; (void)pQIds; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::RemoveQuestions")));
+  if (nQuestions < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
+      SR_FILE_LINE "|nQuestions| must be non-negative."));
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (remove questions) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // Validate all the ids before removing any, so that a failure leaves the KB intact.
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      const TPqaId iQuestion = pQIds[i];
+      if (iQuestion < 0 || iQuestion >= _dims._nQuestions) {
+        const TPqaId nKB = _dims._nQuestions;
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iQuestion, 0, nKB - 1),
+          SRString::MakeUnowned(SR_FILE_LINE "Question index is not in KB range."));
+      }
+      if (_questionGaps.IsGap(iQuestion)) {
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iQuestion), SRString::MakeUnowned(
+          SR_FILE_LINE "Question index is not in KB (but rather at a gap)."));
+      }
+    }
+    // The weights stay in the KB until it's compacted. A repeated id is removed once.
+    CEKBVersion::Change kbvc(_kbVersion);
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      if (!_questionGaps.IsGap(pQIds[i])) {
+        _questionGaps.Release(pQIds[i]);
+      }
+    }
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::RemoveTargets(const TPqaId nTargets, const TPqaId *pTIds) {
-  (void)nTargets; (void)pTIds; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::RemoveTargets")));
+  if (nTargets < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nTargets), SRString::MakeUnowned(
+      SR_FILE_LINE "|nTargets| must be non-negative."));
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (remove targets) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // Validate all the ids before removing any, so that a failure leaves the KB intact.
+    for (TPqaId i = 0; i < nTargets; i++) {
+      const TPqaId iTarget = pTIds[i];
+      if (iTarget < 0 || iTarget >= _dims._nTargets) {
+        const TPqaId nKB = _dims._nTargets;
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iTarget, 0, nKB - 1),
+          SRString::MakeUnowned(SR_FILE_LINE "Target index is not in KB range."));
+      }
+      if (_targetGaps.IsGap(iTarget)) {
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iTarget), SRString::MakeUnowned(
+          SR_FILE_LINE "Target index is not in KB (but rather at a gap)."));
+      }
+    }
+    // The weights stay in the KB until it's compacted. A repeated id is removed once.
+    CEKBVersion::Change kbvc(_kbVersion);
+    for (TPqaId i = 0; i < nTargets; i++) {
+      if (!_targetGaps.IsGap(pTIds[i])) {
+        _targetGaps.Release(pTIds[i]);
+      }
+    }
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+template<typename taNumber> void CpuEngine<taNumber>::LockedCompactKB(CEKBArena<taNumber> &kb,
+  const CompactionResult &cr, const size_t iFirstMovedQuestion, const size_t iFirstMovedTarget)
+{
+  const size_t nQuestions = SRCast::ToSizeT(cr._nQuestions);
+  const size_t nTargets = SRCast::ToSizeT(cr._nTargets);
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(_nMemOpThreads * SRMaxSizeof<CECompactKBSubtaskTargets<taNumber>,
+    CECompactKBSubtaskQuestions<taNumber>>::value, SRMemPadding::None, mtCommon);
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+
+  CECompactKBTask<taNumber> task(*this, kb, nQuestions, cr._pOldQuestions, iFirstMovedQuestion, nTargets,
+    cr._pOldTargets, iFirstMovedTarget);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+  if (iFirstMovedTarget < nTargets) {
+    const size_t nRows = nQuestions * (kb.GetNAnswers() + 1) + 1;
+    pr.SplitAndRunSubtasks<CECompactKBSubtaskTargets<taNumber>>(task, nRows, _nMemOpThreads);
+  }
+  // The questions are moved after all the targets are gathered, because a stripe of vectors crosses the rows.
+  if (iFirstMovedQuestion < nQuestions) {
+    const size_t nTargVects = SRSimd::VectsFromComps<taNumber>(nTargets);
+    pr.SplitAndRunSubtasks<CECompactKBSubtaskQuestions<taNumber>>(task, nTargVects, _nMemOpThreads);
+  }
+  kb.ShrinkQuestions(nQuestions);
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::Compact(CompactionResult &cr) {
-  (void)cr; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::Compact")));
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (compact) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    if (_kb.IsReadOnly() && (_questionGaps.HasGaps() || _targetGaps.HasGaps())) {
+      rwl.EarlyRelease();
+      return MakeReadOnlyError();
+    }
+    const TPqaId nQuestions = _dims._nQuestions - _questionGaps.GetNGaps();
+    const TPqaId nTargets = _dims._nTargets - _targetGaps.GetNGaps();
+    SRSmartMPP<TPqaId> oldQuestions(_memPool, CompactionMapItems(nQuestions));
+    SRSmartMPP<TPqaId> oldTargets(_memPool, CompactionMapItems(nTargets));
+    const size_t iFirstMovedQuestion = FillOldIds(_dims._nQuestions, _questionGaps, oldQuestions.Get());
+    const size_t iFirstMovedTarget = FillOldIds(_dims._nTargets, _targetGaps, oldTargets.Get());
+
+    CompactionResult res;
+    res._nQuestions = nQuestions;
+    res._nTargets = nTargets;
+    res._pOldQuestions = oldQuestions.Get();
+    res._pOldTargets = oldTargets.Get();
+    if (nQuestions != _dims._nQuestions || nTargets != _dims._nTargets) {
+      CEKBVersion::Change kbvc(_kbVersion);
+      LockedForEachKB([&](CEKBArena<taNumber> &kb) {
+        LockedCompactKB(kb, res, iFirstMovedQuestion, iFirstMovedTarget);
+      });
+      _questionGaps.Compact(nQuestions);
+      _targetGaps.Compact(nTargets);
+      CELOG(Info) << "Compacted the KB from " << _dims._nQuestions << " to " << nQuestions << " questions and from "
+        << _dims._nTargets << " to " << nTargets << " targets.";
+      _dims._nQuestions = nQuestions;
+      _dims._nTargets = nTargets;
+      LockedOnDimsChanged();
+    }
+    oldQuestions.Detach();
+    oldTargets.Detach();
+    cr = res;
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
 }
 
 template<typename taNumber> PqaError CpuEngine<taNumber>::ReleaseCompactionResult(CompactionResult &cr) {
-  (void)cr; //TODO: remove when implemented
-  return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
-    "CpuEngine<taNumber>::ReleaseCompactionResult")));
+  _memPool.ReleaseMem(cr._pOldQuestions, CompactionMapItems(cr._nQuestions) * sizeof(TPqaId));
+  _memPool.ReleaseMem(cr._pOldTargets, CompactionMapItems(cr._nTargets) * sizeof(TPqaId));
+  cr._pOldQuestions = cr._pOldTargets = nullptr;
+  cr._nQuestions = cr._nTargets = 0;
+  return PqaError();
 }
 
 //// Instantiations
 template class CpuEngine<SRDoubleNumber>;
+template class CpuEngine<SRFloatNumber>;
 
 } // namespace ProbQA
@@ -9,6 +9,12 @@
 #include "../PqaCore/CECreateQuizOperation.fwd.h"
 
 #include "../PqaCore/KBFileInfo.h"
+#include "../PqaCore/CEKBArena.h"
+#include "../PqaCore/CEKBDirtyPages.h"
+#include "../PqaCore/CEKBEpochs.h"
+#include "../PqaCore/CEKBVersion.h"
+#include "../PqaCore/CENextQsCache.h"
+#include "../PqaCore/CETrainJournal.h"
 #include "../PqaCore/BaseCpuEngine.h"
 #include "../PqaCore/CENormPriorsTask.h"
 #include "../PqaCore/CENormPriorsSubtaskMax.h"
@@ -19,6 +25,8 @@ namespace ProbQA {
 
 // So long as it's data-only structure, it doesn't need fwd/decl/impl header design.
 template<typename taNumber> class CETrainTaskNumSpec;
+template<typename taNumber> class CESaveKBJob;
+template<typename taNumber> class CERecomputeDJob;
 
 template<typename taNumber> class CpuEngine : public BaseCpuEngine {
   static_assert(std::is_base_of<SRPlat::SRRealNumber, taNumber>::value, "taNumber must a PqaNumber subclass.");
@@ -28,25 +36,77 @@ public: // constants
     CENormPriorsSubtaskCorrSum<taNumber>, CEDivTargPriorsSubtask<CENormPriorsTask<taNumber>>>::value,
     SRPlat::SRBucketSummatorPar<taNumber>::_cSubtaskMemReq });
 
+private: // types
+  // The parts of a KB file besides the weights, taken under the KB lock so that they can be written without it.
+  struct KBFileExtras {
+    KBFileDirectory _dir;
+    std::vector<uint64_t> _questionGaps;
+    std::vector<uint64_t> _targetGaps;
+    uint64_t _nQuestionsAsked;
+    uint64_t _nTrainings;
+  };
+
 private: // variables
   //// N questions, K answers, M targets
 
-  // space A: [iQuestion][iAnswer][iTarget] . Guarded by _rws
-  std::vector<std::vector<SRPlat::SRFastArray<taNumber, false>>> _sA;
-  // matrix D: [iQuestion][iTarget] . Guarded by _rws
-  std::vector<SRPlat::SRFastArray<taNumber, false>> _mD;
-  // vector B: [iTarget] . Guarded by _rws
-  SRPlat::SRFastArray<taNumber, false> _vB;
+  // Space A: [iQuestion][iAnswer][iTarget] , matrix D: [iQuestion][iTarget] and vector B: [iTarget] in a single
+  //   contiguous SIMD-aligned allocation, with the spare capacity for the questions and targets added in maintenance
+  //   mode. Guarded by _rws
+  CEKBArena<taNumber> _kb;
+  // In the epoch mode, the second instance of the KB, equal to _kb except during a training. Guarded by _rws
+  CEKBArena<taNumber> _kbMirror;
+  // The instance of the KB for the readers: _kb , or in the epoch mode either instance. The readers in the epoch mode
+  //   pin _kbEpochs instead of locking _rws .
+  std::atomic<CEKBArena<taNumber>*> _pReadKB;
+  // The instance of the KB that the trainings update, which is the other one in the epoch mode. Guarded by _rws
+  CEKBArena<taNumber> *_pWriteKB;
+  CEKBEpochs _kbEpochs;
+  // The pages of the KB weights changed since the last save. Marked under the exclusive _rws, reset under the shared
+  //   _rws together with _csCheckpoint.
+  CEKBDirtyPages _dirtyPages;
+  // Serializes the saves, which reset _dirtyPages. Obtained after _rws.
+  SRPlat::SRCriticalSection _csCheckpoint;
+  // The file of the last save, against which _dirtyPages are tracked. Guarded by _csCheckpoint.
+  std::string _checkpointPath;
+  // The number of trainings applied to the KB, which numbers the records in the journal. Guarded by _rws
+  uint64_t _nTrainings = 0;
+  // The number of changes of the dimensions of the KB, so that the background jobs notice the weights moved or
+  //   reinitialized between their locks. Guarded by _rws
+  uint64_t _nReshapes = 0;
+  // Open if EngineDefinition::_journalPath is given. Thread-safe itself.
+  CETrainJournal _journal;
+  // Changes around each change of the weights or the dimensions of the KB, under the exclusive _rws .
+  CEKBVersion _kbVersion;
+  // Thread-safe itself.
+  CENextQsCache _nextQsCache;
 
   std::vector<CEQuiz<taNumber>*> _quizzes; // Guarded by _csQuizReg
 
 private: // methods
 
   static size_t CalcWorkerStackSize(const EngineDefinition& engDef);
+  // Called by the maintenance switch when no operation is in progress, to enlarge the stacks of the workers if the
+  //   current dimensions need more.
+  static void AdjustWorkerStacks(void *pEngine);
+
+  // Fill the KB with the initial values, in parallel on the workers.
+  void InitKB(const taNumber initA, const taNumber initD, const taNumber initB);
+  // Compute the table of 1/D from matrix D, in parallel on the workers.
+  void InitInvD();
+  // Read or write the weights at the given offsets of a KB file having |nFileRowItems| items in a row of targets, in
+  //   parallel on _nMemOpThreads workers.
+  PqaError TransferKBFile(CEKBArena<taNumber> &kb, const SRPlat::SRPositionalFile &file, const char* const filePath,
+    const uint64_t offsA, const uint64_t offsD, const uint64_t offsB, const size_t nFileRowItems, const bool bWrite);
+  // Decode the compressed weights of a KB file in parallel on the workers. Throws on failure.
+  void ReadCodedKB(const KBFileInfo &kbFi);
+  // Read the gaps and the counter of questions asked from the sections of a KB file, if it has them. Throws on failure.
+  void ReadSectionedExtras(const KBFileInfo &kbFi);
+  // Apply the records of the journal newer than the KB, then open the journal for appending. Throws on failure.
+  void ReplayJournal(const char* const journalPath);
 
 #pragma region Behind Train() interface method
   PqaError TrainInternal(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget,
-    const TPqaAmount amount);
+    const TPqaAmount amount, const CETrainJournal::RecordKind kind);
 #pragma endregion
 
 #pragma region Behind StartQuiz() and ResumeQuiz() currently. May be needed by something else.
@@ -54,23 +114,105 @@ private: // methods
 #pragma endregion
 
   CEQuiz<taNumber>* UseQuiz(PqaError& err, const TPqaId iQuiz);
-
-  PqaError LockedSaveKB(SRPlat::SRSmartFile &sf, const bool bDoubleBuffer, const char* const filePath);
+  // Evaluate the questions for |quiz| and select one at random by their priorities. Unless |kbVersion| is
+  //   CEKBVersion::_cNone , cache the distribution of the priorities if the KB is still of that version.
+  TPqaId EvalNextQuestion(const CEQuiz<taNumber> &quiz, const uint64_t kbVersion);
+  // The error for the attempts to train or grow a read-only mapped KB.
+  static PqaError MakeReadOnlyError();
+
+  void LockedTakeExtras(KBFileExtras &extras);
+  // Copy the weights into a row-major arena over the memory of _kb.GetNBytes(), in parallel on _nMemOpThreads workers.
+  void LockedSnapshotKB(CEKBArena<taNumber> &snapshot);
+  // Write the weights of |kb|, which is either _kb or its snapshot, and the extras taken along with them.
+  PqaError WriteKBFile(const SRPlat::SRPositionalFile &file, const char* const filePath, CEKBArena<taNumber> &kb,
+    const KBFileExtras &extras);
+  PqaError WriteKBExtras(const SRPlat::SRPositionalFile &file, const char* const filePath,
+    const KBFileExtras &extras);
+  // Encode the weights of |kb| in parallel on the workers, and write them with the extras, which get the directory of a
+  //   compressed file.
+  PqaError WriteCodedKBFile(const SRPlat::SRPositionalFile &file, const char* const filePath,
+    const CEKBArena<taNumber> &kb, KBFileExtras &extras);
+  // Write the directory, the index of the blocks and the extras, once the encoded blocks are written.
+  PqaError FinishCodedKBFile(const SRPlat::SRPositionalFile &file, const char* const filePath, KBFileExtras &extras,
+    const uint64_t nRowsPerBlock, const std::vector<uint64_t> &blockEnds);
+  PqaError LockedSaveKB(const SRPlat::SRPositionalFile &file, const char* const filePath, const bool bCompress);
+  // Write the snapshot of an asynchronous save on the I/O thread, plainly or compressed, in chunks so that |job| can
+  //   be cancelled.
+  PqaError StreamKBFile(CESaveKBJob<taNumber> &job, const SRPlat::SRPositionalFile &file,
+    const CEKBArena<taNumber> &snapshot, const KBFileExtras &extras);
+  PqaError StreamCodedKBFile(CESaveKBJob<taNumber> &job, const SRPlat::SRPositionalFile &file,
+    const CEKBArena<taNumber> &snapshot, KBFileExtras &extras);
+  // In the epoch mode, publish the instance of the KB just trained, wait for the grace period of the readers of the
+  //   other instance, then bring the other instance up to date and make it the one to train next.
+  void LockedPublishTrained(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget);
+  // The same for any update, where |fCatchUp(prev, updated)| brings the previous instance up to date.
+  template<typename taFunc> void LockedPublish(const taFunc &fCatchUp) {
+    if (!_kbEpochs.IsEnabled()) {
+      return;
+    }
+    CEKBArena<taNumber> *const pPrev = _pReadKB.load(std::memory_order_relaxed);
+    _pReadKB.store(_pWriteKB, std::memory_order_seq_cst);
+    _kbEpochs.Synchronize();
+    // Now no reader uses the previous instance, so it can catch up with the update.
+    fCatchUp(*pPrev, static_cast<const CEKBArena<taNumber>&>(*_pWriteKB));
+    _pWriteKB = pPrev;
+  }
+  // Sum cube A over the answers into |pSums| for the questions [iFirst;iLimit) with compensated summation, in parallel
+  //   on the workers.
+  void SumD(const CEKBArena<taNumber> &kb, const size_t iFirst, const size_t iLimit, double *pSums);
+  // Write the sums into the rows of D and 1/D of the items that aren't gaps, and accumulate the number of items
+  //   changed and the maximum relative drift corrected.
+  void LockedApplyD(const size_t iFirst, const size_t iLimit, const double *pSums, uint64_t &nCorrected,
+    double &maxRelDrift);
+  // Make room in both instances of the KB for |nQuestions| questions and |nTargets| targets. The capacity grows
+  //   geometrically, so that adding the items one by one takes amortized O(N*K) or O(K*M) time per item. The weights of
+  //   the new items are left for the caller to initialize. Throws on allocation failure, leaving the KB intact.
+  void LockedReserveKB(const TPqaId nQuestions, const TPqaId nTargets);
+  // The saved file can't be patched anymore once the dimensions of the KB change.
+  void LockedOnDimsChanged();
+  // Call |f(kb)| for each instance of the KB: _kb , and _kbMirror in the epoch mode. The caller must hold _rws .
+  template<typename taFunc> void LockedForEachKB(const taFunc &f) {
+    f(_kb);
+    if (_kbEpochs.IsEnabled()) {
+      f(_kbMirror);
+    }
+  }
+  // Gather the weights of |kb| to the new ids of |cr| in place, in parallel on _nMemOpThreads workers.
+  void LockedCompactKB(CEKBArena<taNumber> &kb, const CompactionResult &cr, const size_t iFirstMovedQuestion,
+    const size_t iFirstMovedTarget);
+  // Mark the pages of the KB changed by training the given answered questions for the target.
+  void LockedMarkTrained(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget);
+  // Rewrite the dirty pages, the gaps and the counter of questions asked in the file of the last save, if its layout
+  //   is the same as the KB's. Sets |bPatched| to false if the file must be rewritten as a whole instead.
+  PqaError LockedPatchKB(const SRPlat::SRPositionalFile &file, const char* const filePath, bool &bPatched,
+    uint64_t &nPagesWritten);
 
 public: // Internal interface methods
 
+  //// The cells of the instance of the KB that the trainings update. The caller must hold _rws .
   const taNumber& GetA(const TPqaId iQuestion, const TPqaId iAnswer, const TPqaId iTarget) const;
   taNumber& ModA(const TPqaId iQuestion, const TPqaId iAnswer, const TPqaId iTarget);
   
   const taNumber& GetD(const TPqaId iQuestion, const TPqaId iTarget) const;
   taNumber& ModD(const TPqaId iQuestion, const TPqaId iTarget);
+  // Only if GetKB().HasInvD()
+  taNumber& ModInvD(const TPqaId iQuestion, const TPqaId iTarget);
 
   const taNumber& GetB(const TPqaId iTarget) const;
   taNumber& ModB(const TPqaId iTarget);
 
+  // The instance of the KB for the readers, which doesn't change while the caller holds a CEKBReadGuard .
+  const CEKBArena<taNumber>& GetKB() const;
+  CEKBEpochs& GetKBEpochs() { return _kbEpochs; }
+
   PqaError NormalizePriors(CEQuiz<taNumber> &quiz, SRPlat::SRPoolRunner &pr,
     const SRPlat::SRPoolRunner::Split& targSplit);
 
+  // The body of SaveKBAsync() on the I/O thread of |job|. Leaves the maintenance switch entered by SaveKBAsync().
+  PqaError RunSaveKBJob(CESaveKBJob<taNumber> &job);
+  // The body of RecomputeDAsync() on the thread of |job|. Leaves the maintenance switch entered by RecomputeDAsync().
+  PqaError RunRecomputeDJob(CERecomputeDJob<taNumber> &job);
+
 public: // Client interface methods
   explicit CpuEngine(const EngineDefinition& engDef, KBFileInfo *pKbFi);
   virtual ~CpuEngine() override final;
@@ -89,8 +231,14 @@ public: // Client interface methods
   virtual PqaError ReleaseQuiz(const TPqaId iQuiz) override final;
 
 
-  virtual PqaError SaveKB(const char* const filePath, const bool bDoubleBuffer) override final;
+  virtual PqaError SaveKB(const char* const filePath, const bool bDoubleBuffer, const bool bCompress = false)
+    override final;
+  virtual PqaError SaveKBIncremental(const char* const filePath) override final;
+  virtual IPqaSaveKBJob* SaveKBAsync(PqaError& err, const char* const filePath, const SaveKBOptions &options)
+    override final;
+  virtual IPqaRecomputeDJob* RecomputeDAsync(PqaError& err, const RecomputeDOptions &options) override final;
   virtual uint64_t GetTotalQuestionsAsked(PqaError& err) override final;
+  virtual PqaError GetStats(EngineStats &stats) override final;
 
   virtual PqaError StartMaintenance(const bool forceQuizes) override final;
   virtual PqaError FinishMaintenance() override final;
@@ -10,29 +10,41 @@ namespace ProbQA {
 
 template<typename taNumber> inline const taNumber&
 CpuEngine<taNumber>::GetA(const TPqaId iQuestion, const TPqaId iAnswer, const TPqaId iTarget) const {
-  return _sA[SRPlat::SRCast::ToSizeT(iQuestion)][SRPlat::SRCast::ToSizeT(iAnswer)][SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->GetA(SRPlat::SRCast::ToSizeT(iQuestion), SRPlat::SRCast::ToSizeT(iAnswer),
+    SRPlat::SRCast::ToSizeT(iTarget));
 }
 template<typename taNumber> inline taNumber&
 CpuEngine<taNumber>::ModA(const TPqaId iQuestion, const TPqaId iAnswer, const TPqaId iTarget) {
-  return _sA[SRPlat::SRCast::ToSizeT(iQuestion)][SRPlat::SRCast::ToSizeT(iAnswer)][SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->ModA(SRPlat::SRCast::ToSizeT(iQuestion), SRPlat::SRCast::ToSizeT(iAnswer),
+    SRPlat::SRCast::ToSizeT(iTarget));
 }
 
 template<typename taNumber> inline const taNumber&
 CpuEngine<taNumber>::GetD(const TPqaId iQuestion, const TPqaId iTarget) const {
-  return _mD[SRPlat::SRCast::ToSizeT(iQuestion)][SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->GetD(SRPlat::SRCast::ToSizeT(iQuestion))[SRPlat::SRCast::ToSizeT(iTarget)];
 }
 template<typename taNumber> inline taNumber&
 CpuEngine<taNumber>::ModD(const TPqaId iQuestion, const TPqaId iTarget) {
-  return _mD[SRPlat::SRCast::ToSizeT(iQuestion)][SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->ModD(SRPlat::SRCast::ToSizeT(iQuestion))[SRPlat::SRCast::ToSizeT(iTarget)];
+}
+
+template<typename taNumber> inline taNumber&
+CpuEngine<taNumber>::ModInvD(const TPqaId iQuestion, const TPqaId iTarget) {
+  return _pWriteKB->ModInvD(SRPlat::SRCast::ToSizeT(iQuestion))[SRPlat::SRCast::ToSizeT(iTarget)];
 }
 
 template<typename taNumber> inline const taNumber&
 CpuEngine<taNumber>::GetB(const TPqaId iTarget) const {
-  return _vB[SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->GetB()[SRPlat::SRCast::ToSizeT(iTarget)];
 }
 template<typename taNumber> inline taNumber&
 CpuEngine<taNumber>::ModB(const TPqaId iTarget) {
-  return _vB[SRPlat::SRCast::ToSizeT(iTarget)];
+  return _pWriteKB->ModB()[SRPlat::SRCast::ToSizeT(iTarget)];
+}
+
+template<typename taNumber> inline const CEKBArena<taNumber>& CpuEngine<taNumber>::GetKB() const {
+  // Ordered after the pin of the epoch, as the left-right scheme requires.
+  return *_pReadKB.load(std::memory_order_seq_cst);
 }
 
 } // namespace ProbQA
@@ -18,6 +18,12 @@ public:
 
   // Get |iQuad|th 4 adjacent bits denoting gaps.
   uint8_t GetQuad(const taId iQuad) const { return _isGap.GetQuad(iQuad); }
+  // Get the bits of |iQuad|th quad and, if |bPair|, of the next quad in the high half, e.g. for an AVX-512 mask.
+  uint8_t GetQuadPair(const taId iQuad, const bool bPair) const {
+    return static_cast<uint8_t>(GetQuad(iQuad) | (bPair ? (GetQuad(iQuad + 1) << 4) : 0));
+  }
+  // Get |iOctet|th 8 adjacent bits denoting gaps.
+  uint8_t GetOctet(const taId iOctet) const { return _isGap.GetPacked<uint8_t>(iOctet); }
 
   template<typename taResult> const taResult& GetPacked(const taId iPack) const {
     return _isGap.GetPacked<taResult>(iPack);
@@ -7,6 +7,8 @@
 #include "../PqaCore/Interface/PqaErrors.h"
 #include "../PqaCore/Interface/PqaCommon.h"
 #include "../PqaCore/Interface/PqaCore.h"
+#include "../PqaCore/Interface/IPqaSaveKBJob.h"
+#include "../PqaCore/Interface/IPqaRecomputeDJob.h"
 
 namespace ProbQA {
 
@@ -46,10 +48,30 @@ public:
   // Save the knowledge base, but not the quizes in progress.
   // Double buffer uses as much additional memory as the size of the KB, but reduces KB lock duration because the KB
   //   is only locked for the period of copying in memory to the buffer, then saving to disk proceeds without a lock.
-  virtual PqaError SaveKB(const char* const filePath, const bool bDoubleBuffer) = 0;
+  // Compression makes the file smaller, especially when much of the KB is untrained, at the cost of encoding it on the
+  //   workers. A compressed file can't be memory-mapped, nor patched by SaveKBIncremental().
+  virtual PqaError SaveKB(const char* const filePath, const bool bDoubleBuffer, const bool bCompress = false) = 0;
+  // Save the knowledge base by rewriting in place only the parts changed since the last save, if that save was to the
+  //   same file and the dimensions of the KB haven't changed since then. Otherwise saves the whole KB.
+  virtual PqaError SaveKBIncremental(const char* const filePath) = 0;
+  // Start saving the knowledge base on a dedicated I/O thread rather than on the workers, and return the handle to
+  //   poll, wait for or cancel the save. The KB is locked only for copying it to a buffer, like with double buffer in
+  //   SaveKB(). The caller must delete the handle. Shutdown() waits for the saves in progress to finish.
+  // Returns nullptr on error.
+  virtual IPqaSaveKBJob* SaveKBAsync(PqaError& err, const char* const filePath,
+    const SaveKBOptions &options = SaveKBOptions()) = 0;
+  // Start recomputing matrix D from cube A with compensated summation, chunk by chunk driven by a dedicated thread, to
+  //   correct the drift accumulated by the trainings. A chunk is summed on the workers under the shared KB lock, and
+  //   then written under the exclusive lock. The caller must delete the handle. Shutdown() and the switches of the mode wait for the
+  //   recomputation in progress to finish.
+  // Returns nullptr on error.
+  virtual IPqaRecomputeDJob* RecomputeDAsync(PqaError& err,
+    const RecomputeDOptions &options = RecomputeDOptions()) = 0;
 
   // Statistics method, especially useful for charging.
   virtual uint64_t GetTotalQuestionsAsked(PqaError& err) = 0;
+  // Fill in the statistics about the engine and the resources it has obtained.
+  virtual PqaError GetStats(EngineStats &stats) = 0;
   // Get engine dimensions: the number of questions, answers and targets
   virtual const EngineDimensions& GetDims() const = 0;
 
@@ -65,12 +87,17 @@ public:
   ////   target probabilities may change without this question answered.
   //// Removal of a target requires recomputation of all target probabilities in each quiz, so this is also undesired
   ////   to keep the engine fast.
+  // The ids of the new questions and targets reuse the gaps first. The KB keeps spare capacity for the new items, so
+  //   adding them one by one takes amortized time proportional to a row of the KB per item. The training journal
+  //   doesn't record the additions, so the KB should be saved after them.
   virtual PqaError AddQuestions(TPqaId nQuestions, AddQuestionParam *pAqps) = 0;
   virtual PqaError AddTargets(TPqaId nTargets, AddTargetParam *pAtps) = 0;
+  // The removed questions and targets become gaps, which keep their weights in the KB until it's compacted.
   virtual PqaError RemoveQuestions(const TPqaId nQuestions, const TPqaId *pQIds) = 0;
   virtual PqaError RemoveTargets(const TPqaId nTargets, const TPqaId *pTIds) = 0;
 
-  // Compacts questions and targets so that there are no gaps.
+  // Compacts questions and targets so that there are no gaps. The KB is compacted in place, keeping its spare capacity.
+  //   As with the additions, the training journal doesn't record the compaction, so the KB should be saved after it.
   // Fills the CompactionResult structure passed in. A call to ReleaseCompactionResult() is needed to release the
   //   resources after usage of the structure.
   //TODO: make this obligatory before exiting the maintenance mode? So to forbid gaps in regular mode.
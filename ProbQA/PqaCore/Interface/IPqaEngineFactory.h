@@ -15,7 +15,9 @@ class PQACORE_API IPqaEngineFactory {
 public:
   // Usual computing on a CPU.
   virtual IPqaEngine* CreateCpuEngine(PqaError& err, const EngineDefinition& engDef) = 0;
-  virtual IPqaEngine* LoadCpuEngine(PqaError& err, const char* const filePath) = 0;
+  // Usual computing on a CPU, with the KB and its dimensions read from a file.
+  virtual IPqaEngine* LoadCpuEngine(PqaError& err, const char* const filePath,
+    const LoadKBOptions& options = LoadKBOptions()) = 0;
 
   // Computing on a graphics card with CUDA technology.
   virtual IPqaEngine* CreateCudaEngine(PqaError& err, const EngineDefinition& engDef) = 0;
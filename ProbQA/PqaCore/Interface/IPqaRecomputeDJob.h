@@ -0,0 +1,30 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaErrors.h"
+#include "../PqaCore/Interface/PqaCommon.h"
+#include "../PqaCore/Interface/PqaCore.h"
+
+namespace ProbQA {
+
+// The handle of a recomputation of matrix D running in background, returned by IPqaEngine::RecomputeDAsync(). The
+//   methods are thread-safe. Deleting the handle waits for the recomputation to finish, so cancel it first to return
+//   sooner.
+class PQACORE_API IPqaRecomputeDJob {
+public:
+  virtual ~IPqaRecomputeDJob() { }
+
+  virtual void GetProgress(RecomputeDProgress &progress) = 0;
+  // Returns |true| if the recomputation has finished within the timeout, successfully or not.
+  virtual bool Wait(const uint32_t timeoutMiS = INFINITE) = 0;
+  // Request to stop after the current chunk. The recomputation then finishes with PqaErrorCode::Cancelled , and the
+  //   chunks already done stay corrected. It has no effect if the recomputation has already finished.
+  virtual void Cancel() = 0;
+  // Returns the outcome of the recomputation once it has finished, or an error if it's still in progress.
+  virtual PqaError TakeResult() = 0;
+};
+
+} // namespace ProbQA
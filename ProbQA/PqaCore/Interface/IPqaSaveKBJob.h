@@ -0,0 +1,29 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaErrors.h"
+#include "../PqaCore/Interface/PqaCommon.h"
+#include "../PqaCore/Interface/PqaCore.h"
+
+namespace ProbQA {
+
+// The handle of a save of the KB running in background, returned by IPqaEngine::SaveKBAsync(). The methods are
+//   thread-safe. Deleting the handle waits for the save to finish, so cancel it first to return sooner.
+class PQACORE_API IPqaSaveKBJob {
+public:
+  virtual ~IPqaSaveKBJob() { }
+
+  virtual void GetProgress(SaveKBProgress &progress) = 0;
+  // Returns |true| if the save has finished within the timeout, successfully or not.
+  virtual bool Wait(const uint32_t timeoutMiS = INFINITE) = 0;
+  // Request to stop writing the file as soon as possible. The save then finishes with PqaErrorCode::Cancelled , and
+  //   the file is left incomplete. It has no effect if the save has already finished.
+  virtual void Cancel() = 0;
+  // Returns the outcome of the save once it has finished, or an error if it's still in progress.
+  virtual PqaError TakeResult() = 0;
+};
+
+} // namespace ProbQA
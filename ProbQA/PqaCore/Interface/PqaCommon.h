@@ -5,6 +5,7 @@
 #pragma once
 
 #include "../PqaCore/Interface/PqaCore.h"
+#include "../SRPlatform/Interface/SRCpuInfo.h"
 
 namespace ProbQA {
 
@@ -31,6 +32,17 @@ struct PrecisionDefinition {
   uint64_t _reserved : 16;
 };
 
+// How LoadCpuEngine() brings the KB into memory.
+enum class TPqaKBMapping : uint8_t {
+  // Read the KB file into memory allocated for the engine.
+  None = 0,
+  // Map the KB file into memory, so that the pages are loaded on demand and shared among the processes. Training
+  //   modifies the pages privately to the process, never writing them to the file.
+  CopyOnWrite = 1,
+  // Map the KB file into memory as above, and refuse training.
+  ReadOnly = 2
+};
+
 struct EngineDimensions {
   TPqaId _nAnswers;
   TPqaId _nQuestions;
@@ -42,6 +54,126 @@ struct EngineDefinition {
   PrecisionDefinition _prec;
   TPqaAmount _initAmount = 1;
   size_t _memPoolMaxBytes = 512 * 1024 * 1024;
+  // Store cube A as [iQuestion][targetTile][iAnswer][targetInTile] so that NextQuestion() processes all the answers of
+  //   a tile of targets while the priors are in L1 cache.
+  bool _tiledA = false;
+  // Back the KB and the large memory pool allocations with large (huge) pages, so to reduce TLB misses. Quietly falls
+  //   back to regular pages if large pages are not available: see EngineStats for what was actually obtained.
+  bool _largePages = false;
+  // Distribute the workers among NUMA nodes and partition the targets of the KB and quizzes by the nodes, so that the
+  //   workers mostly access the memory of their own node. Note that large pages are placed at allocation rather than
+  //   at first touch, so they don't benefit from this.
+  bool _numaAware = false;
+  // Maintain the table of 1/D along with the KB, so that the hot kernels multiply instead of divide. It takes as much
+  //   memory as matrix D .
+  bool _invDTable = false;
+  // Store only the cells of the KB that differ from the initial values, so that the memory scales with the amount of
+  //   training rather than with the product of the numbers of questions, answers and targets. Double precision only.
+  //   The engine doesn't support IPqaEngine::SaveKBAsync() and IPqaEngine::RecomputeDAsync() .
+  bool _sparseKB = false;
+  // Append each training to this journal file, and first replay its records that are newer than the KB, so that the
+  //   trainings since the last save survive a crash. Train() and RecordQuizTarget() return when their record is
+  //   flushed to the storage device. The journal isn't truncated by the saves. Dense KB only.
+  const char* _journalPath = nullptr;
+  // Keep two instances of the KB, so that NextQuestion(), RecordAnswer(), StartQuiz() and ResumeQuiz() read one of them
+  //   without waiting for the trainings, which update the other instance, publish it, then catch up the first one once
+  //   its readers are gone. It doubles the memory of the KB, and the trainings wait for the readers instead. Dense KB
+  //   only.
+  bool _epochKB = false;
+  // Within a quiz, drop from the computations the SIMD vectors of targets whose probabilities all fall below this
+  //   fraction of the maximum probability, so that NextQuestion(), RecordAnswer() and ListTopTargets() later in the
+  //   quiz take time proportional to the remaining targets rather than to all of them. The dropped targets have zero
+  //   probability until the next full pass, which recomputes the probabilities of all the targets and readmits those
+  //   above the threshold. 0 disables the pruning. Dense KB in double precision only.
+  double _pruneTargetsEps = 0;
+  // The number of answers recorded in a quiz with pruning between the full passes over all the targets.
+  TPqaId _pruneFullPassPeriod = 8;
+  // The number of the first questions in a quiz that NextQuestion() selects by the distributions shared between the
+  //   quizzes. All the quizzes start from the same priors, so the distribution for the first question is the same for
+  //   them, and the one for the second question depends only on the first answer. The distributions are cached per
+  //   sequence of answers, and dropped on any change of the KB. Resumed quizzes don't use the cache. 0 disables the
+  //   cache. Dense KB only.
+  TPqaId _nextQsCacheDepth = 0;
+  // The memory budget of the cache of the distributions of the next question, in bytes.
+  uint64_t _nextQsCacheMaxBytes = uint64_t(64) << 20;
+  // The widest instruction set that the hot kernels may use. The engine uses the narrower of this and the one that the
+  //   CPU supports, so lowering it runs the same computations on the narrower kernels, e.g. to compare or to benchmark
+  //   them. The engine requires at least AVX2.
+  SRPlat::SRInstructionSet _maxInstructionSet = SRPlat::SRInstructionSet::Avx512;
+};
+
+struct LoadKBOptions {
+  // The options of the engine as in CreateCpuEngine(), except that the dimensions, the precision and whether the KB is
+  //   sparse are read from the KB file, so |_engDef._dims|, |_engDef._prec| and |_engDef._sparseKB| are ignored.
+  EngineDefinition _engDef;
+  // If the KB can't be mapped as requested (e.g. the layout of the file doesn't allow it), it's read into memory.
+  TPqaKBMapping _mapping = TPqaKBMapping::None;
+};
+
+struct EngineStats {
+  uint64_t _nQuestionsAsked;
+  // The number of bytes taken by the KB weights A, D and B, excluding the derived data like the table of 1/D .
+  uint64_t _kbBytes;
+  // Whether the KB is backed by large pages.
+  bool _kbLargePages;
+  // Whether the KB is a view of the memory-mapped KB file.
+  bool _kbMapped;
+  //// The number of large memory pool allocations that obtained large pages, and that fell back to regular pages.
+  uint64_t _nPoolLargePageAllocs;
+  uint64_t _nPoolLargePageFallbacks;
+  //// The durations of the last successful SaveKB() in microseconds: in total, and of holding the KB lock. The
+  ////   double-buffered save holds the lock only for copying the KB in memory.
+  uint64_t _lastSaveMicros;
+  uint64_t _lastSaveLockMicros;
+};
+
+struct SaveKBOptions {
+  // Run the I/O thread in the background mode, which lowers both its CPU and its I/O priority.
+  bool _bLowPriority = true;
+  // The number of bytes written at once, between the checks for cancellation and the updates of the progress. When
+  //   compressing, the blocks of the codec are written at once instead.
+  size_t _chunkBytes = size_t(8) << 20;
+  // Compress the weights as IPqaEngine::SaveKB() does, on the I/O thread.
+  bool _bCompress = false;
+};
+
+struct SaveKBProgress {
+  // The number of bytes of KB weights to write, known once the snapshot is taken, and of them written so far. These are
+  //   the bytes before compression.
+  uint64_t _nBytesTotal;
+  uint64_t _nBytesWritten;
+  // How long the KB was locked for taking the snapshot.
+  uint64_t _lockMicros;
+  // The time since the save was requested, up to its finish.
+  uint64_t _elapsedMicros;
+  // The average speed of writing the file since the snapshot was taken.
+  double _bytesPerSec;
+  bool _bDone;
+};
+
+struct RecomputeDOptions {
+  // Run the thread driving the chunks in the background mode, which lowers its CPU priority. The chunks are summed on
+  //   the workers, so it's |_pauseMiS| that limits their share of the CPU.
+  bool _bLowPriority = true;
+  // The number of questions in a chunk, recomputed at once. The KB is locked exclusively for at most one chunk.
+  TPqaId _nQuestionsPerChunk = 64;
+  // The pause after each chunk, which limits the share of the CPU and memory bandwidth taken from the foreground.
+  uint32_t _pauseMiS = 0;
+};
+
+struct RecomputeDProgress {
+  // The number of questions to recompute, and of them recomputed so far.
+  TPqaId _nQuestionsTotal;
+  TPqaId _nQuestionsDone;
+  // The number of items of D that differed from the sum over the answers, and the maximum relative difference among
+  //   them, which is the drift corrected.
+  uint64_t _nItemsCorrected;
+  double _maxRelDrift;
+  // The longest time the KB was locked exclusively for a chunk.
+  uint64_t _maxLockMicros;
+  // The time since the recomputation was requested, up to its finish.
+  uint64_t _elapsedMicros;
+  bool _bDone;
 };
 
 struct AnsweredQuestion {
@@ -0,0 +1,205 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/KBFileFormat.h"
+#include "../PqaCore/Interface/PqaErrorParams.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+namespace {
+
+constexpr uint64_t cFnvPrime = 0x100000001b3;
+
+} // anonymous namespace
+
+uint64_t KBFileDirectory::HashBytes(uint64_t hash, const void *const p, const size_t nBytes) {
+  const uint8_t *const PTR_RESTRICT pBytes = static_cast<const uint8_t*>(p);
+  for (size_t i = 0; i < nBytes; i++) {
+    hash = (hash ^ pBytes[i]) * cFnvPrime;
+  }
+  return hash;
+}
+
+void KBFileDirectory::InitHeader(const PrecisionDefinition& prec, const EngineDimensions& dims,
+  const uint32_t version)
+{
+  std::memset(this, 0, sizeof(*this));
+  std::memcpy(_header._magic, cKBFileMagic, sizeof(cKBFileMagic));
+  _header._version = version;
+  _header._endianTag = _cEndianTag;
+  _header._prec = prec;
+  _header._dims = dims;
+}
+
+uint64_t KBFileDirectory::AddSection(const KBFileSectionKind kind, const uint64_t offset, const uint64_t nBytes,
+  const uint64_t rowBytes)
+{
+  assert(_header._nSections < _cMaxSections);
+  KBFileSection &sect = _sections[_header._nSections];
+  _header._nSections++;
+  sect._kind = kind;
+  sect._offset = offset;
+  sect._nBytes = nBytes;
+  sect._rowBytes = rowBytes;
+  return AlignToPage(offset + nBytes);
+}
+
+uint64_t KBFileDirectory::AddExtraSections(uint64_t offset) {
+  offset = AddSection(KBFileSectionKind::QuestionGaps, offset,
+    CalcBitmapBytes(SRCast::ToUint64(_header._dims._nQuestions)), 0);
+  offset = AddSection(KBFileSectionKind::TargetGaps, offset,
+    CalcBitmapBytes(SRCast::ToUint64(_header._dims._nTargets)), 0);
+  offset = AddSection(KBFileSectionKind::QuestionsAsked, offset, sizeof(uint64_t), 0);
+  return AddSection(KBFileSectionKind::TrainingsCount, offset, sizeof(uint64_t), 0);
+}
+
+void KBFileDirectory::Init(const PrecisionDefinition& prec, const EngineDimensions& dims, const size_t nNumBytes,
+  const size_t nRowItems)
+{
+  InitHeader(prec, dims, _cPlainVersion);
+  const uint64_t nQuestions = SRCast::ToUint64(dims._nQuestions);
+  const uint64_t nAnswers = SRCast::ToUint64(dims._nAnswers);
+  const uint64_t rowBytes = uint64_t(nRowItems) * nNumBytes;
+  uint64_t offset = _cPageBytes;
+  offset = AddSection(KBFileSectionKind::CubeA, offset, nQuestions * nAnswers * rowBytes, rowBytes);
+  offset = AddSection(KBFileSectionKind::MatrixD, offset, nQuestions * rowBytes, rowBytes);
+  offset = AddSection(KBFileSectionKind::VectorB, offset, rowBytes, rowBytes);
+  AddExtraSections(offset);
+  _header._checksum = CalcChecksum();
+}
+
+void KBFileDirectory::InitCoded(const PrecisionDefinition& prec, const EngineDimensions& dims,
+  const size_t nNumBytes, const size_t nRowItems, const uint64_t nBlocks)
+{
+  InitHeader(prec, dims, _cCodedVersion);
+  uint64_t offset = _cPageBytes;
+  offset = AddSection(KBFileSectionKind::CodecIndex, offset, (nBlocks + 1) * sizeof(uint64_t), 0);
+  offset = AddExtraSections(offset);
+  AddSection(KBFileSectionKind::CodedWeights, offset, 0, uint64_t(nRowItems) * nNumBytes);
+  _header._checksum = CalcChecksum();
+}
+
+void KBFileDirectory::InitSparse(const PrecisionDefinition& prec, const EngineDimensions& dims,
+  const uint64_t nCells)
+{
+  InitHeader(prec, dims, _cSparseVersion);
+  const uint64_t nQuestions = SRCast::ToUint64(dims._nQuestions);
+  const uint64_t nAnswers = SRCast::ToUint64(dims._nAnswers);
+  const uint64_t nTargets = SRCast::ToUint64(dims._nTargets);
+  uint64_t offset = _cPageBytes;
+  offset = AddSection(KBFileSectionKind::QuestionDefaults, offset, nQuestions * sizeof(double), 0);
+  offset = AddSection(KBFileSectionKind::SparseIndex, offset, nQuestions * (nAnswers + 1) * sizeof(uint64_t), 0);
+  offset = AddSection(KBFileSectionKind::SparseCells, offset, nCells * sizeof(KBFileSparseCell), 0);
+  offset = AddSection(KBFileSectionKind::VectorB, offset, nTargets * sizeof(double), nTargets * sizeof(double));
+  AddExtraSections(offset);
+  _header._checksum = CalcChecksum();
+}
+
+void KBFileDirectory::SetCodedBytes(const uint64_t nBytes) {
+  for (uint32_t i = 0; i < _header._nSections; i++) {
+    if (_sections[i]._kind == KBFileSectionKind::CodedWeights) {
+      _sections[i]._nBytes = nBytes;
+    }
+  }
+  _header._checksum = CalcChecksum();
+}
+
+uint64_t KBFileDirectory::CalcChecksum() const {
+  KBFileHeader header = _header;
+  header._checksum = 0;
+  const uint64_t hash = HashBytes(_cHashBasis, &header, sizeof(header));
+  return HashBytes(hash, _sections, std::min(_header._nSections, _cMaxSections) * sizeof(KBFileSection));
+}
+
+PqaError KBFileDirectory::Validate(const char* const filePath) const {
+  if (std::memcmp(_header._magic, cKBFileMagic, sizeof(cKBFileMagic)) != 0) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "The KB file doesn't start with the magic of the sectioned format."));
+  }
+  if (_header._endianTag != _cEndianTag) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(
+      (_header._endianTag == _byteswap_ulong(_cEndianTag)) ? SR_FILE_LINE "The KB file is written on a machine of"
+      " the other byte order." : SR_FILE_LINE "The endianness tag of the KB file is damaged."));
+  }
+  if (_header._version == 0 || _header._version > _cVersion) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+      "Unsupported version of KB file format: ")(_header._version).GetOwnedSRString());
+  }
+  if (_header._nSections > _cMaxSections) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+      "The number of sections in the KB file is too large: ")(_header._nSections).GetOwnedSRString());
+  }
+  if (_header._checksum != CalcChecksum()) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "The checksum of the KB file header doesn't match."));
+  }
+  for (uint32_t i = 0; i < _header._nSections; i++) {
+    if ((_sections[i]._offset & (_cPageBytes - 1)) != 0) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+        "The section of the KB file isn't at a page boundary: ")(_sections[i]._offset).GetOwnedSRString());
+    }
+  }
+  // Unknown sections are skipped, while the weights are required.
+  if (IsCoded()) {
+    const KBFileSection *pIndex = Find(KBFileSectionKind::CodecIndex);
+    if (pIndex == nullptr || pIndex->_nBytes < 2 * sizeof(uint64_t) || pIndex->_nBytes % sizeof(uint64_t) != 0
+      || Find(KBFileSectionKind::CodedWeights)->_rowBytes == 0)
+    {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "The KB file lacks a proper index of the compressed weights."));
+    }
+    return PqaError();
+  }
+  const uint64_t nQuestions = SRCast::ToUint64(_header._dims._nQuestions);
+  const uint64_t nAnswers = SRCast::ToUint64(_header._dims._nAnswers);
+  if (IsSparse()) {
+    const uint64_t nTargets = SRCast::ToUint64(_header._dims._nTargets);
+    const KBFileSection *pDefaults = Find(KBFileSectionKind::QuestionDefaults);
+    const KBFileSection *pIndex = Find(KBFileSectionKind::SparseIndex);
+    const KBFileSection *pB = Find(KBFileSectionKind::VectorB);
+    if (_header._prec._type != TPqaPrecisionType::Double || pDefaults == nullptr
+      || pDefaults->_nBytes != nQuestions * sizeof(double) || pIndex == nullptr
+      || pIndex->_nBytes != nQuestions * (nAnswers + 1) * sizeof(uint64_t)
+      || Find(KBFileSectionKind::SparseCells)->_nBytes % sizeof(KBFileSparseCell) != 0 || pB == nullptr
+      || pB->_nBytes != nTargets * sizeof(double))
+    {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "The KB file lacks proper sections of the sparse weights."));
+    }
+    return PqaError();
+  }
+  const std::pair<KBFileSectionKind, uint64_t> weights[] = { { KBFileSectionKind::CubeA, nQuestions * nAnswers },
+    { KBFileSectionKind::MatrixD, nQuestions }, { KBFileSectionKind::VectorB, 1 } };
+  for (const auto& kindRows : weights) {
+    const KBFileSection *pSect = Find(kindRows.first);
+    if (pSect == nullptr || pSect->_rowBytes == 0 || pSect->_nBytes != kindRows.second * pSect->_rowBytes) {
+      return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
+        "The KB file lacks a proper section of the weights: ")(static_cast<uint32_t>(kindRows.first))
+        .GetOwnedSRString());
+    }
+  }
+  return PqaError();
+}
+
+const KBFileSection* KBFileDirectory::Find(const KBFileSectionKind kind) const {
+  for (uint32_t i = 0, iEn = std::min(_header._nSections, _cMaxSections); i < iEn; i++) {
+    if (_sections[i]._kind == kind) {
+      return _sections + i;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t KBFileDirectory::GetFileBytes() const {
+  uint64_t limit = _cPageBytes;
+  for (uint32_t i = 0, iEn = std::min(_header._nSections, _cMaxSections); i < iEn; i++) {
+    limit = std::max(limit, _sections[i]._offset + _sections[i]._nBytes);
+  }
+  return limit;
+}
+
+} // namespace ProbQA
@@ -0,0 +1,132 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/Interface/PqaErrors.h"
+
+namespace ProbQA {
+
+// Sectioned KB file format. The first page of the file holds the header and the directory of the sections. Each section
+//   begins at a page boundary, and in the sections of the weights each row of targets is padded to a whole number of
+//   SIMD vectors as in the KB arena, so that a KB file can be memory-mapped and used in place.
+// A KB file in the legacy format starts with the precision definition instead of the magic, then the engine dimensions
+//   follow, then the unpadded weights: cube A, matrix D and vector B. The first byte of the magic is not a valid
+//   precision type, so the formats can't be confused.
+// Optionally the weights are compressed: then instead of the sections of cube A, matrix D and vector B, the file has
+//   the padded rows of the weights in the same order encoded by CEKBCodec in blocks of rows, and the index of the
+//   blocks. Such a file has version 2, so that the engines predating the compression reject it.
+// A sparse KB is saved with the explicit cells only: instead of the sections of cube A and matrix D, the file has the
+//   default cell of A of each question, the index of the rows of explicit cells, and the cells themselves. The rows are
+//   in the order of CESparseKB: [iQuestion][iAnswer] rows of A, each followed by the row of D at iAnswer=nAnswers .
+//   Vector B is dense and unpadded. Such a file has version 3, and it's loaded by the sparse engine only.
+
+// The line ending bytes of the magic catch a file damaged by text-mode transfer.
+constexpr uint8_t cKBFileMagic[8] = { 0x8F, 'P', 'q', 'a', 'K', 'B', '\r', '\n' };
+
+enum class KBFileSectionKind : uint32_t {
+  None = 0,
+  CubeA = 1, // A[iQuestion][iAnswer][iTarget], in padded rows of targets
+  MatrixD = 2, // D[iQuestion][iTarget], in padded rows of targets
+  VectorB = 3, // B[iTarget], a single padded row of targets
+  QuestionGaps = 4, // bitmap of 64-bit words, where a set bit denotes a gap
+  TargetGaps = 5, // bitmap of 64-bit words, where a set bit denotes a gap
+  QuestionsAsked = 6, // uint64_t total number of questions asked
+  TrainingsCount = 7, // uint64_t number of trainings in the KB, i.e. the last one replayed from the training journal
+  // uint64_t number of rows in a block, then uint64_t end of each block, from the beginning of CodedWeights section
+  CodecIndex = 8,
+  CodedWeights = 9, // the rows of A, D and B encoded in blocks; _rowBytes is the size of a padded row before encoding
+  QuestionDefaults = 10, // double default cell of A of each question
+  SparseIndex = 11, // uint64_t end of each row of explicit cells, in cells from the beginning of SparseCells section
+  SparseCells = 12 // KBFileSparseCell explicit cells, in the increasing order of the targets within each row
+};
+
+struct KBFileSparseCell {
+  TPqaId _iTarget;
+  double _value;
+};
+
+struct KBFileSection {
+  KBFileSectionKind _kind;
+  uint32_t _reserved;
+  uint64_t _offset; // from the beginning of the file, at a page boundary
+  uint64_t _nBytes; // excluding the padding up to the next page
+  uint64_t _rowBytes; // the size of a padded row of targets, or 0 if the section doesn't consist of rows
+};
+
+struct KBFileHeader {
+  uint8_t _magic[sizeof(cKBFileMagic)];
+  uint32_t _version;
+  // The tag as written by the machine that made the file, so that the machines of the other byte order see it reversed.
+  uint32_t _endianTag;
+  // FNV-1a hash of the header with this field set to 0, and of the directory. The weights are not hashed: this would
+  //   dominate the time of saving and loading, and would make all the pages of a mapped KB be read at once.
+  uint64_t _checksum;
+  PrecisionDefinition _prec;
+  EngineDimensions _dims;
+  uint32_t _nSections;
+  uint32_t _reserved;
+};
+
+// The header and the directory of the sections, as they are stored in the first page of a KB file.
+class KBFileDirectory {
+public: // constants
+  static constexpr uint32_t _cVersion = 3;
+  // The version of the files with a sparse KB.
+  static constexpr uint32_t _cSparseVersion = 3;
+  // The version of the files with the compressed weights.
+  static constexpr uint32_t _cCodedVersion = 2;
+  // The version of the files with the plain weights, which the older engines can read.
+  static constexpr uint32_t _cPlainVersion = 1;
+  static constexpr uint32_t _cEndianTag = 0x01020304;
+  static constexpr uint64_t _cPageBytes = 4096;
+  static constexpr uint32_t _cMaxSections = (_cPageBytes - sizeof(KBFileHeader)) / sizeof(KBFileSection);
+  static constexpr uint64_t _cHashBasis = 0xcbf29ce484222325;
+
+public: // variables
+  KBFileHeader _header;
+  KBFileSection _sections[_cMaxSections];
+
+private: // methods
+  void InitHeader(const PrecisionDefinition& prec, const EngineDimensions& dims, const uint32_t version);
+  // Append a section at |offset|, and return the offset of the next one, at a page boundary.
+  uint64_t AddSection(const KBFileSectionKind kind, const uint64_t offset, const uint64_t nBytes,
+    const uint64_t rowBytes);
+  // Append the sections of the gaps and the counters.
+  uint64_t AddExtraSections(uint64_t offset);
+
+public: // methods
+  static uint64_t AlignToPage(const uint64_t offset) { return (offset + _cPageBytes - 1) & ~(_cPageBytes - 1); }
+  static uint64_t CalcBitmapBytes(const uint64_t nBits) { return ((nBits + 63) >> 6) * sizeof(uint64_t); }
+  // FNV-1a hash of |nBytes| at |p|, continuing from |hash|, which is _cHashBasis at the beginning.
+  static uint64_t HashBytes(uint64_t hash, const void *const p, const size_t nBytes);
+
+  // Lay out the sections of a KB of dimensions |dims| and numbers of |nNumBytes| bytes, having |nRowItems| items,
+  //   including the padding, in a row of targets. Computes the checksum.
+  void Init(const PrecisionDefinition& prec, const EngineDimensions& dims, const size_t nNumBytes,
+    const size_t nRowItems);
+  // Lay out the sections of a KB whose weights are encoded in |nBlocks| blocks. The encoded weights come last, so that
+  //   they can be written before their size is known: call SetCodedBytes() then.
+  void InitCoded(const PrecisionDefinition& prec, const EngineDimensions& dims, const size_t nNumBytes,
+    const size_t nRowItems, const uint64_t nBlocks);
+  // Lay out the sections of a sparse KB in double precision with |nCells| explicit cells.
+  void InitSparse(const PrecisionDefinition& prec, const EngineDimensions& dims, const uint64_t nCells);
+  // Set the size of the encoded weights, and recompute the checksum.
+  void SetCodedBytes(const uint64_t nBytes);
+  bool IsCoded() const { return Find(KBFileSectionKind::CodedWeights) != nullptr; }
+  bool IsSparse() const { return Find(KBFileSectionKind::SparseCells) != nullptr; }
+  uint64_t CalcChecksum() const;
+  // Check the header and the directory just read from |filePath|, except the layout of the rows of the weights, which
+  //   depends on the engine.
+  PqaError Validate(const char* const filePath) const;
+
+  // Returns nullptr if the file doesn't have the section.
+  const KBFileSection* Find(const KBFileSectionKind kind) const;
+  // The size of the file, i.e. the limit of the last section.
+  uint64_t GetFileBytes() const;
+};
+
+static_assert(sizeof(KBFileDirectory) <= KBFileDirectory::_cPageBytes, "The directory must fit the first page.");
+
+} // namespace ProbQA
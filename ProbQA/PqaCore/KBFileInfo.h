@@ -4,12 +4,43 @@
 
 #pragma once
 
+#include "../PqaCore/KBFileFormat.h"
+
 namespace ProbQA {
 
 struct KBFileInfo {
-  SRPlat::SRSmartFile &_sf;
+  const SRPlat::SRPositionalFile &_file;
   const char* const _filePath;
-  KBFileInfo(SRPlat::SRSmartFile &sf, const char* const filePath) : _sf(sf), _filePath(filePath) { }
+  // The offset of the KB weights in a legacy file, i.e. the size of the headers.
+  const uint64_t _dataOffset;
+  // The header and the directory of a sectioned file, or nullptr for a legacy file.
+  const KBFileDirectory *const _pDir;
+  const TPqaKBMapping _mapping;
+
+  KBFileInfo(const SRPlat::SRPositionalFile &file, const char* const filePath, const uint64_t dataOffset,
+    const KBFileDirectory *const pDir, const TPqaKBMapping mapping)
+    : _file(file), _filePath(filePath), _dataOffset(dataOffset), _pDir(pDir), _mapping(mapping) { }
+
+  // Get the offsets of cube A, matrix D and vector B in the file, and the number of items in a row of targets,
+  //   for a KB of dimensions |dims| and numbers of |nNumBytes| bytes.
+  void LocateWeights(const EngineDimensions &dims, const size_t nNumBytes, uint64_t &offsA, uint64_t &offsD,
+    uint64_t &offsB, uint64_t &nRowItems) const
+  {
+    if (_pDir != nullptr) {
+      const KBFileSection &sectA = *_pDir->Find(KBFileSectionKind::CubeA);
+      offsA = sectA._offset;
+      offsD = _pDir->Find(KBFileSectionKind::MatrixD)->_offset;
+      offsB = _pDir->Find(KBFileSectionKind::VectorB)->_offset;
+      nRowItems = sectA._rowBytes / nNumBytes;
+      return;
+    }
+    // The legacy file has no padding.
+    const uint64_t nTargets = SRPlat::SRCast::ToUint64(dims._nTargets);
+    nRowItems = nTargets;
+    offsA = _dataOffset;
+    offsD = offsA + SRPlat::SRCast::ToUint64(dims._nQuestions * dims._nAnswers) * nTargets * nNumBytes;
+    offsB = offsD + SRPlat::SRCast::ToUint64(dims._nQuestions) * nTargets * nNumBytes;
+  }
 };
 
 } // namespace ProbQA
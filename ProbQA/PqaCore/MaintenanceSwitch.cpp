@@ -79,7 +79,7 @@ void MaintenanceSwitch::LeaveAgnostic() {
   }
 }
 
-template <MaintenanceSwitch::Mode taMode> void MaintenanceSwitch::SwitchMode() {
+template <MaintenanceSwitch::Mode taMode> void MaintenanceSwitch::SwitchMode(FIdleCallback fIdle, void *pData) {
   {
     SRLock<SRCriticalSection> csl(_cs);
     if (_bModeChangeRequested) {
@@ -109,14 +109,17 @@ template <MaintenanceSwitch::Mode taMode> void MaintenanceSwitch::SwitchMode() {
         }
       } while (_nUsing > 0);
     }
+    if (fIdle != nullptr) {
+      fIdle(pData);
+    }
     _curMode = static_cast<uint64_t>(taMode);
     _bModeChangeRequested = 0;
   }
   _canEnter.WakeAll();
 }
 
-template void MaintenanceSwitch::SwitchMode<MaintenanceSwitch::Mode::Maintenance>();
-template void MaintenanceSwitch::SwitchMode<MaintenanceSwitch::Mode::Regular>();
+template void MaintenanceSwitch::SwitchMode<MaintenanceSwitch::Mode::Maintenance>(FIdleCallback fIdle, void *pData);
+template void MaintenanceSwitch::SwitchMode<MaintenanceSwitch::Mode::Regular>(FIdleCallback fIdle, void *pData);
 
 bool MaintenanceSwitch::Shutdown() {
   SRLock<SRCriticalSection> csl(_cs);
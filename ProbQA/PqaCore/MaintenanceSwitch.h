@@ -8,6 +8,8 @@ namespace ProbQA {
 
 class MaintenanceSwitch {
 public: // types
+  typedef void (*FIdleCallback)(void *pData);
+
   enum class Mode : uint8_t {
     None = 0,
     Regular = 1,
@@ -81,7 +83,10 @@ public: // methods
   //   current operations of the current mode to finish, then switch to the new mode.
   // Throws if it is already in the target mode or in the process of state change.
   // Throws when shut(ting) down.
-  template <Mode taMode> void SwitchMode();
+  template <Mode taMode> void SwitchMode() { SwitchMode<taMode>(nullptr, nullptr); }
+  // Same as above, but also call |fIdle(pData)| once the operations of the current mode have finished, before the new
+  //   mode is in effect. No operation can start meanwhile.
+  template <Mode taMode> void SwitchMode(FIdleCallback fIdle, void *pData);
   // Wait for completion of any current operations (except mode switch) and forbid starting any new operations in any
   //   mode. Concurrent switch operations throw and may do this a little later than when this method returns.
   // Returns |true| if shutdown has happened in the current call. Returns |false| if it was already shut down.
@@ -6,6 +6,7 @@
 #include "PqaEngineBaseFactory.h"
 #include "../PqaCore/Interface/PqaErrorParams.h"
 #include "../PqaCore/CpuEngine.h"
+#include "../PqaCore/SparseCpuEngine.h"
 #include "../PqaCore/ErrorHelper.h"
 
 using namespace SRPlat;
@@ -14,15 +15,66 @@ namespace ProbQA {
 
 IPqaEngine* PqaEngineBaseFactory::MakeCpuEngine(PqaError& err, const EngineDefinition& engDef, KBFileInfo *pKbFi) {
   try {
+    // The engine is compiled for AVX2, and only the hot kernels have variants for the wider instruction sets.
+    if (SRCpuInfo::GetInstructionSet() < SRInstructionSet::Avx2
+      || engDef._maxInstructionSet < SRInstructionSet::Avx2)
+    {
+      //TODO: implement
+      err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+        "ProbQA Engine on CPU without AVX2 and FMA3.")));
+      return nullptr;
+    }
     std::unique_ptr<IPqaEngine> pEngine;
+    if (engDef._sparseKB) {
+      if (engDef._prec._type != TPqaPrecisionType::Double) {
+        //TODO: implement
+        err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+          "Sparse ProbQA Engine on CPU for precision except double.")));
+        return nullptr;
+      }
+      if (engDef._journalPath != nullptr) {
+        err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+          "Training journal for Sparse ProbQA Engine on CPU.")));
+        return nullptr;
+      }
+      if (engDef._epochKB) {
+        err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+          "Epoch mode of the KB for Sparse ProbQA Engine on CPU.")));
+        return nullptr;
+      }
+      if (engDef._pruneTargetsEps > 0) {
+        err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+          "Pruning of the targets in quizzes for Sparse ProbQA Engine on CPU.")));
+        return nullptr;
+      }
+      if (engDef._nextQsCacheDepth > 0) {
+        err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+          "Cache of the next question for Sparse ProbQA Engine on CPU.")));
+        return nullptr;
+      }
+      // LoadCpuEngine() makes the sparse engine for the sparse KB files only.
+      assert(pKbFi == nullptr || (pKbFi->_pDir != nullptr && pKbFi->_pDir->IsSparse()));
+      pEngine.reset(new SparseCpuEngine(engDef, pKbFi));
+      err.Release();
+      return pEngine.release();
+    }
+    if (engDef._pruneTargetsEps > 0 && engDef._prec._type != TPqaPrecisionType::Double) {
+      //TODO: implement
+      err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
+        "Pruning of the targets in quizzes for precision except double.")));
+      return nullptr;
+    }
     switch (engDef._prec._type) {
     case TPqaPrecisionType::Double:
       pEngine.reset(new CpuEngine<SRDoubleNumber>(engDef, pKbFi));
       break;
+    case TPqaPrecisionType::Float:
+      pEngine.reset(new CpuEngine<SRFloatNumber>(engDef, pKbFi));
+      break;
     default:
       //TODO: implement
       err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(SR_FILE_LINE
-        "ProbQA Engine on CPU for precision except double.")));
+        "ProbQA Engine on CPU for precision except double and float.")));
       return nullptr;
     }
     err.Release();
@@ -44,33 +96,52 @@ IPqaEngine* PqaEngineBaseFactory::CreateCpuEngine(PqaError& err, const EngineDef
   return MakeCpuEngine(err, engDef, nullptr);
 }
 
-IPqaEngine* PqaEngineBaseFactory::LoadCpuEngine(PqaError& err, const char* const filePath) {
-  SRSmartFile sf(std::fopen(filePath, "rb"));
-  if (sf.Get() == nullptr) {
+IPqaEngine* PqaEngineBaseFactory::LoadCpuEngine(PqaError& err, const char* const filePath,
+  const LoadKBOptions& options)
+{
+  SRPositionalFile file;
+  if (!file.Open(filePath, SRPositionalFile::Mode::Read)) {
     err = PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(filePath), SRString::MakeUnowned(
       SR_FILE_LINE "Can't open the KB file to read."));
     return nullptr;
   }
-  if (std::setvbuf(sf.Get(), nullptr, _IOFBF, BaseCpuEngine::_cFileBufSize) != 0) {
-    err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRMessageBuilder(SR_FILE_LINE
-      "Can't set file buffer size to ")(BaseCpuEngine::_cFileBufSize).GetOwnedSRString());
-    return nullptr;
+
+  EngineDefinition engDef = options._engDef;
+  // The file is in the sectioned format if it starts with the magic, otherwise it's in the legacy format.
+  KBFileDirectory dir;
+  if (file.ReadAt(dir._header._magic, sizeof(dir._header._magic), 0)
+    && std::memcmp(dir._header._magic, cKBFileMagic, sizeof(cKBFileMagic)) == 0)
+  {
+    if (!file.ReadAt(&dir, sizeof(dir), 0)) {
+      err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Can't read the header and the directory of the sectioned KB file."));
+      return nullptr;
+    }
+    err = dir.Validate(filePath);
+    if (!err.IsOk()) {
+      return nullptr;
+    }
+    engDef._prec = dir._header._prec;
+    engDef._dims = dir._header._dims;
+    engDef._sparseKB = dir.IsSparse();
+    KBFileInfo kbFi(file, filePath, KBFileDirectory::_cPageBytes, &dir, options._mapping);
+    return MakeCpuEngine(err, engDef, &kbFi);
   }
 
-  EngineDefinition engDef;
-  if (std::fread(&engDef._prec, sizeof(engDef._prec), 1, sf.Get()) != 1) {
+  if (!file.ReadAt(&engDef._prec, sizeof(engDef._prec), 0)) {
     err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
       "Can't read precision definition header."));
     return nullptr;
   }
 
-  if (std::fread(&engDef._dims, sizeof(engDef._dims), 1, sf.Get()) != 1) {
+  if (!file.ReadAt(&engDef._dims, sizeof(engDef._dims), sizeof(engDef._prec))) {
     err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
       "Can't read engine dimensions header."));
     return nullptr;
   }
 
-  KBFileInfo kbFi(sf, filePath);
+  engDef._sparseKB = false;
+  KBFileInfo kbFi(file, filePath, sizeof(engDef._prec) + sizeof(engDef._dims), nullptr, options._mapping);
   return MakeCpuEngine(err, engDef, &kbFi);
 }
 
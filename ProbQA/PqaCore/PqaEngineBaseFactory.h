@@ -21,7 +21,7 @@ private: // methods
 
 public: // methods
   IPqaEngine* CreateCpuEngine(PqaError& err, const EngineDefinition& engDef) override final;
-  IPqaEngine* LoadCpuEngine(PqaError& err, const char* const filePath) override final;
+  IPqaEngine* LoadCpuEngine(PqaError& err, const char* const filePath, const LoadKBOptions& options) override final;
 
   IPqaEngine* CreateCudaEngine(PqaError& err, const EngineDefinition& engDef) override final;
   IPqaEngine* CreateGridEngine(PqaError& err, const EngineDefinition& engDef) override final;
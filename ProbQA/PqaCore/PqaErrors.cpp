@@ -38,6 +38,8 @@ SRPlat::SRString ToSRString(const PqaErrorCode pec) {
     return SRString::MakeUnowned("The amount is not positive");
   case PqaErrorCode::AbsentId:
     return SRString::MakeUnowned("The ID is absent from KB");
+  case PqaErrorCode::Cancelled:
+    return SRString::MakeUnowned("The operation has been cancelled");
   default: {
     std::string message("Unhandled");
     message += std::to_string(static_cast<int64_t>(pec));
@@ -0,0 +1,1130 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../PqaCore/SparseCpuEngine.h"
+#include "../PqaCore/CESparseQuiz.h"
+#include "../PqaCore/CESparseEvalQsTask.h"
+#include "../PqaCore/CESparseEvalQsSubtask.h"
+#include "../PqaCore/CETrainTaskNumSpec.h"
+#include "../PqaCore/ErrorHelper.h"
+
+using namespace SRPlat;
+
+namespace ProbQA {
+
+#define CELOG(severityVar) SRLogStream(ISRLogger::Severity::severityVar, _pLogger.load(std::memory_order_acquire))
+
+size_t SparseCpuEngine::CalcWorkerStackSize(const EngineDefinition& engDef) {
+  return CESparseEvalQsSubtask::CalcStackReq(engDef);
+}
+
+SparseCpuEngine::SparseCpuEngine(const EngineDefinition& engDef, KBFileInfo *pKbFi)
+  : BaseCpuEngine(engDef, CalcWorkerStackSize(engDef)),
+  _defaultLog2Ratio(-std::log2(SRCast::ToDouble(engDef._dims._nAnswers)))
+{
+  const size_t nQuestions = SRCast::ToSizeT(_dims._nQuestions);
+  const size_t nAnswers = SRCast::ToSizeT(_dims._nAnswers);
+  const size_t nTargets = SRCast::ToSizeT(_dims._nTargets);
+
+  // The same initial values as in the dense engine, but only vector B is materialized.
+  const double init1 = SRCast::ToDouble(engDef._initAmount);
+  const double initSqr = init1 * init1;
+  _kb.Init(nQuestions, nAnswers, nTargets, initSqr, init1);
+
+  _questionGaps.GrowTo(nQuestions);
+  _targetGaps.GrowTo(nTargets);
+  if (pKbFi != nullptr) {
+    if (pKbFi->_mapping != TPqaKBMapping::None) {
+      CELOG(Warning) << SR_FILE_LINE "The sparse KB file " << pKbFi->_filePath << " can't be mapped. Reading it"
+        " instead.";
+    }
+    ReadKB(*pKbFi);
+  }
+}
+
+void SparseCpuEngine::ReadKB(const KBFileInfo &kbFi) {
+  const KBFileDirectory &dir = *kbFi._pDir;
+  const size_t nQuestions = SRCast::ToSizeT(_dims._nQuestions);
+  const size_t nTargets = SRCast::ToSizeT(_dims._nTargets);
+  const size_t nRows = _kb.GetNRows();
+  const KBFileSection &sectCells = *dir.Find(KBFileSectionKind::SparseCells);
+  const uint64_t nCells = sectCells._nBytes / sizeof(KBFileSparseCell);
+  auto fnFail = [&](SRString &&message) {
+    PqaException(PqaErrorCode::FileOp, new FileOpErrorParams(kbFi._filePath), std::move(message)).ThrowMoving();
+  };
+
+  SRSmartMPP<double> smppDefaults(_memPool, nQuestions);
+  SRSmartMPP<uint64_t> smppRowEnds(_memPool, nRows);
+  if (!kbFi._file.ReadAt(smppDefaults.Get(), nQuestions * sizeof(double),
+    dir.Find(KBFileSectionKind::QuestionDefaults)->_offset) || !kbFi._file.ReadAt(smppRowEnds.Get(),
+    nRows * sizeof(uint64_t), dir.Find(KBFileSectionKind::SparseIndex)->_offset) || !kbFi._file.ReadAt(_kb.ModB(),
+    nTargets * sizeof(double), dir.Find(KBFileSectionKind::VectorB)->_offset))
+  {
+    fnFail(SRString::MakeUnowned(SR_FILE_LINE "Can't read the default cells, the index of the rows or vector B ."));
+  }
+  for (size_t i = 0; i < nQuestions; i++) {
+    const double defaultA = smppDefaults.Get()[i];
+    if (!(defaultA > 0)) {
+      fnFail(SRMessageBuilder(SR_FILE_LINE "The default cell of question ")(i)(" isn't positive: ")(defaultA)
+        .GetOwnedSRString());
+    }
+    _kb.InitQuestion(i, defaultA);
+  }
+
+  // The cells are read in chunks of the file buffer size, and distributed over the rows.
+  constexpr size_t cBufCells = _cFileBufSize / sizeof(KBFileSparseCell);
+  SRSmartMPP<KBFileSparseCell> smppBuf(_memPool, cBufCells);
+  const KBFileSparseCell *const PTR_RESTRICT pBuf = smppBuf.Get();
+  uint64_t nRead = 0;
+  size_t nBuffered = 0, iBuffered = 0;
+  std::vector<TPqaId> targets;
+  std::vector<double> values;
+  uint64_t rowBegin = 0;
+  for (size_t iRow = 0; iRow < nRows; iRow++) {
+    const uint64_t rowEnd = smppRowEnds.Get()[iRow];
+    if (rowEnd < rowBegin || rowEnd > nCells) {
+      fnFail(SRMessageBuilder(SR_FILE_LINE "The index of the sparse KB is damaged at row ")(iRow).GetOwnedSRString());
+    }
+    const size_t nRowCells = SRCast::ToSizeT(rowEnd - rowBegin);
+    targets.resize(nRowCells);
+    values.resize(nRowCells);
+    for (size_t j = 0; j < nRowCells; j++) {
+      if (iBuffered == nBuffered) {
+        nBuffered = SRCast::ToSizeT(std::min<uint64_t>(cBufCells, nCells - nRead));
+        if (!kbFi._file.ReadAt(smppBuf.Get(), nBuffered * sizeof(KBFileSparseCell),
+          sectCells._offset + nRead * sizeof(KBFileSparseCell)))
+        {
+          fnFail(SRString::MakeUnowned(SR_FILE_LINE "Can't read the explicit cells of the sparse KB."));
+        }
+        nRead += nBuffered;
+        iBuffered = 0;
+      }
+      const KBFileSparseCell &cell = pBuf[iBuffered];
+      iBuffered++;
+      if (cell._iTarget < 0 || cell._iTarget >= _dims._nTargets || (j > 0 && cell._iTarget <= targets[j - 1])) {
+        fnFail(SRMessageBuilder(SR_FILE_LINE "The targets of row ")(iRow)(" of the sparse KB are out of range or"
+          " order.").GetOwnedSRString());
+      }
+      targets[j] = cell._iTarget;
+      values[j] = cell._value;
+    }
+    _kb.ModRow(iRow).Assign(targets.data(), values.data(), nRowCells);
+    rowBegin = rowEnd;
+  }
+  if (rowBegin != nCells) {
+    fnFail(SRString::MakeUnowned(SR_FILE_LINE "The index of the sparse KB doesn't cover all the explicit cells."));
+  }
+
+  bool bOk = ReadGaps(kbFi, KBFileSectionKind::QuestionGaps, _dims._nQuestions, _questionGaps)
+    && ReadGaps(kbFi, KBFileSectionKind::TargetGaps, _dims._nTargets, _targetGaps);
+  const KBFileSection *pAsked = dir.Find(KBFileSectionKind::QuestionsAsked);
+  if (bOk && pAsked != nullptr) {
+    uint64_t nAsked;
+    bOk = kbFi._file.ReadAt(&nAsked, sizeof(nAsked), pAsked->_offset);
+    _nQuestionsAsked.store(nAsked, std::memory_order_relaxed);
+  }
+  if (!bOk) {
+    fnFail(SRString::MakeUnowned(SR_FILE_LINE "Can't read the gaps or the counter of questions asked."));
+  }
+}
+
+SparseCpuEngine::~SparseCpuEngine() {
+  PqaError pqaErr = Shutdown();
+  if (!pqaErr.IsOk() && pqaErr.GetCode() != PqaErrorCode::ObjectShutDown) {
+    CELOG(Error) << "Failed SparseCpuEngine::Shutdown(): " << pqaErr.ToString(true);
+  }
+}
+
+PqaError SparseCpuEngine::SetLogger(ISRLogger *pLogger) {
+  if (pLogger == nullptr) {
+    pLogger = SRDefaultLogger::Get();
+  }
+  _pLogger.store(pLogger, std::memory_order_release);
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::Shutdown(const char* const saveFilePath) {
+  if (!_maintSwitch.Shutdown()) {
+    // Return an error saying that the engine seems already shut down.
+    SRMessageBuilder mbMsg("MaintenanceSwitch seems already shut down.");
+    if (saveFilePath != nullptr) {
+      mbMsg(" Not saving file: ")(saveFilePath);
+    }
+    return PqaError(PqaErrorCode::ObjectShutDown, new ObjectShutDownErrorParams(SRString::MakeUnowned(
+      "SparseCpuEngine::Shutdown()")), mbMsg.GetOwnedSRString());
+  }
+  // By this moment, all operations must have shut down and no new operations can be started.
+
+  PqaError err;
+  if (saveFilePath != nullptr) do {
+    SRPositionalFile file;
+    if (!file.Open(saveFilePath, SRPositionalFile::Mode::Write)) {
+      err = PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(saveFilePath), SRString::MakeUnowned(
+        SR_FILE_LINE "Can't open the file to write KB to."));
+      break;
+    }
+    err = LockedSaveKB(file, saveFilePath);
+    if (err.IsOk() && !file.Close()) {
+      err = PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(saveFilePath), SRString::MakeUnowned(SR_FILE_LINE
+        "Failed in closing the file."));
+    }
+  } WHILE_FALSE;
+
+  //// Shutdown worker threads
+  _tpWorkers.RequestShutdown();
+
+  //// Release quizzes
+  for (size_t i = 0; i < _quizzes.size(); i++) {
+    if (_quizGaps.IsGap(i)) {
+      continue;
+    }
+    SRCheckingRelease(_memPool, _quizzes[i]);
+  }
+  _quizzes.clear();
+  _quizGaps.Compact(0);
+
+  //// Release KB
+  _kb.Clear();
+  _questionGaps.Compact(0);
+  _targetGaps.Compact(0);
+  _dims._nAnswers = _dims._nQuestions = _dims._nTargets = 0;
+
+  //// Release memory pool
+  _memPool.FreeAllChunks();
+
+  return err;
+}
+
+PqaError SparseCpuEngine::CheckAnsweredQuestions(const TPqaId nQuestions, const AnsweredQuestion* const pAQs) const {
+  for (TPqaId i = 0; i < nQuestions; i++) {
+    const TPqaId iQuestion = pAQs[i]._iQuestion;
+    if (iQuestion < 0 || iQuestion >= _dims._nQuestions) {
+      return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iQuestion, 0,
+        _dims._nQuestions - 1), SRString::MakeUnowned(SR_FILE_LINE "Question index is not in KB range."));
+    }
+    if (_questionGaps.IsGap(iQuestion)) {
+      return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iQuestion), SRString::MakeUnowned(
+        SR_FILE_LINE "Question index is not in KB (but rather at a gap)."));
+    }
+    const TPqaId iAnswer = pAQs[i]._iAnswer;
+    if (iAnswer < 0 || iAnswer >= _dims._nAnswers) {
+      return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iAnswer, 0,
+        _dims._nAnswers - 1), SRString::MakeUnowned(SR_FILE_LINE "Answer index is not in KB range."));
+    }
+  }
+  return PqaError();
+}
+
+void SparseCpuEngine::TrainOne(const AnsweredQuestion& aq, const TPqaId iTarget, const double twoB,
+  const double bSquare)
+{
+  const size_t iQuestion = SRCast::ToSizeT(aq._iQuestion);
+  // The rows of A and D are distinct, so inserting a cell into one doesn't move the cells of the other.
+  double &a = _kb.ModARow(iQuestion, SRCast::ToSizeT(aq._iAnswer)).Mod(iTarget, _kb.GetDefaultA(iQuestion));
+  double &d = _kb.ModDRow(iQuestion).Mod(iTarget, _kb.GetDefaultD(iQuestion));
+  // (a+b)**2 = a**2 + 2*a*b + b**2
+  const double addend = std::sqrt(a) * twoB + bSquare;
+  a += addend;
+  d += addend;
+}
+
+PqaError SparseCpuEngine::TrainInternal(const TPqaId nQuestions, const AnsweredQuestion* const pAQs,
+  const TPqaId iTarget, const TPqaAmount amount)
+{
+  if (nQuestions < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
+      "|nQuestions| must be non-negative."));
+  }
+  if (amount <= 0) {
+    return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(amount), SRString::MakeUnowned(
+      SR_FILE_LINE "|amount| must be positive."));
+  }
+  const CETrainTaskNumSpec<SRDoubleNumber> numSpec(amount);
+
+  MaintenanceSwitch::AgnosticLock msal(_maintSwitch);
+  // The training is sequential: unlike the dense engine, its cost is proportional to the number of questions rather
+  //   than to the number of targets.
+  SRRWLock<true> rwl(_rws);
+
+  if (iTarget < 0 || iTarget >= _dims._nTargets) {
+    const TPqaId nKB = _dims._nTargets;
+    rwl.EarlyRelease();
+    return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iTarget, 0, nKB - 1),
+      SRString::MakeUnowned("Target index is not in KB range."));
+  }
+  if (_targetGaps.IsGap(iTarget)) {
+    rwl.EarlyRelease();
+    return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iTarget), SRString::MakeUnowned(
+      "Target index is not in KB (but rather at a gap)."));
+  }
+  PqaError err = CheckAnsweredQuestions(nQuestions, pAQs);
+  if (!err.IsOk()) {
+    return std::move(err);
+  }
+
+  for (TPqaId i = 0; i < nQuestions; i++) {
+    TrainOne(pAQs[i], iTarget, numSpec._inc2B, numSpec._incBSquare);
+  }
+  _kb.ModB()[SRCast::ToSizeT(iTarget)] += amount;
+
+  // This method should increase the counter of questions asked by the number of questions in this training.
+  _nQuestionsAsked.fetch_add(nQuestions, std::memory_order_relaxed);
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::Train(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget,
+  const TPqaAmount amount)
+{
+  try {
+    return TrainInternal(nQuestions, pAQs, iTarget, amount);
+  }
+  CATCH_TO_ERR_RETURN;
+}
+
+void SparseCpuEngine::ApplyAnswer(CESparseQuiz &quiz, const AnsweredQuestion& aq) const {
+  const size_t iQuestion = SRCast::ToSizeT(aq._iQuestion);
+  const CESparseRow &PTR_RESTRICT rowD = _kb.GetDRow(iQuestion);
+  const TPqaId *const PTR_RESTRICT pExplicit = rowD.GetTargets();
+  const double *const PTR_RESTRICT pD = rowD.GetValues();
+  double *const PTR_RESTRICT pLogLhs = quiz.GetLogLhs();
+  CESparseKB::ForEachMerged(pExplicit, rowD.GetSize(), _kb.GetARow(iQuestion, SRCast::ToSizeT(aq._iAnswer)),
+    _kb.GetDefaultA(iQuestion), [&](const size_t j, const double a)
+  {
+    pLogLhs[pExplicit[j]] += std::log2(a / pD[j]) - _defaultLog2Ratio;
+  });
+}
+
+TPqaId SparseCpuEngine::CreateQuizInternal(PqaError& err, const TPqaId nAnswered, const AnsweredQuestion* const pAQs) {
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      err = PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " regular-only mode operation (Start/Resume quiz) because current mode is not regular"
+        " (but maintenance/shutdown?)."));
+      return cInvalidPqaId;
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+    err = CheckAnsweredQuestions(nAnswered, pAQs);
+    if (!err.IsOk()) {
+      return cInvalidPqaId;
+    }
+
+    SRObjectMPP<CESparseQuiz> spQuiz(_memPool, this);
+    CESparseQuiz &quiz = *spQuiz.Get();
+    __m256i *pQAsked = quiz.GetQAsked();
+    SRUtils::FillZeroVects<true>(pQAsked, SRSimd::VectsFromBits(_dims._nQuestions));
+    for (TPqaId i = 0; i < nAnswered; i++) {
+      SRBitHelper::Set(pQAsked, pAQs[i]._iQuestion);
+    }
+    quiz.ModAnswers().insert(quiz.ModAnswers().end(), pAQs, pAQs + nAnswered);
+
+    {
+      SRRWLock<false> rwl(_rws);
+      double *const PTR_RESTRICT pLogLhs = quiz.GetLogLhs();
+      const double *const PTR_RESTRICT pB = _kb.GetB();
+      for (TPqaId i = 0; i < _dims._nTargets; i++) {
+        pLogLhs[i] = (_targetGaps.IsGap(i) ? -std::numeric_limits<double>::infinity() : std::log2(pB[i]));
+      }
+      for (TPqaId i = 0; i < nAnswered; i++) {
+        ApplyAnswer(quiz, pAQs[i]);
+      }
+    }
+
+    TPqaId quizId;
+    {
+      SRLock<SRCriticalSection> csl(_csQuizReg);
+      quizId = _quizGaps.Acquire();
+      if (quizId >= TPqaId(_quizzes.size())) {
+        assert(quizId == TPqaId(_quizzes.size()));
+        _quizzes.emplace_back(nullptr);
+      }
+      _quizzes[SRCast::ToSizeT(quizId)] = spQuiz.Detach();
+    }
+    return quizId;
+  }
+  CATCH_TO_ERR_SET(err);
+  return cInvalidPqaId;
+}
+
+TPqaId SparseCpuEngine::StartQuiz(PqaError& err) {
+  return CreateQuizInternal(err, 0, nullptr);
+}
+
+TPqaId SparseCpuEngine::ResumeQuiz(PqaError& err, const TPqaId nAnswered, const AnsweredQuestion* const pAQs) {
+  if (nAnswered < 0) {
+    err = PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nAnswered), SRString::MakeUnowned(
+      "|nAnswered| must be non-negative."));
+    return cInvalidPqaId;
+  }
+  return CreateQuizInternal(err, nAnswered, pAQs);
+}
+
+CESparseQuiz* SparseCpuEngine::UseQuiz(PqaError& err, const TPqaId iQuiz) {
+  SRLock<SRCriticalSection> csl(_csQuizReg);
+  const TPqaId nQuizzes = _quizzes.size();
+  if (iQuiz < 0 || iQuiz >= nQuizzes) {
+    csl.EarlyRelease();
+    // For nQuizzes == 0, this may return [0;-1] range: we can't otherwise return an empty range because we return
+    //   the range with both bounds inclusive.
+    err = PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iQuiz, 0, nQuizzes - 1),
+      SRString::MakeUnowned(SR_FILE_LINE "Quiz index is not in quiz registry range."));
+    return nullptr;
+  }
+  if (_quizGaps.IsGap(iQuiz)) {
+    csl.EarlyRelease();
+    err = PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iQuiz), SRString::MakeUnowned(
+      SR_FILE_LINE "Quiz index is not in the registry (but rather at a gap)."));
+    return nullptr;
+  }
+  return _quizzes[iQuiz];
+}
+
+PqaError SparseCpuEngine::CalcPriorStats(CESparseEvalQsTask &task, const CESparseQuiz &quiz) {
+  const TPqaId nTargets = _dims._nTargets;
+  const double *const PTR_RESTRICT pLogLhs = quiz.GetLogLhs();
+
+  double maxLogLh = -std::numeric_limits<double>::infinity();
+  for (TPqaId i = 0; i < nTargets; i++) {
+    maxLogLh = std::max(maxLogLh, pLogLhs[i]);
+  }
+  if (!std::isfinite(maxLogLh)) {
+    return MAKE_INTERR_MSG(SRString::MakeUnowned("Max log-likelihood over the priors is not finite. Are all the"
+      " targets in gaps?"));
+  }
+  SRAccumulator<SRDoubleNumber> accLhs(SRDoubleNumber(0.0));
+  for (TPqaId i = 0; i < nTargets; i++) {
+    accLhs.Add(SRDoubleNumber::FromDouble(std::exp2(pLogLhs[i] - maxLogLh)));
+  }
+  const double logNorm = maxLogLh + std::log2(accLhs.Get().GetValue());
+
+  SRAccumulator<SRDoubleNumber> accPLog2P(SRDoubleNumber(0.0));
+  SRAccumulator<SRDoubleNumber> accPSquare(SRDoubleNumber(0.0));
+  double minLog2P = CESparseEvalQsTask::_cHeavyLog2;
+  task._nHeavy = 0;
+  for (TPqaId i = 0; i < nTargets; i++) {
+    const double log2P = pLogLhs[i] - logNorm;
+    const double p = std::exp2(log2P);
+    task._pProbs[i] = p;
+    task._pLog2Probs[i] = log2P;
+    task._pLackLog2[i] = log2P;
+    if (p <= 0) {
+      continue;
+    }
+    accPLog2P.Add(SRDoubleNumber::FromDouble(p * log2P));
+    accPSquare.Add(SRDoubleNumber::FromDouble(p * p));
+    if (log2P >= CESparseEvalQsTask::_cHeavyLog2 && task._nHeavy < CESparseEvalQsTask::_cMaxHeavy) {
+      task._pHeavyLog2[task._nHeavy] = log2P;
+      task._nHeavy++;
+    } else {
+      minLog2P = std::min(minLog2P, log2P);
+    }
+  }
+  task._sumPLog2P = accPLog2P.Get().GetValue();
+  task._sumPSquare = accPSquare.Get().GetValue();
+
+  //// Histogram of the light priors over log2(-log2(p)), so that the bins are narrow relative to log2(p)
+  task._binLow = std::log2(-CESparseEvalQsTask::_cHeavyLog2);
+  const double span = std::log2(-minLog2P) - task._binLow;
+  task._binScale = ((span > 0) ? (CESparseEvalQsTask::_cNBins / span) : 0);
+  std::fill(task._pBinCounts, task._pBinCounts + CESparseEvalQsTask::_cNBins, 0.0);
+  std::fill(task._pBinMeans, task._pBinMeans + CESparseEvalQsTask::_cNBins, 0.0);
+  TPqaId nHeavySeen = 0;
+  for (TPqaId i = 0; i < nTargets; i++) {
+    const double log2P = task._pLog2Probs[i];
+    if (task._pProbs[i] <= 0) {
+      continue;
+    }
+    // The heavy targets were taken in the increasing order of target index.
+    if (log2P >= CESparseEvalQsTask::_cHeavyLog2 && nHeavySeen < task._nHeavy) {
+      nHeavySeen++;
+      continue;
+    }
+    const TPqaId iBin = task.GetBin(log2P);
+    task._pBinCounts[iBin] += 1;
+    task._pBinMeans[iBin] += log2P;
+  }
+  for (TPqaId i = 0; i < CESparseEvalQsTask::_cNBins; i++) {
+    if (task._pBinCounts[i] != 0) {
+      task._pBinMeans[i] /= task._pBinCounts[i];
+    }
+  }
+  // The light targets stand for the means of their bins, so that the lack over the explicit targets is subtracted
+  //   from SumLack() consistently.
+  nHeavySeen = 0;
+  for (TPqaId i = 0; i < nTargets; i++) {
+    const double log2P = task._pLog2Probs[i];
+    if (task._pProbs[i] <= 0) {
+      continue;
+    }
+    if (log2P >= CESparseEvalQsTask::_cHeavyLog2 && nHeavySeen < task._nHeavy) {
+      nHeavySeen++;
+      continue;
+    }
+    task._pLackLog2[i] = task._pBinMeans[task.GetBin(log2P)];
+  }
+  return PqaError();
+}
+
+TPqaId SparseCpuEngine::NextQuestion(PqaError& err, const TPqaId iQuiz) {
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    err = PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (compute next question) because current mode is not regular (but maintenance/shutdown?)."));
+    return cInvalidPqaId;
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  CESparseQuiz *pQuiz = UseQuiz(err, iQuiz);
+  if (pQuiz == nullptr) {
+    assert(!err.IsOk());
+    return cInvalidPqaId;
+  }
+
+  const SRSubtaskCount nWorkers = _tpWorkers.GetWorkerCount() * 8;
+  const size_t nTargets = SRCast::ToSizeT(_dims._nTargets);
+  SRMemTotal mtCommon;
+  const SRByteMem miSubtasks(nWorkers * sizeof(CESparseEvalQsSubtask), SRMemPadding::None, mtCommon);
+  const SRByteMem miSplit(SRPoolRunner::CalcSplitMemReq(nWorkers), SRMemPadding::Both, mtCommon);
+  const SRMemItem<SRDoubleNumber> miRunLength(_dims._nQuestions, SRMemPadding::Both, mtCommon);
+  const SRMemItem<SRDoubleNumber> miGrandTotals(nWorkers, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miProbs(nTargets, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miLog2Probs(nTargets, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miLackLog2(nTargets, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miHeavyLog2(CESparseEvalQsTask::_cMaxHeavy, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miBinCounts(CESparseEvalQsTask::_cNBins, SRMemPadding::Both, mtCommon);
+  const SRMemItem<double> miBinMeans(CESparseEvalQsTask::_cNBins, SRMemPadding::Both, mtCommon);
+
+  SRSmartMPP<uint8_t> commonBuf(_memPool, mtCommon._nBytes);
+  SRPoolRunner pr(_tpWorkers, miSubtasks.BytePtr(commonBuf));
+
+  TPqaId selQuestion;
+  do {
+    CESparseEvalQsTask evalQsTask(*this, *pQuiz, _dims._nTargets - _targetGaps.GetNGaps(),
+      miRunLength.Ptr(commonBuf));
+    evalQsTask._pProbs = miProbs.Ptr(commonBuf);
+    evalQsTask._pLog2Probs = miLog2Probs.Ptr(commonBuf);
+    evalQsTask._pLackLog2 = miLackLog2.Ptr(commonBuf);
+    evalQsTask._pHeavyLog2 = miHeavyLog2.Ptr(commonBuf);
+    evalQsTask._pBinCounts = miBinCounts.Ptr(commonBuf);
+    evalQsTask._pBinMeans = miBinMeans.Ptr(commonBuf);
+    err = CalcPriorStats(evalQsTask, *pQuiz);
+    if (!err.IsOk()) {
+      return cInvalidPqaId;
+    }
+    // Although there are no more subtasks which would use this split, it will be used for run-length analysis.
+    const SRPoolRunner::Split questionSplit = SRPoolRunner::CalcSplit(miSplit.BytePtr(commonBuf), _dims._nQuestions,
+      nWorkers);
+    {
+      SRRWLock<false> rwl(_rws);
+      pr.RunPreSplit<CESparseEvalQsSubtask>(evalQsTask, questionSplit);
+    }
+    SRAccumulator<SRDoubleNumber> accTotG(SRDoubleNumber(0.0));
+    const SRDoubleNumber *const PTR_RESTRICT pRunLength = evalQsTask.GetRunLength();
+    SRDoubleNumber *const PTR_RESTRICT pGrandTotals = miGrandTotals.Ptr(commonBuf);
+    for (SRSubtaskCount i = 0; i < questionSplit._nSubtasks; i++) {
+      const SRDoubleNumber curGT = pRunLength[questionSplit._pBounds[i] - 1];
+      accTotG.Add(curGT);
+      pGrandTotals[i] = accTotG.Get();
+      if (!pGrandTotals[i].IsFinite()) {
+        CELOG(Error) << SR_FILE_LINE << "Overflow or underflow has happened in the question evaluation subtasks: "
+          << pGrandTotals[i].ToAmount();
+      }
+    }
+    const SRDoubleNumber totG = pGrandTotals[questionSplit._nSubtasks - 1];
+    if (totG <= TPqaAmount(0)) {
+      CELOG(Warning) << SR_FILE_LINE << "Grand-grand total is " << totG.ToAmount();
+    }
+    const SRDoubleNumber selRunLen = SRDoubleNumber::MakeRandom(totG, SRFastRandom::ThreadLocal());
+    const SRSubtaskCount iWorker = static_cast<SRSubtaskCount>(
+      std::upper_bound(pGrandTotals, pGrandTotals + questionSplit._nSubtasks, selRunLen) - pGrandTotals);
+    if (iWorker >= questionSplit._nSubtasks) {
+      assert(iWorker == questionSplit._nSubtasks);
+      selQuestion = _dims._nQuestions - 1;
+      break;
+    }
+
+    const SRDoubleNumber inWorkerRunLen = selRunLen
+      - ((iWorker == 0) ? SRDoubleNumber(0.0) : pGrandTotals[iWorker-1]);
+    const TPqaId iFirst = ((iWorker == 0) ? 0 : questionSplit._pBounds[iWorker - 1]);
+    const TPqaId iLimit = questionSplit._pBounds[iWorker];
+    selQuestion = std::upper_bound(pRunLength + iFirst, pRunLength + iLimit, inWorkerRunLen) - pRunLength;
+    if (selQuestion >= iLimit) {
+      assert(selQuestion == iLimit);
+      CELOG(Warning) << SR_FILE_LINE "Hopefully due to a rounding error, within-worker run length binary search hasn't"
+        " found a strictly greater value. Random selection: " << selRunLen.ToAmount() << ", in-worker run length "
+        << inWorkerRunLen.ToAmount() << ", worker index " << iWorker;
+      selQuestion = iLimit - 1;
+    }
+  } WHILE_FALSE;
+
+  // If the selected question is in a gap or already answered, try to select the neighboring questions
+  if (_questionGaps.IsGap(selQuestion) || SRBitHelper::Test(pQuiz->GetQAsked(), selQuestion)) {
+    selQuestion = FindNearestQuestion(selQuestion, *pQuiz);
+  }
+  if (selQuestion == cInvalidPqaId) {
+    err = PqaError(PqaErrorCode::QuestionsExhausted, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Found no unasked"
+      " question that is not in a gap."));
+    return cInvalidPqaId;
+  }
+  pQuiz->SetActiveQuestion(selQuestion);
+  _nQuestionsAsked.fetch_add(1, std::memory_order_relaxed);
+  return selQuestion;
+}
+
+PqaError SparseCpuEngine::RecordAnswer(const TPqaId iQuiz, const TPqaId iAnswer) {
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (record an answer) because current mode is not regular (but maintenance/shutdown?)."));
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  // Check that iAnswer is within the range
+  if (iAnswer < 0 || iAnswer >= _dims._nAnswers) {
+    return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iAnswer, 0, _dims._nAnswers - 1),
+      SRString::MakeUnowned("Answer index is not in the answer range."));
+  }
+
+  CESparseQuiz *pQuiz;
+  {
+    PqaError err;
+    pQuiz = UseQuiz(err, iQuiz);
+    if (pQuiz == nullptr) {
+      assert(!err.IsOk());
+      return std::move(err);
+    }
+  }
+
+  return pQuiz->RecordAnswer(iAnswer);
+}
+
+TPqaId SparseCpuEngine::ListTopTargets(PqaError& err, const TPqaId iQuiz, const TPqaId maxCount, RatedTarget *pDest) {
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    err = PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (list top targets) because current mode is not regular (but maintenance/shutdown?)."));
+    return cInvalidPqaId;
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  CESparseQuiz *pQuiz = UseQuiz(err, iQuiz);
+  if (pQuiz == nullptr) {
+    assert(!err.IsOk());
+    return cInvalidPqaId;
+  }
+  if (maxCount < 0) {
+    err = PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(maxCount), SRString::MakeUnowned(
+      SR_FILE_LINE "|maxCount| must be non-negative."));
+    return cInvalidPqaId;
+  }
+
+  const double *const PTR_RESTRICT pLogLhs = pQuiz->GetLogLhs();
+  const TPqaId nValidTargets = _dims._nTargets - _targetGaps.GetNGaps();
+  SRSmartMPP<TPqaId> smppIds(_memPool, nValidTargets);
+  TPqaId *const PTR_RESTRICT pIds = smppIds.Get();
+  double maxLogLh = -std::numeric_limits<double>::infinity();
+  TPqaId nIds = 0;
+  for (TPqaId i = 0; i < _dims._nTargets; i++) {
+    if (_targetGaps.IsGap(i)) {
+      continue;
+    }
+    pIds[nIds] = i;
+    nIds++;
+    maxLogLh = std::max(maxLogLh, pLogLhs[i]);
+  }
+  assert(nIds == nValidTargets);
+  SRAccumulator<SRDoubleNumber> accLhs(SRDoubleNumber(0.0));
+  for (TPqaId i = 0; i < nIds; i++) {
+    accLhs.Add(SRDoubleNumber::FromDouble(std::exp2(pLogLhs[pIds[i]] - maxLogLh)));
+  }
+  const double logNorm = maxLogLh + std::log2(accLhs.Get().GetValue());
+
+  const TPqaId nListed = std::min(maxCount, nIds);
+  std::partial_sort(pIds, pIds + nListed, pIds + nIds, [pLogLhs](const TPqaId a, const TPqaId b) {
+    return pLogLhs[a] > pLogLhs[b];
+  });
+  for (TPqaId i = 0; i < nListed; i++) {
+    pDest[i]._iTarget = pIds[i];
+    pDest[i]._prob = std::exp2(pLogLhs[pIds[i]] - logNorm);
+  }
+  return nListed;
+}
+
+PqaError SparseCpuEngine::RecordQuizTarget(const TPqaId iQuiz, const TPqaId iTarget, const TPqaAmount amount) {
+  if (amount <= 0) {
+    return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(amount), SRString::MakeUnowned(
+      SR_FILE_LINE "|amount| must be positive."));
+  }
+
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (record quiz target) because current mode is not regular (but maintenance/shutdown?)."));
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  if (iTarget < 0 || iTarget >= _dims._nTargets) {
+    const TPqaId nKB = _dims._nTargets;
+    mssl.EarlyRelease();
+    return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iTarget, 0, nKB - 1),
+      SRString::MakeUnowned(SR_FILE_LINE "Target index is not in KB range."));
+  }
+
+  if (_targetGaps.IsGap(iTarget)) {
+    mssl.EarlyRelease();
+    return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iTarget), SRString::MakeUnowned(SR_FILE_LINE
+      "Target index is not in KB (but rather at a gap)."));
+  }
+
+  CESparseQuiz *pQuiz;
+  {
+    PqaError err;
+    pQuiz = UseQuiz(err, iQuiz);
+    if (pQuiz == nullptr) {
+      assert(!err.IsOk());
+      return std::move(err);
+    }
+  }
+
+  const std::vector<AnsweredQuestion>& answers = pQuiz->GetAnswers();
+  const CETrainTaskNumSpec<SRDoubleNumber> numSpec(amount);
+  {
+    SRRWLock<true> rwl(_rws);
+    for (const AnsweredQuestion& aq : answers) {
+      TrainOne(aq, iTarget, numSpec._inc2B, numSpec._incBSquare);
+    }
+    _kb.ModB()[SRCast::ToSizeT(iTarget)] += amount;
+  }
+
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::ReleaseQuiz(const TPqaId iQuiz) {
+  constexpr auto msMode = MaintenanceSwitch::Mode::Regular;
+  if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+    return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform regular-only"
+      " mode operation (release quiz) because current mode is not regular (but maintenance/shutdown?)."));
+  }
+  MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+
+  CESparseQuiz *pQuiz;
+  {
+    SRLock<SRCriticalSection> csl(_csQuizReg);
+    const TPqaId nQuizzes = _quizzes.size();
+    if (iQuiz < 0 || iQuiz >= nQuizzes) {
+      csl.EarlyRelease();
+      // For nQuizzes == 0, this may return [0;-1] range: we can't otherwise return an empty range because we return
+      //   the range with both bounds inclusive.
+      return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iQuiz, 0, nQuizzes - 1),
+        SRString::MakeUnowned(SR_FILE_LINE "Quiz index is not in quiz registry range."));
+    }
+    if (_quizGaps.IsGap(iQuiz)) {
+      csl.EarlyRelease();
+      return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iQuiz), SRString::MakeUnowned(
+        SR_FILE_LINE "Quiz index is not in the registry (but rather at a gap)."));
+    }
+
+    pQuiz = _quizzes[iQuiz];
+    _quizzes[iQuiz] = nullptr; // avoid double-free problems
+
+    _quizGaps.Release(iQuiz);
+  }
+
+  SRCheckingRelease(_memPool, pQuiz);
+
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::LockedSaveKB(const SRPositionalFile &file, const char* const filePath) {
+  const size_t nQuestions = SRCast::ToSizeT(_dims._nQuestions);
+  const size_t nTargets = SRCast::ToSizeT(_dims._nTargets);
+  const size_t nRows = _kb.GetNRows();
+  uint64_t nCells = 0;
+  for (size_t iRow = 0; iRow < nRows; iRow++) {
+    nCells += _kb.GetRow(iRow).GetSize();
+  }
+  KBFileDirectory dir;
+  dir.InitSparse(_precDef, _dims, nCells);
+  // The gaps between the sections read as zeros after the preallocation.
+  if (!file.Preallocate(dir.GetFileBytes()) || !file.WriteAt(&dir, sizeof(dir), 0)) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't preallocate the KB file or write its header and directory."));
+  }
+
+  // The cells of the rows go one after another, and are written in chunks of the file buffer size.
+  const uint64_t offsCells = dir.Find(KBFileSectionKind::SparseCells)->_offset;
+  constexpr size_t cBufCells = _cFileBufSize / sizeof(KBFileSparseCell);
+  SRSmartMPP<KBFileSparseCell> smppBuf(_memPool, cBufCells);
+  SRSmartMPP<uint64_t> smppRowEnds(_memPool, nRows);
+  KBFileSparseCell *const PTR_RESTRICT pBuf = smppBuf.Get();
+  uint64_t nWritten = 0;
+  size_t nBuffered = 0;
+  auto fnFlush = [&]() {
+    const bool bOk = file.WriteAt(pBuf, nBuffered * sizeof(KBFileSparseCell),
+      offsCells + nWritten * sizeof(KBFileSparseCell));
+    nWritten += nBuffered;
+    nBuffered = 0;
+    return bOk;
+  };
+  bool bOk = true;
+  for (size_t iRow = 0; bOk && iRow < nRows; iRow++) {
+    const CESparseRow &row = _kb.GetRow(iRow);
+    for (size_t j = 0; bOk && j < row.GetSize(); j++) {
+      if (nBuffered == cBufCells) {
+        bOk = fnFlush();
+      }
+      pBuf[nBuffered]._iTarget = row.GetTargets()[j];
+      pBuf[nBuffered]._value = row.GetValues()[j];
+      nBuffered++;
+    }
+    smppRowEnds.Get()[iRow] = nWritten + nBuffered;
+  }
+  bOk = bOk && fnFlush()
+    && file.WriteAt(smppRowEnds.Get(), nRows * sizeof(uint64_t), dir.Find(KBFileSectionKind::SparseIndex)->_offset)
+    && file.WriteAt(_kb.GetDefaultsA(), nQuestions * sizeof(double),
+      dir.Find(KBFileSectionKind::QuestionDefaults)->_offset)
+    && file.WriteAt(_kb.GetB(), nTargets * sizeof(double), dir.Find(KBFileSectionKind::VectorB)->_offset);
+  if (!bOk) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't write the KB weights."));
+  }
+
+  std::vector<uint64_t> questionGaps, targetGaps;
+  PackGaps(_dims._nQuestions, _questionGaps, questionGaps);
+  PackGaps(_dims._nTargets, _targetGaps, targetGaps);
+  const uint64_t nQuestionsAsked = _nQuestionsAsked.load(std::memory_order_relaxed);
+  // The sparse engine has no training journal, so it doesn't count the trainings.
+  const uint64_t nTrainings = 0;
+  bOk = file.WriteAt(questionGaps.data(), questionGaps.size() * sizeof(uint64_t),
+      dir.Find(KBFileSectionKind::QuestionGaps)->_offset)
+    && file.WriteAt(targetGaps.data(), targetGaps.size() * sizeof(uint64_t),
+      dir.Find(KBFileSectionKind::TargetGaps)->_offset)
+    && file.WriteAt(&nQuestionsAsked, sizeof(nQuestionsAsked), dir.Find(KBFileSectionKind::QuestionsAsked)->_offset)
+    && file.WriteAt(&nTrainings, sizeof(nTrainings), dir.Find(KBFileSectionKind::TrainingsCount)->_offset);
+  if (!bOk) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Can't write the gaps or the counters of questions asked and trainings."));
+  }
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::SaveKB(const char* const filePath, const bool bDoubleBuffer, const bool bCompress)
+{
+  (void)bDoubleBuffer; // only the explicit cells are written, so a snapshot wouldn't shorten the lock much
+  if (bCompress) {
+    return PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
+      "SparseCpuEngine::SaveKB() with compression")));
+  }
+  const auto tStart = std::chrono::steady_clock::now();
+  SRPositionalFile file;
+  if (!file.Open(filePath, SRPositionalFile::Mode::Write)) {
+    return PqaError(PqaErrorCode::CantOpenFile, new CantOpenFileErrorParams(filePath), SRString::MakeUnowned(
+      SR_FILE_LINE "Can't open the file to write KB to."));
+  }
+
+  std::chrono::steady_clock::duration lockTime;
+  {
+    MaintenanceSwitch::AgnosticLock msal(_maintSwitch);
+    SRRWLock<false> rwl(_rws);
+    const auto tLocked = std::chrono::steady_clock::now();
+
+    PqaError err = LockedSaveKB(file, filePath);
+    if (!err.IsOk()) {
+      return std::move(err);
+    }
+    lockTime = std::chrono::steady_clock::now() - tLocked;
+  }
+
+  // Close it explicitly here, to be able to handle and report an error
+  if (!file.Close()) {
+    return PqaError(PqaErrorCode::FileOp, new FileOpErrorParams(filePath), SRString::MakeUnowned(SR_FILE_LINE
+      "Failed in closing the file."));
+  }
+
+  _lastSaveLockMicros.store(SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(lockTime).count()),
+    std::memory_order_relaxed);
+  _lastSaveMicros.store(SRCast::ToUint64(std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - tStart).count()), std::memory_order_relaxed);
+  return PqaError();
+}
+
+uint64_t SparseCpuEngine::GetTotalQuestionsAsked(PqaError& err) {
+  err.Release();
+  return _nQuestionsAsked.load(std::memory_order_relaxed);
+}
+
+PqaError SparseCpuEngine::SaveKBIncremental(const char* const filePath) {
+  // The explicit cells have no fixed place in the file, so it can't be patched, while the sparse KB is small anyway.
+  return SaveKB(filePath, false);
+}
+
+IPqaSaveKBJob* SparseCpuEngine::SaveKBAsync(PqaError& err, const char* const filePath, const SaveKBOptions &options) {
+  (void)filePath; (void)options;
+  // The sparse KB is saved by SaveKB() in time proportional to the trained cells, under the reader lock only.
+  err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
+    "SparseCpuEngine::SaveKBAsync")));
+  return nullptr;
+}
+
+IPqaRecomputeDJob* SparseCpuEngine::RecomputeDAsync(PqaError& err, const RecomputeDOptions &options) {
+  (void)options;
+  // Only the explicit cells of D accumulate the rounding errors of training, and there are few of them.
+  err = PqaError(PqaErrorCode::NotImplemented, new NotImplementedErrorParams(SRString::MakeUnowned(
+    "SparseCpuEngine::RecomputeDAsync")));
+  return nullptr;
+}
+
+PqaError SparseCpuEngine::GetStats(EngineStats &stats) {
+  stats._nQuestionsAsked = _nQuestionsAsked.load(std::memory_order_relaxed);
+  {
+    SRRWLock<false> rwl(_rws);
+    stats._kbBytes = _kb.GetNBytes();
+  }
+  stats._kbLargePages = false;
+  stats._kbMapped = false;
+  stats._nPoolLargePageAllocs = _memPool.GetNLargePageAllocs();
+  stats._nPoolLargePageFallbacks = _memPool.GetNLargePageFallbacks();
+  stats._lastSaveMicros = _lastSaveMicros.load(std::memory_order_relaxed);
+  stats._lastSaveLockMicros = _lastSaveLockMicros.load(std::memory_order_relaxed);
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::StartMaintenance(const bool forceQuizes) {
+  try {
+    // Wait for the regular-only operations to finish, and deny the new ones, so that the quizzes can't be used.
+    _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Maintenance>();
+    SRLock<SRCriticalSection> csl(_csQuizReg);
+    const TPqaId nQuizzes = TPqaId(_quizzes.size()) - _quizGaps.GetNGaps();
+    if (nQuizzes > 0 && !forceQuizes) {
+      csl.EarlyRelease();
+      _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Regular>();
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRMessageBuilder(SR_FILE_LINE "Can't start maintenance because"
+        " there are ")(nQuizzes)(" quizzes in progress.").GetOwnedSRString());
+    }
+    // The quizzes are computed for the current dimensions of the KB, which maintenance changes.
+    for (size_t i = 0; i < _quizzes.size(); i++) {
+      if (_quizGaps.IsGap(i)) {
+        continue;
+      }
+      SRCheckingRelease(_memPool, _quizzes[i]);
+    }
+    _quizzes.clear();
+    _quizGaps.Compact(0);
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::FinishMaintenance() {
+  try {
+    // The stacks of the workers depend only on the number of answers, which maintenance doesn't change.
+    _maintSwitch.SwitchMode<MaintenanceSwitch::Mode::Regular>();
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::AddQuestions(TPqaId nQuestions, AddQuestionParam *pAqps) {
+  if (nQuestions < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
+      SR_FILE_LINE "|nQuestions| must be non-negative."));
+  }
+  for (TPqaId i = 0; i < nQuestions; i++) {
+    if (pAqps[i]._initialAmount <= 0) {
+      return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(pAqps[i]._initialAmount),
+        SRString::MakeUnowned(SR_FILE_LINE "The initial amount of a question must be positive."));
+    }
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (add questions) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // The gaps are reused first, then the questions are appended.
+    const TPqaId nAppended = std::max<TPqaId>(0, nQuestions - _questionGaps.GetNGaps());
+    _kb.Grow(SRCast::ToSizeT(_dims._nQuestions + nAppended), SRCast::ToSizeT(_dims._nTargets));
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      const TPqaId iQuestion = _questionGaps.Acquire();
+      pAqps[i]._iQuestion = iQuestion;
+      // All the cells of the question are default, as in the dense engine they are initialized to the same value.
+      const double init1 = SRCast::ToDouble(pAqps[i]._initialAmount);
+      _kb.InitQuestion(SRCast::ToSizeT(iQuestion), init1 * init1);
+    }
+    _dims._nQuestions += nAppended;
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::AddTargets(TPqaId nTargets, AddTargetParam *pAtps) {
+  if (nTargets < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nTargets), SRString::MakeUnowned(
+      SR_FILE_LINE "|nTargets| must be non-negative."));
+  }
+  for (TPqaId i = 0; i < nTargets; i++) {
+    if (pAtps[i]._initialAmount <= 0) {
+      return PqaError(PqaErrorCode::NonPositiveAmount, new NonPositiveAmountErrorParams(pAtps[i]._initialAmount),
+        SRString::MakeUnowned(SR_FILE_LINE "The initial amount of a target must be positive."));
+    }
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (add targets) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // The gaps are reused first, then the targets are appended.
+    const TPqaId nAppended = std::max<TPqaId>(0, nTargets - _targetGaps.GetNGaps());
+    _kb.Grow(SRCast::ToSizeT(_dims._nQuestions), SRCast::ToSizeT(_dims._nTargets + nAppended));
+    for (TPqaId i = 0; i < nTargets; i++) {
+      const TPqaId iTarget = _targetGaps.Acquire();
+      pAtps[i]._iTarget = iTarget;
+      // The cells of the target are explicit only in the questions whose initial amount differs from the target's.
+      const double init1 = SRCast::ToDouble(pAtps[i]._initialAmount);
+      _kb.InitTarget(iTarget, init1 * init1, init1);
+    }
+    _dims._nTargets += nAppended;
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::RemoveQuestions(const TPqaId nQuestions, const TPqaId *pQIds) {
+  if (nQuestions < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nQuestions), SRString::MakeUnowned(
+      SR_FILE_LINE "|nQuestions| must be non-negative."));
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (remove questions) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // Validate all the ids before removing any, so that a failure leaves the KB intact.
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      const TPqaId iQuestion = pQIds[i];
+      if (iQuestion < 0 || iQuestion >= _dims._nQuestions) {
+        const TPqaId nKB = _dims._nQuestions;
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iQuestion, 0, nKB - 1),
+          SRString::MakeUnowned(SR_FILE_LINE "Question index is not in KB range."));
+      }
+      if (_questionGaps.IsGap(iQuestion)) {
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iQuestion), SRString::MakeUnowned(
+          SR_FILE_LINE "Question index is not in KB (but rather at a gap)."));
+      }
+    }
+    // The cells stay in the KB until it's compacted or the question is added again. A repeated id is removed once.
+    for (TPqaId i = 0; i < nQuestions; i++) {
+      if (!_questionGaps.IsGap(pQIds[i])) {
+        _questionGaps.Release(pQIds[i]);
+      }
+    }
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::RemoveTargets(const TPqaId nTargets, const TPqaId *pTIds) {
+  if (nTargets < 0) {
+    return PqaError(PqaErrorCode::NegativeCount, new NegativeCountErrorParams(nTargets), SRString::MakeUnowned(
+      SR_FILE_LINE "|nTargets| must be non-negative."));
+  }
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (remove targets) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    // Validate all the ids before removing any, so that a failure leaves the KB intact.
+    for (TPqaId i = 0; i < nTargets; i++) {
+      const TPqaId iTarget = pTIds[i];
+      if (iTarget < 0 || iTarget >= _dims._nTargets) {
+        const TPqaId nKB = _dims._nTargets;
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::IndexOutOfRange, new IndexOutOfRangeErrorParams(iTarget, 0, nKB - 1),
+          SRString::MakeUnowned(SR_FILE_LINE "Target index is not in KB range."));
+      }
+      if (_targetGaps.IsGap(iTarget)) {
+        rwl.EarlyRelease();
+        return PqaError(PqaErrorCode::AbsentId, new AbsentIdErrorParams(iTarget), SRString::MakeUnowned(
+          SR_FILE_LINE "Target index is not in KB (but rather at a gap)."));
+      }
+    }
+    // The cells stay in the KB until it's compacted or the target is added again. A repeated id is removed once.
+    for (TPqaId i = 0; i < nTargets; i++) {
+      if (!_targetGaps.IsGap(pTIds[i])) {
+        _targetGaps.Release(pTIds[i]);
+      }
+    }
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::Compact(CompactionResult &cr) {
+  try {
+    constexpr auto msMode = MaintenanceSwitch::Mode::Maintenance;
+    if (!_maintSwitch.TryEnterSpecific<msMode>()) {
+      return PqaError(PqaErrorCode::WrongMode, nullptr, SRString::MakeUnowned(SR_FILE_LINE "Can't perform"
+        " maintenance-only mode operation (compact) because current mode is not maintenance (but"
+        " regular/shutdown?)."));
+    }
+    MaintenanceSwitch::SpecificLeaver<msMode> mssl(_maintSwitch);
+    SRRWLock<true> rwl(_rws);
+    const TPqaId nQuestions = _dims._nQuestions - _questionGaps.GetNGaps();
+    const TPqaId nTargets = _dims._nTargets - _targetGaps.GetNGaps();
+    SRSmartMPP<TPqaId> oldQuestions(_memPool, CompactionMapItems(nQuestions));
+    SRSmartMPP<TPqaId> oldTargets(_memPool, CompactionMapItems(nTargets));
+    FillOldIds(_dims._nQuestions, _questionGaps, oldQuestions.Get());
+    FillOldIds(_dims._nTargets, _targetGaps, oldTargets.Get());
+
+    CompactionResult res;
+    res._nQuestions = nQuestions;
+    res._nTargets = nTargets;
+    res._pOldQuestions = oldQuestions.Get();
+    res._pOldTargets = oldTargets.Get();
+    if (nQuestions != _dims._nQuestions || nTargets != _dims._nTargets) {
+      // Only the rows of the remaining questions are moved, and only the cells of the remaining targets are kept.
+      _kb.Compact(SRCast::ToSizeT(nQuestions), res._pOldQuestions, SRCast::ToSizeT(nTargets), res._pOldTargets);
+      _questionGaps.Compact(nQuestions);
+      _targetGaps.Compact(nTargets);
+      CELOG(Info) << "Compacted the sparse KB from " << _dims._nQuestions << " to " << nQuestions
+        << " questions and from " << _dims._nTargets << " to " << nTargets << " targets.";
+      _dims._nQuestions = nQuestions;
+      _dims._nTargets = nTargets;
+    }
+    oldQuestions.Detach();
+    oldTargets.Detach();
+    cr = res;
+  }
+  CATCH_TO_ERR_RETURN;
+  return PqaError();
+}
+
+PqaError SparseCpuEngine::ReleaseCompactionResult(CompactionResult &cr) {
+  _memPool.ReleaseMem(cr._pOldQuestions, CompactionMapItems(cr._nQuestions) * sizeof(TPqaId));
+  _memPool.ReleaseMem(cr._pOldTargets, CompactionMapItems(cr._nTargets) * sizeof(TPqaId));
+  cr._pOldQuestions = cr._pOldTargets = nullptr;
+  cr._nQuestions = cr._nTargets = 0;
+  return PqaError();
+}
+
+} // namespace ProbQA
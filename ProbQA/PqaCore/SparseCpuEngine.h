@@ -0,0 +1,101 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../PqaCore/BaseCpuEngine.h"
+#include "../PqaCore/CESparseKB.h"
+
+namespace ProbQA {
+
+class CESparseQuiz;
+class CESparseEvalQsTask;
+
+// CPU engine over a sparse KB, in double precision. Its memory scales with the amount of training rather than with the
+//   product of the numbers of questions, answers and targets, so it suits very large target catalogs where most of the
+//   cells of cube A are never trained. The operations visit only the explicit cells of the KB, and handle the default
+//   cells analytically.
+class SparseCpuEngine : public BaseCpuEngine {
+private: // variables
+  // Space A: [iQuestion][iAnswer] and matrix D: [iQuestion] rows of explicit cells, and dense vector B: [iTarget] .
+  //   Guarded by _rws
+  CESparseKB _kb;
+
+  std::vector<CESparseQuiz*> _quizzes; // Guarded by _csQuizReg
+
+  // log2(defaultA/defaultD): the factor that an answer contributes to the likelihood of a target with default cells.
+  const double _defaultLog2Ratio;
+
+private: // methods
+  static size_t CalcWorkerStackSize(const EngineDefinition& engDef);
+
+  // Check that the questions and the answers are in KB range, and the questions are not in gaps.
+  PqaError CheckAnsweredQuestions(const TPqaId nQuestions, const AnsweredQuestion* const pAQs) const;
+  PqaError TrainInternal(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget,
+    const TPqaAmount amount);
+  // Add the training of |aq| for |iTarget| to the KB. The caller must hold _rws for writing.
+  void TrainOne(const AnsweredQuestion& aq, const TPqaId iTarget, const double twoB, const double bSquare);
+
+  TPqaId CreateQuizInternal(PqaError& err, const TPqaId nAnswered, const AnsweredQuestion* const pAQs);
+  CESparseQuiz* UseQuiz(PqaError& err, const TPqaId iQuiz);
+
+  // Normalize the priors of |quiz| into |task| and gather their statistics.
+  PqaError CalcPriorStats(CESparseEvalQsTask &task, const CESparseQuiz &quiz);
+
+  // Read the sparse KB and the gaps from the file, throwing PqaException on failure.
+  void ReadKB(const KBFileInfo &kbFi);
+  PqaError LockedSaveKB(const SRPlat::SRPositionalFile &file, const char* const filePath);
+
+public: // Internal interface methods
+  const CESparseKB& GetKB() const { return _kb; }
+  double GetDefaultLog2Ratio() const { return _defaultLog2Ratio; }
+  // Multiply the likelihoods of |quiz| by the probabilities of answer |aq|, except the factor that is the same for all
+  //   the targets. The caller must hold _rws for reading.
+  void ApplyAnswer(CESparseQuiz &quiz, const AnsweredQuestion& aq) const;
+
+public: // Client interface methods
+  explicit SparseCpuEngine(const EngineDefinition& engDef, KBFileInfo *pKbFi);
+  virtual ~SparseCpuEngine() override final;
+
+  virtual PqaError Train(const TPqaId nQuestions, const AnsweredQuestion* const pAQs, const TPqaId iTarget,
+    const TPqaAmount amount = 1) override final;
+
+  virtual TPqaId StartQuiz(PqaError& err) override final;
+  virtual TPqaId ResumeQuiz(PqaError& err, const TPqaId nAnswered, const AnsweredQuestion* const pAQs) override final;
+  virtual TPqaId NextQuestion(PqaError& err, const TPqaId iQuiz) override final;
+  virtual PqaError RecordAnswer(const TPqaId iQuiz, const TPqaId iAnswer) override final;
+  virtual TPqaId ListTopTargets(PqaError& err, const TPqaId iQuiz, const TPqaId maxCount, RatedTarget *pDest)
+    override final;
+  virtual PqaError RecordQuizTarget(const TPqaId iQuiz, const TPqaId iTarget, const TPqaAmount amount = 1)
+    override final;
+  virtual PqaError ReleaseQuiz(const TPqaId iQuiz) override final;
+
+  // Saves the explicit cells in the sectioned format, see KBFileFormat.h . Such a file is loaded by the sparse engine.
+  virtual PqaError SaveKB(const char* const filePath, const bool bDoubleBuffer, const bool bCompress = false)
+    override final;
+  virtual PqaError SaveKBIncremental(const char* const filePath) override final;
+  //// The background save and recomputation of D are not supported: they return PqaErrorCode::NotImplemented .
+  virtual IPqaSaveKBJob* SaveKBAsync(PqaError& err, const char* const filePath, const SaveKBOptions &options)
+    override final;
+  virtual IPqaRecomputeDJob* RecomputeDAsync(PqaError& err, const RecomputeDOptions &options) override final;
+  virtual uint64_t GetTotalQuestionsAsked(PqaError& err) override final;
+  virtual PqaError GetStats(EngineStats &stats) override final;
+
+  virtual PqaError StartMaintenance(const bool forceQuizes) override final;
+  virtual PqaError FinishMaintenance() override final;
+
+  virtual PqaError AddQuestions(TPqaId nQuestions, AddQuestionParam *pAqps) override final;
+  virtual PqaError AddTargets(TPqaId nTargets, AddTargetParam *pAtps) override final;
+  virtual PqaError RemoveQuestions(const TPqaId nQuestions, const TPqaId *pQIds) override final;
+  virtual PqaError RemoveTargets(const TPqaId nTargets, const TPqaId *pTIds) override final;
+
+  virtual PqaError Compact(CompactionResult &cr) override final;
+
+  virtual PqaError ReleaseCompactionResult(CompactionResult &cr) override final;
+
+  virtual PqaError Shutdown(const char* const saveFilePath = nullptr) override final;
+  virtual PqaError SetLogger(SRPlat::ISRLogger *pLogger) override final;
+};
+
+} // namespace ProbQA
@@ -12,12 +12,13 @@ public:
     typename taSubtask::TTask& task)
   {
     using namespace SRPlat;
-    SRAccumulator<taNumber> acc(taNumber(0));
+    // Accumulate in double precision regardless of taNumber, so that a float engine doesn't lose precision here.
+    SRAccumulator<SRDoubleNumber> acc(SRDoubleNumber(0.0));
     //TODO: vectorize to multiple numbers at once
     for (SRSubtaskCount i = 0; i < kp.GetNSubtasks(); i++) {
-      acc.Add(kp.GetSubtask(i)->_sumPriors);
+      acc.Add(SRDoubleNumber(kp.GetSubtask(i)->_sumPriors.ToAmount()));
     }
-    task._sumPriors.Set1(acc.Get());
+    task._sumPriors.Set1(taNumber(acc.Get().ToAmount()));
   }
 };
 
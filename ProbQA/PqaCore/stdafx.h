@@ -23,9 +23,12 @@
 #pragma warning( disable : 4251 ) // needs to have dll-interface to be used by clients of class
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <queue>
 #include <random>
@@ -40,6 +43,7 @@
 #include "../SRPlatform/Interface/ISRLogger.h"
 #include "../SRPlatform/Interface/SRAccumulator.h"
 #include "../SRPlatform/Interface/SRAccumVectDbl256.h"
+#include "../SRPlatform/Interface/SRAccumVectDbl512.h"
 #include "../SRPlatform/Interface/SRAlignedAllocator.h"
 #include "../SRPlatform/Interface/SRBaseSubtask.h"
 #include "../SRPlatform/Interface/SRBaseTask.h"
@@ -53,12 +57,15 @@
 #include "../SRPlatform/Interface/SRCriticalSection.h"
 #include "../SRPlatform/Interface/SRDefaultLogger.h"
 #include "../SRPlatform/Interface/SRDoubleNumber.h"
+#include "../SRPlatform/Interface/SRFloatNumber.h"
 #include "../SRPlatform/Interface/SRException.h"
 #include "../SRPlatform/Interface/SRFastArray.h"
 #include "../SRPlatform/Interface/SRFastRandom.h"
+#include "../SRPlatform/Interface/SRFileMapping.h"
 #include "../SRPlatform/Interface/SRFinally.h"
 #include "../SRPlatform/Interface/SRHeap.h"
 #include "../SRPlatform/Interface/SRLambdaSubtask.h"
+#include "../SRPlatform/Interface/SRLargePages.h"
 #include "../SRPlatform/Interface/SRLock.h"
 #include "../SRPlatform/Interface/SRLogStream.h"
 #include "../SRPlatform/Interface/SRMath.h"
@@ -66,6 +73,7 @@
 #include "../SRPlatform/Interface/SRMemPool.h"
 #include "../SRPlatform/Interface/SRMinimalTask.h"
 #include "../SRPlatform/Interface/SRPoolRunner.h"
+#include "../SRPlatform/Interface/SRPositionalFile.h"
 #include "../SRPlatform/Interface/SRReaderWriterSync.h"
 #include "../SRPlatform/Interface/SRSimd.h"
 #include "../SRPlatform/Interface/SRSmartFile.h"
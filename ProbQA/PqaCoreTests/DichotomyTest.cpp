@@ -3,18 +3,21 @@
 // This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
 
 #include "stdafx.h"
+#include "EngineTestHelpers.h"
 
 using namespace ProbQA;
 using namespace SRPlat;
+using namespace PqaTest;
 
-TEST(DichotomyTest, Main) {
+namespace {
+
+// The dimensions of the dichotomy engine. The tests turn on the options under check in the definition returned.
+EngineDefinition MakeDichotomyDefinition() {
+  return MakeEngineDefinition(5, 1000, 1000);
+}
+
+void CheckDichotomy(const EngineDefinition &ed) {
   PqaError err;
-  EngineDefinition ed;
-  ed._dims._nAnswers = 5;
-  ed._dims._nQuestions = 1000;
-  ed._dims._nTargets = 1000;
-  ed._initAmount = 0.1;
-  ed._prec._type = TPqaPrecisionType::Double;
   IPqaEngine *pEngine = PqaGetEngineFactory().CreateCpuEngine(err, ed);
   ASSERT_TRUE(err.IsOk());
   ASSERT_TRUE(pEngine != nullptr);
@@ -99,3 +102,171 @@ TEST(DichotomyTest, Main) {
   ASSERT_GE(nCorrect, nTrials * 0.98);
   delete pEngine;
 }
+
+// The options that only change where the memory and the workers are, must not change the priors of the quizzes. So an
+//   engine of |ed| must list the same probabilities of the targets as a plain engine trained the same way, up to the
+//   relative difference |relTol|.
+void CheckSameAsPlain(const EngineDefinition &ed, const double relTol) {
+  PqaError err;
+  std::unique_ptr<IPqaEngine> pPlain(PqaGetEngineFactory().CreateCpuEngine(err, MakeEngineDefinition(
+    ed._dims._nAnswers, ed._dims._nQuestions, ed._dims._nTargets)));
+  ASSERT_TRUE(err.IsOk());
+  std::unique_ptr<IPqaEngine> pTested(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 2000);
+  ASSERT_TRUE(ApplyTrainings(*pPlain, trainings).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pTested, trainings).IsOk());
+
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  IPqaEngine *const engines[] = { pPlain.get(), pTested.get() };
+  std::vector<double> probs[2];
+  for (int64_t i = 0; i < 10; i++) {
+    // Distinct questions with random answers.
+    std::vector<AnsweredQuestion> answered;
+    const TPqaId iFirst = ea.Generate<TPqaId>(ed._dims._nQuestions);
+    for (TPqaId j = 0; j < 8; j++) {
+      answered.emplace_back((iFirst + 7 * j) % ed._dims._nQuestions, ea.Generate<TPqaId>(ed._dims._nAnswers));
+    }
+    for (size_t e = 0; e < 2; e++) {
+      const TPqaId iQuiz = engines[e]->ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+      ASSERT_TRUE(err.IsOk());
+      ASSERT_EQ(ed._dims._nTargets, ListAllTargets(*engines[e], iQuiz, probs[e]));
+      ASSERT_TRUE(engines[e]->ReleaseQuiz(iQuiz).IsOk());
+    }
+    for (size_t k = 0; k < probs[0].size(); k++) {
+      EXPECT_NEAR(probs[0][k], probs[1][k], relTol * probs[0][k]) << "at target " << k;
+    }
+  }
+
+  // Large pages are obtained only if requested and supported by the OS, otherwise the engine quietly falls back to
+  //   regular pages.
+  EngineStats stats;
+  ASSERT_TRUE(pTested->GetStats(stats).IsOk());
+  if (!ed._largePages || SRLargePages::GetPageBytes() == 0) {
+    EXPECT_FALSE(stats._kbLargePages);
+    EXPECT_EQ(uint64_t(0), stats._nPoolLargePageAllocs + stats._nPoolLargePageFallbacks);
+  }
+}
+
+// The posteriors after any answer differ from the near-uniform priors by tiny amounts, so the velocities are far below
+//   the squares of the priors. The single-pass kernel of the row-major cube A must then agree with the two-pass kernel
+//   of the tiled one on the priorities of the questions, and so on the distribution of the first question.
+void CheckNearUniformVelocity(const TPqaId nAnswers) {
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(nAnswers, 8, 203);
+  std::unique_ptr<IPqaEngine> pFused(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ed._tiledA = true;
+  std::unique_ptr<IPqaEngine> pTwoPass(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+
+  // A question per training, and the question's scale of the deviations from uniform.
+  std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 400, 1);
+  for (RecordedTraining &rt : trainings) {
+    rt._amount = std::ldexp(rt._amount, -40 + 3 * int(rt._aqs[0]._iQuestion));
+  }
+  ASSERT_TRUE(ApplyTrainings(*pFused, trainings).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pTwoPass, trainings).IsOk());
+
+  constexpr int64_t cnQuizzes = 20 * 1000;
+  std::vector<int64_t> fused, twoPass;
+  SampleFirstQuestions(*pFused, cnQuizzes, fused);
+  SampleFirstQuestions(*pTwoPass, cnQuizzes, twoPass);
+  EXPECT_EQ(0, CountDiffering(fused, twoPass));
+}
+
+// The cache of the next question must be dropped by the trainings, so that an engine with the cache selects the first
+//   question by the same distribution as one without it, both before and after the trainings change the distribution.
+void CheckNextQsCache() {
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 8, 64);
+  std::unique_ptr<IPqaEngine> pPlain(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ed._nextQsCacheDepth = 2;
+  std::unique_ptr<IPqaEngine> pCached(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 20 * 1000, 4);
+  ASSERT_TRUE(ApplyTrainings(*pPlain, trainings, 0, 100).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pCached, trainings, 0, 100).IsOk());
+  constexpr int64_t cnQuizzes = 20 * 1000;
+  std::vector<int64_t> plainBefore, cachedBefore;
+  SampleFirstQuestions(*pPlain, cnQuizzes, plainBefore);
+  SampleFirstQuestions(*pCached, cnQuizzes, cachedBefore);
+  EXPECT_EQ(0, CountDiffering(plainBefore, cachedBefore));
+
+  ASSERT_TRUE(ApplyTrainings(*pPlain, trainings, 100, trainings.size()).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pCached, trainings, 100, trainings.size()).IsOk());
+  std::vector<int64_t> plainAfter, cachedAfter;
+  SampleFirstQuestions(*pPlain, cnQuizzes, plainAfter);
+  SampleFirstQuestions(*pCached, cnQuizzes, cachedAfter);
+  // Otherwise a stale cache would go unnoticed.
+  EXPECT_LT(0, CountDiffering(plainBefore, plainAfter));
+  EXPECT_EQ(0, CountDiffering(plainAfter, cachedAfter));
+}
+
+} // anonymous namespace
+
+TEST(DichotomyTest, Main) {
+  CheckDichotomy(MakeDichotomyDefinition());
+}
+
+TEST(DichotomyTest, TiledA) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._tiledA = true;
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, InvDTable) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._invDTable = true;
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, Float) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._prec._type = TPqaPrecisionType::Float;
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, SparseKB) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._sparseKB = true;
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, Pruning) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._pruneTargetsEps = 1e-6;
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, LargePages) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._largePages = true;
+  CheckSameAsPlain(ed, 0);
+  CheckDichotomy(ed);
+}
+
+// On a machine with a single NUMA node, the engine behaves as if the option is off. On several nodes, the targets are
+//   split among the workers differently, so the sums are taken in another order.
+TEST(DichotomyTest, NumaAware) {
+  EngineDefinition ed = MakeDichotomyDefinition();
+  ed._numaAware = true;
+  CheckSameAsPlain(ed, 1e-12);
+  CheckDichotomy(ed);
+}
+
+TEST(DichotomyTest, NearUniformVelocity) {
+  CheckNearUniformVelocity(5);
+}
+
+// More answers than the unrolled kernels take.
+TEST(DichotomyTest, NearUniformVelocityManyAnswers) {
+  CheckNearUniformVelocity(10);
+}
+
+TEST(DichotomyTest, NextQsCache) {
+  CheckNextQsCache();
+}
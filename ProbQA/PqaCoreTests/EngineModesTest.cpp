@@ -0,0 +1,85 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// Run a quiz of a few questions with random answers, expecting the engine to keep to its dimensions.
+void RunRandomQuiz(IPqaEngine &engine, SREntropyAdapter &ea) {
+  const EngineDimensions dims = engine.GetDims();
+  PqaError err;
+  const TPqaId iQuiz = engine.StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  for (int i = 0; i < 5; i++) {
+    const TPqaId iQuestion = engine.NextQuestion(err, iQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(iQuestion >= 0 && iQuestion < dims._nQuestions);
+    ASSERT_TRUE(engine.RecordAnswer(iQuiz, ea.Generate<TPqaId>(dims._nAnswers)).IsOk());
+  }
+  RatedTarget rts[10];
+  const TPqaId nListed = engine.ListTopTargets(err, iQuiz, 10, rts);
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_EQ(10, nListed);
+  for (TPqaId i = 0; i < nListed; i++) {
+    ASSERT_TRUE(rts[i]._iTarget >= 0 && rts[i]._iTarget < dims._nTargets);
+  }
+  ASSERT_TRUE(engine.ReleaseQuiz(iQuiz).IsOk());
+}
+
+} // anonymous namespace
+
+TEST(EngineModesTest, EpochKB) {
+  const char* const cEpochPath = "PqaTest_Epoch.kb";
+  const char* const cPlainPath = "PqaTest_Plain.kb";
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 100, 200);
+  std::unique_ptr<IPqaEngine> pPlain(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ed._epochKB = true;
+  std::unique_ptr<IPqaEngine> pEpoch(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+
+  // The quizzes read one instance of the KB while the trainings update the other.
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 5000);
+  std::atomic<bool> bTrainOk(true);
+  std::thread trainer([&] {
+    bTrainOk = ApplyTrainings(*pEpoch, trainings).IsOk();
+  });
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  // The trainer thread must be joined even if a check fails.
+  for (int i = 0; i < 300 && !::testing::Test::HasFailure(); i++) {
+    RunRandomQuiz(*pEpoch, ea);
+  }
+  trainer.join();
+  ASSERT_TRUE(bTrainOk);
+
+  // Both instances have caught up with all the trainings.
+  ASSERT_TRUE(ApplyTrainings(*pPlain, trainings).IsOk());
+  KBWeights expected, epoch;
+  ASSERT_TRUE(SaveAndReadKB(*pPlain, cPlainPath, expected));
+  ASSERT_TRUE(SaveAndReadKB(*pEpoch, cEpochPath, epoch));
+  ExpectKBNear(expected, epoch);
+  RunRandomQuiz(*pEpoch, ea);
+
+  // An engine loaded in the epoch mode trains both instances alike.
+  LoadKBOptions lo;
+  lo._engDef._epochKB = true;
+  pEpoch.reset(PqaGetEngineFactory().LoadCpuEngine(err, cEpochPath, lo));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEpoch, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pPlain, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(SaveAndReadKB(*pPlain, cPlainPath, expected));
+  ASSERT_TRUE(SaveAndReadKB(*pEpoch, cEpochPath, epoch));
+  ExpectKBNear(expected, epoch);
+  pEpoch.reset();
+  std::remove(cEpochPath);
+  std::remove(cPlainPath);
+}
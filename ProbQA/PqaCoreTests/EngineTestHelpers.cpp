@@ -0,0 +1,233 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+
+namespace PqaTest {
+
+namespace {
+
+const KBFileSection* FindSection(const KBFileDirectory &dir, const KBFileSectionKind kind) {
+  const uint32_t nSections = (dir._header._nSections < KBFileDirectory::_cMaxSections) ? dir._header._nSections
+    : KBFileDirectory::_cMaxSections;
+  for (uint32_t i = 0; i < nSections; i++) {
+    if (dir._sections[i]._kind == kind) {
+      return dir._sections + i;
+    }
+  }
+  return nullptr;
+}
+
+// Read |nRows| rows of |nItems| numbers from |sect|, skipping the padding of each row.
+bool ReadRows(std::FILE *fp, const KBFileSection *pSect, const bool bFloat, const size_t nRows, const size_t nItems,
+  std::vector<double> &dest)
+{
+  const size_t nNumBytes = bFloat ? sizeof(float) : sizeof(double);
+  if (pSect == nullptr || pSect->_rowBytes < nItems * nNumBytes || pSect->_nBytes != nRows * pSect->_rowBytes) {
+    return false;
+  }
+  std::vector<uint8_t> row(SRCast::ToSizeT(pSect->_rowBytes));
+  dest.resize(nRows * nItems);
+  for (size_t i = 0; i < nRows; i++) {
+    if (_fseeki64(fp, int64_t(pSect->_offset + i * pSect->_rowBytes), SEEK_SET) != 0
+      || std::fread(row.data(), 1, row.size(), fp) != row.size())
+    {
+      return false;
+    }
+    for (size_t j = 0; j < nItems; j++) {
+      dest[i * nItems + j] = bFloat ? reinterpret_cast<const float*>(row.data())[j]
+        : reinterpret_cast<const double*>(row.data())[j];
+    }
+  }
+  return true;
+}
+
+// Read the weights from a file of a sparse KB, materializing the default cells of the questions.
+bool ReadSparseWeights(std::FILE *fp, const KBFileDirectory &dir, KBWeights &kbw) {
+  const size_t nQuestions = SRCast::ToSizeT(kbw._dims._nQuestions);
+  const size_t nAnswers = SRCast::ToSizeT(kbw._dims._nAnswers);
+  const size_t nTargets = SRCast::ToSizeT(kbw._dims._nTargets);
+  const size_t nRows = nQuestions * (nAnswers + 1);
+  const KBFileSection *pDefaults = FindSection(dir, KBFileSectionKind::QuestionDefaults);
+  const KBFileSection *pIndex = FindSection(dir, KBFileSectionKind::SparseIndex);
+  const KBFileSection *pCells = FindSection(dir, KBFileSectionKind::SparseCells);
+  const KBFileSection *pB = FindSection(dir, KBFileSectionKind::VectorB);
+  if (pDefaults == nullptr || pIndex == nullptr || pCells == nullptr || pB == nullptr) {
+    return false;
+  }
+  std::vector<double> defaults(nQuestions);
+  std::vector<uint64_t> rowEnds(nRows);
+  std::vector<KBFileSparseCell> cells(SRCast::ToSizeT(pCells->_nBytes / sizeof(KBFileSparseCell)));
+  kbw._b.resize(nTargets);
+  auto fnRead = [fp](const KBFileSection *pSect, void *pDest, const size_t nBytes) {
+    return _fseeki64(fp, int64_t(pSect->_offset), SEEK_SET) == 0 && std::fread(pDest, 1, nBytes, fp) == nBytes;
+  };
+  if (!fnRead(pDefaults, defaults.data(), defaults.size() * sizeof(double))
+    || !fnRead(pIndex, rowEnds.data(), rowEnds.size() * sizeof(uint64_t))
+    || !fnRead(pCells, cells.data(), cells.size() * sizeof(KBFileSparseCell))
+    || !fnRead(pB, kbw._b.data(), kbw._b.size() * sizeof(double)))
+  {
+    return false;
+  }
+  kbw._a.resize(nQuestions * nAnswers * nTargets);
+  kbw._d.resize(nQuestions * nTargets);
+  uint64_t rowBegin = 0;
+  for (size_t i = 0; i < nQuestions; i++) {
+    for (size_t k = 0; k <= nAnswers; k++) {
+      // The row of D follows the rows of A of the question.
+      double *pRow = (k < nAnswers) ? &kbw._a[(i * nAnswers + k) * nTargets] : &kbw._d[i * nTargets];
+      std::fill(pRow, pRow + nTargets, (k < nAnswers) ? defaults[i] : defaults[i] * nAnswers);
+      const uint64_t rowEnd = rowEnds[i * (nAnswers + 1) + k];
+      if (rowEnd < rowBegin || rowEnd > cells.size()) {
+        return false;
+      }
+      for (uint64_t j = rowBegin; j < rowEnd; j++) {
+        pRow[size_t(cells[size_t(j)]._iTarget)] = cells[size_t(j)]._value;
+      }
+      rowBegin = rowEnd;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+EngineDefinition MakeEngineDefinition(const TPqaId nAnswers, const TPqaId nQuestions, const TPqaId nTargets) {
+  EngineDefinition ed;
+  ed._dims._nAnswers = nAnswers;
+  ed._dims._nQuestions = nQuestions;
+  ed._dims._nTargets = nTargets;
+  ed._initAmount = 0.1;
+  ed._prec._type = TPqaPrecisionType::Double;
+  return ed;
+}
+
+std::vector<RecordedTraining> MakeTrainings(const EngineDimensions& dims, const size_t nTrainings,
+  const TPqaId maxQuestions)
+{
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  std::vector<RecordedTraining> trainings(nTrainings);
+  for (RecordedTraining &rt : trainings) {
+    const TPqaId nAQs = 1 + ea.Generate<TPqaId>(maxQuestions);
+    for (TPqaId i = 0; i < nAQs; i++) {
+      rt._aqs.emplace_back(ea.Generate<TPqaId>(dims._nQuestions), ea.Generate<TPqaId>(dims._nAnswers));
+    }
+    rt._iTarget = ea.Generate<TPqaId>(dims._nTargets);
+    rt._amount = 0.5 + ea.Generate<TPqaId>(4);
+  }
+  return trainings;
+}
+
+PqaError ApplyTrainings(IPqaEngine &engine, const std::vector<RecordedTraining> &trainings, const size_t iFirst,
+  const size_t iLimit)
+{
+  for (size_t i = iFirst; i < iLimit; i++) {
+    const RecordedTraining &rt = trainings[i];
+    PqaError err = engine.Train(TPqaId(rt._aqs.size()), rt._aqs.data(), rt._iTarget, rt._amount);
+    if (!err.IsOk()) {
+      return std::move(err);
+    }
+  }
+  return PqaError();
+}
+
+void SampleFirstQuestions(IPqaEngine &engine, const int64_t nQuizzes, std::vector<int64_t> &counts) {
+  PqaError err;
+  counts.assign(SRCast::ToSizeT(engine.GetDims()._nQuestions), 0);
+  for (int64_t i = 0; i < nQuizzes; i++) {
+    const TPqaId iQuiz = engine.StartQuiz(err);
+    ASSERT_TRUE(err.IsOk());
+    const TPqaId iQuestion = engine.NextQuestion(err, iQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(iQuestion >= 0 && iQuestion < engine.GetDims()._nQuestions);
+    counts[SRCast::ToSizeT(iQuestion)]++;
+    ASSERT_TRUE(engine.ReleaseQuiz(iQuiz).IsOk());
+  }
+}
+
+int64_t CountDiffering(const std::vector<int64_t> &a, const std::vector<int64_t> &b) {
+  int64_t nDiffering = 0;
+  for (size_t i = 0; i < a.size(); i++) {
+    const double tolerance = 5 * std::sqrt(double(a[i] + b[i])) + 10;
+    if (std::abs(double(a[i] - b[i])) > tolerance) {
+      nDiffering++;
+    }
+  }
+  return nDiffering;
+}
+
+TPqaId ListAllTargets(IPqaEngine &engine, const TPqaId iQuiz, std::vector<double> &probs) {
+  PqaError err;
+  const TPqaId nTargets = engine.GetDims()._nTargets;
+  std::vector<RatedTarget> rts(SRCast::ToSizeT(nTargets));
+  const TPqaId nListed = engine.ListTopTargets(err, iQuiz, nTargets, rts.data());
+  EXPECT_TRUE(err.IsOk());
+  probs.assign(SRCast::ToSizeT(nTargets), 0);
+  for (TPqaId i = 0; i < nListed; i++) {
+    probs[SRCast::ToSizeT(rts[i]._iTarget)] = rts[i]._prob;
+  }
+  return nListed;
+}
+
+bool ReadKBWeights(const char* const filePath, KBWeights &kbw) {
+  std::FILE *fp = std::fopen(filePath, "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  KBFileDirectory dir;
+  bool bOk = (std::fread(&dir, sizeof(dir), 1, fp) == 1)
+    && std::memcmp(dir._header._magic, cKBFileMagic, sizeof(cKBFileMagic)) == 0;
+  if (bOk && dir._header._version == KBFileDirectory::_cSparseVersion) {
+    kbw._dims = dir._header._dims;
+    bOk = ReadSparseWeights(fp, dir, kbw);
+    std::fclose(fp);
+    return bOk;
+  }
+  bOk = bOk && dir._header._version == KBFileDirectory::_cPlainVersion
+    && (dir._header._prec._type == TPqaPrecisionType::Double || dir._header._prec._type == TPqaPrecisionType::Float);
+  if (bOk) {
+    const bool bFloat = (dir._header._prec._type == TPqaPrecisionType::Float);
+    kbw._dims = dir._header._dims;
+    const size_t nQuestions = SRCast::ToSizeT(kbw._dims._nQuestions);
+    const size_t nAnswers = SRCast::ToSizeT(kbw._dims._nAnswers);
+    const size_t nTargets = SRCast::ToSizeT(kbw._dims._nTargets);
+    bOk = ReadRows(fp, FindSection(dir, KBFileSectionKind::CubeA), bFloat, nQuestions * nAnswers, nTargets, kbw._a)
+      && ReadRows(fp, FindSection(dir, KBFileSectionKind::MatrixD), bFloat, nQuestions, nTargets, kbw._d)
+      && ReadRows(fp, FindSection(dir, KBFileSectionKind::VectorB), bFloat, 1, nTargets, kbw._b);
+  }
+  std::fclose(fp);
+  return bOk;
+}
+
+bool SaveAndReadKB(IPqaEngine &engine, const char* const filePath, KBWeights &kbw) {
+  PqaError err = engine.SaveKB(filePath, false);
+  return err.IsOk() && ReadKBWeights(filePath, kbw);
+}
+
+void ExpectKBNear(const KBWeights &expected, const KBWeights &actual, const double relTol) {
+  ASSERT_EQ(expected._dims._nAnswers, actual._dims._nAnswers);
+  ASSERT_EQ(expected._dims._nQuestions, actual._dims._nQuestions);
+  ASSERT_EQ(expected._dims._nTargets, actual._dims._nTargets);
+  const std::pair<const std::vector<double>*, const std::vector<double>*> parts[] = { { &expected._a, &actual._a },
+    { &expected._d, &actual._d }, { &expected._b, &actual._b } };
+  for (const auto &part : parts) {
+    ASSERT_EQ(part.first->size(), part.second->size());
+    for (size_t i = 0; i < part.first->size(); i++) {
+      const double e = (*part.first)[i];
+      const double a = (*part.second)[i];
+      if (relTol == 0) {
+        ASSERT_EQ(e, a) << "at item " << i;
+      } else {
+        ASSERT_LE(std::abs(e - a), relTol * std::abs(e)) << "at item " << i;
+      }
+    }
+  }
+}
+
+} // namespace PqaTest
@@ -0,0 +1,67 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+namespace PqaTest {
+
+// A training as passed to IPqaEngine::Train(), recorded so that the same trainings can be applied to several engines.
+struct RecordedTraining {
+  std::vector<ProbQA::AnsweredQuestion> _aqs;
+  ProbQA::TPqaId _iTarget;
+  ProbQA::TPqaAmount _amount;
+};
+
+// The weights of a KB read from a file in the sectioned format with the plain weights, converted to double and without
+//   the padding of the rows.
+struct KBWeights {
+  ProbQA::EngineDimensions _dims;
+  std::vector<double> _a; // [iQuestion][iAnswer][iTarget]
+  std::vector<double> _d; // [iQuestion][iTarget]
+  std::vector<double> _b; // [iTarget]
+
+  double GetA(const ProbQA::TPqaId iQuestion, const ProbQA::TPqaId iAnswer, const ProbQA::TPqaId iTarget) const {
+    return _a[size_t((iQuestion * _dims._nAnswers + iAnswer) * _dims._nTargets + iTarget)];
+  }
+  double GetD(const ProbQA::TPqaId iQuestion, const ProbQA::TPqaId iTarget) const {
+    return _d[size_t(iQuestion * _dims._nTargets + iTarget)];
+  }
+};
+
+// The definition of a plain dense engine in double precision, which the other engines are checked against.
+ProbQA::EngineDefinition MakeEngineDefinition(const ProbQA::TPqaId nAnswers, const ProbQA::TPqaId nQuestions,
+  const ProbQA::TPqaId nTargets);
+
+// Make |nTrainings| random trainings of up to |maxQuestions| answered questions each.
+std::vector<RecordedTraining> MakeTrainings(const ProbQA::EngineDimensions& dims, const size_t nTrainings,
+  const ProbQA::TPqaId maxQuestions = 16);
+
+// Apply the trainings in [iFirst, iLimit), stopping at the first error.
+ProbQA::PqaError ApplyTrainings(ProbQA::IPqaEngine &engine, const std::vector<RecordedTraining> &trainings,
+  const size_t iFirst, const size_t iLimit);
+inline ProbQA::PqaError ApplyTrainings(ProbQA::IPqaEngine &engine, const std::vector<RecordedTraining> &trainings) {
+  return ApplyTrainings(engine, trainings, 0, trainings.size());
+}
+
+// Count the first questions that fresh quizzes of |engine| get.
+void SampleFirstQuestions(ProbQA::IPqaEngine &engine, const int64_t nQuizzes, std::vector<int64_t> &counts);
+
+// The number of items whose counts differ by more than 5 standard deviations of the difference, for comparing the
+//   distributions that two engines sample.
+int64_t CountDiffering(const std::vector<int64_t> &a, const std::vector<int64_t> &b);
+
+// List all the targets of quiz |iQuiz| into |probs| by their ids, leaving 0 for the targets that aren't listed.
+//   Returns the number of the targets listed.
+ProbQA::TPqaId ListAllTargets(ProbQA::IPqaEngine &engine, const ProbQA::TPqaId iQuiz, std::vector<double> &probs);
+
+// Returns |false| if the file can't be read or isn't a sectioned KB file with the plain weights or a sparse KB.
+bool ReadKBWeights(const char* const filePath, KBWeights &kbw);
+
+// Save the KB of |engine| to |filePath| and read its weights back.
+bool SaveAndReadKB(ProbQA::IPqaEngine &engine, const char* const filePath, KBWeights &kbw);
+
+// Expect the weights to be equal up to the relative difference |relTol|, which is 0 for exact equality.
+void ExpectKBNear(const KBWeights &expected, const KBWeights &actual, const double relTol = 0);
+
+} // namespace PqaTest
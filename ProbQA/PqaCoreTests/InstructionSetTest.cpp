@@ -0,0 +1,95 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// The kernels of the instruction sets multiply the same factors, but sum them in another order.
+constexpr double cIsaRelTol = 1e-12;
+
+// The AVX-512 kernels of RecordAnswer() and ResumeQuiz() must compute the same priors as the AVX2 ones, and the
+//   AVX-512 kernel of NextQuestion() the same run lengths of the questions, and so the same distribution of the
+//   question selected. The number of targets isn't a multiple of the SIMD width, so that the tails are covered.
+void CheckAvx512(const bool invDTable) {
+  if (SRCpuInfo::GetInstructionSet() < SRInstructionSet::Avx512) {
+    std::printf("Skipped: AVX-512 is not available.\n");
+    return;
+  }
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 8, 203);
+  ed._invDTable = invDTable;
+  ed._maxInstructionSet = SRInstructionSet::Avx2;
+  std::unique_ptr<IPqaEngine> pAvx2(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ed._maxInstructionSet = SRInstructionSet::Avx512;
+  std::unique_ptr<IPqaEngine> pAvx512(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 2000, 4);
+  ASSERT_TRUE(ApplyTrainings(*pAvx2, trainings).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pAvx512, trainings).IsOk());
+
+  // A quiz driven by NextQuestion() and RecordAnswer() in one engine, against the quiz resumed with the same answers in
+  //   the other engine, both ways.
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  IPqaEngine *const engines[] = { pAvx2.get(), pAvx512.get() };
+  std::vector<double> drivenProbs, resumedProbs;
+  for (size_t k = 0; k < 2; k++) {
+    IPqaEngine &driven = *engines[k];
+    IPqaEngine &resumed = *engines[1 - k];
+    const TPqaId iQuiz = driven.StartQuiz(err);
+    ASSERT_TRUE(err.IsOk());
+    std::vector<AnsweredQuestion> answered;
+    for (TPqaId j = 0; j < ed._dims._nQuestions; j++) {
+      const TPqaId iQuestion = driven.NextQuestion(err, iQuiz);
+      ASSERT_TRUE(err.IsOk());
+      const TPqaId iAnswer = ea.Generate<TPqaId>(ed._dims._nAnswers);
+      ASSERT_TRUE(driven.RecordAnswer(iQuiz, iAnswer).IsOk());
+      answered.emplace_back(iQuestion, iAnswer);
+
+      const TPqaId iResumedQuiz = resumed.ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+      ASSERT_TRUE(err.IsOk());
+      ASSERT_EQ(ed._dims._nTargets, ListAllTargets(resumed, iResumedQuiz, resumedProbs));
+      ASSERT_TRUE(resumed.ReleaseQuiz(iResumedQuiz).IsOk());
+      ASSERT_EQ(ed._dims._nTargets, ListAllTargets(driven, iQuiz, drivenProbs));
+      for (size_t i = 0; i < drivenProbs.size(); i++) {
+        EXPECT_NEAR(drivenProbs[i], resumedProbs[i], cIsaRelTol * drivenProbs[i]) << "at target " << i;
+      }
+    }
+    ASSERT_TRUE(driven.ReleaseQuiz(iQuiz).IsOk());
+  }
+
+  constexpr int64_t cnQuizzes = 20 * 1000;
+  std::vector<int64_t> avx2, avx512;
+  SampleFirstQuestions(*pAvx2, cnQuizzes, avx2);
+  SampleFirstQuestions(*pAvx512, cnQuizzes, avx512);
+  EXPECT_EQ(0, CountDiffering(avx2, avx512));
+}
+
+} // anonymous namespace
+
+TEST(InstructionSetTest, Avx512) {
+  CheckAvx512(false);
+}
+
+TEST(InstructionSetTest, Avx512InvDTable) {
+  CheckAvx512(true);
+}
+
+// The engine is compiled for AVX2, so it can't be limited to a narrower instruction set.
+TEST(InstructionSetTest, BelowAvx2) {
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 8, 203);
+  ed._maxInstructionSet = SRInstructionSet::Sse2;
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  EXPECT_TRUE(pEngine == nullptr);
+  EXPECT_EQ(PqaErrorCode::NotImplemented, err.GetCode());
+}
@@ -0,0 +1,192 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// A row-major KB arena over its own SIMD-aligned memory.
+template<typename taNumber> class TestArena {
+  void *_pMem;
+  size_t _nBytes;
+
+public:
+  CEKBArena<taNumber> _kb;
+
+  explicit TestArena(const size_t nQuestions, const size_t nAnswers, const size_t nTargets) {
+    const size_t nTargStride = CEKBArena<taNumber>::CalcTargStride(nTargets);
+    _nBytes = (nQuestions * (nAnswers + 1) + 1) * nTargStride * sizeof(taNumber);
+    _pMem = _mm_malloc(_nBytes, SRSimd::_cNBytes);
+    _kb.View(_pMem, nQuestions, nAnswers, nTargStride);
+  }
+  ~TestArena() {
+    _kb.Clear();
+    _mm_free(_pMem);
+  }
+  uint8_t* GetBytes() { return static_cast<uint8_t*>(_pMem); }
+  size_t GetNBytes() const { return _nBytes; }
+};
+
+template<typename taNumber> void SetBits(taNumber &num, const typename CEKBCodec<taNumber>::TBits bits) {
+  std::memcpy(&num, &bits, sizeof(num));
+}
+
+// Fill the KB with the weights as the codec meets them: the initial weights repeating, the trained ones sharing the
+//   high bits, and in vector B the XORs of all meaningful bits.
+template<typename taNumber> void FillTestKB(TestArena<taNumber> &ta) {
+  typedef typename CEKBCodec<taNumber>::TBits TBits;
+  CEKBArena<taNumber> &kb = ta._kb;
+  SRFastRandom fr;
+  taNumber *pNums = reinterpret_cast<taNumber*>(ta.GetBytes());
+  const size_t nNums = ta.GetNBytes() / sizeof(taNumber);
+  for (size_t i = 0; i < nNums; i++) {
+    const uint64_t rnd = fr.Generate<uint64_t>();
+    if ((rnd & 1) == 0) {
+      pNums[i] = taNumber(0.01);
+    } else {
+      pNums[i] = taNumber(1 + (rnd >> 11) * (99.0 / (uint64_t(1) << 53)));
+    }
+  }
+  const TBits outer = (TBits(1) << (CEKBCodec<taNumber>::_cNBits - 1)) | 1;
+  taNumber *pB = kb.ModB();
+  for (size_t j = 0; j < kb.GetTargStride(); j++) {
+    SetBits(pB[j], (j & 1) ? outer : TBits(0));
+  }
+}
+
+// Encode the KB in blocks of |nRowsPerBlock| rows, decode them into another KB, and expect the same bytes.
+template<typename taNumber> void CheckRoundTrip(TestArena<taNumber> &src, const size_t nRowsPerBlock) {
+  typedef CEKBCodec<taNumber> TCodec;
+  const CEKBArena<taNumber> &kb = src._kb;
+  TestArena<taNumber> dest(kb.GetNQuestions(), kb.GetNAnswers(), kb.GetTargStride());
+  std::memset(dest.GetBytes(), 0xA5, dest.GetNBytes());
+  const size_t nRows = TCodec::CalcNRows(kb);
+  std::vector<uint8_t> block(TCodec::CalcMaxBytes(nRowsPerBlock, kb.GetTargStride()));
+  for (size_t iFirst = 0; iFirst < nRows; iFirst += nRowsPerBlock) {
+    const size_t iLimit = std::min(iFirst + nRowsPerBlock, nRows);
+    const size_t nBytes = TCodec::EncodeRows(kb, iFirst, iLimit, block.data());
+    ASSERT_LE(nBytes, block.size());
+    ASSERT_TRUE(TCodec::DecodeRows(dest._kb, iFirst, iLimit, block.data(), nBytes)) << "rows " << iFirst;
+  }
+  ASSERT_EQ(0, std::memcmp(src.GetBytes(), dest.GetBytes(), src.GetNBytes()));
+}
+
+template<typename taNumber> void CheckCodec() {
+  typedef CEKBCodec<taNumber> TCodec;
+  TestArena<taNumber> src(7, 3, 45);
+  FillTestKB(src);
+  const size_t nRows = TCodec::CalcNRows(src._kb);
+  // A row per block, blocks ending inside cube A, at its end and inside matrix D, and a single block.
+  for (const size_t nRowsPerBlock : { size_t(1), size_t(2), size_t(3), size_t(7), nRows }) {
+    CheckRoundTrip(src, nRowsPerBlock);
+  }
+
+  // The damaged blocks are rejected without reading past their end: the block is copied to a buffer of its size.
+  std::vector<uint8_t> block(TCodec::CalcMaxBytes(nRows, src._kb.GetTargStride()));
+  const size_t nBytes = TCodec::EncodeRows(src._kb, 0, nRows, block.data());
+  TestArena<taNumber> dest(7, 3, 45);
+  for (size_t nCut = 1; nCut <= 16; nCut++) {
+    std::vector<uint8_t> truncated(block.begin(), block.begin() + (nBytes - nCut));
+    EXPECT_FALSE(TCodec::DecodeRows(dest._kb, 0, nRows, truncated.data(), truncated.size())) << "cut " << nCut;
+  }
+  std::vector<uint8_t> extended(block.begin(), block.begin() + nBytes);
+  extended.push_back(0);
+  EXPECT_FALSE(TCodec::DecodeRows(dest._kb, 0, nRows, extended.data(), extended.size()));
+  // '10' - the window of the previous XOR, while there is none yet.
+  const uint8_t noWindow[] = { 0x80 };
+  EXPECT_FALSE(TCodec::DecodeRows(dest._kb, 0, 1, noWindow, sizeof(noWindow)));
+  // '11' - the lengths having more leading zeros and meaningful bits than the number has bits.
+  const uint8_t badLens[] = { 0xFF, 0xFF, 0xFF };
+  EXPECT_FALSE(TCodec::DecodeRows(dest._kb, 0, 1, badLens, sizeof(badLens)));
+}
+
+std::vector<uint8_t> ReadFileBytes(const char* const filePath) {
+  std::vector<uint8_t> bytes;
+  std::FILE *fp = std::fopen(filePath, "rb");
+  if (fp != nullptr) {
+    uint8_t buf[4096];
+    size_t nRead;
+    while ((nRead = std::fread(buf, 1, sizeof(buf), fp)) != 0) {
+      bytes.insert(bytes.end(), buf, buf + nRead);
+    }
+    std::fclose(fp);
+  }
+  return bytes;
+}
+
+bool WriteFileBytes(const char* const filePath, const std::vector<uint8_t> &bytes) {
+  std::FILE *fp = std::fopen(filePath, "wb");
+  if (fp == nullptr) {
+    return false;
+  }
+  const bool bOk = (std::fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size());
+  return (std::fclose(fp) == 0) && bOk;
+}
+
+} // anonymous namespace
+
+TEST(KBCodecTest, RoundTripDouble) {
+  CheckCodec<SRDoubleNumber>();
+}
+
+TEST(KBCodecTest, RoundTripFloat) {
+  CheckCodec<SRFloatNumber>();
+}
+
+TEST(KBCodecTest, CompressedFile) {
+  const char* const cCodedPath = "PqaTest_Coded.kb";
+  const char* const cDamagedPath = "PqaTest_Damaged.kb";
+  const char* const cPlainPath = "PqaTest_Plain.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 100, 126);
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEngine, MakeTrainings(ed._dims, 1000)).IsOk());
+  KBWeights saved;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cPlainPath, saved));
+  ASSERT_TRUE(pEngine->SaveKB(cCodedPath, false, true).IsOk());
+
+  std::unique_ptr<IPqaEngine> pLoaded(PqaGetEngineFactory().LoadCpuEngine(err, cCodedPath));
+  ASSERT_TRUE(err.IsOk());
+  KBWeights loaded;
+  ASSERT_TRUE(SaveAndReadKB(*pLoaded, cPlainPath, loaded));
+  ExpectKBNear(saved, loaded);
+  pLoaded.reset();
+
+  const std::vector<uint8_t> coded = ReadFileBytes(cCodedPath);
+  ASSERT_GT(coded.size(), KBFileDirectory::_cPageBytes);
+  KBFileDirectory dir;
+  std::memcpy(&dir, coded.data(), sizeof(dir));
+  const KBFileSection *pIndex = nullptr;
+  for (uint32_t i = 0; i < dir._header._nSections; i++) {
+    if (dir._sections[i]._kind == KBFileSectionKind::CodecIndex) {
+      pIndex = dir._sections + i;
+    }
+  }
+  ASSERT_TRUE(pIndex != nullptr);
+
+  std::vector<std::vector<uint8_t>> damaged;
+  // The file truncated within the last block of the compressed weights.
+  damaged.emplace_back(coded.begin(), coded.end() - 1);
+  // The length of a section changed without updating the checksum.
+  damaged.push_back(coded);
+  reinterpret_cast<KBFileDirectory*>(damaged.back().data())->_sections[0]._nBytes += 8;
+  // The end of the first block moved, so the blocks no longer meet the length of the section.
+  damaged.push_back(coded);
+  reinterpret_cast<uint64_t*>(damaged.back().data() + pIndex->_offset)[1] -= 1;
+  for (size_t i = 0; i < damaged.size(); i++) {
+    ASSERT_TRUE(WriteFileBytes(cDamagedPath, damaged[i]));
+    std::unique_ptr<IPqaEngine> pDamaged(PqaGetEngineFactory().LoadCpuEngine(err, cDamagedPath));
+    EXPECT_FALSE(err.IsOk()) << "damage #" << i;
+    EXPECT_TRUE(pDamaged == nullptr) << "damage #" << i;
+  }
+  std::remove(cCodedPath);
+  std::remove(cDamagedPath);
+  std::remove(cPlainPath);
+}
@@ -0,0 +1,344 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// Save a trained plain engine, then load the file memory-mapped with |lo| and check that the loaded engine has the same
+//   weights and the file stays intact.
+void CheckMappedLoad(const LoadKBOptions &lo) {
+  const char* const cOrigPath = "PqaTest_Mapped.kb";
+  const char* const cCheckPath = "PqaTest_MappedCheck.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(4, 64, 128);
+  std::unique_ptr<IPqaEngine> pOrig(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pOrig, trainings, 0, 500).IsOk());
+  KBWeights saved;
+  ASSERT_TRUE(SaveAndReadKB(*pOrig, cOrigPath, saved));
+
+  std::unique_ptr<IPqaEngine> pMapped(PqaGetEngineFactory().LoadCpuEngine(err, cOrigPath, lo));
+  ASSERT_TRUE(err.IsOk());
+  EngineStats stats;
+  ASSERT_TRUE(pMapped->GetStats(stats).IsOk());
+  EXPECT_TRUE(stats._kbMapped);
+  KBWeights loaded;
+  ASSERT_TRUE(SaveAndReadKB(*pMapped, cCheckPath, loaded));
+  ExpectKBNear(saved, loaded);
+
+  // The quizzes run on the mapped pages.
+  const TPqaId iQuiz = pMapped->StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  const TPqaId iQuestion = pMapped->NextQuestion(err, iQuiz);
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(iQuestion >= 0 && iQuestion < ed._dims._nQuestions);
+  ASSERT_TRUE(pMapped->ReleaseQuiz(iQuiz).IsOk());
+
+  err = ApplyTrainings(*pMapped, trainings, 500, trainings.size());
+  if (lo._mapping == TPqaKBMapping::ReadOnly) {
+    EXPECT_EQ(PqaErrorCode::WrongMode, err.GetCode());
+  } else {
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(ApplyTrainings(*pOrig, trainings, 500, trainings.size()).IsOk());
+    KBWeights expected, trained;
+    ASSERT_TRUE(SaveAndReadKB(*pOrig, cCheckPath, expected));
+    ASSERT_TRUE(SaveAndReadKB(*pMapped, cCheckPath, trained));
+    ExpectKBNear(expected, trained);
+  }
+  pMapped.reset();
+
+  // Training a copy-on-write mapping modifies the pages privately to the process.
+  KBWeights reread;
+  ASSERT_TRUE(ReadKBWeights(cOrigPath, reread));
+  ExpectKBNear(saved, reread);
+  std::remove(cOrigPath);
+  std::remove(cCheckPath);
+}
+
+// Save a trained engine of precision |precType|, load the file, and check that the loaded engine saves the same weights.
+void CheckSectionedRoundTrip(const TPqaPrecisionType precType, const bool tiledA) {
+  const char* const cOrigPath = "PqaTest_Sectioned.kb";
+  const char* const cCheckPath = "PqaTest_SectionedCheck.kb";
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 100, 126);
+  ed._prec._type = precType;
+  ed._tiledA = tiledA;
+  std::unique_ptr<IPqaEngine> pOrig(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pOrig, MakeTrainings(ed._dims, 1000)).IsOk());
+  KBWeights saved;
+  ASSERT_TRUE(SaveAndReadKB(*pOrig, cOrigPath, saved));
+
+  KBFileDirectory dir;
+  std::FILE *fp = std::fopen(cOrigPath, "rb");
+  ASSERT_TRUE(fp != nullptr);
+  const size_t nRead = std::fread(&dir, sizeof(dir), 1, fp);
+  std::fclose(fp);
+  ASSERT_EQ(1u, nRead);
+  EXPECT_EQ(0, std::memcmp(dir._header._magic, cKBFileMagic, sizeof(cKBFileMagic)));
+  EXPECT_EQ(KBFileDirectory::_cPlainVersion, dir._header._version);
+  EXPECT_EQ(KBFileDirectory::_cEndianTag, dir._header._endianTag);
+  ASSERT_LE(dir._header._nSections, KBFileDirectory::_cMaxSections);
+  for (uint32_t i = 0; i < dir._header._nSections; i++) {
+    EXPECT_EQ(0u, dir._sections[i]._offset % KBFileDirectory::_cPageBytes);
+    EXPECT_GE(dir._sections[i]._offset, KBFileDirectory::_cPageBytes);
+  }
+
+  // The loaded engine keeps the layout of cube A of the original one.
+  LoadKBOptions lo;
+  lo._engDef = ed;
+  std::unique_ptr<IPqaEngine> pLoaded(PqaGetEngineFactory().LoadCpuEngine(err, cOrigPath, lo));
+  ASSERT_TRUE(err.IsOk());
+  EXPECT_EQ(ed._dims._nTargets, pLoaded->GetDims()._nTargets);
+  KBWeights loaded;
+  ASSERT_TRUE(SaveAndReadKB(*pLoaded, cCheckPath, loaded));
+  ExpectKBNear(saved, loaded);
+  pLoaded.reset();
+  std::remove(cOrigPath);
+  std::remove(cCheckPath);
+}
+
+// Matrix D must be the sum of cube A over the answers, up to the rounding of the trainings.
+void ExpectDConsistent(const KBWeights &kbw) {
+  for (TPqaId i = 0; i < kbw._dims._nQuestions; i++) {
+    for (TPqaId j = 0; j < kbw._dims._nTargets; j++) {
+      double sum = 0;
+      for (TPqaId k = 0; k < kbw._dims._nAnswers; k++) {
+        sum += kbw.GetA(i, k, j);
+      }
+      ASSERT_LE(std::abs(sum - kbw.GetD(i, j)), 1e-9 * kbw.GetD(i, j)) << "question " << i << ", target " << j;
+    }
+  }
+}
+
+} // anonymous namespace
+
+TEST(KBFileTest, MappedCopyOnWrite) {
+  LoadKBOptions lo;
+  lo._mapping = TPqaKBMapping::CopyOnWrite;
+  CheckMappedLoad(lo);
+}
+
+TEST(KBFileTest, MappedReadOnly) {
+  LoadKBOptions lo;
+  lo._mapping = TPqaKBMapping::ReadOnly;
+  CheckMappedLoad(lo);
+}
+
+// The table of 1/D can't be in the mapped file, so it's allocated separately and computed from the mapped matrix D .
+TEST(KBFileTest, MappedInvDTable) {
+  LoadKBOptions lo;
+  lo._mapping = TPqaKBMapping::CopyOnWrite;
+  lo._engDef._invDTable = true;
+  CheckMappedLoad(lo);
+}
+
+TEST(KBFileTest, SectionedRoundTrip) {
+  CheckSectionedRoundTrip(TPqaPrecisionType::Double, false);
+}
+
+TEST(KBFileTest, SectionedRoundTripFloat) {
+  CheckSectionedRoundTrip(TPqaPrecisionType::Float, false);
+}
+
+// The rows of the tiled cube A are gathered and scattered by the workers in parallel when saving and loading.
+TEST(KBFileTest, SectionedRoundTripTiled) {
+  CheckSectionedRoundTrip(TPqaPrecisionType::Double, true);
+}
+
+TEST(KBFileTest, LegacyLoad) {
+  const char* const cSectionedPath = "PqaTest_Sectioned.kb";
+  const char* const cLegacyPath = "PqaTest_Legacy.kb";
+  const char* const cCheckPath = "PqaTest_LegacyCheck.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 100, 126);
+  std::unique_ptr<IPqaEngine> pOrig(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pOrig, MakeTrainings(ed._dims, 1000)).IsOk());
+  KBWeights saved;
+  ASSERT_TRUE(SaveAndReadKB(*pOrig, cSectionedPath, saved));
+
+  // The legacy format: the precision definition, the engine dimensions, then the unpadded cube A, matrix D and vector B.
+  std::FILE *fp = std::fopen(cLegacyPath, "wb");
+  ASSERT_TRUE(fp != nullptr);
+  bool bOk = (std::fwrite(&ed._prec, sizeof(ed._prec), 1, fp) == 1)
+    && (std::fwrite(&ed._dims, sizeof(ed._dims), 1, fp) == 1);
+  for (const std::vector<double> *pPart : { &saved._a, &saved._d, &saved._b }) {
+    bOk = bOk && (std::fwrite(pPart->data(), sizeof(double), pPart->size(), fp) == pPart->size());
+  }
+  std::fclose(fp);
+  ASSERT_TRUE(bOk);
+
+  std::unique_ptr<IPqaEngine> pLoaded(PqaGetEngineFactory().LoadCpuEngine(err, cLegacyPath));
+  ASSERT_TRUE(err.IsOk());
+  KBWeights loaded;
+  ASSERT_TRUE(SaveAndReadKB(*pLoaded, cCheckPath, loaded));
+  ExpectKBNear(saved, loaded);
+  pLoaded.reset();
+  std::remove(cSectionedPath);
+  std::remove(cLegacyPath);
+  std::remove(cCheckPath);
+}
+
+TEST(KBFileTest, DoubleBufferSave) {
+  const char* const cPlainPath = "PqaTest_Plain.kb";
+  const char* const cDoubleBufPath = "PqaTest_DoubleBuf.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 100, 200);
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 20 * 1000);
+  ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(pEngine->SaveKB(cPlainPath, false).IsOk());
+  ASSERT_TRUE(pEngine->SaveKB(cDoubleBufPath, true).IsOk());
+  KBWeights plain, doubleBuf;
+  ASSERT_TRUE(ReadKBWeights(cPlainPath, plain));
+  ASSERT_TRUE(ReadKBWeights(cDoubleBufPath, doubleBuf));
+  ExpectKBNear(plain, doubleBuf);
+
+  // The snapshot is taken under the lock, so a save concurrent with the trainings doesn't catch one half-applied.
+  std::atomic<bool> bTrainOk(true);
+  std::thread trainer([&] {
+    bTrainOk = ApplyTrainings(*pEngine, trainings, 1000, trainings.size()).IsOk();
+  });
+  // The trainer thread must be joined even if a check fails.
+  for (int i = 0; i < 10 && !::testing::Test::HasFailure(); i++) {
+    EXPECT_TRUE(pEngine->SaveKB(cDoubleBufPath, true).IsOk());
+    EXPECT_TRUE(ReadKBWeights(cDoubleBufPath, doubleBuf));
+    ExpectDConsistent(doubleBuf);
+  }
+  trainer.join();
+  ASSERT_TRUE(bTrainOk);
+  std::remove(cPlainPath);
+  std::remove(cDoubleBufPath);
+}
+
+TEST(KBFileTest, IncrementalSave) {
+  const char* const cIncrPath = "PqaTest_Incremental.kb";
+  const char* const cFullPath = "PqaTest_Full.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 100, 200);
+  // Only the engine saving incrementally saves to its file, so that the file stays the one to patch. The reference
+  //   engine gets the same trainings and saves in full.
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  std::unique_ptr<IPqaEngine> pRef(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 3000);
+  ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pRef, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(pEngine->SaveKB(cIncrPath, false).IsOk());
+
+  // Patch the pages dirtied by the trainings a few times over, and the last time with nothing to patch.
+  KBWeights incr, full;
+  for (size_t iFirst = 1000; iFirst <= trainings.size(); iFirst += 1000) {
+    const size_t iLimit = std::min(iFirst + 1000, trainings.size());
+    ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, iFirst, iLimit).IsOk());
+    ASSERT_TRUE(ApplyTrainings(*pRef, trainings, iFirst, iLimit).IsOk());
+    ASSERT_TRUE(pEngine->SaveKBIncremental(cIncrPath).IsOk());
+    ASSERT_TRUE(ReadKBWeights(cIncrPath, incr));
+    ASSERT_TRUE(SaveAndReadKB(*pRef, cFullPath, full));
+    ExpectKBNear(full, incr);
+  }
+
+  // After the dimensions change, the whole KB is saved.
+  AddTargetParam atp;
+  atp._initialAmount = 0.1;
+  for (IPqaEngine *pCur : { pEngine.get(), pRef.get() }) {
+    ASSERT_TRUE(pCur->StartMaintenance(false).IsOk());
+    ASSERT_TRUE(pCur->AddTargets(1, &atp).IsOk());
+    ASSERT_TRUE(pCur->FinishMaintenance().IsOk());
+  }
+  ASSERT_TRUE(pEngine->SaveKBIncremental(cIncrPath).IsOk());
+  ASSERT_TRUE(ReadKBWeights(cIncrPath, incr));
+  EXPECT_EQ(ed._dims._nTargets + 1, incr._dims._nTargets);
+  ASSERT_TRUE(SaveAndReadKB(*pRef, cFullPath, full));
+  ExpectKBNear(full, incr);
+  std::remove(cIncrPath);
+  std::remove(cFullPath);
+}
+
+TEST(KBFileTest, JournalCrashRecovery) {
+  const char* const cKBPath = "PqaTest_Journaled.kb";
+  const char* const cJournalPath = "PqaTest_Journal.log";
+  const char* const cRefPath = "PqaTest_PreCrash.kb";
+  const char* const cCheckPath = "PqaTest_Recovered.kb";
+  std::remove(cJournalPath);
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 100, 200);
+  ed._journalPath = cJournalPath;
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 2000);
+  ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, 0, 1000).IsOk());
+  ASSERT_TRUE(pEngine->SaveKB(cKBPath, false).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, 1000, trainings.size()).IsOk());
+  KBWeights preCrash;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cRefPath, preCrash));
+  // The crash: the trainings after the save to |cKBPath| are only in the journal.
+  pEngine.reset();
+
+  LoadKBOptions lo;
+  lo._engDef._journalPath = cJournalPath;
+  std::unique_ptr<IPqaEngine> pRecovered(PqaGetEngineFactory().LoadCpuEngine(err, cKBPath, lo));
+  ASSERT_TRUE(err.IsOk());
+  KBWeights recovered;
+  ASSERT_TRUE(SaveAndReadKB(*pRecovered, cCheckPath, recovered));
+  ExpectKBNear(preCrash, recovered);
+  pRecovered.reset();
+  std::remove(cKBPath);
+  std::remove(cJournalPath);
+  std::remove(cRefPath);
+  std::remove(cCheckPath);
+}
+
+TEST(KBFileTest, AsyncSave) {
+  const char* const cAsyncPath = "PqaTest_Async.kb";
+  const char* const cSyncPath = "PqaTest_Sync.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(8, 500, 1000);
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEngine, MakeTrainings(ed._dims, 1000)).IsOk());
+  KBWeights sync, async;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cSyncPath, sync));
+
+  SaveKBOptions options;
+  options._chunkBytes = 64 * 1024;
+  std::unique_ptr<IPqaSaveKBJob> pJob(pEngine->SaveKBAsync(err, cAsyncPath, options));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(pJob->Wait());
+  ASSERT_TRUE(pJob->TakeResult().IsOk());
+  SaveKBProgress progress;
+  pJob->GetProgress(progress);
+  EXPECT_TRUE(progress._bDone);
+  EXPECT_GT(progress._nBytesTotal, 0u);
+  EXPECT_EQ(progress._nBytesTotal, progress._nBytesWritten);
+  pJob.reset();
+  ASSERT_TRUE(ReadKBWeights(cAsyncPath, async));
+  ExpectKBNear(sync, async);
+
+  // With small chunks, the job checks for the cancellation thousands of times before it's done.
+  options._chunkBytes = 4096;
+  pJob.reset(pEngine->SaveKBAsync(err, cAsyncPath, options));
+  ASSERT_TRUE(err.IsOk());
+  pJob->Cancel();
+  ASSERT_TRUE(pJob->Wait());
+  EXPECT_EQ(PqaErrorCode::Cancelled, pJob->TakeResult().GetCode());
+  pJob->GetProgress(progress);
+  EXPECT_LT(progress._nBytesWritten, progress._nBytesTotal);
+  pJob.reset();
+  // The engine stays usable after the cancellation.
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cAsyncPath, async));
+  ExpectKBNear(sync, async);
+  std::remove(cAsyncPath);
+  std::remove(cSyncPath);
+}
@@ -0,0 +1,226 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+void CheckCompact(const bool tiledA) {
+  const char* const cBeforePath = "PqaTest_BeforeCompact.kb";
+  const char* const cAfterPath = "PqaTest_AfterCompact.kb";
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 100, 230);
+  ed._tiledA = tiledA;
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEngine, MakeTrainings(ed._dims, 2000)).IsOk());
+  KBWeights before;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cBeforePath, before));
+
+  // The removed ones include the first and the last, and a run crossing a SIMD vector.
+  const TPqaId removedQuestions[] = { 0, 7, 8, 9, 50, 99 };
+  const TPqaId removedTargets[] = { 0, 3, 4, 5, 6, 100, 101, 200, 229 };
+  ASSERT_TRUE(pEngine->StartMaintenance(false).IsOk());
+  ASSERT_TRUE(pEngine->RemoveQuestions(TPqaId(std::size(removedQuestions)), removedQuestions).IsOk());
+  ASSERT_TRUE(pEngine->RemoveTargets(TPqaId(std::size(removedTargets)), removedTargets).IsOk());
+  CompactionResult cr;
+  ASSERT_TRUE(pEngine->Compact(cr).IsOk());
+  ASSERT_EQ(ed._dims._nQuestions - TPqaId(std::size(removedQuestions)), cr._nQuestions);
+  ASSERT_EQ(ed._dims._nTargets - TPqaId(std::size(removedTargets)), cr._nTargets);
+  const std::vector<TPqaId> oldQuestions(cr._pOldQuestions, cr._pOldQuestions + cr._nQuestions);
+  const std::vector<TPqaId> oldTargets(cr._pOldTargets, cr._pOldTargets + cr._nTargets);
+  ASSERT_TRUE(pEngine->ReleaseCompactionResult(cr).IsOk());
+  ASSERT_TRUE(pEngine->FinishMaintenance().IsOk());
+
+  // The old ids are the remaining ones, in the increasing order.
+  for (size_t i = 1; i < oldQuestions.size(); i++) {
+    ASSERT_LT(oldQuestions[i - 1], oldQuestions[i]);
+  }
+  for (size_t i = 1; i < oldTargets.size(); i++) {
+    ASSERT_LT(oldTargets[i - 1], oldTargets[i]);
+  }
+  for (const TPqaId iQuestion : removedQuestions) {
+    ASSERT_FALSE(std::binary_search(oldQuestions.begin(), oldQuestions.end(), iQuestion));
+  }
+  for (const TPqaId iTarget : removedTargets) {
+    ASSERT_FALSE(std::binary_search(oldTargets.begin(), oldTargets.end(), iTarget));
+  }
+
+  KBWeights after;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cAfterPath, after));
+  ASSERT_EQ(TPqaId(oldQuestions.size()), after._dims._nQuestions);
+  ASSERT_EQ(TPqaId(oldTargets.size()), after._dims._nTargets);
+  for (TPqaId i = 0; i < after._dims._nQuestions; i++) {
+    for (TPqaId j = 0; j < after._dims._nTargets; j++) {
+      for (TPqaId k = 0; k < after._dims._nAnswers; k++) {
+        ASSERT_EQ(before.GetA(oldQuestions[i], k, oldTargets[j]), after.GetA(i, k, j));
+      }
+      ASSERT_EQ(before.GetD(oldQuestions[i], oldTargets[j]), after.GetD(i, j));
+    }
+  }
+  for (TPqaId j = 0; j < after._dims._nTargets; j++) {
+    ASSERT_EQ(before._b[size_t(oldTargets[j])], after._b[size_t(j)]);
+  }
+
+  // The compacted KB is trained and quizzed as usual.
+  ASSERT_TRUE(ApplyTrainings(*pEngine, MakeTrainings(after._dims, 100)).IsOk());
+  const TPqaId iQuiz = pEngine->StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  const TPqaId iQuestion = pEngine->NextQuestion(err, iQuiz);
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(iQuestion >= 0 && iQuestion < after._dims._nQuestions);
+  ASSERT_TRUE(pEngine->ReleaseQuiz(iQuiz).IsOk());
+  std::remove(cBeforePath);
+  std::remove(cAfterPath);
+}
+
+// The sum of cube A over the answers with Kahan summation, as the recomputation of matrix D does it.
+double SumA(const KBWeights &kbw, const TPqaId iQuestion, const TPqaId iTarget) {
+  double sum = 0, corr = 0;
+  for (TPqaId k = 0; k < kbw._dims._nAnswers; k++) {
+    const double y = kbw.GetA(iQuestion, k, iTarget) - corr;
+    const double t = sum + y;
+    corr = (t - sum) - y;
+    sum = t;
+  }
+  return sum - corr;
+}
+
+// Recompute matrix D and wait for it, expecting all the questions to be done.
+void RecomputeD(IPqaEngine &engine) {
+  PqaError err;
+  RecomputeDOptions options;
+  options._bLowPriority = false;
+  // The chunks don't divide the questions evenly.
+  options._nQuestionsPerChunk = 7;
+  std::unique_ptr<IPqaRecomputeDJob> pJob(engine.RecomputeDAsync(err, options));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(pJob->Wait());
+  ASSERT_TRUE(pJob->TakeResult().IsOk());
+  RecomputeDProgress progress;
+  pJob->GetProgress(progress);
+  EXPECT_EQ(engine.GetDims()._nQuestions, progress._nQuestionsTotal);
+  EXPECT_EQ(progress._nQuestionsTotal, progress._nQuestionsDone);
+}
+
+} // anonymous namespace
+
+TEST(KBMaintenanceTest, AddQuestionsAndTargets) {
+  const char* const cGrownPath = "PqaTest_Grown.kb";
+  const char* const cPlainPath = "PqaTest_Plain.kb";
+  PqaError err;
+  const EngineDefinition edFinal = MakeEngineDefinition(5, 100, 230);
+  const EngineDefinition edInitial = MakeEngineDefinition(5, 60, 100);
+  std::unique_ptr<IPqaEngine> pPlain(PqaGetEngineFactory().CreateCpuEngine(err, edFinal));
+  ASSERT_TRUE(err.IsOk());
+  std::unique_ptr<IPqaEngine> pGrown(PqaGetEngineFactory().CreateCpuEngine(err, edInitial));
+  ASSERT_TRUE(err.IsOk());
+  const std::vector<RecordedTraining> before = MakeTrainings(edInitial._dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pPlain, before).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pGrown, before).IsOk());
+
+  // Grow in batches, so that the spare capacity is used up and reallocated a few times.
+  ASSERT_TRUE(pGrown->StartMaintenance(false).IsOk());
+  TPqaId iNextQuestion = edInitial._dims._nQuestions;
+  for (TPqaId i = 0; i < 4; i++) {
+    std::vector<AddQuestionParam> aqps(10);
+    for (AddQuestionParam &aqp : aqps) {
+      aqp._initialAmount = edFinal._initAmount;
+    }
+    ASSERT_TRUE(pGrown->AddQuestions(TPqaId(aqps.size()), aqps.data()).IsOk());
+    for (const AddQuestionParam &aqp : aqps) {
+      EXPECT_EQ(iNextQuestion, aqp._iQuestion);
+      iNextQuestion++;
+    }
+  }
+  TPqaId iNextTarget = edInitial._dims._nTargets;
+  for (TPqaId i = 0; i < 10; i++) {
+    std::vector<AddTargetParam> atps(13);
+    for (AddTargetParam &atp : atps) {
+      atp._initialAmount = edFinal._initAmount;
+    }
+    ASSERT_TRUE(pGrown->AddTargets(TPqaId(atps.size()), atps.data()).IsOk());
+    for (const AddTargetParam &atp : atps) {
+      EXPECT_EQ(iNextTarget, atp._iTarget);
+      iNextTarget++;
+    }
+  }
+  ASSERT_TRUE(pGrown->FinishMaintenance().IsOk());
+  EXPECT_EQ(edFinal._dims._nQuestions, pGrown->GetDims()._nQuestions);
+  EXPECT_EQ(edFinal._dims._nTargets, pGrown->GetDims()._nTargets);
+
+  const std::vector<RecordedTraining> after = MakeTrainings(edFinal._dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pPlain, after).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pGrown, after).IsOk());
+  KBWeights expected, grown;
+  ASSERT_TRUE(SaveAndReadKB(*pPlain, cPlainPath, expected));
+  ASSERT_TRUE(SaveAndReadKB(*pGrown, cGrownPath, grown));
+  ExpectKBNear(expected, grown);
+
+  // The quizzes run over the grown KB.
+  const TPqaId iQuiz = pGrown->StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  const TPqaId iQuestion = pGrown->NextQuestion(err, iQuiz);
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(iQuestion >= 0 && iQuestion < edFinal._dims._nQuestions);
+  ASSERT_TRUE(pGrown->ReleaseQuiz(iQuiz).IsOk());
+  std::remove(cGrownPath);
+  std::remove(cPlainPath);
+}
+
+TEST(KBMaintenanceTest, Compact) {
+  CheckCompact(false);
+}
+
+TEST(KBMaintenanceTest, CompactTiled) {
+  CheckCompact(true);
+}
+
+TEST(KBMaintenanceTest, RecomputeD) {
+  const char* const cBeforePath = "PqaTest_BeforeRecompute.kb";
+  const char* const cAfterPath = "PqaTest_AfterRecompute.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 100, 230);
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  // Many trainings, so that the increments of D drift from the sums of A.
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 20 * 1000);
+  ASSERT_TRUE(ApplyTrainings(*pEngine, trainings, 0, 10 * 1000).IsOk());
+  KBWeights before, after;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cBeforePath, before));
+  RecomputeD(*pEngine);
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cAfterPath, after));
+  // Only matrix D changes, to the compensated sums of cube A.
+  EXPECT_EQ(before._a, after._a);
+  EXPECT_EQ(before._b, after._b);
+  for (TPqaId i = 0; i < after._dims._nQuestions; i++) {
+    for (TPqaId j = 0; j < after._dims._nTargets; j++) {
+      const double expected = SumA(before, i, j);
+      ASSERT_LE(std::abs(expected - after.GetD(i, j)), 1e-15 * expected) << "question " << i << ", target " << j;
+    }
+  }
+
+  // The chunks summed while the trainings go on are summed again before they are written.
+  std::atomic<bool> bTrainOk(true);
+  std::thread trainer([&] {
+    bTrainOk = ApplyTrainings(*pEngine, trainings, 10 * 1000, trainings.size()).IsOk();
+  });
+  RecomputeD(*pEngine);
+  trainer.join();
+  ASSERT_TRUE(bTrainOk);
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cAfterPath, after));
+  for (TPqaId i = 0; i < after._dims._nQuestions; i++) {
+    for (TPqaId j = 0; j < after._dims._nTargets; j++) {
+      const double expected = SumA(after, i, j);
+      ASSERT_LE(std::abs(expected - after.GetD(i, j)), 1e-12 * expected) << "question " << i << ", target " << j;
+    }
+  }
+  std::remove(cBeforePath);
+  std::remove(cAfterPath);
+}
@@ -0,0 +1,203 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// The pruned quiz multiplies the likelihoods of the active targets by the same factors as the unpruned one, only in
+//   another order.
+constexpr double cPruneRelTol = 1e-9;
+constexpr double cPruneEps = 1e-2;
+// The amount of the trainings that separate the targets: an answer makes a target trained for the other answer about
+//   1e-3 as likely as one trained for the answer given.
+constexpr TPqaAmount cStrongAmount = 100;
+
+// Make an unpruned dense engine and one that prunes the targets, of the definition |ed|.
+void MakeEnginePair(const EngineDefinition &ed, const TPqaId fullPassPeriod, std::unique_ptr<IPqaEngine> &pPlain,
+  std::unique_ptr<IPqaEngine> &pPruned)
+{
+  PqaError err;
+  pPlain.reset(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  EngineDefinition edPruned = ed;
+  edPruned._pruneTargetsEps = cPruneEps;
+  edPruned._pruneFullPassPeriod = fullPassPeriod;
+  pPruned.reset(PqaGetEngineFactory().CreateCpuEngine(err, edPruned));
+  ASSERT_TRUE(err.IsOk());
+}
+
+// 2 answers, 12 questions and 8 groups of 8 targets. Question |iQuestion| asks bit iQuestion%3 of the group, and the
+//   later questions separate the groups weaker, so that the quizzes drop and readmit the groups at different paces.
+void TrainGroupBits(IPqaEngine &engine) {
+  const TPqaId nTargets = engine.GetDims()._nTargets;
+  for (TPqaId iTarget = 0; iTarget < nTargets; iTarget++) {
+    const TPqaId iGroup = iTarget / 8;
+    for (TPqaId k = 0; k < 4; k++) {
+      std::vector<AnsweredQuestion> aqs;
+      for (TPqaId iBit = 0; iBit < 3; iBit++) {
+        aqs.emplace_back(3 * k + iBit, (iGroup >> iBit) & 1);
+      }
+      ASSERT_TRUE(engine.Train(3, aqs.data(), iTarget, std::ldexp(cStrongAmount, -2 * int(k))).IsOk());
+    }
+  }
+}
+
+// The probabilities of the targets that the pruned quiz lists must be those of the unpruned quiz normalized over the
+//   listed targets. So they differ from the unpruned ones by no more than the mass of the dropped targets.
+void ExpectRenormalized(const std::vector<double> &plain, const std::vector<double> &pruned) {
+  ASSERT_EQ(plain.size(), pruned.size());
+  double activeMass = 0;
+  for (size_t i = 0; i < pruned.size(); i++) {
+    if (pruned[i] > 0) {
+      activeMass += plain[i];
+    }
+  }
+  ASSERT_GT(activeMass, 0);
+  for (size_t i = 0; i < pruned.size(); i++) {
+    if (pruned[i] > 0) {
+      EXPECT_NEAR(plain[i] / activeMass, pruned[i], cPruneRelTol * pruned[i]) << "at target " << i;
+    }
+  }
+}
+
+// Count the second questions that fresh quizzes of |engine| get after answering the first question with answer 0.
+void SampleSecondQuestions(IPqaEngine &engine, const int64_t nQuizzes, std::vector<int64_t> &counts) {
+  PqaError err;
+  const TPqaId nQuestions = engine.GetDims()._nQuestions;
+  counts.assign(SRCast::ToSizeT(nQuestions), 0);
+  for (int64_t i = 0; i < nQuizzes; i++) {
+    const TPqaId iQuiz = engine.StartQuiz(err);
+    ASSERT_TRUE(err.IsOk());
+    const TPqaId iFirst = engine.NextQuestion(err, iQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(engine.RecordAnswer(iQuiz, 0).IsOk());
+    const TPqaId iSecond = engine.NextQuestion(err, iQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(iSecond >= 0 && iSecond < nQuestions && iSecond != iFirst);
+    counts[SRCast::ToSizeT(iSecond)]++;
+    ASSERT_TRUE(engine.ReleaseQuiz(iQuiz).IsOk());
+  }
+}
+
+} // anonymous namespace
+
+// Random answers both drop the groups of targets and shift the mass back to them. After each answer, the pruned quiz
+//   must list the same probabilities as an unpruned quiz resumed with the same answers, up to the dropped mass.
+TEST(PruningTest, ListTopTargets) {
+  std::unique_ptr<IPqaEngine> pPlain, pPruned;
+  MakeEnginePair(MakeEngineDefinition(2, 12, 64), 4, pPlain, pPruned);
+  TrainGroupBits(*pPlain);
+  TrainGroupBits(*pPruned);
+  const TPqaId nQuestions = pPruned->GetDims()._nQuestions;
+  const TPqaId nTargets = pPruned->GetDims()._nTargets;
+
+  SRFastRandom fr;
+  SREntropyAdapter ea(fr);
+  PqaError err;
+  int64_t nPrunedLists = 0;
+  std::vector<double> plainProbs, prunedProbs;
+  for (int64_t iTrial = 0; iTrial < 20; iTrial++) {
+    const TPqaId iPrunedQuiz = pPruned->StartQuiz(err);
+    ASSERT_TRUE(err.IsOk());
+    std::vector<AnsweredQuestion> answered;
+    std::vector<bool> asked(SRCast::ToSizeT(nQuestions), false);
+    for (TPqaId j = 0; j < nQuestions; j++) {
+      const TPqaId iQuestion = pPruned->NextQuestion(err, iPrunedQuiz);
+      ASSERT_TRUE(err.IsOk());
+      ASSERT_TRUE(iQuestion >= 0 && iQuestion < nQuestions);
+      ASSERT_FALSE(asked[SRCast::ToSizeT(iQuestion)]);
+      asked[SRCast::ToSizeT(iQuestion)] = true;
+      const TPqaId iAnswer = ea.Generate<TPqaId>(2);
+      ASSERT_TRUE(pPruned->RecordAnswer(iPrunedQuiz, iAnswer).IsOk());
+      answered.emplace_back(iQuestion, iAnswer);
+
+      const TPqaId iPlainQuiz = pPlain->ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+      ASSERT_TRUE(err.IsOk());
+      ASSERT_EQ(nTargets, ListAllTargets(*pPlain, iPlainQuiz, plainProbs));
+      ASSERT_TRUE(pPlain->ReleaseQuiz(iPlainQuiz).IsOk());
+      const TPqaId nPrunedListed = ListAllTargets(*pPruned, iPrunedQuiz, prunedProbs);
+      ASSERT_GT(nPrunedListed, 0);
+      if (nPrunedListed < nTargets) {
+        nPrunedLists++;
+      }
+      ExpectRenormalized(plainProbs, prunedProbs);
+    }
+    ASSERT_TRUE(pPruned->ReleaseQuiz(iPrunedQuiz).IsOk());
+  }
+  // Otherwise the test would check nothing about pruning.
+  EXPECT_LT(0, nPrunedLists);
+}
+
+// The pruned quiz replaces the dropped targets in the priorities of the questions by their lack, so it must select the
+//   next question by nearly the same distribution as the unpruned one.
+TEST(PruningTest, NextQuestion) {
+  std::unique_ptr<IPqaEngine> pPlain, pPruned;
+  MakeEnginePair(MakeEngineDefinition(2, 12, 64), 4, pPlain, pPruned);
+  TrainGroupBits(*pPlain);
+  TrainGroupBits(*pPruned);
+  constexpr int64_t cnQuizzes = 20 * 1000;
+  std::vector<int64_t> plain, pruned;
+  SampleSecondQuestions(*pPlain, cnQuizzes, plain);
+  SampleSecondQuestions(*pPruned, cnQuizzes, pruned);
+  EXPECT_EQ(0, CountDiffering(plain, pruned));
+}
+
+// Targets [0, 32) answer question 0 with answer 0 and the other questions with answer 1, while targets [32, 64) answer
+//   the opposite. The first answers drop the latter half, the next ones shift the mass back to it, and the full pass
+//   must readmit it.
+TEST(PruningTest, Readmission) {
+  std::unique_ptr<IPqaEngine> pPlain, pPruned;
+  MakeEnginePair(MakeEngineDefinition(2, 8, 64), 3, pPlain, pPruned);
+  const TPqaId nQuestions = pPruned->GetDims()._nQuestions;
+  const TPqaId nTargets = pPruned->GetDims()._nTargets;
+  const TPqaId nHalf = nTargets / 2;
+  for (IPqaEngine *pEngine : { pPlain.get(), pPruned.get() }) {
+    for (TPqaId iTarget = 0; iTarget < nTargets; iTarget++) {
+      const TPqaId iFlip = ((iTarget < nHalf) ? 0 : 1);
+      std::vector<AnsweredQuestion> aqs;
+      for (TPqaId i = 0; i < nQuestions; i++) {
+        aqs.emplace_back(i, ((i == 0) ? 0 : 1) ^ iFlip);
+      }
+      ASSERT_TRUE(pEngine->Train(nQuestions, aqs.data(), iTarget, cStrongAmount).IsOk());
+    }
+  }
+
+  PqaError err;
+  std::vector<AnsweredQuestion> answered = { AnsweredQuestion(0, 0) };
+  // A resumed quiz is pruned by its first recorded answer, which is a full pass.
+  const TPqaId iPrunedQuiz = pPruned->ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+  ASSERT_TRUE(err.IsOk());
+  // The mass of the latter half relative to the former one after each answer is 1e-6, 1e-3, 1 and 1e3 . The full
+  //   passes are after the first and the fourth answers.
+  const TPqaId answers[] = { 1, 0, 0, 0 };
+  std::vector<double> plainProbs, prunedProbs;
+  for (size_t j = 0; j < std::size(answers); j++) {
+    const TPqaId iQuestion = pPruned->NextQuestion(err, iPrunedQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(iQuestion >= 1 && iQuestion < nQuestions);
+    ASSERT_TRUE(pPruned->RecordAnswer(iPrunedQuiz, answers[j]).IsOk());
+    answered.emplace_back(iQuestion, answers[j]);
+
+    const TPqaId iPlainQuiz = pPlain->ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_EQ(nTargets, ListAllTargets(*pPlain, iPlainQuiz, plainProbs));
+    ASSERT_TRUE(pPlain->ReleaseQuiz(iPlainQuiz).IsOk());
+    ASSERT_EQ(nHalf, ListAllTargets(*pPruned, iPrunedQuiz, prunedProbs));
+    ExpectRenormalized(plainProbs, prunedProbs);
+
+    // Until the full pass, the latter half stays dropped even when its mass is back. Then the former half is dropped.
+    const bool bReadmitted = (j + 1 == std::size(answers));
+    for (TPqaId i = 0; i < nTargets; i++) {
+      EXPECT_EQ(bReadmitted == (i >= nHalf), prunedProbs[SRCast::ToSizeT(i)] > 0) << "at target " << i;
+    }
+  }
+  EXPECT_GT(plainProbs[SRCast::ToSizeT(nHalf)], 0.99 / nHalf);
+  ASSERT_TRUE(pPruned->ReleaseQuiz(iPrunedQuiz).IsOk());
+}
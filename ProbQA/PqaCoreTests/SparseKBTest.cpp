@@ -0,0 +1,260 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "EngineTestHelpers.h"
+
+using namespace ProbQA;
+using namespace SRPlat;
+using namespace PqaTest;
+
+namespace {
+
+// The weights of the sparse engine are computed in the same way as of the dense one, but sequentially.
+constexpr double cSparseRelTol = 1e-12;
+
+// Make a dense engine and a sparse one of the definition |ed|.
+void MakeEnginePair(const EngineDefinition &ed, std::unique_ptr<IPqaEngine> &pDense,
+  std::unique_ptr<IPqaEngine> &pSparse)
+{
+  PqaError err;
+  pDense.reset(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  EngineDefinition edSparse = ed;
+  edSparse._sparseKB = true;
+  pSparse.reset(PqaGetEngineFactory().CreateCpuEngine(err, edSparse));
+  ASSERT_TRUE(err.IsOk());
+}
+
+// The ids that a maintenance run assigned, which are the same in the dense and the sparse engines.
+struct MaintenanceIds {
+  std::vector<TPqaId> _addedQuestions;
+  std::vector<TPqaId> _addedTargets;
+  std::vector<TPqaId> _oldQuestions;
+  std::vector<TPqaId> _oldTargets;
+};
+
+// Add questions and targets of |amount| to |engine|, appending their ids to |ids|.
+void AddItems(IPqaEngine &engine, const TPqaId nQuestions, const TPqaId nTargets, const TPqaAmount amount,
+  MaintenanceIds &ids)
+{
+  std::vector<AddQuestionParam> aqps(SRCast::ToSizeT(nQuestions));
+  for (AddQuestionParam &aqp : aqps) {
+    aqp._initialAmount = amount;
+  }
+  ASSERT_TRUE(engine.AddQuestions(nQuestions, aqps.data()).IsOk());
+  std::vector<AddTargetParam> atps(SRCast::ToSizeT(nTargets));
+  for (AddTargetParam &atp : atps) {
+    atp._initialAmount = amount;
+  }
+  ASSERT_TRUE(engine.AddTargets(nTargets, atps.data()).IsOk());
+  for (const AddQuestionParam &aqp : aqps) {
+    ids._addedQuestions.push_back(aqp._iQuestion);
+  }
+  for (const AddTargetParam &atp : atps) {
+    ids._addedTargets.push_back(atp._iTarget);
+  }
+}
+
+void RunMaintenance(IPqaEngine &engine, MaintenanceIds &ids) {
+  ASSERT_TRUE(engine.StartMaintenance(false).IsOk());
+  // The amounts differ from the initial amount of the engine, so some cells of the new targets are explicit.
+  AddItems(engine, 10, 13, 0.2, ids);
+  ASSERT_FALSE(::testing::Test::HasFatalFailure());
+  AddItems(engine, 5, 7, 0.3, ids);
+  ASSERT_FALSE(::testing::Test::HasFatalFailure());
+  const TPqaId removedQuestions[] = { 0, 7, 61, 74 };
+  const TPqaId removedTargets[] = { 3, 50, 105, 119 };
+  ASSERT_TRUE(engine.RemoveQuestions(TPqaId(std::size(removedQuestions)), removedQuestions).IsOk());
+  ASSERT_TRUE(engine.RemoveTargets(TPqaId(std::size(removedTargets)), removedTargets).IsOk());
+  // Reuse some of the gaps, resetting the weights trained there.
+  AddItems(engine, 2, 2, 0.1, ids);
+  ASSERT_FALSE(::testing::Test::HasFatalFailure());
+  CompactionResult cr;
+  ASSERT_TRUE(engine.Compact(cr).IsOk());
+  ids._oldQuestions.assign(cr._pOldQuestions, cr._pOldQuestions + cr._nQuestions);
+  ids._oldTargets.assign(cr._pOldTargets, cr._pOldTargets + cr._nTargets);
+  ASSERT_TRUE(engine.ReleaseCompactionResult(cr).IsOk());
+  ASSERT_TRUE(engine.FinishMaintenance().IsOk());
+}
+
+} // anonymous namespace
+
+TEST(SparseKBTest, Maintenance) {
+  const char* const cDensePath = "PqaTest_DenseMaint.kb";
+  const char* const cSparsePath = "PqaTest_SparseMaint.kb";
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 60, 100);
+  std::unique_ptr<IPqaEngine> pDense, pSparse;
+  MakeEnginePair(ed, pDense, pSparse);
+  ASSERT_FALSE(HasFatalFailure());
+  const std::vector<RecordedTraining> before = MakeTrainings(ed._dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pDense, before).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pSparse, before).IsOk());
+
+  MaintenanceIds denseIds, sparseIds;
+  RunMaintenance(*pDense, denseIds);
+  ASSERT_FALSE(HasFatalFailure());
+  RunMaintenance(*pSparse, sparseIds);
+  ASSERT_FALSE(HasFatalFailure());
+  EXPECT_EQ(denseIds._addedQuestions, sparseIds._addedQuestions);
+  EXPECT_EQ(denseIds._addedTargets, sparseIds._addedTargets);
+  EXPECT_EQ(denseIds._oldQuestions, sparseIds._oldQuestions);
+  EXPECT_EQ(denseIds._oldTargets, sparseIds._oldTargets);
+  const EngineDimensions dims = pSparse->GetDims();
+  EXPECT_EQ(pDense->GetDims()._nQuestions, dims._nQuestions);
+  EXPECT_EQ(pDense->GetDims()._nTargets, dims._nTargets);
+
+  const std::vector<RecordedTraining> after = MakeTrainings(dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pDense, after).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pSparse, after).IsOk());
+  KBWeights expected, sparse;
+  ASSERT_TRUE(SaveAndReadKB(*pDense, cDensePath, expected));
+  ASSERT_TRUE(SaveAndReadKB(*pSparse, cSparsePath, sparse));
+  ExpectKBNear(expected, sparse, cSparseRelTol);
+
+  // The quizzes run over the maintained KB.
+  const TPqaId iQuiz = pSparse->StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  const TPqaId iQuestion = pSparse->NextQuestion(err, iQuiz);
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(iQuestion >= 0 && iQuestion < dims._nQuestions);
+  ASSERT_TRUE(pSparse->RecordAnswer(iQuiz, 0).IsOk());
+  RatedTarget rt;
+  ASSERT_EQ(1, pSparse->ListTopTargets(err, iQuiz, 1, &rt));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(pSparse->ReleaseQuiz(iQuiz).IsOk());
+  std::remove(cDensePath);
+  std::remove(cSparsePath);
+}
+
+TEST(SparseKBTest, SaveLoad) {
+  const char* const cSavedPath = "PqaTest_SparseSaved.kb";
+  const char* const cReloadedPath = "PqaTest_SparseReloaded.kb";
+  PqaError err;
+  EngineDefinition ed = MakeEngineDefinition(5, 60, 100);
+  ed._sparseKB = true;
+  std::unique_ptr<IPqaEngine> pEngine(PqaGetEngineFactory().CreateCpuEngine(err, ed));
+  ASSERT_TRUE(err.IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pEngine, MakeTrainings(ed._dims, 1000)).IsOk());
+  // The gaps and the added items with their own default cells are saved too.
+  ASSERT_TRUE(pEngine->StartMaintenance(false).IsOk());
+  MaintenanceIds ids;
+  AddItems(*pEngine, 3, 3, 0.3, ids);
+  ASSERT_FALSE(HasFatalFailure());
+  const TPqaId iRemovedQuestion = 5;
+  const TPqaId iRemovedTarget = 17;
+  ASSERT_TRUE(pEngine->RemoveQuestions(1, &iRemovedQuestion).IsOk());
+  ASSERT_TRUE(pEngine->RemoveTargets(1, &iRemovedTarget).IsOk());
+  ASSERT_TRUE(pEngine->FinishMaintenance().IsOk());
+  KBWeights saved;
+  ASSERT_TRUE(SaveAndReadKB(*pEngine, cSavedPath, saved));
+  EngineStats stats;
+  ASSERT_TRUE(pEngine->GetStats(stats).IsOk());
+
+  // The KB file decides that the engine is sparse, regardless of the options.
+  LoadKBOptions lo;
+  lo._engDef._sparseKB = false;
+  std::unique_ptr<IPqaEngine> pLoaded(PqaGetEngineFactory().LoadCpuEngine(err, cSavedPath, lo));
+  ASSERT_TRUE(err.IsOk());
+  EngineStats loadedStats;
+  ASSERT_TRUE(pLoaded->GetStats(loadedStats).IsOk());
+  EXPECT_EQ(stats._kbBytes, loadedStats._kbBytes);
+  EXPECT_FALSE(loadedStats._kbMapped);
+  KBWeights reloaded;
+  ASSERT_TRUE(SaveAndReadKB(*pLoaded, cReloadedPath, reloaded));
+  ExpectKBNear(saved, reloaded);
+  {
+    // Only the sparse engine saves the sparse sections.
+    KBFileDirectory dir;
+    std::FILE *fp = std::fopen(cReloadedPath, "rb");
+    ASSERT_NE(nullptr, fp);
+    ASSERT_EQ(1u, std::fread(&dir, sizeof(dir), 1, fp));
+    std::fclose(fp);
+    EXPECT_EQ(KBFileDirectory::_cSparseVersion, dir._header._version);
+  }
+  EXPECT_EQ(pEngine->GetTotalQuestionsAsked(err), pLoaded->GetTotalQuestionsAsked(err));
+
+  // The gaps are restored, and the quizzes go the same way over both engines.
+  const AnsweredQuestion aq(iRemovedQuestion, 0);
+  EXPECT_EQ(PqaErrorCode::AbsentId, pLoaded->Train(1, &aq, 0).GetCode());
+  const AnsweredQuestion aqValid(0, 0);
+  EXPECT_EQ(PqaErrorCode::AbsentId, pLoaded->Train(1, &aqValid, iRemovedTarget).GetCode());
+  for (IPqaEngine *pCur : { pEngine.get(), pLoaded.get() }) {
+    ASSERT_TRUE(pCur->Train(1, &aqValid, 1).IsOk());
+  }
+  // NextQuestion() selects at random, so the quizzes are resumed from the same answers instead.
+  const AnsweredQuestion answered[] = { AnsweredQuestion(0, 1), AnsweredQuestion(2, 3), AnsweredQuestion(9, 0) };
+  RatedTarget tops[2][5];
+  IPqaEngine *const engines[2] = { pEngine.get(), pLoaded.get() };
+  for (size_t e = 0; e < 2; e++) {
+    const TPqaId iQuiz = engines[e]->ResumeQuiz(err, TPqaId(std::size(answered)), answered);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_EQ(5, engines[e]->ListTopTargets(err, iQuiz, 5, tops[e]));
+    ASSERT_TRUE(err.IsOk());
+    const TPqaId iQuestion = engines[e]->NextQuestion(err, iQuiz);
+    ASSERT_TRUE(err.IsOk());
+    EXPECT_NE(iRemovedQuestion, iQuestion);
+    ASSERT_TRUE(engines[e]->ReleaseQuiz(iQuiz).IsOk());
+  }
+  for (size_t i = 0; i < 5; i++) {
+    EXPECT_EQ(tops[0][i]._iTarget, tops[1][i]._iTarget);
+    EXPECT_EQ(tops[0][i]._prob, tops[1][i]._prob);
+  }
+  std::remove(cSavedPath);
+  std::remove(cReloadedPath);
+}
+
+TEST(SparseKBTest, SameAsDense) {
+  PqaError err;
+  const EngineDefinition ed = MakeEngineDefinition(5, 60, 100);
+  std::unique_ptr<IPqaEngine> pDense, pSparse;
+  MakeEnginePair(ed, pDense, pSparse);
+  ASSERT_FALSE(HasFatalFailure());
+  const std::vector<RecordedTraining> trainings = MakeTrainings(ed._dims, 1000);
+  ASSERT_TRUE(ApplyTrainings(*pDense, trainings).IsOk());
+  ASSERT_TRUE(ApplyTrainings(*pSparse, trainings).IsOk());
+
+  // The sparse engine selects the questions, with its approximation of the lack term, and the dense engine resumes
+  //   from the same answers at each step.
+  const TPqaId nTargets = ed._dims._nTargets;
+  std::vector<AnsweredQuestion> answered;
+  const TPqaId iSparseQuiz = pSparse->StartQuiz(err);
+  ASSERT_TRUE(err.IsOk());
+  for (TPqaId step = 0; step < 8; step++) {
+    const TPqaId iQuestion = pSparse->NextQuestion(err, iSparseQuiz);
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(iQuestion >= 0 && iQuestion < ed._dims._nQuestions);
+    for (const AnsweredQuestion &aq : answered) {
+      ASSERT_NE(aq._iQuestion, iQuestion);
+    }
+    const TPqaId iAnswer = (iQuestion + step) % ed._dims._nAnswers;
+    ASSERT_TRUE(pSparse->RecordAnswer(iSparseQuiz, iAnswer).IsOk());
+    answered.emplace_back(iQuestion, iAnswer);
+
+    const TPqaId iDenseQuiz = pDense->ResumeQuiz(err, TPqaId(answered.size()), answered.data());
+    ASSERT_TRUE(err.IsOk());
+    std::vector<RatedTarget> denseTops(SRCast::ToSizeT(nTargets)), sparseTops(SRCast::ToSizeT(nTargets));
+    ASSERT_EQ(nTargets, pDense->ListTopTargets(err, iDenseQuiz, nTargets, denseTops.data()));
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_EQ(nTargets, pSparse->ListTopTargets(err, iSparseQuiz, nTargets, sparseTops.data()));
+    ASSERT_TRUE(err.IsOk());
+    ASSERT_TRUE(pDense->ReleaseQuiz(iDenseQuiz).IsOk());
+
+    // The targets of equal probability may come in any order, so the distributions are compared by target.
+    std::vector<double> denseProbs(SRCast::ToSizeT(nTargets), -1), sparseProbs(SRCast::ToSizeT(nTargets), -1);
+    for (TPqaId i = 0; i < nTargets; i++) {
+      denseProbs[SRCast::ToSizeT(denseTops[i]._iTarget)] = denseTops[i]._prob;
+      sparseProbs[SRCast::ToSizeT(sparseTops[i]._iTarget)] = sparseTops[i]._prob;
+    }
+    for (size_t j = 0; j < denseProbs.size(); j++) {
+      ASSERT_NEAR(denseProbs[j], sparseProbs[j], 1e-9 * denseProbs[j] + 1e-15) << "target " << j << ", step " << step;
+    }
+    // The ranking is the same up to the ties.
+    for (TPqaId i = 0; i < nTargets; i++) {
+      ASSERT_NEAR(denseTops[i]._prob, sparseTops[i]._prob, 1e-9 * denseTops[i]._prob + 1e-15) << "rank " << i;
+    }
+  }
+  ASSERT_TRUE(pSparse->ReleaseQuiz(iSparseQuiz).IsOk());
+}
@@ -26,27 +26,44 @@
 #include <cassert>
 #include <chrono>
 #include <cinttypes>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <random>
 #include <string>
 #include <tchar.h>
 #include <thread>
+#include <type_traits>
 #include <vector>
 #pragma warning( pop )
 
 // SRPlatform library includes
 #include "../SRPlatform/Interface/ISRLogger.h"
 #include "../SRPlatform/Interface/SRBasicTypes.h"
+#include "../SRPlatform/Interface/SRCast.h"
+#include "../SRPlatform/Interface/SRCpuInfo.h"
 #include "../SRPlatform/Interface/SRDefaultLogger.h"
+#include "../SRPlatform/Interface/SRDoubleNumber.h"
 #include "../SRPlatform/Interface/SRException.h"
 #include "../SRPlatform/Interface/SRFastRandom.h"
+#include "../SRPlatform/Interface/SRFileMapping.h"
+#include "../SRPlatform/Interface/SRFloatNumber.h"
+#include "../SRPlatform/Interface/SRLargePages.h"
+#include "../SRPlatform/Interface/SRMath.h"
+#include "../SRPlatform/Interface/SRMessageBuilder.h"
+#include "../SRPlatform/Interface/SRSimd.h"
 #include "../SRPlatform/Interface/SRString.h"
+#include "../SRPlatform/Interface/SRUtils.h"
 
 // PqaCore library includes
 #include "../PqaCore/Interface/IPqaEngineFactory.h"
+#include "../PqaCore/CEKBArena.h"
+#include "../PqaCore/CEKBCodec.h"
+#include "../PqaCore/KBFileFormat.h"
 
 
 // Google Test Framework includes
@@ -28,6 +28,10 @@ public:
   }
   inline SRAccumVectDbl256& __vectorcall Add(const __m256d value);
   inline SRAccumVectDbl256& __vectorcall Add(SRVectCompCount at, const double value);
+  // Add 8 floats, converting them to double precision.
+  inline SRAccumVectDbl256& __vectorcall Add(const __m256 value);
+  // The compensated sums of each component separately.
+  inline __m256d __vectorcall ComponentSums() const;
   //Note: this method is not at maximum precision.
   inline double __vectorcall GetFullSum() const;
   inline double __vectorcall PreciseSum() const;
@@ -45,6 +49,11 @@ inline SRAccumVectDbl256& __vectorcall SRAccumVectDbl256::Add(const __m256d valu
   return *this;
 }
 
+inline SRAccumVectDbl256& __vectorcall SRAccumVectDbl256::Add(const __m256 value) {
+  Add(SRSimd::WidenLowF32(value));
+  return Add(SRSimd::WidenHighF32(value));
+}
+
 inline SRAccumVectDbl256& __vectorcall SRAccumVectDbl256::Add(SRVectCompCount at, const double value) {
   const double y = value - _corr.m256d_f64[at];
   const double t = _sum.m256d_f64[at] + y;
@@ -53,6 +62,10 @@ inline SRAccumVectDbl256& __vectorcall SRAccumVectDbl256::Add(SRVectCompCount at
   return *this;
 }
 
+inline __m256d __vectorcall SRAccumVectDbl256::ComponentSums() const {
+  return _mm256_sub_pd(_sum, _corr);
+}
+
 inline double __vectorcall SRAccumVectDbl256::GetFullSum() const {
   const __m256d interleaved = _mm256_hadd_pd(_corr, _sum);
   const __m128d corrSum = _mm_add_pd(_mm256_extractf128_pd(interleaved, 1), _mm256_castpd256_pd128(interleaved));
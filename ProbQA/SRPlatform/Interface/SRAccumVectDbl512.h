@@ -0,0 +1,73 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../SRPlatform/Interface/SRSimd.h"
+#include "../SRPlatform/Interface/SRMacros.h"
+#include "../SRPlatform/Interface/SRAccumulator.h"
+
+namespace SRPlat {
+
+// 512-bit vector of Kahan summators for double precision scalars, for the AVX-512 kernels. It must only be used after
+//   checking that SRCpuInfo::GetInstructionSet() reports AVX-512.
+class SRAccumVectDbl512 {
+  __m512d _sum;
+  __m512d _corr;
+
+public:
+  explicit SRAccumVectDbl512() : _sum(_mm512_setzero_pd()), _corr(_mm512_setzero_pd()) {}
+  void Reset() {
+    _sum = _mm512_setzero_pd();
+    _corr = _mm512_setzero_pd();
+  }
+  inline SRAccumVectDbl512& __vectorcall Add(const __m512d value);
+  inline double __vectorcall PreciseSum() const;
+  inline double __vectorcall PairSum(const SRAccumVectDbl512& fellow, double& fellowSum) const;
+};
+
+FLOAT_PRECISE_BEGIN
+inline SRAccumVectDbl512& __vectorcall SRAccumVectDbl512::Add(const __m512d value) {
+  const __m512d y = _mm512_sub_pd(value, _corr);
+  const __m512d t = _mm512_add_pd(_sum, y);
+  _corr = _mm512_sub_pd(_mm512_sub_pd(t, _sum), y);
+  _sum = t;
+  return *this;
+}
+
+inline double __vectorcall SRAccumVectDbl512::PreciseSum() const {
+  SRAccumulator<SRDoubleNumber> ans(SRDoubleNumber::FromDouble(_corr.m512d_f64[7]));
+  for (int i = 6; i >= 0; i--) {
+    ans.Add(SRDoubleNumber::FromDouble(_corr.m512d_f64[i]));
+  }
+  ans.Neg();
+  for (int i = 7; i >= 0; i--) {
+    ans.Add(SRDoubleNumber::FromDouble(_sum.m512d_f64[i]));
+  }
+  return ans.Get().GetValue();
+}
+
+inline double __vectorcall SRAccumVectDbl512::PairSum(const SRAccumVectDbl512& fellow, double& fellowSum) const {
+  __m128d sum = _mm_set_pd(fellow._corr.m512d_f64[7], _corr.m512d_f64[7]);
+  __m128d corr = _mm_setzero_pd();
+  for (int i = 6; i >= 0; i--) {
+    const __m128d y = _mm_sub_pd(_mm_set_pd(fellow._corr.m512d_f64[i], _corr.m512d_f64[i]), corr);
+    const __m128d t = _mm_add_pd(sum, y);
+    corr = _mm_sub_pd(_mm_sub_pd(t, sum), y);
+    sum = t;
+  }
+  sum = _mm_xor_pd(sum, SRSimd::_cDoubleSign128);
+  corr = _mm_xor_pd(corr, SRSimd::_cDoubleSign128);
+  for (int i = 7; i >= 0; i--) {
+    const __m128d y = _mm_sub_pd(_mm_set_pd(fellow._sum.m512d_f64[i], _sum.m512d_f64[i]), corr);
+    const __m128d t = _mm_add_pd(sum, y);
+    corr = _mm_sub_pd(_mm_sub_pd(t, sum), y);
+    sum = t;
+  }
+  fellowSum = sum.m128d_f64[1] - corr.m128d_f64[1];
+  return sum.m128d_f64[0] - corr.m128d_f64[0];
+}
+FLOAT_PRECISE_END
+
+} // namespace SRPlat
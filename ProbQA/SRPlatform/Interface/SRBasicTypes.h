@@ -9,6 +9,7 @@ namespace SRPlat {
 typedef double SRAmount;
 typedef uint32_t SRThreadCount;
 typedef size_t SRSubtaskCount;
+typedef uint16_t SRNumaNode;
 typedef uint8_t SRVectCompCount;
 
 } // namespace SRPlat
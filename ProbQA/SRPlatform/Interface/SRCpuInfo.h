@@ -8,6 +8,13 @@
 
 namespace SRPlat {
 
+// The instruction sets for which the hot kernels have implementations, in the order of preference.
+enum class SRInstructionSet : uint8_t {
+  Sse2 = 0, // x64 baseline
+  Avx2 = 1, // AVX2 with FMA3
+  Avx512 = 2 // AVX-512 Foundation
+};
+
 //TODO: refactor from hard-coded values to values queried at runtime
 // Get cache line size: https://stackoverflow.com/questions/794632/programmatically-get-the-cache-line-size
 class SRPLATFORM_API SRCpuInfo {
@@ -17,6 +24,10 @@ public:
   static constexpr uint8_t _nLogicalCoresPerPhysCore = 2;
   static constexpr uint16_t _cacheLineBytes = 1 << _logCacheLineBytes;
   static constexpr uintptr_t _cacheLineMask = _cacheLineBytes - 1;
+
+  // The best instruction set supported both by the CPU, according to CPUID, and by the OS, which must save the
+  //   extended registers on context switches. It is detected once per process.
+  static SRInstructionSet GetInstructionSet();
 };
 
 } // namespace SRPlat
@@ -0,0 +1,42 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../SRPlatform/Interface/SRPlatform.h"
+
+namespace SRPlat {
+
+// A view of a whole file mapped into memory. The view is aligned at page boundary. The pages are loaded from the file
+//   on first access, and the unmodified pages are shared with the other processes mapping the same file.
+// In the copy-on-write mode, the process can modify its view: the modified pages become private to the process and are
+//   never written back to the file.
+class SRPLATFORM_API SRFileMapping {
+public: // types
+  enum class Mode : uint8_t {
+    ReadOnly = 0,
+    CopyOnWrite = 1
+  };
+
+private: // variables
+  void *_pView;
+  uint64_t _nBytes;
+
+public: // methods
+  explicit SRFileMapping() : _pView(nullptr), _nBytes(0) { }
+  SRFileMapping(const SRFileMapping&) = delete;
+  SRFileMapping& operator=(const SRFileMapping&) = delete;
+  ~SRFileMapping() { Unmap(); }
+
+  // Returns false if the file can't be mapped, leaving the object empty. Unmaps the previous view, if any.
+  bool Map(const char* const filePath, const Mode mode);
+  // Does nothing if there is no view.
+  void Unmap();
+
+  uint8_t* Get() const { return static_cast<uint8_t*>(_pView); }
+  uint64_t GetNBytes() const { return _nBytes; }
+  bool IsMapped() const { return _pView != nullptr; }
+};
+
+} // namespace SRPlat
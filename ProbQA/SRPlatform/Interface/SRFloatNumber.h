@@ -0,0 +1,105 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../SRPlatform/Interface/SRRealNumber.h"
+#include "../SRPlatform/Interface/SRCast.h"
+#include "../SRPlatform/Interface/SRPacked64.h"
+#include "../SRPlatform/Interface/SRFastRandom.h"
+
+namespace SRPlat {
+
+// Single precision number: it halves the memory and bandwidth of the arrays in comparison to SRDoubleNumber, so that a
+//   SIMD vector holds 8 numbers. Sums over many numbers should still be accumulated in double precision.
+class SRPLATFORM_API SRFloatNumber : public SRRealNumber {
+public: // constants
+  static const int64_t _cMaxExp = 127;
+  static const int64_t _cExpOffs = 127;
+
+private: // variables
+  float _value;
+
+public:
+  static __m128i __vectorcall ScaleBySizeBytesU32(const __m128i a);
+
+  explicit SRFloatNumber() { }
+  explicit SRFloatNumber(const SRAmount init) : _value(static_cast<float>(SRCast::ToDouble(init))) { }
+
+  static SRFloatNumber FromFloat(const float value) {
+    SRFloatNumber ans;
+    ans._value = value;
+    return ans;
+  }
+
+  // Set to random number between 0 and |upper| inclusively.
+  static SRFloatNumber MakeRandom(const SRFloatNumber upper, SRFastRandom& fr) {
+    SRFloatNumber ans;
+    ans._value = static_cast<float>(double(upper.GetValue()) * fr.Generate<uint64_t>()
+      / std::numeric_limits<uint64_t>::max());
+    return ans;
+  }
+
+  SRAmount ToAmount() const { return _value; }
+
+  float GetValue() const { return _value; }
+  float& ModValue() { return _value; }
+  void SetValue(const float value) { _value = value; }
+
+  bool IsFinite() const { return std::isfinite(_value); }
+  bool IsZero() const { return fabsf(_value) == +0.0f; }
+
+  SRFloatNumber& Mul(const SRFloatNumber& fellow) {
+    _value *= fellow._value;
+    return *this;
+  }
+  SRFloatNumber& Add(const SRFloatNumber& fellow) {
+    _value += fellow._value;
+    return *this;
+  }
+  SRFloatNumber& Sqr() {
+    _value *= _value;
+    return *this;
+  }
+  SRFloatNumber operator*(const int64_t fellow) const {
+    SRFloatNumber answer;
+    answer._value = static_cast<float>(_value * double(fellow));
+    return answer;
+  }
+  SRFloatNumber operator-(const SRFloatNumber& fellow) const {
+    SRFloatNumber answer;
+    answer._value = _value - fellow._value;
+    return answer;
+  }
+  SRFloatNumber& operator+=(const SRAmount amount) {
+    _value = static_cast<float>(_value + SRCast::ToDouble(amount));
+    return *this;
+  }
+  SRFloatNumber& operator+=(const SRFloatNumber fellow) {
+    _value += fellow._value;
+    return *this;
+  }
+
+  bool operator<(const SRFloatNumber fellow) const {
+    return _value < fellow._value;
+  }
+  bool operator<=(const SRAmount fellow) const {
+    return _value <= fellow;
+  }
+};
+
+static_assert(sizeof(SRFloatNumber) == sizeof(float), "To allow AVX2 and avoid unaligned access penalties.");
+
+template<> struct SRNumPack<SRFloatNumber> {
+  static constexpr SRVectCompCount _cnComps = 8;
+  __m256 _comps;
+
+  SRNumPack() { }
+  SRNumPack(const __m256 value) : _comps(value) { }
+  void Set1(SRFloatNumber value) { _comps = _mm256_set1_ps(value.GetValue()); }
+};
+
+static_assert(sizeof(SRNumPack<SRFloatNumber>) == sizeof(__m256), "To enable reinterpret_cast");
+
+} // namespace SRPlat
@@ -0,0 +1,30 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../SRPlatform/Interface/SRPlatform.h"
+#include "../SRPlatform/Interface/SRMacros.h"
+
+namespace SRPlat {
+
+// Allocation of memory blocks directly from the OS in whole pages, preferring large pages (2 MiB on x64) so to reduce
+//   TLB misses in scattered accesses to big arrays. Large pages require SeLockMemoryPrivilege to be granted to the
+//   user, and physically contiguous free memory. When they are not available, the allocation quietly falls back to
+//   regular pages.
+// The blocks are aligned at page boundary, thus they are also aligned for SIMD.
+class SRPLATFORM_API SRLargePages {
+public: // methods
+  // Returns the size of a large page, or 0 if the OS doesn't support large pages.
+  static size_t GetPageBytes();
+
+  // Returns nullptr if the memory can't be allocated even in regular pages. |bLarge| receives whether the block is
+  //   backed by large pages.
+  ATTR_RESTRICT static void* Alloc(const size_t nBytes, bool &bLarge);
+
+  // Release a block allocated with Alloc(). Does nothing for nullptr.
+  static void Free(void *p);
+};
+
+} // namespace SRPlat
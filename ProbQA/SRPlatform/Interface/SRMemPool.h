@@ -9,6 +9,7 @@
 #include "../SRPlatform/Interface/SRException.h"
 #include "../SRPlatform/Interface/SRMessageBuilder.h"
 #include "../SRPlatform/Interface/SRSimd.h"
+#include "../SRPlatform/Interface/SRLargePages.h"
 
 namespace SRPlat {
 
@@ -26,6 +27,8 @@ SRPLATFORM_API SRBaseMemPool& SRGetBaseMemPool();
 
 // If the unit is 256-bit, then taLogUnitBits should be 8 because 256 == (1<<8) .
 // This class is thread-safe, except some methods explicitly specified as not thread-safe.
+// Allocations too large for the granules bypass the pool. Optionally, those of at least half a large page are backed by
+//   large pages, falling back to regular pages when large pages can't be obtained.
 template<uint32_t taLogNUnitBits, uint32_t taNGranules> class SRMemPool : public SRBaseMemPool {
   static_assert(taLogNUnitBits >= 3, "Must be integer number of bytes.");
 
@@ -39,6 +42,9 @@ private: // variables
   std::atomic<void*> *_memChunks;
   std::atomic<size_t> _totalUnits;
   std::atomic<size_t> _maxTotalUnits;
+  std::atomic<uint64_t> _nLargePageAllocs;
+  std::atomic<uint64_t> _nLargePageFallbacks;
+  const bool _bLargePages;
 
 private: // methods
   void FreeChunk(const size_t iSlot) {
@@ -50,12 +56,39 @@ private: // methods
     }
   }
 
+  bool IsLargePageCandidate(const size_t nBytes) const {
+    if (!_bLargePages) {
+      return false;
+    }
+    const size_t pageBytes = SRLargePages::GetPageBytes();
+    return pageBytes != 0 && nBytes >= (pageBytes >> 1);
+  }
+
+  ATTR_RESTRICT void* AllocLarge(const size_t nBytes) {
+    if (!IsLargePageCandidate(nBytes)) {
+      return _mm_malloc(nBytes, _cNUnitBytes);
+    }
+    bool bLarge;
+    void *PTR_RESTRICT p = SRLargePages::Alloc(nBytes, bLarge);
+    (bLarge ? _nLargePageAllocs : _nLargePageFallbacks).fetch_add(1, std::memory_order_relaxed);
+    return p;
+  }
+
+  void ReleaseLarge(void *PTR_RESTRICT p, const size_t nBytes) {
+    if (IsLargePageCandidate(nBytes)) {
+      SRLargePages::Free(p);
+    } else {
+      _mm_free(p);
+    }
+  }
+
 public:
   static_assert((taNGranules * sizeof(std::atomic<void*>)) % SRSimd::_cNBytes == 0,
     "For SIMD efficiency, choose taNGranules divisable by larger power of 2.");
 
-  explicit SRMemPool(const size_t maxTotalUnits = (512 * 1024 * 1024) / _cNUnitBytes)
-    : _totalUnits(0), _maxTotalUnits(maxTotalUnits)
+  explicit SRMemPool(const size_t maxTotalUnits = (512 * 1024 * 1024) / _cNUnitBytes, const bool bLargePages = false)
+    : _totalUnits(0), _maxTotalUnits(maxTotalUnits), _nLargePageAllocs(0), _nLargePageFallbacks(0),
+    _bLargePages(bLargePages)
   {
     const size_t nMemChunksBytes = taNGranules * sizeof(*_memChunks);
     _memChunks = static_cast<decltype(_memChunks)>(_mm_malloc(nMemChunksBytes, SRSimd::_cNBytes));
@@ -97,7 +130,7 @@ public:
   ATTR_RESTRICT virtual void* AllocMem(const size_t nBytes) override final {
     const size_t iSlot = (nBytes + _cNUnitBytes - 1) >> _cLogNUnitBytes;
     if (iSlot >= taNGranules) {
-      return _mm_malloc(iSlot * _cNUnitBytes, _cNUnitBytes);
+      return AllocLarge(iSlot * _cNUnitBytes);
     }
     if (iSlot <= 0) {
       return nullptr;
@@ -117,7 +150,11 @@ public:
 
   void ReleaseMem(void *PTR_RESTRICT p, const size_t nBytes) override final {
     const size_t iSlot = (nBytes + _cNUnitBytes - 1) >> _cLogNUnitBytes;
-    if (iSlot >= taNGranules || iSlot <= 0) {
+    if (iSlot >= taNGranules) {
+      ReleaseLarge(p, iSlot * _cNUnitBytes);
+      return;
+    }
+    if (iSlot <= 0) {
       _mm_free(p);
       return;
     }
@@ -139,6 +176,10 @@ public:
   void SetMaxTotalUnits(const size_t nUnits) {
     _maxTotalUnits.store(nUnits, std::memory_order_relaxed);
   }
+
+  // The number of allocations bypassing the pool that obtained large pages, and that fell back to regular pages.
+  uint64_t GetNLargePageAllocs() const { return _nLargePageAllocs.load(std::memory_order_relaxed); }
+  uint64_t GetNLargePageFallbacks() const { return _nLargePageFallbacks.load(std::memory_order_relaxed); }
 };
 
 // MPP - memory pool pointer
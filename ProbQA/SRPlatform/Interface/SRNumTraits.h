@@ -33,4 +33,19 @@ template<> struct SRNumTraits<double> {
   }
 };
 
+template<> struct SRNumTraits<float> {
+  static constexpr uint16_t _cnMantissaBits = 23;
+  static constexpr uint16_t _cMantissaOffs = 0;
+  static constexpr uint16_t _cnExponentBits = 8;
+  static constexpr uint16_t _cExponentOffs = _cnMantissaBits;
+  static constexpr uint16_t _cSignOffs = _cExponentOffs + _cnExponentBits;
+  static constexpr uint16_t _cnTotalBits = _cnMantissaBits + _cnExponentBits + /* sign */ 1;
+
+  static constexpr int16_t _cExponent0Down = 127;
+  static constexpr uint32_t _cExponent0Up = uint32_t(_cExponent0Down) << _cExponentOffs;
+  static constexpr uint16_t _cExponentMaskDown = 0xff;
+  static constexpr uint32_t _cExponentMaskUp = uint32_t(_cExponentMaskDown) << _cExponentOffs;
+  static constexpr uint32_t _cSignMaskUp = 1ui32 << _cSignOffs;
+};
+
 } // namespace SRPlat
@@ -9,6 +9,9 @@
 
 namespace SRPlat {
 
+// If the thread pool is NUMA-aware, the subtasks are bound to the nodes by their position in the range of items, see
+//   SRThreadPool::GetItemNode(). So a subtask processing a range of targets runs on the node that has first-touched the
+//   memory for those targets, given that the memory was first-touched by a subtask of the same split.
 class SRPoolRunner {
 public: // types
   template<typename taSubtask> class Keeper {
@@ -173,7 +176,10 @@ template<typename taSubtask, typename taCallback> inline SRPoolRunner::Keeper<ta
     kp._nSubtasks++;
     curStart = nextStart;
   }
-  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task);
+  const size_t nItems = curStart;
+  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task, [&](const SRSubtaskCount iSubtask) {
+    return _pTp->GetItemNode((iSubtask == 0) ? 0 : split._pBounds[iSubtask - 1], nItems);
+  });
 
   kp._pTask = nullptr; // Don't call again SRBaseTask::WaitComplete() if it throws here.
   task.WaitComplete();
@@ -199,7 +205,10 @@ template<typename taSubtask, typename taCallback> inline
     kp._nSubtasks++;
   }
   assert(nextStart == nItems);
-  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task);
+  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task, [&](const SRSubtaskCount iSubtask) {
+    const size_t iFirst = iSubtask * perWorker.quot + std::min<size_t>(iSubtask, perWorker.rem);
+    return _pTp->GetItemNode(iFirst, nItems);
+  });
 
   kp._pTask = nullptr; // Don't call again SRBaseTask::WaitComplete() if it throws here.
   task.WaitComplete();
@@ -218,7 +227,9 @@ template<typename taSubtask, typename taCallback> inline
     // For finalization, it's important to increment subtask counter right after another subtask has been constructed.
     kp._nSubtasks++;
   }
-  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task);
+  _pTp->EnqueueAdjacent(kp._pSubtasks, kp._nSubtasks, task, [&](const SRSubtaskCount iSubtask) {
+    return _pTp->GetItemNode(iSubtask, nWorkers);
+  });
 
   kp._pTask = nullptr; // Don't call again SRBaseTask::WaitComplete() if it throws here.
   task.WaitComplete();
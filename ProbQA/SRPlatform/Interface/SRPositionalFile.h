@@ -0,0 +1,58 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#pragma once
+
+#include "../SRPlatform/Interface/SRPlatform.h"
+
+namespace SRPlat {
+
+// A file read and written at explicit offsets rather than at a shared file pointer, so that multiple threads can
+//   transfer disjoint ranges of the file concurrently. The file is opened for overlapped I/O, because the system
+//   serializes the operations on a synchronous handle. The methods wait for their operations to complete.
+class SRPLATFORM_API SRPositionalFile {
+public: // types
+  enum class Mode : uint8_t {
+    Read = 0, // open an existing file for reading
+    Write = 1, // create the file or truncate the existing one, for writing
+    Update = 2, // open an existing file for reading and writing in place
+    Extend = 3 // open the file for reading and writing, creating it if it doesn't exist
+  };
+
+private: // variables
+  void *_hFile;
+
+private: // methods
+  bool Transfer(void *p, const size_t nBytes, const uint64_t offset, const bool bWrite) const;
+
+public: // methods
+  explicit SRPositionalFile() : _hFile(nullptr) { }
+  SRPositionalFile(const SRPositionalFile&) = delete;
+  SRPositionalFile& operator=(const SRPositionalFile&) = delete;
+  ~SRPositionalFile() { Close(); }
+
+  // Returns false if the file can't be opened, leaving the object empty. Closes the previous file, if any.
+  bool Open(const char* const filePath, const Mode mode);
+  // Returns false if closing the file failed. Does nothing and returns true if there is no file.
+  bool Close();
+
+  // Set the size of the file at once, so that the concurrent writes don't extend it one after another. The
+  //   extension reads as zeros.
+  bool Preallocate(const uint64_t nBytes) const;
+  bool GetSize(uint64_t &nBytes) const;
+  // Wait until the data written so far reaches the storage device.
+  bool Flush() const;
+  // Thread-safe for concurrent calls. Returns false on failure, including reading past the end of the file.
+  bool ReadAt(void *p, const size_t nBytes, const uint64_t offset) const {
+    return Transfer(p, nBytes, offset, false);
+  }
+  // Thread-safe for concurrent calls. Returns false on failure.
+  bool WriteAt(const void *p, const size_t nBytes, const uint64_t offset) const {
+    return Transfer(const_cast<void*>(p), nBytes, offset, true);
+  }
+
+  bool IsOpen() const { return _hFile != nullptr; }
+};
+
+} // namespace SRPlat
@@ -36,9 +36,12 @@ public:
   static const __m128i _cDoubleExpMaskDown32;
   static const __m128i _cDoubleExp0Down32;
   static const __m128d _cDoubleSign128;
+  static const __m256i _cFloatExpMaskUp;
+  static const __m256i _cFloatExp0Up;
 private:
   static const __m256i _cSet1MsbOffs;
   static const __m256i _cSet1LsbOffs;
+  static const __m256i _cBitOctetSel;
   static constexpr uint8_t _cnStbqEntries = 1 << 4;
   static const uint32_t _cStbqTable[_cnStbqEntries];
 
@@ -136,6 +139,32 @@ public:
     return _mm256_sub_epi64(exps, _cDoubleExp0Down);
   }
 
+  // Returns the exponents of the 8 floats as 32-bit integers.
+  template<bool taNorm0> ATTR_NOALIAS static __m256i __vectorcall ExtractExponents32(const __m256 nums) {
+    const __m256i exps = _mm256_srli_epi32(_mm256_and_si256(_cFloatExpMaskUp, _mm256_castps_si256(nums)),
+      SRNumTraits<float>::_cExponentOffs);
+    if constexpr (!taNorm0) {
+      return exps;
+    }
+    return _mm256_sub_epi32(exps, _mm256_set1_epi32(SRNumTraits<float>::_cExponent0Down));
+  }
+
+  // Sign-extend the lower and the higher 4 32-bit components to 64 bits.
+  ATTR_NOALIAS static __m256i __vectorcall WidenLowI32(const __m256i vect) {
+    return _mm256_cvtepi32_epi64(_mm256_castsi256_si128(vect));
+  }
+  ATTR_NOALIAS static __m256i __vectorcall WidenHighI32(const __m256i vect) {
+    return _mm256_cvtepi32_epi64(_mm256_extracti128_si256(vect, 1));
+  }
+
+  // Convert the lower and the higher 4 floats to doubles.
+  ATTR_NOALIAS static __m256d __vectorcall WidenLowF32(const __m256 vect) {
+    return _mm256_cvtps_pd(_mm256_castps256_ps128(vect));
+  }
+  ATTR_NOALIAS static __m256d __vectorcall WidenHighF32(const __m256 vect) {
+    return _mm256_cvtps_pd(_mm256_extractf128_ps(vect, 1));
+  }
+
   // Extract components 1,3,5,7
   ATTR_NOALIAS static __m128i __vectorcall ExtractOdd(const __m256i vect) {
     const __m128i hiLane = _mm256_extracti128_si256(vect, 1);
@@ -191,12 +220,45 @@ public:
     return SRPacked64(exps._u64 - normalizer._u64);
   }
 
+  // Truncate the 64-bit components of |lo| and |hi| to 32 bits, keeping the order: lo0,lo1,lo2,lo3,hi0,hi1,hi2,hi3
+  ATTR_NOALIAS static __m256i __vectorcall NarrowI64(const __m256i lo, const __m256i hi) {
+    return _mm256_set_m128i(ExtractEven(hi), ExtractEven(lo));
+  }
+
+  ATTR_NOALIAS static __m256 __vectorcall MakeExponent0(const __m256 nums) {
+    const __m256 e0nums = _mm256_or_ps(_mm256_castsi256_ps(_cFloatExp0Up),
+      _mm256_andnot_ps(_mm256_castsi256_ps(_cFloatExpMaskUp), nums));
+    return e0nums;
+  }
+
+  // |exps| are 32-bit integers.
+  ATTR_NOALIAS static __m256 __vectorcall ReplaceExponents(const __m256 nums, const __m256i exps) {
+    const __m256 newExps = _mm256_castsi256_ps(_mm256_slli_epi32(exps, SRNumTraits<float>::_cExponentOffs));
+    const __m256 newNums = _mm256_or_ps(newExps, _mm256_andnot_ps(_mm256_castsi256_ps(_cFloatExpMaskUp), nums));
+    return newNums;
+  }
+
   ATTR_NOALIAS static __m256d __vectorcall MakeExponent0(const __m256d nums) {
     const __m256d e0nums = _mm256_or_pd(_mm256_castsi256_pd(_cDoubleExp0Up),
       _mm256_andnot_pd(_mm256_castsi256_pd(_cDoubleExpMaskUp), nums));
     return e0nums;
   }
 
+  //// AVX-512 variants for the kernels selected by SRCpuInfo::GetInstructionSet() . Only AVX-512F is used.
+  ATTR_NOALIAS static __m512d __vectorcall MakeExponent0(const __m512d nums) {
+    const __m512i e0nums = _mm512_or_si512(_mm512_broadcast_i64x4(_cDoubleExp0Up),
+      _mm512_andnot_si512(_mm512_broadcast_i64x4(_cDoubleExpMaskUp), _mm512_castpd_si512(nums)));
+    return _mm512_castsi512_pd(e0nums);
+  }
+  template<bool taNorm0> ATTR_NOALIAS static __m512i __vectorcall ExtractExponents64(const __m512d nums) {
+    const __m512i exps = _mm512_srli_epi64(_mm512_and_si512(_mm512_broadcast_i64x4(_cDoubleExpMaskUp),
+      _mm512_castpd_si512(nums)), SRNumTraits<double>::_cExponentOffs);
+    if (!taNorm0) {
+      return exps;
+    }
+    return _mm512_sub_epi64(exps, _mm512_broadcast_i64x4(_cDoubleExp0Down));
+  }
+
   ATTR_NOALIAS static __m256d __vectorcall ReplaceExponents(const __m256d nums, const __m256i exps) {
     const __m256d newExps = _mm256_castsi256_pd(_mm256_slli_epi64(exps, SRNumTraits<double>::_cExponentOffs));
     const __m256d newNums = _mm256_or_pd(newExps, _mm256_andnot_pd(_mm256_castsi256_pd(_cDoubleExpMaskUp), nums));
@@ -255,6 +317,13 @@ public:
     return BroadcastBytesToComps64(_cStbqTable[bitQuad]);
   }
 
+  // Set to all-one bits the 32-bit components corresponding to the set bits of |bitOctet|, e.g. for the gap mask of 8
+  //   floats.
+  ATTR_NOALIAS static __m256i __vectorcall SetToBitOctet(const uint8_t bitOctet) {
+    const __m256i selected = _mm256_and_si256(_mm256_set1_epi32(bitOctet), _cBitOctetSel);
+    return _mm256_cmpeq_epi32(selected, _cBitOctetSel);
+  }
+
   // Checks 4 32-bit components for conflicts. If components from lower to higher are abcd, returns:
   //   Bit 0: a conflicts with b
   //   Bit 1: b conflicts with c
@@ -400,6 +469,12 @@ template<> struct SRSimd::CastImpl<__m256d, __m256i> {
 template<> struct SRSimd::CastImpl<__m256i, __m256d> {
   static __m256i DoIt(const __m256d par) { return _mm256_castpd_si256(par); }
 };
+template<> struct SRSimd::CastImpl<__m256, __m256i> {
+  static __m256 DoIt(const __m256i par) { return _mm256_castsi256_ps(par); }
+};
+template<> struct SRSimd::CastImpl<__m256i, __m256> {
+  static __m256i DoIt(const __m256 par) { return _mm256_castps_si256(par); }
+};
 
 // For static class members, __vectorcall must be specified again in the definition: https://docs.microsoft.com/en-us/cpp/cpp/vectorcall
 template<typename taResult, typename taParam> inline taResult __vectorcall SRSimd::Cast(const taParam par) {
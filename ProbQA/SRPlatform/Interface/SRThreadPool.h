@@ -17,6 +17,10 @@ class SRBaseSubtask;
 class SRBaseTask;
 template class SRPLATFORM_API SRQueue<SRBaseSubtask*>;
 
+// If NUMA-aware, the workers are distributed among NUMA nodes in proportion to the number of logical processors of
+//   each node, and each worker is bound to the processors of its node. Besides the common queue of subtasks, each node
+//   has its own queue of subtasks that must run on that node, e.g. because they process a range of items first-touched
+//   by the workers of that node.
 class SRPLATFORM_API SRThreadPool : public ISRLogCustomizable {
   struct RareData; // cache-insensitive piece of thread pool data
 
@@ -29,11 +33,15 @@ public: // types
 
 private: // variables
   SRQueue<SRBaseSubtask*> _qu;
+  SRQueue<SRBaseSubtask*> *_pNodeQus; // nullptr if there is a single node
   SRCriticalSection _cs;
   SRConditionVariable _haveWork;
   size_t _stackSize;
   // It has to be const to allow accessing without locks by the clients.
   const SRThreadCount _nWorkers;
+  SRNumaNode _nNodes; // doesn't change after construction
+  // Worker indices are assigned to nodes in ranges: worker i belongs to the first node with i < _pNodeWorkerLims[node]
+  SRThreadCount *_pNodeWorkerLims;
   uint8_t _shutdownRequested : 1;
   RareData *_pRd;
 
@@ -41,13 +49,16 @@ private: // methods
   // Don't forget to clear _shutdownRequested before re-launching threads.
   void LaunchThreads();
   void StopThreads();
+  void InitNodes(const bool bNumaAware);
   void WorkerEntry();
   static bool DefaultCriticalCallback(void *pData, SRException &&ex);
   bool RunCriticalCallback(SRException &&ex);
 
 public:
   // Actual stack size will be increased by _cReserveStackSize.
-  explicit SRThreadPool(const SRThreadCount nThreads, const size_t stackSize);
+  // If |bNumaAware| is requested on a machine with a single NUMA node, the thread pool behaves as if it's not
+  //   requested.
+  explicit SRThreadPool(const SRThreadCount nThreads, const size_t stackSize, const bool bNumaAware = false);
   virtual ~SRThreadPool() override final;
 
   virtual ISRLogger* GetLogger() const override final;
@@ -57,6 +68,20 @@ public:
   void SetCriticalCallback(FCriticalCallback f, void *pData = nullptr);
 
   SRThreadCount GetWorkerCount() const { return _nWorkers; }
+  SRNumaNode GetNodeCount() const { return _nNodes; }
+
+  // The items are distributed among the nodes in proportion to the number of workers on each node. Returns the node
+  //   owning the item |iItem| out of |nItems|, so that both the first touch of the memory for the item and the
+  //   processing of the item happen on that node.
+  SRNumaNode GetItemNode(const size_t iItem, const size_t nItems) const {
+    assert(iItem < nItems);
+    const size_t iWorker = (iItem * _nWorkers) / nItems;
+    SRNumaNode iNode = 0;
+    while (iWorker >= _pNodeWorkerLims[iNode]) {
+      iNode++;
+    }
+    return iNode;
+  }
 
   void Enqueue(SRBaseSubtask *pSt);
   // The subtasks can belong to different tasks.
@@ -68,6 +93,9 @@ public:
   // Subtasks must belong to the same task.
   template<typename taSubtask> inline void EnqueueAdjacent(taSubtask *pFirst, const SRSubtaskCount nSubtasks,
     SRBaseTask &task);
+  // Same as above, but subtask i runs on NUMA node nodeOf(i) .
+  template<typename taSubtask, typename taNodeOf> inline void EnqueueAdjacent(taSubtask *pFirst,
+    const SRSubtaskCount nSubtasks, SRBaseTask &task, const taNodeOf &nodeOf);
 
   size_t GetStackSize() const { return _stackSize; }
   void ChangeStackSize(const size_t stackSize);
@@ -94,4 +122,27 @@ template<typename taSubtask> inline void SRThreadPool::EnqueueAdjacent(taSubtask
   _haveWork.WakeAll();
 }
 
+template<typename taSubtask, typename taNodeOf> inline void SRThreadPool::EnqueueAdjacent(taSubtask *pFirst,
+  const SRSubtaskCount nSubtasks, SRBaseTask &task, const taNodeOf &nodeOf)
+{
+  if (_pNodeQus == nullptr) {
+    EnqueueAdjacent(pFirst, nSubtasks, task);
+    return;
+  }
+  {
+    SRLock<SRCriticalSection> csl(_cs);
+    if (_shutdownRequested) {
+      throw SRException(SRString::MakeUnowned("An attempt to push multiple subtasks to a shut(ting) down thread pool."));
+    }
+    for (size_t i = 0; i < nSubtasks; i++) {
+      const SRNumaNode iNode = nodeOf(i);
+      assert(iNode < _nNodes);
+      _pNodeQus[iNode].Push(pFirst + i);
+    }
+    task._nToDo += nSubtasks;
+  }
+  // Wake all because a worker woken by WakeOne() may belong to another node.
+  _haveWork.WakeAll();
+}
+
 } // namespace SRPlat
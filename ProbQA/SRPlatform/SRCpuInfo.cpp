@@ -0,0 +1,49 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../SRPlatform/Interface/SRCpuInfo.h"
+
+namespace SRPlat {
+
+namespace {
+
+bool TestBits(const int reg, const uint32_t bits) {
+  return (static_cast<uint32_t>(reg) & bits) == bits;
+}
+
+SRInstructionSet DetectInstructionSet() {
+  int regs[4]; // EAX, EBX, ECX, EDX
+  __cpuid(regs, 0);
+  const int maxLeaf = regs[0];
+  __cpuid(regs, 1);
+  constexpr uint32_t cFma = 1 << 12, cOsXSave = 1 << 27, cAvx = 1 << 28; // ECX of leaf 1
+  if (!TestBits(regs[2], cFma | cOsXSave | cAvx) || maxLeaf < 7) {
+    return SRInstructionSet::Sse2;
+  }
+  // The OS must have enabled saving of XMM and YMM state, and for AVX-512 also of the opmask and ZMM state.
+  const uint64_t xcr0 = _xgetbv(_XCR_XFEATURE_ENABLED_MASK);
+  constexpr uint64_t cYmmState = (1 << 1) | (1 << 2), cZmmState = (1 << 5) | (1 << 6) | (1 << 7);
+  if ((xcr0 & cYmmState) != cYmmState) {
+    return SRInstructionSet::Sse2;
+  }
+  __cpuidex(regs, 7, 0);
+  constexpr uint32_t cAvx2 = 1 << 5, cAvx512F = 1 << 16; // EBX of leaf 7
+  if (!TestBits(regs[1], cAvx2)) {
+    return SRInstructionSet::Sse2;
+  }
+  if (!TestBits(regs[1], cAvx512F) || (xcr0 & cZmmState) != cZmmState) {
+    return SRInstructionSet::Avx2;
+  }
+  return SRInstructionSet::Avx512;
+}
+
+} // anonymous namespace
+
+SRInstructionSet SRCpuInfo::GetInstructionSet() {
+  static const SRInstructionSet isa = DetectInstructionSet();
+  return isa;
+}
+
+} // namespace SRPlat
@@ -0,0 +1,49 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../SRPlatform/Interface/SRFileMapping.h"
+
+namespace SRPlat {
+
+bool SRFileMapping::Map(const char* const filePath, const Mode mode) {
+  Unmap();
+  const HANDLE hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(hFile);
+    return false;
+  }
+  // The protection of the mapping must allow the access requested for the view.
+  const HANDLE hMapping = CreateFileMappingA(hFile, nullptr, (mode == Mode::ReadOnly) ? PAGE_READONLY : PAGE_WRITECOPY,
+    0, 0, nullptr);
+  // The mapping keeps the file open.
+  CloseHandle(hFile);
+  if (hMapping == nullptr) {
+    return false;
+  }
+  void *pView = MapViewOfFile(hMapping, (mode == Mode::ReadOnly) ? FILE_MAP_READ : FILE_MAP_COPY, 0, 0, 0);
+  // The view keeps the mapping open.
+  CloseHandle(hMapping);
+  if (pView == nullptr) {
+    return false;
+  }
+  _pView = pView;
+  _nBytes = static_cast<uint64_t>(fileSize.QuadPart);
+  return true;
+}
+
+void SRFileMapping::Unmap() {
+  if (_pView != nullptr) {
+    UnmapViewOfFile(_pView);
+    _pView = nullptr;
+    _nBytes = 0;
+  }
+}
+
+} // namespace SRPlat
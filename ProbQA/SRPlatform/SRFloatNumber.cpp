@@ -0,0 +1,16 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../SRPlatform/Interface/SRFloatNumber.h"
+
+namespace SRPlat {
+
+__m128i __vectorcall SRFloatNumber::ScaleBySizeBytesU32(const __m128i a) {
+  static_assert(sizeof(SRFloatNumber) == (1 << 2), "Hard-coded below");
+  const __m128i ans = _mm_slli_epi32(a, 2);
+  return ans;
+}
+
+} // namespace SRPlat
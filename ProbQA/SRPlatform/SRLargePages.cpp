@@ -0,0 +1,64 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../SRPlatform/Interface/SRLargePages.h"
+
+namespace SRPlat {
+
+namespace {
+
+// Large pages can only be allocated by a process having SeLockMemoryPrivilege enabled in its token.
+bool EnableLockMemoryPrivilege() {
+  HANDLE hToken;
+  if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken)) {
+    return false;
+  }
+  TOKEN_PRIVILEGES tp;
+  tp.PrivilegeCount = 1;
+  tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+  // AdjustTokenPrivileges() succeeds even if the privilege is not granted to the user, so check the last error too.
+  const bool bOk = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &tp.Privileges[0].Luid)
+    && AdjustTokenPrivileges(hToken, FALSE, &tp, 0, nullptr, nullptr) && GetLastError() == ERROR_SUCCESS;
+  CloseHandle(hToken);
+  return bOk;
+}
+
+// The size of a large page, or 0 if large pages can't be used by this process.
+size_t InitLargePageBytes() {
+  const size_t pageBytes = GetLargePageMinimum();
+  if (pageBytes == 0 || !EnableLockMemoryPrivilege()) {
+    return 0;
+  }
+  return pageBytes;
+}
+
+} // anonymous namespace
+
+size_t SRLargePages::GetPageBytes() {
+  static const size_t largePageBytes = InitLargePageBytes();
+  return largePageBytes;
+}
+
+ATTR_RESTRICT void* SRLargePages::Alloc(const size_t nBytes, bool &bLarge) {
+  const size_t pageBytes = GetPageBytes();
+  if (pageBytes != 0) {
+    const size_t nLargeBytes = (nBytes + pageBytes - 1) & (~(pageBytes - 1));
+    void *p = VirtualAlloc(nullptr, nLargeBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (p != nullptr) {
+      bLarge = true;
+      return p;
+    }
+  }
+  bLarge = false;
+  return VirtualAlloc(nullptr, nBytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void SRLargePages::Free(void *p) {
+  if (p != nullptr) {
+    VirtualFree(p, 0, MEM_RELEASE);
+  }
+}
+
+} // namespace SRPlat
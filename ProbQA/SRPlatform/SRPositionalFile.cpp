@@ -0,0 +1,102 @@
+// Probabilistic Question-Answering system
+// @2017 Sarge Rogatch
+// This software is distributed under GNU AGPLv3 license. See file LICENSE in repository root for details.
+
+#include "stdafx.h"
+#include "../SRPlatform/Interface/SRPositionalFile.h"
+
+namespace SRPlat {
+
+bool SRPositionalFile::Open(const char* const filePath, const Mode mode) {
+  Close();
+  DWORD access, shareMode, disposition;
+  switch (mode) {
+  case Mode::Read:
+    access = GENERIC_READ;
+    shareMode = FILE_SHARE_READ;
+    disposition = OPEN_EXISTING;
+    break;
+  case Mode::Write:
+    access = GENERIC_WRITE;
+    shareMode = 0;
+    disposition = CREATE_ALWAYS;
+    break;
+  case Mode::Update:
+    access = GENERIC_READ | GENERIC_WRITE;
+    shareMode = 0;
+    disposition = OPEN_EXISTING;
+    break;
+  case Mode::Extend:
+    access = GENERIC_READ | GENERIC_WRITE;
+    shareMode = 0;
+    disposition = OPEN_ALWAYS;
+    break;
+  default:
+    return false;
+  }
+  const HANDLE hFile = CreateFileA(filePath, access, shareMode, nullptr, disposition,
+    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  _hFile = hFile;
+  return true;
+}
+
+bool SRPositionalFile::Close() {
+  if (_hFile == nullptr) {
+    return true;
+  }
+  const bool bOk = (CloseHandle(_hFile) != 0);
+  _hFile = nullptr;
+  return bOk;
+}
+
+bool SRPositionalFile::Preallocate(const uint64_t nBytes) const {
+  FILE_END_OF_FILE_INFO eofi;
+  eofi.EndOfFile.QuadPart = static_cast<LONGLONG>(nBytes);
+  return SetFileInformationByHandle(_hFile, FileEndOfFileInfo, &eofi, sizeof(eofi)) != 0;
+}
+
+bool SRPositionalFile::GetSize(uint64_t &nBytes) const {
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(_hFile, &size)) {
+    return false;
+  }
+  nBytes = static_cast<uint64_t>(size.QuadPart);
+  return true;
+}
+
+bool SRPositionalFile::Flush() const {
+  return FlushFileBuffers(_hFile) != 0;
+}
+
+bool SRPositionalFile::Transfer(void *p, const size_t nBytes, const uint64_t offset, const bool bWrite) const {
+  // A single operation transfers less than 4GB, so large ranges go in chunks.
+  constexpr size_t cMaxChunk = size_t(1) << 30;
+  // The operations of the other threads may complete on the same handle, so each operation waits on its own event.
+  const HANDLE hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+  if (hEvent == nullptr) {
+    return false;
+  }
+  bool bOk = true;
+  for (size_t done = 0; bOk && done < nBytes;) {
+    const DWORD nChunk = static_cast<DWORD>(std::min(cMaxChunk, nBytes - done));
+    const uint64_t chunkOffs = offset + done;
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(chunkOffs);
+    ov.OffsetHigh = static_cast<DWORD>(chunkOffs >> 32);
+    ov.hEvent = hEvent;
+    uint8_t *pChunk = static_cast<uint8_t*>(p) + done;
+    const BOOL bStarted = bWrite ? WriteFile(_hFile, pChunk, nChunk, nullptr, &ov)
+      : ReadFile(_hFile, pChunk, nChunk, nullptr, &ov);
+    DWORD nTransferred = 0;
+    bOk = (bStarted || GetLastError() == ERROR_IO_PENDING)
+      && GetOverlappedResult(_hFile, &ov, &nTransferred, TRUE) && nTransferred == nChunk;
+    done += nChunk;
+  }
+  CloseHandle(hEvent);
+  return bOk;
+}
+
+} // namespace SRPlat
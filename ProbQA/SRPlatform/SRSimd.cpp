@@ -17,6 +17,9 @@ const __m256d SRSimd::_cDoubleSign256 = _mm256_set1_pd(-0.0);
 const __m128i SRSimd::_cDoubleExpMaskDown32 = _mm_set1_epi32(SRNumTraits<double>::_cExponentMaskDown);
 const __m128i SRSimd::_cDoubleExp0Down32 = _mm_set1_epi32(SRNumTraits<double>::_cExponent0Down);
 const __m128d SRSimd::_cDoubleSign128 = _mm_set1_pd(-0.0);
+const __m256i SRSimd::_cFloatExpMaskUp = _mm256_set1_epi32(SRNumTraits<float>::_cExponentMaskUp);
+const __m256i SRSimd::_cFloatExp0Up = _mm256_set1_epi32(SRNumTraits<float>::_cExponent0Up);
+const __m256i SRSimd::_cBitOctetSel = _mm256_set_epi32(128, 64, 32, 16, 8, 4, 2, 1);
 
 const uint32_t SRSimd::_cStbqTable[_cnStbqEntries] = {
   0, 0xff, 0xff00, 0xffff, 0xff0000, 0xff00ff, 0xffff00, 0xffffff,
@@ -26,6 +26,8 @@ struct SRThreadPool::RareData {
   std::atomic<ISRLogger*> _pLogger;
   FCriticalCallback _cbCritical;
   void *_pCcbData;
+  GROUP_AFFINITY *_pNodeAffinities; // nullptr if there is a single node
+  std::atomic<SRThreadCount> _nLaunched; // Launched worker threads take their indices from this counter
   HANDLE _workers[0];
 
   static DWORD WINAPI PlatformEntry(LPVOID lpParameter) {
@@ -37,23 +39,67 @@ struct SRThreadPool::RareData {
 
 #define TPLOG(severityVar) SRLogStream(ISRLogger::Severity::severityVar, GetLogger())
 
-SRThreadPool::SRThreadPool(const SRThreadCount nThreads, const size_t stackSize) : _qu(SRMath::CeilLog2(nThreads)),
-  _nWorkers(nThreads), _shutdownRequested(0), _stackSize(stackSize + _cReserveStackSize)
+SRThreadPool::SRThreadPool(const SRThreadCount nThreads, const size_t stackSize, const bool bNumaAware)
+  : _qu(SRMath::CeilLog2(nThreads)), _pNodeQus(nullptr), _nWorkers(nThreads), _nNodes(1), _pNodeWorkerLims(nullptr),
+  _shutdownRequested(0), _stackSize(stackSize + _cReserveStackSize)
 {
   _pRd = SRCast::Ptr<RareData>(malloc(sizeof(RareData) + sizeof(HANDLE) * _nWorkers));
   _pRd->_pLogger = SRDefaultLogger::Get();
+  _pRd->_pNodeAffinities = nullptr;
   SetCriticalCallback(nullptr);
+  InitNodes(bNumaAware);
   LaunchThreads();
 }
 
 SRThreadPool::~SRThreadPool() {
   RequestShutdown();
   StopThreads();
+  free(_pNodeQus);
+  free(_pNodeWorkerLims);
+  free(_pRd->_pNodeAffinities);
   free(_pRd);
 }
 
+void SRThreadPool::InitNodes(const bool bNumaAware) {
+  std::vector<GROUP_AFFINITY> affinities;
+  std::vector<uint64_t> nodeProcLims; // prefix sums of logical processor counts
+  ULONG highestNode;
+  if (bNumaAware && GetNumaHighestNodeNumber(&highestNode)) {
+    for (ULONG i = 0; i <= highestNode; i++) {
+      GROUP_AFFINITY ga;
+      if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(i), &ga) || ga.Mask == 0) {
+        continue; // a node without processors, e.g. memory-only
+      }
+      affinities.push_back(ga);
+      nodeProcLims.push_back((nodeProcLims.empty() ? 0 : nodeProcLims.back()) + __popcnt64(ga.Mask));
+    }
+  }
+  // Each node must get at least one worker, otherwise the subtasks bound to it would never run.
+  if (affinities.size() <= 1 || affinities.size() > _nWorkers) {
+    _pNodeWorkerLims = SRCast::Ptr<SRThreadCount>(malloc(sizeof(SRThreadCount)));
+    _pNodeWorkerLims[0] = _nWorkers;
+    return;
+  }
+  _nNodes = static_cast<SRNumaNode>(affinities.size());
+  _pNodeWorkerLims = SRCast::Ptr<SRThreadCount>(malloc(sizeof(SRThreadCount) * _nNodes));
+  _pRd->_pNodeAffinities = SRCast::Ptr<GROUP_AFFINITY>(malloc(sizeof(GROUP_AFFINITY) * _nNodes));
+  _pNodeQus = SRCast::Ptr<SRQueue<SRBaseSubtask*>>(malloc(sizeof(SRQueue<SRBaseSubtask*>) * _nNodes));
+  SRThreadCount prevLim = 0;
+  for (SRNumaNode i = 0; i < _nNodes; i++) {
+    const uint64_t proportional = (nodeProcLims[i] * _nWorkers + (nodeProcLims.back() >> 1)) / nodeProcLims.back();
+    const SRThreadCount curLim = std::min<SRThreadCount>(_nWorkers - (_nNodes - 1 - i),
+      std::max<SRThreadCount>(prevLim + 1, static_cast<SRThreadCount>(proportional)));
+    _pNodeWorkerLims[i] = curLim;
+    _pRd->_pNodeAffinities[i] = affinities[i];
+    new(_pNodeQus + i) SRQueue<SRBaseSubtask*>(SRMath::CeilLog2(curLim - prevLim));
+    prevLim = curLim;
+  }
+  assert(prevLim == _nWorkers);
+}
+
 void SRThreadPool::LaunchThreads() {
   assert(!_shutdownRequested);
+  _pRd->_nLaunched.store(0, std::memory_order_relaxed);
   for (size_t i = 0; i < _nWorkers; i++) {
     // Use WinAPI threads in order to be able to set the stack size
     HANDLE hThread = CreateThread(nullptr, _stackSize, &RareData::PlatformEntry, this, 0, nullptr);
@@ -130,18 +176,32 @@ bool SRThreadPool::RunCriticalCallback(SRException &&ex) {
 #define DECIDE_CCB(exVar) if(RunCriticalCallback(exVar)) { continue; } else { break; }
 
 void SRThreadPool::WorkerEntry() {
+  SRQueue<SRBaseSubtask*> *pNodeQu = nullptr;
+  if (_pNodeQus != nullptr) {
+    const SRThreadCount iWorker = _pRd->_nLaunched.fetch_add(1, std::memory_order_relaxed);
+    SRNumaNode iNode = 0;
+    while (iWorker >= _pNodeWorkerLims[iNode]) {
+      iNode++;
+    }
+    pNodeQu = _pNodeQus + iNode;
+    if (!SetThreadGroupAffinity(GetCurrentThread(), _pRd->_pNodeAffinities + iNode, nullptr)) {
+      // The worker still runs the subtasks of its node, just without the guarantee of memory locality.
+      SR_LOG_WINFAIL_GLE(Warning, GetLogger());
+    }
+  }
   for (;;) {
     SRBaseTask *pTask = nullptr;
     SubtaskCompleter stc;
     try {
       SRLock<SRCriticalSection> csl(_cs);
-      while (_qu.Size() == 0) {
+      while (_qu.Size() == 0 && (pNodeQu == nullptr || pNodeQu->Size() == 0)) {
         if (_shutdownRequested) {
           return;
         }
         _haveWork.Wait(_cs);
       }
-      stc.Set(_qu.PopGet());
+      // Prefer the subtasks bound to the node of this worker.
+      stc.Set((pNodeQu != nullptr && pNodeQu->Size() != 0) ? pNodeQu->PopGet() : _qu.PopGet());
       pTask = stc.Get()->GetTask();
     }
     catch (SRException& ex) {
@@ -7,6 +7,7 @@
 namespace SRPlat {
 
 const __m256d SRVectMath::_cdOne256 = _mm256_set1_pd(1.0);
+const __m256 SRVectMath::_cfOne256 = _mm256_set1_ps(1.0f);
 const __m256d SRVectMath::_c2divLn2 = _mm256_set1_pd(2.8853900817779268147198493620038); // 2.0/ln(2)
 const __m256d SRVectMath::_cLog2Coeff1 = _mm256_set1_pd(1.0 / 3);
 const __m256d SRVectMath::_cLog2Coeff2 = _mm256_set1_pd(1.0 / 5);
@@ -34,4 +34,5 @@
 #include <string>
 #include <thread>
 #include <type_traits>
+#include <vector>
 #pragma warning( pop )
@@ -33,3 +33,35 @@ TEST(SRAccumVectDbl256, PairSum) {
   EXPECT_EQ(va2.GetFullSum(), 57600);
   EXPECT_EQ(va2.PreciseSum(), 57600);
 }
+
+TEST(SRAccumVectDbl512, PreciseSum) {
+  if (SRCpuInfo::GetInstructionSet() < SRInstructionSet::Avx512) {
+    std::cout << "Skipped: AVX-512 is not available." << std::endl;
+    return;
+  }
+  SRFastRandom fr;
+  for (int64_t iTrial = 0; iTrial < 100; iTrial++) {
+    SRAccumVectDbl512 va512, fellow512;
+    SRAccumVectDbl256 va256;
+    for (int64_t i = 0; i < 1000; i++) {
+      __m512d value;
+      for (int8_t j = 0; j <= 7; j++) {
+        // Positive numbers of magnitudes from 2**-32 to 2**32, so that the small ones are lost without compensation.
+        const double mant = 1 + (fr.Generate<uint64_t>() >> 11) * (1.0 / (uint64_t(1) << 53));
+        value.m512d_f64[j] = std::ldexp(mant, int(fr.Generate<uint64_t>() % 65) - 32);
+      }
+      va512.Add(value);
+      fellow512.Add(_mm512_add_pd(value, value));
+      va256.Add(_mm512_castpd512_pd256(value));
+      va256.Add(_mm512_extractf64x4_pd(value, 1));
+    }
+    const double expected = va256.PreciseSum();
+    const double actual = va512.PreciseSum();
+    EXPECT_NEAR(expected, actual, expected * 1e-15);
+    // Doubling all the summands doubles exactly each step of the summation.
+    double fellowSum;
+    const double pairSum = va512.PairSum(fellow512, fellowSum);
+    EXPECT_NEAR(actual, pairSum, actual * 1e-15);
+    EXPECT_EQ(2 * pairSum, fellowSum);
+  }
+}
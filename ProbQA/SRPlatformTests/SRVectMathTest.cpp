@@ -101,4 +101,35 @@ TEST(SRVectMathTest, Log2Hot) {
       EXPECT_NEAR(expected, actual.m256d_f64[j], absErr);
     }
   }
-}
\ No newline at end of file
+}
+TEST(SRVectMathTest, Log2Hot512) {
+  if (SRCpuInfo::GetInstructionSet() < SRInstructionSet::Avx512) {
+    std::cout << "Skipped: AVX-512 is not available." << std::endl;
+    return;
+  }
+  SRFastRandom fr;
+  std::vector<double> nums = { 0, 1, 0.5, 2, SRCast::F64FromU64(1), SRCast::F64FromU64(0x000FFFFFFFFFFFFFull),
+    SRCast::F64FromU64(0x0008000000000000ull), SRCast::F64FromU64(0x0010000000000000ull), 1e-300, 1e300,
+    SRCast::F64FromU64(0x7FEFFFFFFFFFFFFFull), 0.999, 1.001 };
+  for (int64_t i = 0; i < 1000 * 1000; i++) {
+    // Any non-negative finite number, including zeros and denormals.
+    uint64_t bits = fr.Generate<uint64_t>() >> 1;
+    if ((bits >> SRNumTraits<double>::_cExponentOffs) == 0x7FF) {
+      bits ^= uint64_t(1) << (SRNumTraits<double>::_cExponentOffs + 10);
+    }
+    nums.push_back(SRCast::F64FromU64(bits));
+  }
+  while ((nums.size() & 7) != 0) {
+    nums.push_back(0);
+  }
+  for (size_t i = 0; i < nums.size(); i += 8) {
+    const __m512d x = _mm512_loadu_pd(nums.data() + i);
+    const __m512d actual = SRVectMath::Log2Hot512(x);
+    const __m256d expectedLo = SRVectMath::Log2Hot(_mm512_castpd512_pd256(x));
+    const __m256d expectedHi = SRVectMath::Log2Hot(_mm512_extractf64x4_pd(x, 1));
+    for (int8_t j = 0; j <= 3; j++) {
+      EXPECT_EQ(expectedLo.m256d_f64[j], actual.m512d_f64[j]) << "x=" << nums[i + j];
+      EXPECT_EQ(expectedHi.m256d_f64[j], actual.m512d_f64[j + 4]) << "x=" << nums[i + j + 4];
+    }
+  }
+}
@@ -38,9 +38,11 @@
 
 // SRPlatform library includes
 #include "../SRPlatform/Interface/SRAccumVectDbl256.h"
+#include "../SRPlatform/Interface/SRAccumVectDbl512.h"
 #include "../SRPlatform/Interface/SRBitArray.h"
 #include "../SRPlatform/Interface/SRBucketSummatorPar.h"
 #include "../SRPlatform/Interface/SRBucketSummatorSeq.h"
+#include "../SRPlatform/Interface/SRCpuInfo.h"
 #include "../SRPlatform/Interface/SRFastRandom.h"
 #include "../SRPlatform/Interface/SRHeap.h"
 #include "../SRPlatform/Interface/SRQueue.h"